@@ -41,6 +41,11 @@
 #include <sys/ioctl.h>
 
 #include "lib_efuse.h"
+#include "lib_efuse_metrics.h"
+#include "lib_efuse_journal.h"
+#include "lib_efuse_owner.h"
+#include "lib_efuse_board.h"
+#include "lib_efuse_label.h"
 
 //------------------------------------------------------------------------------
 // Debug msg
@@ -51,251 +56,1172 @@
     #define dbg_msg(fmt, args...)
 #endif
 
+struct io_guard;
+
+//------------------------------------------------------------------------------
+// Device context. board 설정과 device path를 context 단위로 관리.
+//------------------------------------------------------------------------------
+struct efuse_ctx {
+    int         board_id;
+
+    // device I/O backend (default : efuse_io_kernel)
+    const struct efuse_io *io;
+
+    char        rw_control  [PATH_MAX];
+    char        rw_file     [PATH_MAX];
+
+    const char  *mac_start_str;
+    int         mac_start_addr;     // mac_start_str의 4번째 byte (0x001E06xx)
+    int         mac_block_cnt;
+    int         mac_rw_offset;
+    int         size_byte;
+    int         mac_offset;
+
+    // session (efuse_ctx_begin ~ efuse_ctx_end) 동안 유지되는 descriptor
+    int         sess_active;
+    int         sess_write;
+    int         sess_ctl_fd;
+    int         sess_file_fd;
+
+    // deadline / retry (efuse_ctx_set_retry)
+    struct efuse_retry retry;
+    struct io_guard *guard;         // timeout 설정시 ctx->io = &guard->io
+    long long   deadline_ns;        // CLOCK_MONOTONIC, 0 = 무제한
+    int         op_depth;
+    int         cleanup;            // lock 복구중 (cancel/deadline 무시)
+    int         cancel;
+    int         last_error;
+
+    // intent journal (efuse_ctx_set_journal), journal_id = 진행중인 operation
+    struct efuse_journal *journal;
+    unsigned long long journal_id;
+
+    // device owner (efuse_ctx_set_owner), write session/write 동안 유지
+    struct efuse_owner *owner;
+    struct efuse_owner_lock owner_lock;
+    int         owner_depth;
+
+    // mac label print queue (efuse_ctx_set_label), write/verify 완료시 추가
+    struct efuse_label *label;
+};
+
+// 기존 API(efuse_set_board, efuse_control...)가 사용하는 default context.
+static struct efuse_ctx DefaultCtx = { .sess_ctl_fd = -1, .sess_file_fd = -1,
+                                       .owner_lock = { .slot = -1 } };
+
+//------------------------------------------------------------------------------
+// Kernel I/O backend (sysfs, /dev node 직접 access)
+//------------------------------------------------------------------------------
+static int io_kernel_access (void *priv, const char *path)
+{
+    (void)priv;
+    return access (path, F_OK);
+}
+
+static int io_kernel_open (void *priv, const char *path, int flags)
+{
+    (void)priv;
+    return open (path, flags);
+}
+
+static int io_kernel_close (void *priv, int fd)
+{
+    (void)priv;
+    return close (fd);
+}
+
+static ssize_t io_kernel_pread (void *priv, int fd, void *buf, size_t size, off_t offset)
+{
+    (void)priv;
+    return pread (fd, buf, size, offset);
+}
+
+static ssize_t io_kernel_pwrite (void *priv, int fd, const void *buf, size_t size, off_t offset)
+{
+    (void)priv;
+    return pwrite (fd, buf, size, offset);
+}
+
+static int io_kernel_ioctl (void *priv, int fd, unsigned long request, void *arg)
+{
+    (void)priv;
+    return ioctl (fd, request, arg);
+}
+
+static int io_kernel_fdatasync (void *priv, int fd)
+{
+    (void)priv;
+    return fdatasync (fd);
+}
+
+const struct efuse_io efuse_io_kernel = {
+    .name   = "kernel",
+    .priv   = NULL,
+    .access = io_kernel_access,
+    .open   = io_kernel_open,
+    .close  = io_kernel_close,
+    .pread  = io_kernel_pread,
+    .pwrite = io_kernel_pwrite,
+    .ioctl  = io_kernel_ioctl,
+    .fdatasync = io_kernel_fdatasync,
+};
+
+//------------------------------------------------------------------------------
+// Deadline guard I/O backend (efuse_ctx_set_retry, timeout_ms > 0).
+// device 요청을 context별 I/O thread에서 실행하고 호출 thread는 deadline까지만 대기.
+// 멈춘 syscall은 중단할 수 없으므로 timeout된 요청은 I/O thread에 남겨두고
+// (abandoned) 끝날 때까지 다음 요청은 eEFUSE_ERR_BUSY. 요청 data는 guard buffer를
+// 사용하므로 timeout 후 호출자의 buffer는 바로 해제 가능.
+//------------------------------------------------------------------------------
+#define GUARD_BUF_SIZE  256
+
+enum { eGUARD_PREAD = 0, eGUARD_PWRITE, eGUARD_IOCTL, eGUARD_SYNC };
+
+struct io_guard {
+    struct efuse_io         io;         // priv = guard
+    const struct efuse_io   *inner;     // 실제 backend
+    efuse_ctx               *ctx;
+
+    pthread_t               thread;
+    pthread_mutex_t         mutex;
+    pthread_cond_t          cond_req;
+    pthread_cond_t          cond_done;
+
+    int     ready;      // I/O thread가 처리할 요청 있음
+    int     pending;    // 요청 처리중 (abandoned 요청은 끝날 때까지 유지)
+    int     done;
+    int     abandoned;  // 호출자가 timeout/cancel로 먼저 return
+    int     quit;
+    int     orphan;     // ctx close시 요청이 끝나지 않음, I/O thread가 guard 해제
+    int     close_fd;   // abandoned 요청이 사용중인 fd, 요청이 끝난 후 close
+
+    int     op, fd, err;
+    unsigned long request;
+    size_t  size;
+    off_t   offset;
+    long    ret;
+    unsigned char buf [GUARD_BUF_SIZE];
+};
+
+//------------------------------------------------------------------------------
+static long long mono_ns (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+//------------------------------------------------------------------------------
+// 첫번째 error만 기록 (이후 lock 복구 등의 error로 원인이 덮어써지지 않도록).
+//------------------------------------------------------------------------------
+static void ctx_error (const efuse_ctx *ctx, int error)
+{
+    efuse_ctx *c = (efuse_ctx *)ctx;
+
+    if (c->last_error == eEFUSE_OK)
+        c->last_error = error;
+}
+
+//------------------------------------------------------------------------------
+static void *guard_thread (void *arg)
+{
+    struct io_guard *g = (struct io_guard *)arg;
+    const struct efuse_io *io;
+    long ret = -1;
+    int orphan, err, close_fd;
+
+    pthread_mutex_lock (&g->mutex);
+    while (1) {
+        while (!g->ready && !g->quit)
+            pthread_cond_wait (&g->cond_req, &g->mutex);
+        if (!g->ready)
+            break;
+        g->ready = 0;
+        io = g->inner;
+        pthread_mutex_unlock (&g->mutex);
+
+        errno = 0;
+        switch (g->op) {
+            case eGUARD_PREAD:
+                ret = io->pread  (io->priv, g->fd, g->buf, g->size, g->offset);
+                break;
+            case eGUARD_PWRITE:
+                ret = io->pwrite (io->priv, g->fd, g->buf, g->size, g->offset);
+                break;
+            case eGUARD_IOCTL:
+                ret = io->ioctl  (io->priv, g->fd, g->request, g->buf);
+                break;
+            case eGUARD_SYNC:
+                ret = io->fdatasync (io->priv, g->fd);
+                break;
+        }
+        err = errno;
+
+        pthread_mutex_lock (&g->mutex);
+        close_fd = g->close_fd ? g->fd : -1;
+        g->close_fd = 0;
+        pthread_mutex_unlock (&g->mutex);
+        if (close_fd >= 0)
+            io->close (io->priv, close_fd);
+
+        pthread_mutex_lock (&g->mutex);
+        g->ret  = ret;
+        g->err  = err;
+        g->done = 1;
+        if (g->abandoned) {
+            g->abandoned = 0;
+            g->pending   = 0;
+        }
+        pthread_cond_broadcast (&g->cond_done);
+    }
+    orphan = g->orphan;
+    pthread_mutex_unlock (&g->mutex);
+
+    if (orphan) {
+        pthread_cond_destroy  (&g->cond_req);
+        pthread_cond_destroy  (&g->cond_done);
+        pthread_mutex_destroy (&g->mutex);
+        free (g);
+    }
+    return NULL;
+}
+
+//------------------------------------------------------------------------------
+// I/O thread에 요청 후 deadline까지 대기.
+// ctx->cleanup (lock 복구) 중에는 cancel을 무시하고 timeout_ms 만큼 새로 대기하며,
+// I/O thread가 이전 요청에 멈춰있으면 호출 thread에서 직접 실행 (force_ro는 별도 file).
+//------------------------------------------------------------------------------
+static long guard_call (struct io_guard *g, int op, int fd, unsigned long request,
+                        void *buf, size_t size, off_t offset)
+{
+    efuse_ctx *ctx = g->ctx;
+    const struct efuse_io *io;
+    long long deadline;
+    struct timespec ts;
+    int error = eEFUSE_OK;
+    long ret;
+
+    deadline = ctx->cleanup ? mono_ns () + ctx->retry.timeout_ms * 1000000LL : ctx->deadline_ns;
+
+    pthread_mutex_lock (&g->mutex);
+    if (g->pending && ctx->cleanup && (op == eGUARD_PWRITE)) {
+        io = g->inner;
+        pthread_mutex_unlock (&g->mutex);
+        return io->pwrite (io->priv, fd, buf, size, offset);
+    }
+    if (g->pending)
+        error = eEFUSE_ERR_BUSY;
+    else if (!ctx->cleanup && __atomic_load_n (&ctx->cancel, __ATOMIC_ACQUIRE))
+        error = eEFUSE_ERR_CANCELED;
+    else if (deadline && (mono_ns () >= deadline))
+        error = eEFUSE_ERR_TIMEOUT;
+
+    if (error == eEFUSE_OK) {
+        g->op      = op;
+        g->fd      = fd;
+        g->request = request;
+        g->size    = size;
+        g->offset  = offset;
+        if ((op == eGUARD_PWRITE) || (op == eGUARD_IOCTL))
+            memcpy (g->buf, buf, size);
+
+        g->pending = 1;
+        g->done    = 0;
+        g->ready   = 1;
+        pthread_cond_signal (&g->cond_req);
+
+        ts.tv_sec  = deadline / 1000000000LL;
+        ts.tv_nsec = deadline % 1000000000LL;
+        while (!g->done) {
+            if (!ctx->cleanup && __atomic_load_n (&ctx->cancel, __ATOMIC_ACQUIRE)) {
+                error = eEFUSE_ERR_CANCELED;
+                break;
+            }
+            if (!deadline)
+                pthread_cond_wait (&g->cond_done, &g->mutex);
+            else if ((pthread_cond_timedwait (&g->cond_done, &g->mutex, &ts) == ETIMEDOUT) &&
+                     !g->done) {
+                error = eEFUSE_ERR_TIMEOUT;
+                break;
+            }
+        }
+        if (error != eEFUSE_OK)
+            g->abandoned = 1;
+    }
+    if (error != eEFUSE_OK) {
+        pthread_mutex_unlock (&g->mutex);
+        ctx_error (ctx, error);
+        errno = (error == eEFUSE_ERR_BUSY)     ? EBUSY :
+                (error == eEFUSE_ERR_CANCELED) ? ECANCELED : ETIMEDOUT;
+        return -1;
+    }
+
+    ret = g->ret;
+    if ((ret > 0) && (op == eGUARD_PREAD))
+        memcpy (buf, g->buf, ret);
+    if ((ret >= 0) && (op == eGUARD_IOCTL))
+        memcpy (buf, g->buf, size);
+    g->pending = 0;
+    errno = g->err;
+    pthread_mutex_unlock (&g->mutex);
+    return ret;
+}
+
+//------------------------------------------------------------------------------
+// access/open/close는 device 상태와 무관하게 끝나므로 I/O thread를 거치지 않음.
+//------------------------------------------------------------------------------
+static int io_guard_access (void *priv, const char *path)
+{
+    const struct efuse_io *io = ((struct io_guard *)priv)->inner;
+
+    return io->access (io->priv, path);
+}
+
+static int io_guard_open (void *priv, const char *path, int flags)
+{
+    const struct efuse_io *io = ((struct io_guard *)priv)->inner;
+
+    return io->open (io->priv, path, flags);
+}
+
+// abandoned 요청이 사용중인 fd는 요청이 끝난 후 I/O thread에서 close (fd 재사용 방지).
+static int io_guard_close (void *priv, int fd)
+{
+    struct io_guard *g = (struct io_guard *)priv;
+    const struct efuse_io *io;
+
+    pthread_mutex_lock (&g->mutex);
+    if (g->pending && (g->fd == fd)) {
+        g->close_fd = 1;
+        pthread_mutex_unlock (&g->mutex);
+        return 0;
+    }
+    io = g->inner;
+    pthread_mutex_unlock (&g->mutex);
+    return io->close (io->priv, fd);
+}
+
+static ssize_t io_guard_pread (void *priv, int fd, void *buf, size_t size, off_t offset)
+{
+    struct io_guard *g = (struct io_guard *)priv;
+
+    if (size > GUARD_BUF_SIZE)
+        return g->inner->pread (g->inner->priv, fd, buf, size, offset);
+    return guard_call (g, eGUARD_PREAD, fd, 0, buf, size, offset);
+}
+
+static ssize_t io_guard_pwrite (void *priv, int fd, const void *buf, size_t size, off_t offset)
+{
+    struct io_guard *g = (struct io_guard *)priv;
+
+    if (size > GUARD_BUF_SIZE)
+        return g->inner->pwrite (g->inner->priv, fd, buf, size, offset);
+    return guard_call (g, eGUARD_PWRITE, fd, 0, (void *)buf, size, offset);
+}
+
+static int io_guard_ioctl (void *priv, int fd, unsigned long request, void *arg)
+{
+    struct io_guard *g = (struct io_guard *)priv;
+
+    // request별 arg 크기를 알 수 있는 efuse ioctl만 I/O thread에서 실행.
+    switch (request) {
+        case IOC_WRITE: case IOC_ERASE:
+            return guard_call (g, eGUARD_IOCTL, fd, request, arg, sizeof(struct ioc_data), 0);
+        case IOC_DUMP:
+            return guard_call (g, eGUARD_IOCTL, fd, request, arg, sizeof(struct ioc_dump_data), 0);
+        default :
+            return g->inner->ioctl (g->inner->priv, fd, request, arg);
+    }
+}
+
+static int io_guard_fdatasync (void *priv, int fd)
+{
+    return guard_call ((struct io_guard *)priv, eGUARD_SYNC, fd, 0, NULL, 0, 0);
+}
+
+//------------------------------------------------------------------------------
+static struct io_guard *guard_create (efuse_ctx *ctx)
+{
+    struct io_guard *g = calloc (1, sizeof(struct io_guard));
+    pthread_condattr_t attr;
+
+    if (g == NULL)
+        return NULL;
+
+    g->ctx   = ctx;
+    g->inner = ctx->io;
+
+    g->io.name   = ctx->io->name;
+    g->io.priv   = g;
+    g->io.access = io_guard_access;
+    g->io.open   = io_guard_open;
+    g->io.close  = io_guard_close;
+    g->io.pread  = io_guard_pread;
+    g->io.pwrite = io_guard_pwrite;
+    g->io.ioctl  = io_guard_ioctl;
+    g->io.fdatasync = io_guard_fdatasync;
+
+    pthread_condattr_init (&attr);
+    pthread_condattr_setclock (&attr, CLOCK_MONOTONIC);
+    pthread_mutex_init (&g->mutex, NULL);
+    pthread_cond_init  (&g->cond_req,  NULL);
+    pthread_cond_init  (&g->cond_done, &attr);
+    pthread_condattr_destroy (&attr);
+
+    if (pthread_create (&g->thread, NULL, guard_thread, g)) {
+        pthread_cond_destroy  (&g->cond_req);
+        pthread_cond_destroy  (&g->cond_done);
+        pthread_mutex_destroy (&g->mutex);
+        free (g);
+        return NULL;
+    }
+    return g;
+}
+
+//------------------------------------------------------------------------------
+// 끝나지 않은 요청이 있으면 기다리지 않고 I/O thread가 종료시 guard를 해제.
 //------------------------------------------------------------------------------
-static char *eFuseRWControl = NULL;
-static char *eFuseRWFile    = NULL;
+static void guard_destroy (struct io_guard *g)
+{
+    pthread_mutex_lock (&g->mutex);
+    g->quit = 1;
+    if (g->pending) {
+        g->orphan = 1;
+        pthread_mutex_unlock (&g->mutex);
+        pthread_detach (g->thread);
+        return;
+    }
+    pthread_cond_signal (&g->cond_req);
+    pthread_mutex_unlock (&g->mutex);
+
+    pthread_join (g->thread, NULL);
+    pthread_cond_destroy  (&g->cond_req);
+    pthread_cond_destroy  (&g->cond_done);
+    pthread_mutex_destroy (&g->mutex);
+    free (g);
+}
+
+//------------------------------------------------------------------------------
+// function prototype
+//------------------------------------------------------------------------------
+static const struct efuse_board *ctx_board (const efuse_ctx *ctx);
+static int  ctx_dev_type        (const efuse_ctx *ctx);
+static int  ctx_fd_get          (const efuse_ctx *ctx, int control, int flags);
+static void ctx_fd_put          (const efuse_ctx *ctx, int fd);
+static int  efuse_lock          (const efuse_ctx *ctx, char lock);
+static int  efuse_protect       (const efuse_ctx *ctx, char lock);
+static int  efuse_ctx_set_board (efuse_ctx *ctx, int board_id);
+static unsigned char cksum      (const char *data);
+static int  efuse_write_ioctl   (const efuse_ctx *ctx, const struct efuse_uuid *uuid, char control);
+static int  ctx_aborted         (const efuse_ctx *ctx);
+static int  ctx_control_once    (efuse_ctx *ctx, char *efuse_data, char control);
+static void ctx_op_begin        (efuse_ctx *ctx);
+static int  ctx_op_end          (efuse_ctx *ctx, int ret);
+static int  ctx_backoff         (efuse_ctx *ctx, int ms);
+static int  ctx_op_check        (efuse_ctx *ctx);
+static int  ctx_retry           (efuse_ctx *ctx, int *retry, int *backoff);
+static int  ctx_begin_retry     (efuse_ctx *ctx, int write);
+static int  ctx_write_verify    (efuse_ctx *ctx, const char *efuse_data, char *read_data);
+static int  ctx_journal_begin   (efuse_ctx *ctx, int op, const char *efuse_data);
+static void ctx_journal_state   (efuse_ctx *ctx, int state, int end);
+static int  ctx_owner_error     (int err);
+
+efuse_ctx  *efuse_ctx_open      (int board_id);
+void        efuse_ctx_close     (efuse_ctx *ctx);
+int         efuse_ctx_set_path  (efuse_ctx *ctx, const char *rw_control, const char *rw_file);
+int         efuse_ctx_set_offset(efuse_ctx *ctx, int rw_offset);
+int         efuse_ctx_get_offset(const efuse_ctx *ctx);
+int         efuse_ctx_get_path  (const efuse_ctx *ctx, const char **rw_control, const char **rw_file);
+int         efuse_ctx_set_io    (efuse_ctx *ctx, const struct efuse_io *io);
+const struct efuse_io *efuse_ctx_get_io (const efuse_ctx *ctx);
+const struct efuse_io *efuse_ctx_get_backend (const efuse_ctx *ctx);
+int         efuse_ctx_get_board (const efuse_ctx *ctx);
+int         efuse_ctx_valid_check (const efuse_ctx *ctx, const char *efuse_data);
+void        efuse_ctx_get_mac   (const efuse_ctx *ctx, const char *efuse_data, char *mac);
+int         efuse_ctx_control   (efuse_ctx *ctx, char *efuse_data, char control);
+int         efuse_ctx_slot_scan (efuse_ctx *ctx, struct efuse_slot_info *info);
+int         efuse_ctx_begin     (efuse_ctx *ctx, int write);
+int         efuse_ctx_end       (efuse_ctx *ctx);
+int         efuse_ctx_write_verify (efuse_ctx *ctx, const char *efuse_data, char *read_data);
+int         efuse_ctx_set_retry (efuse_ctx *ctx, const struct efuse_retry *retry);
+int         efuse_ctx_set_journal (efuse_ctx *ctx, struct efuse_journal *journal);
+struct efuse_journal *efuse_ctx_get_journal (const efuse_ctx *ctx);
+int         efuse_ctx_set_owner (efuse_ctx *ctx, struct efuse_owner *owner);
+struct efuse_owner *efuse_ctx_get_owner (const efuse_ctx *ctx);
+int         efuse_ctx_set_label (efuse_ctx *ctx, struct efuse_label *label);
+struct efuse_label *efuse_ctx_get_label (const efuse_ctx *ctx);
+int         efuse_ctx_owner_get (efuse_ctx *ctx, int wait);
+void        efuse_ctx_owner_put (efuse_ctx *ctx);
+void        efuse_ctx_cancel    (efuse_ctx *ctx, int cancel);
+int         efuse_ctx_last_error(const efuse_ctx *ctx);
+const char *efuse_strerror      (int error);
+int         efuse_get_mac_range (int board_id, unsigned long long *mac_start, int *mac_cnt);
+
+int  efuse_set_board    (int board_id);
+int  efuse_get_board    (void);
+int  efuse_set_journal  (struct efuse_journal *journal);
+int  efuse_set_owner    (struct efuse_owner *owner);
+int  efuse_set_label    (struct efuse_label *label);
+efuse_ctx *efuse_get_ctx (void);
+
+int  efuse_valid_check  (const char *efuse_data);
+void efuse_get_mac      (const char *efuse_data, char *mac);
+int  efuse_control      (char *efuse_data, char control);
+
+//------------------------------------------------------------------------------
+// 문자열 변경 함수. 입력 포인터는 반드시 메모리가 할당되어진 변수여야 함.
+//------------------------------------------------------------------------------
+#if 0
+static void tolowerstr (char *p);
+static void tolowerstr (char *p)
+{
+    int i, c = strlen(p);
+
+    for (i = 0; i < c; i++, p++)
+        *p = tolower(*p);
+}
+#endif
+//------------------------------------------------------------------------------
+static void toupperstr (char *p);
+static void toupperstr (char *p)
+{
+    for (; *p; p++)
+        *p = toupper(*p);
+}
+
+//------------------------------------------------------------------------------
+// board descriptor (lib_efuse_board.c). board_id는 항상 table 범위 안.
+//------------------------------------------------------------------------------
+static const struct efuse_board *ctx_board (const efuse_ctx *ctx)
+{
+    return efuse_board_info (ctx->board_id);
+}
+
+static int ctx_dev_type (const efuse_ctx *ctx)
+{
+    return ctx_board (ctx)->dev_type;
+}
+
+//------------------------------------------------------------------------------
+// session이 열려있으면 session descriptor를 사용, 아니면 새로 open.
+// write가 필요한 경우 write session의 descriptor만 사용.
+//------------------------------------------------------------------------------
+static int ctx_fd_get (const efuse_ctx *ctx, int control, int flags)
+{
+    int fd = control ? ctx->sess_ctl_fd : ctx->sess_file_fd;
+
+    if (ctx->sess_active && (fd >= 0) &&
+        (ctx->sess_write || ((flags & O_ACCMODE) == O_RDONLY)))
+        return fd;
+
+    return ctx->io->open (ctx->io->priv, control ? ctx->rw_control : ctx->rw_file, flags);
+}
+
+//------------------------------------------------------------------------------
+static void ctx_fd_put (const efuse_ctx *ctx, int fd)
+{
+    if (ctx->sess_active && ((fd == ctx->sess_ctl_fd) || (fd == ctx->sess_file_fd)))
+        return;
+    ctx->io->close (ctx->io->priv, fd);
+}
+
+//------------------------------------------------------------------------------
+// lock 복구(EFUSE_LOCK)는 deadline이 지났거나 cancel 된 경우에도 시도.
+//------------------------------------------------------------------------------
+static int efuse_lock (const efuse_ctx *ctx, char lock)
+{
+    long long t0 = efuse_metrics_now ();
+    int fd = 0, ret = 1;
+
+    if ((fd = ctx_fd_get (ctx, 1, O_WRONLY)) < 0) {
+        dbg_msg ("error, file write mode open (%s)\n", ctx->rw_control);
+        ctx_error (ctx, eEFUSE_ERR_NODEV);
+        efuse_metrics_add (ctx->board_id, eMETRIC_LOCK, t0);
+        return 0;
+    }
+    ((efuse_ctx *)ctx)->cleanup = (lock == EFUSE_LOCK);
+    if (ctx->io->pwrite (ctx->io->priv, fd, lock ? "1" : "0", 1, 0) != 1) {
+        dbg_msg ("error, write size different.\n");
+        ctx_error (ctx, eEFUSE_ERR_LOCK);
+        ret = 0;
+    }
+    ((efuse_ctx *)ctx)->cleanup = 0;
+    ctx_fd_put (ctx, fd);
+    efuse_metrics_add (ctx->board_id, eMETRIC_LOCK, t0);
+    return ret;
+}
+
+//------------------------------------------------------------------------------
+// emmc hidden partition protect (m1s, m2). write session 중에는 session이 관리.
+//------------------------------------------------------------------------------
+static int efuse_protect (const efuse_ctx *ctx, char lock)
+{
+    if (ctx_dev_type (ctx) != eBOARD_DEV_EMMC)
+        return 1;
+    if (ctx->sess_active && ctx->sess_write)
+        return 1;
+    return efuse_lock (ctx, lock);
+}
+
+//------------------------------------------------------------------------------
+// session 시작. device descriptor를 한번만 open 하고, write session인 경우
+// efuse_ctx_end() 까지 emmc hidden partition을 unlock 상태로 유지.
+//------------------------------------------------------------------------------
+int efuse_ctx_begin (efuse_ctx *ctx, int write)
+{
+    int ioctl_dev = (ctx_dev_type (ctx) == eBOARD_DEV_IOCTL);
+    int emmc_dev  = (ctx_dev_type (ctx) == eBOARD_DEV_EMMC);
+
+    if (!ctx->op_depth)
+        ctx->last_error = eEFUSE_OK;
+    if (ctx->sess_active) {
+        dbg_msg ("error, efuse session already active.\n");
+        ctx_error (ctx, eEFUSE_ERR_PARAM);
+        return 0;
+    }
+    // write session은 efuse_ctx_end() 까지 device owner 유지
+    if (write && !efuse_ctx_owner_get (ctx, 1))
+        return 0;
+    ctx->sess_ctl_fd  = -1;
+    ctx->sess_file_fd = ctx->io->open (ctx->io->priv, ctx->rw_file,
+                            (write && !ioctl_dev) ? O_RDWR : O_RDONLY);
+    if (ctx->sess_file_fd < 0) {
+        dbg_msg ("error, file open (%s)\n", ctx->rw_file);
+        ctx_error (ctx, eEFUSE_ERR_NODEV);
+        if (write)
+            efuse_ctx_owner_put (ctx);
+        return 0;
+    }
+    if (write && (ioctl_dev || emmc_dev)) {
+        ctx->sess_ctl_fd = ctx->io->open (ctx->io->priv, ctx->rw_control,
+                                ioctl_dev ? O_RDWR : O_WRONLY);
+        if (ctx->sess_ctl_fd < 0) {
+            dbg_msg ("error, file open (%s)\n", ctx->rw_control);
+            ctx_error (ctx, eEFUSE_ERR_NODEV);
+            ctx->io->close (ctx->io->priv, ctx->sess_file_fd);
+            efuse_ctx_owner_put (ctx);
+            return 0;
+        }
+    }
+    ctx->sess_active = 1;
+    ctx->sess_write  = write ? 1 : 0;
+
+    if (write && emmc_dev && !efuse_lock (ctx, EFUSE_UNLOCK)) {
+        // unlock write가 일부 적용되었을 수 있으므로 lock 복구 후 종료.
+        efuse_ctx_end (ctx);
+        return 0;
+    }
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+// session 종료. emmc hidden partition은 항상 lock 상태로 복구.
+// return : 0 = lock 복구 실패
+//------------------------------------------------------------------------------
+int efuse_ctx_end (efuse_ctx *ctx)
+{
+    int ret = 1;
+
+    if (!ctx->sess_active)
+        return 1;
+
+    if ((ctx->sess_ctl_fd >= 0) && (ctx_dev_type (ctx) == eBOARD_DEV_EMMC))
+        ret = efuse_lock (ctx, EFUSE_LOCK);
+
+    if (ctx->sess_ctl_fd >= 0)
+        ctx->io->close (ctx->io->priv, ctx->sess_ctl_fd);
+    ctx->io->close (ctx->io->priv, ctx->sess_file_fd);
+    if (ctx->sess_write)
+        efuse_ctx_owner_put (ctx);
+
+    ctx->sess_active  = 0;
+    ctx->sess_write   = 0;
+    ctx->sess_ctl_fd  = -1;
+    ctx->sess_file_fd = -1;
+    return ret;
+}
+
+//------------------------------------------------------------------------------
+static int efuse_ctx_set_board (efuse_ctx *ctx, int board_id)
+{
+    // 알 수 없는 board는 m1 (기존 동작)
+    if (efuse_board_info (board_id) == NULL)
+        board_id = eBOARD_ID_M1;
+
+    ctx->board_id       = board_id;
+    ctx->mac_start_str  = ctx_board (ctx)->mac_start_str;
+    ctx->mac_block_cnt  = ctx_board (ctx)->mac_block_cnt;
+    ctx->mac_rw_offset  = ctx_board (ctx)->mac_rw_offset;
+    ctx->size_byte      = ctx_board (ctx)->size_byte;
+    ctx->mac_offset     = EFUSE_UUID_SIZE - MAC_STR_SIZE;
+    ctx->mac_start_addr = efuse_hex_byte (&ctx->mac_start_str[6]);
+    if (ctx->io == NULL)
+        ctx->io = &efuse_io_kernel;
+    return efuse_ctx_set_path (ctx, ctx_board (ctx)->rw_control, ctx_board (ctx)->rw_file);
+}
+
+//------------------------------------------------------------------------------
+// context 생성. board의 기본 device path/offset으로 초기화 됨.
+//------------------------------------------------------------------------------
+efuse_ctx *efuse_ctx_open (int board_id)
+{
+    efuse_ctx *ctx = calloc (1, sizeof(efuse_ctx));
+
+    if (ctx == NULL) {
+        dbg_msg ("error, efuse context alloc.\n");
+        return NULL;
+    }
+    ctx->sess_ctl_fd  = -1;
+    ctx->sess_file_fd = -1;
+    efuse_owner_lock_init (&ctx->owner_lock);
+    efuse_ctx_set_board (ctx, board_id);
+    return ctx;
+}
+
+//------------------------------------------------------------------------------
+void efuse_ctx_close (efuse_ctx *ctx)
+{
+    if (ctx == NULL)
+        return;
+
+    efuse_ctx_end (ctx);
+    if (ctx->guard != NULL) {
+        ctx->io = ctx->guard->inner;
+        guard_destroy (ctx->guard);
+        ctx->guard = NULL;
+    }
+    if (ctx != &DefaultCtx)
+        free (ctx);
+}
+
+//------------------------------------------------------------------------------
+// device path 변경 (여러 DUT가 연결된 경우, e.g. /dev/mmcblk1boot0).
+// NULL인 항목은 변경하지 않음.
+//------------------------------------------------------------------------------
+int efuse_ctx_set_path (efuse_ctx *ctx, const char *rw_control, const char *rw_file)
+{
+    if (rw_control != NULL) {
+        if ((strlen (rw_control) >= sizeof(ctx->rw_control)) || ctx->owner_depth)
+            return 0;
+        strcpy (ctx->rw_control, rw_control);
+        efuse_owner_lock_init (&ctx->owner_lock);
+    }
+    if (rw_file != NULL) {
+        if (strlen (rw_file) >= sizeof(ctx->rw_file))
+            return 0;
+        strcpy (ctx->rw_file, rw_file);
+    }
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+int efuse_ctx_get_path (const efuse_ctx *ctx, const char **rw_control, const char **rw_file)
+{
+    if (rw_control != NULL) *rw_control = ctx->rw_control;
+    if (rw_file    != NULL) *rw_file    = ctx->rw_file;
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+int efuse_ctx_set_offset (efuse_ctx *ctx, int rw_offset)
+{
+    if (rw_offset < 0)
+        return 0;
+    ctx->mac_rw_offset = rw_offset;
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+int efuse_ctx_get_offset (const efuse_ctx *ctx)
+{
+    return ctx->mac_rw_offset;
+}
+
+//------------------------------------------------------------------------------
+// I/O backend 변경. NULL이면 kernel backend 사용.
+//------------------------------------------------------------------------------
+int efuse_ctx_set_io (efuse_ctx *ctx, const struct efuse_io *io)
+{
+    if (io == NULL)
+        io = &efuse_io_kernel;
+
+    // guard 사용중이면 guard가 호출하는 backend만 변경.
+    if (ctx->guard != NULL) {
+        pthread_mutex_lock (&ctx->guard->mutex);
+        ctx->guard->inner = io;
+        pthread_mutex_unlock (&ctx->guard->mutex);
+    } else
+        ctx->io = io;
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+// 현재 device access에 사용되는 backend (timeout 설정시 guard backend).
+//------------------------------------------------------------------------------
+const struct efuse_io *efuse_ctx_get_io (const efuse_ctx *ctx)
+{
+    return ctx->io;
+}
+
+//------------------------------------------------------------------------------
+// guard 사용시 guard가 호출하는 backend (efuse_ctx_set_io로 설정한 backend).
+//------------------------------------------------------------------------------
+const struct efuse_io *efuse_ctx_get_backend (const efuse_ctx *ctx)
+{
+    const struct efuse_io *io;
+
+    if (ctx->guard == NULL)
+        return ctx->io;
+    pthread_mutex_lock (&ctx->guard->mutex);
+    io = ctx->guard->inner;
+    pthread_mutex_unlock (&ctx->guard->mutex);
+    return io;
+}
+
+//------------------------------------------------------------------------------
+// operation deadline/retry 설정. NULL이면 해제 (기존과 같이 무제한 대기, 재시도 없음).
+//------------------------------------------------------------------------------
+int efuse_ctx_set_retry (efuse_ctx *ctx, const struct efuse_retry *retry)
+{
+    struct efuse_retry r;
+
+    memset (&r, 0, sizeof(r));
+    if (retry != NULL) {
+        if ((retry->timeout_ms < 0) || (retry->retry_cnt < 0) ||
+            (retry->backoff_ms < 0) || (retry->backoff_max_ms < 0))
+            return 0;
+        r = *retry;
+    }
+    if (ctx->op_depth)
+        return 0;
+
+    if ((r.timeout_ms > 0) && (ctx->guard == NULL)) {
+        if ((ctx->guard = guard_create (ctx)) == NULL)
+            return 0;
+        ctx->io = &ctx->guard->io;
+    }
+    if ((r.timeout_ms == 0) && (ctx->guard != NULL)) {
+        ctx->io = ctx->guard->inner;
+        guard_destroy (ctx->guard);
+        ctx->guard = NULL;
+    }
+    ctx->retry = r;
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+// write/erase/write_verify의 intent journal 설정. NULL이면 사용하지 않음.
+// journal은 여러 ctx가 같이 사용할 수 있으며 ctx close시 close 하지 않음.
+//------------------------------------------------------------------------------
+int efuse_ctx_set_journal (efuse_ctx *ctx, struct efuse_journal *journal)
+{
+    if (ctx->op_depth)
+        return 0;
+    ctx->journal    = journal;
+    ctx->journal_id = 0;
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+struct efuse_journal *efuse_ctx_get_journal (const efuse_ctx *ctx)
+{
+    return ctx->journal;
+}
+
+//------------------------------------------------------------------------------
+// device owner table 설정. NULL이면 사용하지 않음 (기존 동작).
+// owner는 rw_control (force_ro, /dev/efuse) 단위로 관리.
+//------------------------------------------------------------------------------
+int efuse_ctx_set_owner (efuse_ctx *ctx, struct efuse_owner *owner)
+{
+    if (ctx->op_depth || ctx->owner_depth)
+        return 0;
+    ctx->owner = owner;
+    efuse_owner_lock_init (&ctx->owner_lock);
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+struct efuse_owner *efuse_ctx_get_owner (const efuse_ctx *ctx)
+{
+    return ctx->owner;
+}
+
+//------------------------------------------------------------------------------
+// mac label print queue 설정. NULL이면 label 출력 안함 (기존 동작).
+// efuse_ctx_write_verify()가 eEFUSE_WV_WRITTEN 인 경우에만 label 추가.
+//------------------------------------------------------------------------------
+int efuse_ctx_set_label (efuse_ctx *ctx, struct efuse_label *label)
+{
+    if (ctx->op_depth)
+        return 0;
+    ctx->label = label;
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+struct efuse_label *efuse_ctx_get_label (const efuse_ctx *ctx)
+{
+    return ctx->label;
+}
+
+//------------------------------------------------------------------------------
+static int ctx_owner_error (int err)
+{
+    switch (err) {
+        case ETIMEDOUT: return eEFUSE_ERR_TIMEOUT;
+        case ECANCELED: return eEFUSE_ERR_CANCELED;
+        default :       return eEFUSE_ERR_OWNER;
+    }
+}
+
+//------------------------------------------------------------------------------
+// device owner 획득 (중첩 가능, efuse_ctx_owner_put()과 같은 횟수 호출).
+// wait = 1 : 다른 owner가 끝날 때까지 순서대로 대기 (operation deadline, cancel 적용)
+// wait = 0 : 사용중이면 eEFUSE_ERR_OWNER로 바로 return
+//------------------------------------------------------------------------------
+int efuse_ctx_owner_get (efuse_ctx *ctx, int wait)
+{
+    int timeout_ms = wait ? -1 : 0;
+
+    if ((ctx->owner == NULL) || ctx->owner_depth++)
+        return 1;
+
+    if (wait && ctx->deadline_ns) {
+        long long left = ctx->deadline_ns - mono_ns ();
+
+        timeout_ms = (left > 0) ? (int)((left + 999999) / 1000000) : 0;
+    }
+    if (!efuse_owner_acquire (ctx->owner, &ctx->owner_lock, ctx->rw_control,
+                              timeout_ms, &ctx->cancel)) {
+        int err = (wait && (errno == EBUSY)) ? ETIMEDOUT : errno;
+
+        ctx->owner_depth--;
+        if (wait) {
+            dbg_msg ("error, device owner. (%s, %s)\n", ctx->rw_control, strerror (err));
+        }
+        ctx_error (ctx, ctx_owner_error (err));
+        return 0;
+    }
+    return 1;
+}
 
-static char *MAC_START_STR    = NULL;
-static int   MAC_BLOCK_CNT    = 0;
-static int   MAC_RW_OFFSET    = 0;
-static int   EFUSE_SIZE_BYTE  = 0;
-static int   EFUSE_BOARD_ID   = eBOARD_ID_M1;
-static int   EFUSE_MAC_OFFSET = 0;
+//------------------------------------------------------------------------------
+void efuse_ctx_owner_put (efuse_ctx *ctx)
+{
+    if ((ctx->owner == NULL) || !ctx->owner_depth)
+        return;
+    if (--ctx->owner_depth == 0)
+        efuse_owner_release (ctx->owner, &ctx->owner_lock);
+}
 
 //------------------------------------------------------------------------------
-// ODROID_M1
+// device write 전 intent 기록 (disk 기록 후 return). 다른 thread의 intent와
+// fdatasync를 같이 사용 (group commit). uuid 형식 error는 기록하지 않음.
+// return : 0 = journal 기록 실패 (device write 하지 않음)
 //------------------------------------------------------------------------------
-const char *M1_eFuseRWControl = "/dev/efuse";
-const char *M1_eFuseRWFile    = "/sys/class/efuse/uuid";
+static int ctx_journal_begin (efuse_ctx *ctx, int op, const char *efuse_data)
+{
+    struct efuse_uuid uuid;
+
+    if ((ctx->journal == NULL) || ctx->journal_id)
+        return 1;
+    if ((op != eJOURNAL_OP_ERASE) &&
+        ((efuse_data == NULL) || !efuse_uuid_parse (efuse_data, &uuid)))
+        return 1;
 
-const char *M1_MAC_START_STR = "001E0651"; // 65536개
-const int   M1_MAC_BLOCK_CNT = 2;          // 2개의 block reserved (13만개)
-const int   M1_MAC_RW_OFFSET = 0;
-const int   M1_EFUSE_SIZE_BYTE = EFUSE_UUID_SIZE;
+    ctx->journal_id = efuse_journal_intent (ctx->journal, op, ctx->board_id,
+                        (op == eJOURNAL_OP_ERASE) ? NULL : efuse_data, ctx->rw_file, 1);
+    if (!ctx->journal_id) {
+        dbg_msg ("error, journal intent write. (%s)\n", ctx->rw_file);
+        ctx_error (ctx, eEFUSE_ERR_JOURNAL);
+        return 0;
+    }
+    return 1;
+}
 
 //------------------------------------------------------------------------------
-// ODROID_M1S
+// 진행중인 operation 상태 기록 (disk 기록은 다음 sync). end = 1 이면 operation 종료.
 //------------------------------------------------------------------------------
-const char *M1S_eFuseRWControl = "/sys/class/block/mmcblk0boot0/force_ro";
-const char *M1S_eFuseRWFile    = "/dev/mmcblk0boot0";
-
-const char *M1S_MAC_START_STR = "001E0653"; // 65536개
-const int   M1S_MAC_BLOCK_CNT = 2;          // 2개의 block reserved (13만개)
-const int   M1S_MAC_RW_OFFSET = 0;
-const int   M1S_EFUSE_SIZE_BYTE = EFUSE_UUID_SIZE;
+static void ctx_journal_state (efuse_ctx *ctx, int state, int end)
+{
+    if (!ctx->journal_id)
+        return;
+    efuse_journal_state (ctx->journal, ctx->journal_id, state);
+    if (end)
+        ctx->journal_id = 0;
+}
 
 //------------------------------------------------------------------------------
-// ODROID_M2
+// 다른 thread에서 진행중인 operation 취소. cancel = 0 으로 해제할 때까지 유지.
+// 진행중인 device 요청은 기다리지 않음 (timeout 설정된 경우).
 //------------------------------------------------------------------------------
-const char *M2_eFuseRWControl = "/sys/class/block/mmcblk0boot1/force_ro";
-const char *M2_eFuseRWFile = "/dev/mmcblk0boot1";
-
-const char *M2_MAC_START_STR = "001E0655"; // 65536개
-const int   M2_MAC_BLOCK_CNT = 2;          // 2개의 block reserved (13만개)
-const int   M2_MAC_RW_OFFSET = (8191 * 512);
-const int   M2_EFUSE_SIZE_BYTE = EFUSE_UUID_SIZE;
+void efuse_ctx_cancel (efuse_ctx *ctx, int cancel)
+{
+    __atomic_store_n (&ctx->cancel, cancel ? 1 : 0, __ATOMIC_RELEASE);
+    if (cancel && (ctx->guard != NULL)) {
+        pthread_mutex_lock (&ctx->guard->mutex);
+        pthread_cond_broadcast (&ctx->guard->cond_done);
+        pthread_mutex_unlock (&ctx->guard->mutex);
+    }
+}
 
 //------------------------------------------------------------------------------
-// ODROID_C4 (2024/11/14, C4 Jig upgrade)
+// 마지막 operation의 실패 원인 (eEFUSE_OK = 성공)
 //------------------------------------------------------------------------------
-const char *C4_eFuseRWControl = "/dev/efuse";
-const char *C4_eFuseRWFile    = "/sys/class/efuse/uuid";
-
-/* 2024/11/14 Jig upgrade. */
-const char *C4_MAC_START_STR = "001E064A"; // 65536개
-const int   C4_MAC_BLOCK_CNT = 3;          // 3개의 block reserved (13만개)
-const int   C4_MAC_RW_OFFSET = 0;
-const int   C4_EFUSE_SIZE_BYTE = EFUSE_UUID_SIZE;
+int efuse_ctx_last_error (const efuse_ctx *ctx)
+{
+    return ctx->last_error;
+}
 
 //------------------------------------------------------------------------------
-// ODROID_C5
-//------------------------------------------------------------------------------
-const char *C5_eFuseRWControl = "/dev/efuse";
-const char *C5_eFuseRWFile    = "/sys/class/efuse/uuid";
+const char *efuse_strerror (int error)
+{
+    switch (error) {
+        case eEFUSE_OK:             return "success";
+        case eEFUSE_ERR_PARAM:      return "invalid parameter";
+        case eEFUSE_ERR_NODEV:      return "device not found";
+        case eEFUSE_ERR_IO:         return "device i/o";
+        case eEFUSE_ERR_LOCK:       return "partition lock";
+        case eEFUSE_ERR_NOSPACE:    return "no empty slot";
+        case eEFUSE_ERR_TIMEOUT:    return "timeout";
+        case eEFUSE_ERR_CANCELED:   return "canceled";
+        case eEFUSE_ERR_BUSY:       return "device busy";
+        case eEFUSE_ERR_JOURNAL:    return "journal write";
+        case eEFUSE_ERR_OWNER:      return "device owned by other process";
+        default :                   return "unknown error";
+    }
+}
 
-const char *C5_MAC_START_STR = "001E0657"; // 65536개
-const int   C5_MAC_BLOCK_CNT = 2;          // 2개의 block reserved (13만개)
-const int   C5_MAC_RW_OFFSET = 0;
-const int   C5_EFUSE_SIZE_BYTE = EFUSE_UUID_SIZE;
+//------------------------------------------------------------------------------
+int efuse_ctx_get_board (const efuse_ctx *ctx)
+{
+    return ctx->board_id;
+}
 
 //------------------------------------------------------------------------------
-// function prototype
+// board에 할당된 mac 범위. mac_start = 0x001E06xx0000, mac_cnt = block * 65536
 //------------------------------------------------------------------------------
-static int  efuse_lock  (char lock);
+int efuse_get_mac_range (int board_id, unsigned long long *mac_start, int *mac_cnt)
+{
+    const struct efuse_board *board = efuse_board_info (board_id);
 
-int  efuse_set_board    (int board_id);
-int  efuse_get_board    (void);
+    if (board == NULL)
+        return 0;
 
-int  efuse_valid_check  (const char *efuse_data);
-void efuse_get_mac      (const char *efuse_data, char *mac);
-int  efuse_control      (char *efuse_data, char control);
+    if (mac_start != NULL)
+        *mac_start = strtoull (board->mac_start_str, NULL, 16) << 16;
+    if (mac_cnt != NULL)
+        *mac_cnt   = board->mac_block_cnt * 65536;
+    return 1;
+}
 
 //------------------------------------------------------------------------------
-// 문자열 변경 함수. 입력 포인터는 반드시 메모리가 할당되어진 변수여야 함.
-//------------------------------------------------------------------------------
-#if 0
-static void tolowerstr (char *p);
-static void tolowerstr (char *p)
+int efuse_set_board_str (char *bd_name)
 {
-    int i, c = strlen(p);
+    int board_id = efuse_board_find (bd_name);
 
-    for (i = 0; i < c; i++, p++)
-        *p = tolower(*p);
+    return (board_id < 0) ? 0 : efuse_set_board (board_id);
 }
-#endif
+
 //------------------------------------------------------------------------------
-static void toupperstr (char *p);
-static void toupperstr (char *p)
+int efuse_set_board (int board_id)
 {
-    int i, c = strlen(p);
-
-    for (i = 0; i < c; i++, p++)
-        *p = toupper(*p);
+    return efuse_ctx_set_board (&DefaultCtx, board_id);
 }
 
 //------------------------------------------------------------------------------
-static int efuse_lock (char lock)
+int efuse_set_journal (struct efuse_journal *journal)
 {
-    int fd = 0;
-
-    if ((fd = open (eFuseRWControl, O_WRONLY)) < 0) {
-        printf ("error, file write mode open (%s)\n", eFuseRWControl);
-        return 0;
-    }
-    if (!write (fd, lock ? "1" : "0", 1))
-        printf ("error, write size different.\n");
+    return efuse_ctx_set_journal (&DefaultCtx, journal);
+}
 
-    close (fd);
-    return 1;
+//------------------------------------------------------------------------------
+int efuse_set_owner (struct efuse_owner *owner)
+{
+    return efuse_ctx_set_owner (&DefaultCtx, owner);
 }
 
 //------------------------------------------------------------------------------
-int efuse_set_board_str (char *bd_name)
+int efuse_set_label (struct efuse_label *label)
 {
-    if (!strncmp (bd_name,  "c4", sizeof("c4")))    return efuse_set_board (eBOARD_ID_C4);
-    if (!strncmp (bd_name,  "m1", sizeof("m1")))    return efuse_set_board (eBOARD_ID_M1);
-    if (!strncmp (bd_name, "m1s", sizeof("m1s")))   return efuse_set_board (eBOARD_ID_M1S);
-    if (!strncmp (bd_name,  "m2", sizeof("m2")))    return efuse_set_board (eBOARD_ID_M2);
-    if (!strncmp (bd_name,  "c5", sizeof("c5")))    return efuse_set_board (eBOARD_ID_C5);
-    return 0;
+    return efuse_ctx_set_label (&DefaultCtx, label);
 }
 
 //------------------------------------------------------------------------------
-int efuse_set_board (int board_id)
+// 기존 API가 사용하는 default context (trace attach 등 ctx API와 같이 사용).
+//------------------------------------------------------------------------------
+efuse_ctx *efuse_get_ctx (void)
 {
-    switch (board_id) {
-        default :
-        case eBOARD_ID_M1:
-            eFuseRWControl  = (char *)M1_eFuseRWControl;
-            eFuseRWFile     = (char *)M1_eFuseRWFile;
-
-            MAC_START_STR   = (char *)M1_MAC_START_STR;
-            MAC_BLOCK_CNT   = M1_MAC_BLOCK_CNT;
-            MAC_RW_OFFSET   = M1_MAC_RW_OFFSET;
-            EFUSE_SIZE_BYTE = M1_EFUSE_SIZE_BYTE;
-            EFUSE_BOARD_ID  = eBOARD_ID_M1;
-            break;
-        case eBOARD_ID_M1S:
-            eFuseRWControl  = (char *)M1S_eFuseRWControl;
-            eFuseRWFile     = (char *)M1S_eFuseRWFile;
-
-            MAC_START_STR   = (char *)M1S_MAC_START_STR;
-            MAC_BLOCK_CNT   = M1S_MAC_BLOCK_CNT;
-            MAC_RW_OFFSET   = M1S_MAC_RW_OFFSET;
-            EFUSE_SIZE_BYTE = M1S_EFUSE_SIZE_BYTE;
-            EFUSE_BOARD_ID  = eBOARD_ID_M1S;
-            break;
-        case eBOARD_ID_M2:
-            eFuseRWControl  = (char *)M2_eFuseRWControl;
-            eFuseRWFile     = (char *)M2_eFuseRWFile;
-
-            MAC_START_STR   = (char *)M2_MAC_START_STR;
-            MAC_BLOCK_CNT   = M2_MAC_BLOCK_CNT;
-            MAC_RW_OFFSET   = M2_MAC_RW_OFFSET;
-            EFUSE_SIZE_BYTE = M2_EFUSE_SIZE_BYTE;
-            EFUSE_BOARD_ID  = eBOARD_ID_M2;
-            break;
-        case eBOARD_ID_C4:
-            eFuseRWControl  = (char *)C4_eFuseRWControl;
-            eFuseRWFile     = (char *)C4_eFuseRWFile;
-
-            MAC_START_STR   = (char *)C4_MAC_START_STR;
-            MAC_BLOCK_CNT   = C4_MAC_BLOCK_CNT;
-            MAC_RW_OFFSET   = C4_MAC_RW_OFFSET;
-            EFUSE_SIZE_BYTE = C4_EFUSE_SIZE_BYTE;
-            EFUSE_BOARD_ID  = eBOARD_ID_C4;
-            break;
-        case eBOARD_ID_C5:
-            eFuseRWControl  = (char *)C5_eFuseRWControl;
-            eFuseRWFile     = (char *)C5_eFuseRWFile;
-
-            MAC_START_STR   = (char *)C5_MAC_START_STR;
-            MAC_BLOCK_CNT   = C5_MAC_BLOCK_CNT;
-            MAC_RW_OFFSET   = C5_MAC_RW_OFFSET;
-            EFUSE_SIZE_BYTE = C5_EFUSE_SIZE_BYTE;
-            EFUSE_BOARD_ID  = eBOARD_ID_C5;
-            break;
-    }
-    EFUSE_MAC_OFFSET = EFUSE_UUID_SIZE - MAC_STR_SIZE;
-    return 1;
+    return &DefaultCtx;
 }
 
 //------------------------------------------------------------------------------
 int efuse_get_board (void)
 {
-    return EFUSE_BOARD_ID;
+    return efuse_ctx_get_board (&DefaultCtx);
 }
 
 //------------------------------------------------------------------------------
-int efuse_valid_check (const char *efuse_data)
+int efuse_ctx_valid_check (const efuse_ctx *ctx, const char *efuse_data)
 {
-    char data[10];
+    const char *m = &efuse_data[ctx->mac_offset];
     int addr, mac;
 
     // not odroid mac
-    if (strstr (efuse_data, "001E06") == NULL) {
+    if ((strnlen (efuse_data, EFUSE_UUID_SIZE) != EFUSE_UUID_SIZE) ||
+        (efuse_hex_byte (&m[0]) != 0x00) ||
+        (efuse_hex_byte (&m[2]) != 0x1E) ||
+        (efuse_hex_byte (&m[4]) != 0x06)) {
         dbg_msg ("error, Not odroid mac address. mac != 00:1e:06:xx:xx:xx, efuse_data = %s\n", efuse_data);
         return 0;
     }
 
-    memset (data, 0, sizeof(data));
-    strncpy (data, &efuse_data[EFUSE_MAC_OFFSET + 6], 2);
-    mac = (int)strtoul(data, NULL, 16);
-
-    memset  (data, 0, sizeof(data));
-    strncpy (data, &MAC_START_STR[6], 2);
-    addr = (int)strtoul(data, NULL, 16);
+    mac  = efuse_hex_byte (&m[6]);
+    addr = ctx->mac_start_addr;
 
-    dbg_msg ("ODROID (Board ID = %d, 0 = m1, 1 = m1s, 2 = m2, 3 = c4, 4 = c5) mac range.\n", EFUSE_BOARD_ID);
-    if ((mac >= addr) && (mac < addr + MAC_BLOCK_CNT)) {
+    dbg_msg ("ODROID-%s (Board ID = %d) mac range.\n", ctx_board (ctx)->name, ctx->board_id);
+    if ((mac >= addr) && (mac < addr + ctx->mac_block_cnt)) {
         dbg_msg ("success, efuse data = %s, mac = %s\n",
-            efuse_data, &efuse_data[EFUSE_MAC_OFFSET]);
+            efuse_data, &efuse_data[ctx->mac_offset]);
         return 1;
     }
 
-    if (EFUSE_BOARD_ID == eBOARD_ID_C4) {
-        addr = (int)strtoul("48", NULL, 16);
-        if (addr == mac) {
-            printf ("ODROID-C4 Old product mac range.\n");
+    if (ctx_board (ctx)->mac_legacy) {
+        if (mac == ctx_board (ctx)->mac_legacy) {
+            dbg_msg ("ODROID-%s Old product mac range.\n", ctx_board (ctx)->name);
             return 1;
         }
     } else {
-        printf ("error, mac range.\n");
-        printf ("mac : %s, range %s0000 ~ (%d block)\n",
-            &efuse_data[EFUSE_MAC_OFFSET], MAC_START_STR, MAC_BLOCK_CNT);
+        dbg_msg ("error, mac range.\n");
+        dbg_msg ("mac : %s, range %s0000 ~ (%d block)\n",
+            &efuse_data[ctx->mac_offset], ctx->mac_start_str, ctx->mac_block_cnt);
     }
     return 0;
 }
 
 //------------------------------------------------------------------------------
-void efuse_get_mac (const char *efuse_data, char *mac)
+int efuse_valid_check (const char *efuse_data)
+{
+    return efuse_ctx_valid_check (&DefaultCtx, efuse_data);
+}
+
+//------------------------------------------------------------------------------
+void efuse_ctx_get_mac (const efuse_ctx *ctx, const char *efuse_data, char *mac)
 {
     memset  (mac, 0, MAC_STR_SIZE);
-    strncpy (mac, &efuse_data[EFUSE_MAC_OFFSET], MAC_STR_SIZE);
+    strncpy (mac, &efuse_data[ctx->mac_offset], MAC_STR_SIZE);
+}
+
+//------------------------------------------------------------------------------
+void efuse_get_mac (const char *efuse_data, char *mac)
+{
+    efuse_ctx_get_mac (&DefaultCtx, efuse_data, mac);
 }
 
 //------------------------------------------------------------------------------
-unsigned char cksum (const char *data)
+static unsigned char cksum (const char *data)
 {
     unsigned char sum = 0, i;
 
@@ -306,139 +1232,320 @@ unsigned char cksum (const char *data)
 }
 
 //------------------------------------------------------------------------------
-int efuse_write_ioctl (const char *efuse_data, char control)
+// uuid flash slot 상태 분석. empty = 0x00, erased = 0xFF, valid = hex 문자열.
+//------------------------------------------------------------------------------
+static int slot_state (const char *slot)
 {
-    int fd, offset = 0;
-    struct ioc_data data;
+    int i, empty = 1, erased = 1, hex = 1;
+
+    for (i = 0; i < UUID_WRITE_SIZE; i++) {
+        if ((unsigned char)slot[i] != 0x00)     empty  = 0;
+        if ((unsigned char)slot[i] != 0xFF)     erased = 0;
+        if (!isxdigit ((unsigned char)slot[i])) hex    = 0;
+    }
+    if (empty)  return eSLOT_EMPTY;
+    if (erased) return eSLOT_ERASED;
+    return hex ? eSLOT_VALID : eSLOT_INVALID;
+}
+
+//------------------------------------------------------------------------------
+// IOC_DUMP 1회로 uuid flash(UUID_FLASH_SIZE) 전체를 읽어 slot 정보 생성.
+// return : 1 = success, 0 = IOC_DUMP 미지원 또는 error
+//------------------------------------------------------------------------------
+static int slot_dump (const efuse_ctx *ctx, int fd, struct efuse_slot_info *info)
+{
+    struct ioc_dump_data dump;
+    int i;
 
-    if ((fd = open (eFuseRWControl, O_RDWR)) < 0)
+    memset (&dump, 0, sizeof(dump));
+    memcpy (dump.mstr, IOC_MSTR_DUMP, strlen(IOC_MSTR_DUMP));
+    dump.offset = 0;
+    dump.len    = UUID_FLASH_SIZE;
+
+    if (ctx->io->ioctl (ctx->io->priv, fd, IOC_DUMP, &dump))
         return 0;
 
-    memset (&data, 0, sizeof(data));
-    memcpy (data.mstr, (efuse_get_board() == eBOARD_ID_M1) ?
-            IOC_MSTR_WRITE_M1 : IOC_MSTR_WRITE_C4, strlen(IOC_MSTR_WRITE_M1));
+    memset (info, 0, sizeof(struct efuse_slot_info));
+    info->active    = -1;
+    info->next_free = -1;
+    for (i = 0; i < UUID_SLOT_CNT; i++) {
+        const char *slot = &dump.data[i * UUID_WRITE_SIZE];
 
-    {
-        int i, cnt;
+        memcpy (info->uuid[i], slot, UUID_WRITE_SIZE);
+        info->state[i] = slot_state (slot);
+        info->cksum[i] = cksum (slot);
 
-        // remove '-' string
-        for (i = 0, cnt = 0; i < (int)strlen(efuse_data); i++) {
-            if (efuse_data [i] != '-')
-                data.uuid [cnt++] = efuse_data [i];
+        switch (info->state[i]) {
+            case eSLOT_EMPTY:
+                if (info->next_free < 0)
+                    info->next_free = i;
+                info->remain++;
+                break;
+            case eSLOT_VALID:
+                info->active = i;
+                break;
+            default :
+                break;
         }
-        data.len   = (control == EFUSE_WRITE) ? cnt : UUID_WRITE_SIZE;
-        data.cksum = cksum (&data.uuid [0]);
     }
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+// uuid flash slot 이력 조회 (m1, c4)
+//------------------------------------------------------------------------------
+int efuse_ctx_slot_scan (efuse_ctx *ctx, struct efuse_slot_info *info)
+{
+    int fd, ret;
+
+    if (ctx_dev_type (ctx) != eBOARD_DEV_IOCTL)
+        return 0;
+
+    if ((fd = ctx_fd_get (ctx, 1, O_RDWR)) < 0)
+        return 0;
+
+    ret = slot_dump (ctx, fd, info);
+    ctx_fd_put (ctx, fd);
+    return ret;
+}
+
+//------------------------------------------------------------------------------
+// timeout/cancel/busy는 device 요청을 더 이상 진행할 수 없는 error.
+//------------------------------------------------------------------------------
+static int ctx_aborted (const efuse_ctx *ctx)
+{
+    return (ctx->last_error == eEFUSE_ERR_TIMEOUT)  ||
+           (ctx->last_error == eEFUSE_ERR_CANCELED) ||
+           (ctx->last_error == eEFUSE_ERR_BUSY);
+}
+
+//------------------------------------------------------------------------------
+// IOC_WRITE 1회. return : 1 = success (abort 여부는 ctx_aborted로 확인)
+//------------------------------------------------------------------------------
+static int slot_write (const efuse_ctx *ctx, int fd, struct ioc_data *data, int offset)
+{
+    data->offset = offset;
+    if (ctx->io->ioctl (ctx->io->priv, fd, IOC_WRITE, data))
+        return 0;
+    dbg_msg ("write success offset = %d\n", offset);
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+// IOC_DUMP 결과는 hint로만 사용 (kernel마다 dump 형식/empty pattern이 다를 수 있음).
+// - write : dump의 next_free에 먼저 write, 실패하거나 next_free가 없으면
+//           기존과 같이 offset 0부터 write 가능한 slot 탐색.
+// - erase : hint 위치에 write 되었고 dump에 active slot이 있으면 active slot,
+//           그 외(hint 불일치, active 없이 사용된 slot 존재)는 기존과 같이 이전 slot.
+//------------------------------------------------------------------------------
+static int efuse_write_ioctl (const efuse_ctx *ctx, const struct efuse_uuid *uuid, char control)
+{
+    int fd, offset = UUID_FLASH_SIZE, erase_offset = -1, hint = -1, used = 0, i;
+    struct ioc_data data;
+    struct efuse_slot_info info;
+    long long t0;
+    int scan;
+
+    if ((fd = ctx_fd_get (ctx, 1, O_RDWR)) < 0) {
+        ctx_error (ctx, eEFUSE_ERR_NODEV);
+        return 0;
+    }
+
+    memset (&data, 0, sizeof(data));
+    memcpy (data.mstr, ctx_board (ctx)->ioc_mstr, sizeof(data.mstr));
+
+    // uuid 32 hex ('-' 제외). erase는 0 data.
+    if (control == EFUSE_WRITE)
+        efuse_uuid_hex (uuid, data.uuid);
+    data.len   = UUID_WRITE_SIZE;
+    data.cksum = cksum (&data.uuid [0]);
 
-    if (data.len != UUID_WRITE_SIZE) {
-        printf ("%s : uuid data size(%d) != UUID_FLASH_SIZE(32)\n", __func__, data.len);
-        close (fd);
+    t0   = efuse_metrics_now ();
+    scan = slot_dump (ctx, fd, &info);
+    efuse_metrics_add (ctx->board_id, eMETRIC_SLOT_SCAN, t0);
+    if (ctx_aborted (ctx)) {
+        ctx_fd_put (ctx, fd);
         return 0;
     }
+    for (i = 0; scan && (i < UUID_SLOT_CNT); i++)
+        used += (info.state[i] != eSLOT_EMPTY);
 
     if (control == EFUSE_WRITE) {
         /* Finding new uuid data write area. */
-        for (offset = 0; offset < UUID_FLASH_SIZE; offset += UUID_WRITE_SIZE) {
-            data.offset = offset;
-            if (!ioctl (fd, IOC_WRITE, &data)) {
-                printf ("write success offset = %d\n", offset);
-                break;
+        t0 = efuse_metrics_now ();
+        if (scan && (info.next_free >= 0) &&
+            slot_write (ctx, fd, &data, info.next_free * UUID_WRITE_SIZE))
+            offset = hint = info.next_free * UUID_WRITE_SIZE;
+
+        for (i = 0; (offset >= UUID_FLASH_SIZE) && (i < UUID_FLASH_SIZE); i += UUID_WRITE_SIZE) {
+            if (ctx_aborted (ctx)) {
+                ctx_fd_put (ctx, fd);
+                return 0;
             }
+            if ((scan && (info.next_free * UUID_WRITE_SIZE == i)) || !slot_write (ctx, fd, &data, i))
+                continue;
+            offset = i;
+        }
+        efuse_metrics_add (ctx->board_id, eMETRIC_SLOT_WRITE, t0);
+        if (ctx_aborted (ctx)) {
+            ctx_fd_put (ctx, fd);
+            return 0;
         }
+
         /* Delete previous uuid data.*/
-        if (offset && (offset < UUID_FLASH_SIZE)) {
-            data.offset = offset - UUID_WRITE_SIZE;
-            printf ("EFUSE_WRITE : erase offset = %d, erase ret = %d\n",
-                data.offset, ioctl (fd, IOC_ERASE, &data));
-        } else {
-            if (offset)
-                printf ("Can't found empty uuid flash area. offsest = %d\n", offset);
+        if ((hint >= 0) && (info.active >= 0))
+            erase_offset = info.active * UUID_WRITE_SIZE;
+        else if ((hint < 0) || used)
+            erase_offset = offset - UUID_WRITE_SIZE;
+
+        // 새 uuid는 이미 write 되었으므로 이전 slot erase 실패는 error 아님.
+        if ((erase_offset >= 0) && (offset < UUID_FLASH_SIZE)) {
+            data.offset = erase_offset;
+            t0 = efuse_metrics_now ();
+            if (ctx->io->ioctl (ctx->io->priv, fd, IOC_ERASE, &data)) {
+                dbg_msg ("EFUSE_WRITE : erase offset = %d, error\n", data.offset);
+            }
+            efuse_metrics_add (ctx->board_id, eMETRIC_SLOT_ERASE, t0);
+        } else if (offset >= UUID_FLASH_SIZE) {
+            dbg_msg ("Can't found empty uuid flash area. offsest = %d\n", offset);
+            ctx_error (ctx, (scan && (info.next_free < 0)) ?
+                            eEFUSE_ERR_NOSPACE : eEFUSE_ERR_IO);
         }
     } else {
-        data.offset = 0;
-        printf ("EFUSE_ERASE : erase offset = %d, erase ret = %d\n",
-                data.offset, ioctl (fd, IOC_ERASE, &data));
+        data.offset = (scan && (info.active >= 0)) ? info.active * UUID_WRITE_SIZE : 0;
+        offset = 0;
+        t0 = efuse_metrics_now ();
+        if (ctx->io->ioctl (ctx->io->priv, fd, IOC_ERASE, &data)) {
+            dbg_msg ("EFUSE_ERASE : erase offset = %d, error\n", data.offset);
+        }
+        efuse_metrics_add (ctx->board_id, eMETRIC_SLOT_ERASE, t0);
+        if (ctx_aborted (ctx))
+            offset = UUID_FLASH_SIZE;
     }
-    close (fd);
+    ctx_fd_put (ctx, fd);
 
     return  (offset < UUID_FLASH_SIZE) ? 1 : 0;
 }
 
 //------------------------------------------------------------------------------
-int efuse_control (char *efuse_data, char control)
+static int ctx_control_once (efuse_ctx *ctx, char *efuse_data, char control)
 {
-    int fd;
+    char wdata [EFUSE_UUID_SIZE +1];
+    struct efuse_uuid uuid;
+    long long t0;
+    int fd, found;
     char size;
 
-    if (access (eFuseRWFile, F_OK) != 0) {
-        dbg_msg ("error, eFuse read/write file not found.(%s)\n", eFuseRWFile);
-        return 0;
-    }
-    if (access (eFuseRWControl, F_OK) != 0) {
-        dbg_msg ("error, eFuse control file not found.(%s)\n", eFuseRWControl);
-        return 0;
+    // session 중에는 descriptor가 이미 open 되어있으므로 path 확인 생략.
+    if (!ctx->sess_active) {
+        t0    = efuse_metrics_now ();
+        found = ctx->io->access (ctx->io->priv, ctx->rw_file) == 0;
+        if (!found) {
+            dbg_msg ("error, eFuse read/write file not found.(%s)\n", ctx->rw_file);
+        } else if (ctx->io->access (ctx->io->priv, ctx->rw_control) != 0) {
+            dbg_msg ("error, eFuse control file not found.(%s)\n", ctx->rw_control);
+            found = 0;
+        }
+        efuse_metrics_add (ctx->board_id, eMETRIC_ACCESS, t0);
+        if (!found) {
+            ctx_error (ctx, eEFUSE_ERR_NODEV);
+            return 0;
+        }
     }
 
     if (efuse_data == NULL) {
         dbg_msg ("error, eFuse data is NULL.\n");
+        ctx_error (ctx, eEFUSE_ERR_PARAM);
         return 0;
     }
     switch (control) {
         case EFUSE_ERASE: case EFUSE_WRITE:
-            if (control == EFUSE_ERASE)
-                memset (efuse_data, 0, EFUSE_SIZE_BYTE);
-
-            switch (efuse_get_board()) {
-                case eBOARD_ID_M1: case eBOARD_ID_C4:
-                    if (!efuse_write_ioctl (efuse_data, control)) {
-                        printf ("error, %s efuse %s\n",
-                            efuse_get_board() == eBOARD_ID_M1 ? "m1":"c4",
+            if (control == EFUSE_ERASE) {
+                memset (efuse_data, 0, ctx->size_byte);
+                memset (wdata, 0, sizeof(wdata));
+            } else {
+                // uuid 형식 확인 및 대문자 변환
+                if (!efuse_uuid_parse (efuse_data, &uuid)) {
+                    dbg_msg ("error, uuid format. (%.*s)\n", EFUSE_UUID_SIZE, efuse_data);
+                    ctx_error (ctx, eEFUSE_ERR_PARAM);
+                    return 0;
+                }
+                efuse_uuid_format (&uuid, wdata);
+            }
+
+            // write session 밖에서는 write 동안만 device owner 유지
+            if (!efuse_ctx_owner_get (ctx, 1))
+                return 0;
+            switch (ctx_dev_type (ctx)) {
+                case eBOARD_DEV_IOCTL:
+                    if (!efuse_write_ioctl (ctx, &uuid, control)) {
+                        dbg_msg ("error, %s efuse %s\n", ctx_board (ctx)->name,
                             control == EFUSE_ERASE ? "erase" : "write");
+                        ctx_error (ctx, eEFUSE_ERR_IO);
+                        efuse_ctx_owner_put (ctx);
                         return 0;
                     }
-                    size = EFUSE_SIZE_BYTE;
+                    size = ctx->size_byte;
                     break;
 
-                case eBOARD_ID_M1S: case eBOARD_ID_M2: case eBOARD_ID_C5:
+                case eBOARD_DEV_EMMC: case eBOARD_DEV_SYSFS:
                     // emmc hidden protect
-                    if (efuse_get_board() != eBOARD_ID_C5) {
-                        if (!efuse_lock(EFUSE_UNLOCK)) return 0;
+                    if (!efuse_protect (ctx, EFUSE_UNLOCK)) {
+                        efuse_protect (ctx, EFUSE_LOCK);
+                        efuse_ctx_owner_put (ctx);
+                        return 0;
                     }
 
-                    if ((fd = open (eFuseRWFile, O_WRONLY)) < 0) {
-                        printf ("error, file write mode open (%s)\n", eFuseRWFile);
+                    if ((fd = ctx_fd_get (ctx, 0, O_WRONLY)) < 0) {
+                        dbg_msg ("error, file write mode open (%s)\n", ctx->rw_file);
+                        ctx_error (ctx, eEFUSE_ERR_NODEV);
+                        efuse_protect (ctx, EFUSE_LOCK);
+                        efuse_ctx_owner_put (ctx);
                         return 0;
                     }
-                    size = pwrite (fd, efuse_data, EFUSE_SIZE_BYTE, MAC_RW_OFFSET);
-                    close (fd);
+                    t0   = efuse_metrics_now ();
+                    size = ctx->io->pwrite (ctx->io->priv, fd, wdata,
+                                            ctx->size_byte, ctx->mac_rw_offset);
+                    efuse_metrics_add (ctx->board_id, eMETRIC_WRITE, t0);
+                    ctx_fd_put (ctx, fd);
 
                     // emmc hidden protect
-                    if (efuse_get_board() != eBOARD_ID_C5) {
-                        if (!efuse_lock(EFUSE_UNLOCK)) return 0;
+                    if (!efuse_protect (ctx, EFUSE_LOCK)) {
+                        efuse_ctx_owner_put (ctx);
+                        return 0;
                     }
                     break;
                 default :
+                    ctx_error (ctx, eEFUSE_ERR_PARAM);
+                    efuse_ctx_owner_put (ctx);
                     return 0;
             }
+            efuse_ctx_owner_put (ctx);
             dbg_msg ("success, eFuse data write. efuse = %s\n", efuse_data);
             break;
         case EFUSE_READ:
-            memset (efuse_data, 0, EFUSE_SIZE_BYTE);
-            if ((fd = open (eFuseRWFile, O_RDONLY)) < 0) {
-                printf ("error, file read mode open (%s)\n", eFuseRWFile);
+            memset (efuse_data, 0, ctx->size_byte);
+            if ((fd = ctx_fd_get (ctx, 0, O_RDONLY)) < 0) {
+                dbg_msg ("error, file read mode open (%s)\n", ctx->rw_file);
+                ctx_error (ctx, eEFUSE_ERR_NODEV);
                 return 0;
             }
-            size = pread (fd, efuse_data, EFUSE_SIZE_BYTE, MAC_RW_OFFSET);
-            close (fd);
+            t0   = efuse_metrics_now ();
+            size = ctx->io->pread (ctx->io->priv, fd, efuse_data,
+                                   ctx->size_byte, ctx->mac_rw_offset);
+            efuse_metrics_add (ctx->board_id, eMETRIC_READ, t0);
+            ctx_fd_put (ctx, fd);
             dbg_msg ("success, eFuse data read. efuse = %s\n", efuse_data);
             break;
         default:
             dbg_msg ("Unknown control cmd.(%d)\n", control);
+            ctx_error (ctx, eEFUSE_ERR_PARAM);
             return 0;
     }
-    if (size != EFUSE_SIZE_BYTE) {
-        printf ("error, read/write size are different. (read/write size = %d, %d)\n",
-		size, EFUSE_SIZE_BYTE);
+    if (size != ctx->size_byte) {
+        dbg_msg ("error, read/write size are different. (read/write size = %d, %d)\n",
+		size, ctx->size_byte);
+        ctx_error (ctx, eEFUSE_ERR_IO);
         return 0;
     }
 
@@ -446,5 +1553,258 @@ int efuse_control (char *efuse_data, char control)
     return 1;
 }
 
+//------------------------------------------------------------------------------
+// operation 시작. 가장 바깥 operation에서 error 초기화 및 deadline 설정.
+//------------------------------------------------------------------------------
+static void ctx_op_begin (efuse_ctx *ctx)
+{
+    if (ctx->op_depth++)
+        return;
+    ctx->last_error  = eEFUSE_OK;
+    ctx->deadline_ns = (ctx->retry.timeout_ms > 0) ?
+                        mono_ns () + ctx->retry.timeout_ms * 1000000LL : 0;
+}
+
+//------------------------------------------------------------------------------
+static int ctx_op_end (efuse_ctx *ctx, int ret)
+{
+    if (--ctx->op_depth == 0)
+        ctx->deadline_ns = 0;
+    return ret;
+}
+
+//------------------------------------------------------------------------------
+// 재시도 전 대기. cancel 확인을 위해 10ms 단위로 나누어 대기.
+// return : 0 = cancel 또는 대기 후 deadline 초과 (재시도 하지 않음)
+//------------------------------------------------------------------------------
+static int ctx_backoff (efuse_ctx *ctx, int ms)
+{
+    long long now = mono_ns (), until = now + ms * 1000000LL, slice;
+    struct timespec ts;
+
+    if (ctx->deadline_ns && (until >= ctx->deadline_ns))
+        return 0;
+
+    while (now < until) {
+        if (__atomic_load_n (&ctx->cancel, __ATOMIC_ACQUIRE))
+            return 0;
+        slice = (until - now < 10000000LL) ? until - now : 10000000LL;
+        ts.tv_sec  = 0;
+        ts.tv_nsec = slice;
+        nanosleep (&ts, NULL);
+        now = mono_ns ();
+    }
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+// return : 0 = cancel 또는 deadline 초과
+//------------------------------------------------------------------------------
+static int ctx_op_check (efuse_ctx *ctx)
+{
+    if (__atomic_load_n (&ctx->cancel, __ATOMIC_ACQUIRE)) {
+        ctx_error (ctx, eEFUSE_ERR_CANCELED);
+        return 0;
+    }
+    if (ctx->deadline_ns && (mono_ns () >= ctx->deadline_ns)) {
+        ctx_error (ctx, eEFUSE_ERR_TIMEOUT);
+        return 0;
+    }
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+// 일시적 error(NODEV, IO, LOCK)는 retry_cnt 만큼 backoff 후 재시도.
+// return : 1 = 재시도
+//------------------------------------------------------------------------------
+static int ctx_retry (efuse_ctx *ctx, int *retry, int *backoff)
+{
+    if ((ctx->last_error != eEFUSE_ERR_NODEV) &&
+        (ctx->last_error != eEFUSE_ERR_IO) &&
+        (ctx->last_error != eEFUSE_ERR_LOCK))
+        return 0;
+    if ((*retry)++ >= ctx->retry.retry_cnt)
+        return 0;
+    if (!ctx_backoff (ctx, *backoff)) {
+        // 대기중 cancel은 cancel로 보고 (deadline 부족은 마지막 error 유지)
+        if (__atomic_load_n (&ctx->cancel, __ATOMIC_ACQUIRE))
+            ctx->last_error = eEFUSE_ERR_CANCELED;
+        return 0;
+    }
+
+    dbg_msg ("retry %d/%d, %s\n", *retry, ctx->retry.retry_cnt,
+                efuse_strerror (ctx->last_error));
+    ctx->last_error = eEFUSE_OK;
+    *backoff = (ctx->retry.backoff_max_ms && (*backoff * 2 > ctx->retry.backoff_max_ms)) ?
+                ctx->retry.backoff_max_ms : *backoff * 2;
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+// 실패 원인은 efuse_ctx_last_error()로 확인.
+//------------------------------------------------------------------------------
+int efuse_ctx_control (efuse_ctx *ctx, char *efuse_data, char control)
+{
+    int ret = 0, retry = 0, backoff = ctx->retry.backoff_ms, journal = 0;
+    long long t0 = efuse_metrics_now ();
+
+    ctx_op_begin (ctx);
+    // write/erase는 retry 전체가 operation 1개 (write_verify 내부 write는 제외)
+    if (((control == EFUSE_WRITE) || (control == EFUSE_ERASE)) && !ctx->journal_id) {
+        if (!ctx_journal_begin (ctx, (control == EFUSE_WRITE) ?
+                                eJOURNAL_OP_WRITE : eJOURNAL_OP_ERASE, efuse_data)) {
+            efuse_metrics_add (ctx->board_id, eMETRIC_CONTROL, t0);
+            return ctx_op_end (ctx, 0);
+        }
+        journal = ctx->journal_id != 0;
+    }
+    while (ctx_op_check (ctx)) {
+        if ((ret = ctx_control_once (ctx, efuse_data, control)) ||
+            !ctx_retry (ctx, &retry, &backoff))
+            break;
+    }
+    if (journal)
+        ctx_journal_state (ctx, ret ? eJOURNAL_WRITTEN : eJOURNAL_FAILED, 1);
+    if (ret && (ctx->op_depth == 1))
+        ctx->last_error = eEFUSE_OK;
+    efuse_metrics_add (ctx->board_id, eMETRIC_CONTROL, t0);
+    return ctx_op_end (ctx, ret);
+}
+
+//------------------------------------------------------------------------------
+int efuse_control (char *efuse_data, char control)
+{
+    return efuse_ctx_control (&DefaultCtx, efuse_data, control);
+}
+
+//------------------------------------------------------------------------------
+// session 시작 (write session의 emmc unlock 실패 등은 재시도)
+//------------------------------------------------------------------------------
+static int ctx_begin_retry (efuse_ctx *ctx, int write)
+{
+    int ret = 0, retry = 0, backoff = ctx->retry.backoff_ms;
+
+    while (ctx_op_check (ctx)) {
+        if ((ret = efuse_ctx_begin (ctx, write)) || !ctx_retry (ctx, &retry, &backoff))
+            break;
+    }
+    return ret;
+}
+
+//------------------------------------------------------------------------------
+// 현재 data를 먼저 읽어 같으면 write 생략, 다르면 write -> sync -> read back 확인.
+// read_data : read back data (EFUSE_UUID_SIZE +1, NULL 가능)
+// return : eEFUSE_WV_xxx
+//------------------------------------------------------------------------------
+static int ctx_write_verify (efuse_ctx *ctx, const char *efuse_data, char *read_data)
+{
+    char wdata [EFUSE_UUID_SIZE +1], rdata [EFUSE_UUID_SIZE +1];
+    int own_session = !ctx->sess_active, ret = eEFUSE_WV_ERROR;
+    long long t0;
+
+    if ((efuse_data == NULL) || (strnlen (efuse_data, EFUSE_UUID_SIZE) != EFUSE_UUID_SIZE)) {
+        ctx_error (ctx, eEFUSE_ERR_PARAM);
+        return eEFUSE_WV_ERROR;
+    }
+
+    memset (wdata, 0, sizeof(wdata));
+    memcpy (wdata, efuse_data, EFUSE_UUID_SIZE);
+    toupperstr (wdata);
+
+    // 1. 현재 data 확인 (read session, unlock 하지 않음)
+    if (own_session && !ctx_begin_retry (ctx, 0))
+        return eEFUSE_WV_ERROR;
+
+    memset (rdata, 0, sizeof(rdata));
+    if (efuse_ctx_control (ctx, rdata, EFUSE_READ) && !memcmp (rdata, wdata, EFUSE_UUID_SIZE)) {
+        ret = eEFUSE_WV_UNCHANGED;
+        goto out;
+    }
+    // read 실패는 data 다름으로 처리, 단 timeout/cancel은 중단.
+    if (ctx_aborted (ctx))
+        goto out;
+    ctx->last_error = eEFUSE_OK;
+
+    // 2. write session으로 전환 후 write, sync, read back (unlock 전에 intent 기록)
+    if (!ctx_journal_begin (ctx, eJOURNAL_OP_WRITE_VERIFY, wdata))
+        goto out;
+    if (own_session) {
+        efuse_ctx_end (ctx);
+        if (!ctx_begin_retry (ctx, 1)) {
+            ctx_journal_state (ctx, eJOURNAL_FAILED, 1);
+            return eEFUSE_WV_ERROR;
+        }
+    }
+    memset (rdata, 0, sizeof(rdata));
+    if (!efuse_ctx_control (ctx, wdata, EFUSE_WRITE))
+        goto out;
+    ctx_journal_state (ctx, eJOURNAL_WRITTEN, 0);
+
+    if (ctx_dev_type (ctx) == eBOARD_DEV_EMMC) {
+        int fd = ctx_fd_get (ctx, 0, O_WRONLY), sync_err = 0;
+
+        if (fd >= 0) {
+            long long t0 = efuse_metrics_now ();
+
+            if ((sync_err = ctx->io->fdatasync (ctx->io->priv, fd)) != 0) {
+                dbg_msg ("error, data sync (%s)\n", ctx->rw_file);
+            }
+            efuse_metrics_add (ctx->board_id, eMETRIC_SYNC, t0);
+            ctx_fd_put (ctx, fd);
+        }
+        if (ctx_aborted (ctx))
+            goto out;
+        // sync 실패는 기록 여부를 알 수 없으므로 실패 처리
+        if (sync_err) {
+            ctx_error (ctx, eEFUSE_ERR_IO);
+            goto out;
+        }
+    }
+    t0 = efuse_metrics_now ();
+    if (!efuse_ctx_control (ctx, rdata, EFUSE_READ))
+        goto out;
+    efuse_metrics_add (ctx->board_id, eMETRIC_VERIFY, t0);
+
+    ret = memcmp (rdata, wdata, EFUSE_UUID_SIZE) ? eEFUSE_WV_MISMATCH : eEFUSE_WV_WRITTEN;
+    if (ret == eEFUSE_WV_MISMATCH) {
+        dbg_msg ("error, verify. write = %s, read = %s\n", wdata, rdata);
+        ctx_error (ctx, eEFUSE_ERR_IO);
+    }
+    ctx_journal_state (ctx, (ret == eEFUSE_WV_WRITTEN) ?
+                        eJOURNAL_VERIFIED : eJOURNAL_MISMATCH, 1);
+out:
+    // write 이후 실패 (sync, read back 등)
+    ctx_journal_state (ctx, eJOURNAL_FAILED, 1);
+    if (own_session && !efuse_ctx_end (ctx))
+        ret = eEFUSE_WV_ERROR;
+    if (read_data != NULL) {
+        memset (read_data, 0, EFUSE_UUID_SIZE +1);
+        memcpy (read_data, rdata, EFUSE_UUID_SIZE);
+    }
+    return ret;
+}
+
+//------------------------------------------------------------------------------
+// deadline은 read/write/sync/read back 전체에 적용.
+//------------------------------------------------------------------------------
+int efuse_ctx_write_verify (efuse_ctx *ctx, const char *efuse_data, char *read_data)
+{
+    long long t0 = efuse_metrics_now ();
+    int ret;
+
+    ctx_op_begin (ctx);
+    ret = ctx_write_verify (ctx, efuse_data, read_data);
+    if ((ret == eEFUSE_WV_WRITTEN) || (ret == eEFUSE_WV_UNCHANGED))
+        ctx->last_error = eEFUSE_OK;
+    efuse_metrics_add (ctx->board_id, eMETRIC_WRITE_VERIFY, t0);
+
+    // label은 worker가 출력 (queue full이면 대기). 실패해도 write 결과는 유지.
+    if ((ret == eEFUSE_WV_WRITTEN) && (ctx->label != NULL) &&
+        !efuse_label_push (ctx->label, ctx->board_id, efuse_data)) {
+        dbg_msg ("error, label queue. (%s)\n", strerror (errno));
+    }
+    return ctx_op_end (ctx, ret);
+}
+
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
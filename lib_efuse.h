@@ -16,6 +16,12 @@
 #ifndef __LIB_EFUSE_H__
 #define __LIB_EFUSE_H__
 
+//------------------------------------------------------------------------------
+#include <sys/types.h>
+
+//------------------------------------------------------------------------------
+#define LIB_EFUSE_VERSION   "0.2"
+
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
 // ODROID-M1S
@@ -33,6 +39,13 @@
 // uuid + mac (00000000-0000-0000-0000-001e06xxxxxx)
 #define EFUSE_UUID_SIZE 36
 
+// binary uuid (16 bytes, 마지막 6 bytes = mac)
+#define EFUSE_UUID_BIN_SIZE 16
+
+struct efuse_uuid {
+    unsigned char   b [EFUSE_UUID_BIN_SIZE];
+};
+
 //------------------------------------------------------------------------------
 #define IOC_WRITE       0x7673
 #define IOC_DUMP        0x7674
@@ -54,6 +67,37 @@ struct ioc_data {
     char            uuid [32];
 }   __attribute__((packed));
 
+// IOC_DUMP : header 뒤의 data에 uuid flash[offset .. offset + len] 복사.
+struct ioc_dump_data {
+    char            mstr[4];
+    int             offset;
+    int             len;
+    unsigned char   cksum;
+    char            data [UUID_FLASH_SIZE];
+}   __attribute__((packed));
+
+//------------------------------------------------------------------------------
+// uuid flash slot (UUID_WRITE_SIZE 단위). write는 empty slot에만 가능하며
+// 새 uuid write 후 이전 slot은 erase 됨.
+//------------------------------------------------------------------------------
+#define UUID_SLOT_CNT   (UUID_FLASH_SIZE / UUID_WRITE_SIZE)
+
+enum {
+    eSLOT_EMPTY = 0,
+    eSLOT_VALID,
+    eSLOT_ERASED,
+    eSLOT_INVALID,
+};
+
+struct efuse_slot_info {
+    int             state   [UUID_SLOT_CNT];
+    unsigned char   cksum   [UUID_SLOT_CNT];
+    char            uuid    [UUID_SLOT_CNT][UUID_WRITE_SIZE +1];
+    int             active;     // 현재 uuid slot (-1 = 없음)
+    int             next_free;  // 다음 write slot (-1 = 없음)
+    int             remain;     // 남은 write 가능 횟수
+};
+
 //------------------------------------------------------------------------------
 enum {
     eBOARD_ID_M1 = 0,
@@ -64,11 +108,134 @@ enum {
     eBOARD_ID_END
 };
 
+//------------------------------------------------------------------------------
+// Device I/O backend. efuse_ctx의 모든 device access는 이 vtable을 통해 처리.
+// priv는 backend 전용 data이며 모든 함수의 첫번째 인자로 전달됨.
+// 반환값/errno는 해당 system call과 동일.
+//------------------------------------------------------------------------------
+struct efuse_io {
+    const char  *name;
+    void        *priv;
+
+    int     (*access)   (void *priv, const char *path);
+    int     (*open)     (void *priv, const char *path, int flags);
+    int     (*close)    (void *priv, int fd);
+    ssize_t (*pread)    (void *priv, int fd, void *buf, size_t size, off_t offset);
+    ssize_t (*pwrite)   (void *priv, int fd, const void *buf, size_t size, off_t offset);
+    int     (*ioctl)    (void *priv, int fd, unsigned long request, void *arg);
+    int     (*fdatasync)(void *priv, int fd);
+};
+
+extern const struct efuse_io efuse_io_kernel;
+
+//------------------------------------------------------------------------------
+// efuse_ctx_write_verify() result
+//------------------------------------------------------------------------------
+enum {
+    eEFUSE_WV_ERROR = 0,    // device access error
+    eEFUSE_WV_UNCHANGED,    // 이미 같은 data, write 하지 않음
+    eEFUSE_WV_WRITTEN,      // write 및 read back 확인 완료
+    eEFUSE_WV_MISMATCH,     // write 후 read back data 다름
+};
+
+//------------------------------------------------------------------------------
+// efuse_ctx_last_error() result. 실패한 operation의 첫번째 원인.
+//------------------------------------------------------------------------------
+enum {
+    eEFUSE_OK = 0,
+    eEFUSE_ERR_PARAM,       // 잘못된 입력 (uuid 형식, control cmd 등)
+    eEFUSE_ERR_NODEV,       // device/control file 없음 또는 open 실패
+    eEFUSE_ERR_IO,          // read/write/ioctl 실패 또는 size 다름
+    eEFUSE_ERR_LOCK,        // emmc force_ro unlock/lock 실패
+    eEFUSE_ERR_NOSPACE,     // uuid flash에 write 가능한 slot 없음
+    eEFUSE_ERR_TIMEOUT,     // operation deadline 초과
+    eEFUSE_ERR_CANCELED,    // efuse_ctx_cancel()
+    eEFUSE_ERR_BUSY,        // timeout된 이전 device 요청이 아직 끝나지 않음
+    eEFUSE_ERR_JOURNAL,     // intent journal 기록 실패 (device write 하지 않음)
+    eEFUSE_ERR_OWNER,       // 다른 process/ctx가 device 사용중 (대기하지 않는 경우)
+    eEFUSE_ERR_END
+};
+
+//------------------------------------------------------------------------------
+// operation deadline / retry 설정 (efuse_ctx_control, efuse_ctx_write_verify).
+// timeout_ms > 0 이면 device pread/pwrite/ioctl/fdatasync는 context별 I/O thread
+// 에서 실행되고, deadline이 지나면 기다리지 않고 eEFUSE_ERR_TIMEOUT으로 return.
+// 재시도는 일시적 error(NODEV, IO, LOCK)에만 적용, backoff는 재시도마다 2배.
+//------------------------------------------------------------------------------
+struct efuse_retry {
+    int     timeout_ms;     // operation 전체 deadline, 0 = 무제한
+    int     retry_cnt;      // 재시도 횟수, 0 = 재시도 없음
+    int     backoff_ms;     // 첫번째 재시도 전 대기 시간
+    int     backoff_max_ms; // 최대 대기 시간
+};
+
+//------------------------------------------------------------------------------
+// Device context (opaque). 하나의 process에서 여러 board/device를 동시에 제어.
+// context간 공유되는 mutable data가 없으므로 thread별 context 사용시 lock 불필요.
+//------------------------------------------------------------------------------
+typedef struct efuse_ctx efuse_ctx;
+
+// intent journal (lib_efuse_journal.h), device owner table (lib_efuse_owner.h),
+// label print queue (lib_efuse_label.h)
+struct efuse_journal;
+struct efuse_owner;
+struct efuse_label;
+
+// daemon/batch/prov 내부 ctx 생성 직후 호출 (journal, owner, label, trace 설정 등).
+// 여러 thread에서 동시에 호출될 수 있음.
+typedef void (*efuse_ctx_init_cb) (void *arg, efuse_ctx *ctx);
+
 //------------------------------------------------------------------------------
 //	function prototype
 //------------------------------------------------------------------------------
+extern efuse_ctx *efuse_ctx_open        (int board_id);
+extern void       efuse_ctx_close       (efuse_ctx *ctx);
+extern int        efuse_ctx_set_path    (efuse_ctx *ctx, const char *rw_control, const char *rw_file);
+extern int        efuse_ctx_get_path    (const efuse_ctx *ctx, const char **rw_control, const char **rw_file);
+extern int        efuse_ctx_set_offset  (efuse_ctx *ctx, int rw_offset);
+extern int        efuse_ctx_get_offset  (const efuse_ctx *ctx);
+extern int        efuse_ctx_set_io      (efuse_ctx *ctx, const struct efuse_io *io);
+extern const struct efuse_io *efuse_ctx_get_io (const efuse_ctx *ctx);
+extern const struct efuse_io *efuse_ctx_get_backend (const efuse_ctx *ctx);
+extern int        efuse_ctx_get_board   (const efuse_ctx *ctx);
+extern int        efuse_ctx_valid_check (const efuse_ctx *ctx, const char *efuse_data);
+extern void       efuse_ctx_get_mac     (const efuse_ctx *ctx, const char *efuse_data, char *mac);
+extern int        efuse_ctx_control     (efuse_ctx *ctx, char *efuse_data, char control);
+extern int        efuse_ctx_slot_scan   (efuse_ctx *ctx, struct efuse_slot_info *info);
+extern int        efuse_ctx_begin       (efuse_ctx *ctx, int write);
+extern int        efuse_ctx_end         (efuse_ctx *ctx);
+extern int        efuse_ctx_write_verify(efuse_ctx *ctx, const char *efuse_data, char *read_data);
+extern int        efuse_ctx_set_retry   (efuse_ctx *ctx, const struct efuse_retry *retry);
+extern int        efuse_ctx_set_journal (efuse_ctx *ctx, struct efuse_journal *journal);
+extern struct efuse_journal *efuse_ctx_get_journal (const efuse_ctx *ctx);
+extern int        efuse_ctx_set_owner   (efuse_ctx *ctx, struct efuse_owner *owner);
+extern struct efuse_owner *efuse_ctx_get_owner (const efuse_ctx *ctx);
+extern int        efuse_ctx_set_label   (efuse_ctx *ctx, struct efuse_label *label);
+extern struct efuse_label *efuse_ctx_get_label (const efuse_ctx *ctx);
+extern int        efuse_ctx_owner_get   (efuse_ctx *ctx, int wait);
+extern void       efuse_ctx_owner_put   (efuse_ctx *ctx);
+extern void       efuse_ctx_cancel      (efuse_ctx *ctx, int cancel);
+extern int        efuse_ctx_last_error  (const efuse_ctx *ctx);
+extern const char *efuse_strerror       (int error);
+extern int        efuse_get_mac_range   (int board_id, unsigned long long *mac_start, int *mac_cnt);
+
+// uuid 변환 (lib_efuse_uuid.c). heap 사용 없음, thread safe.
+extern int        efuse_hex_byte        (const char *hex);
+extern int        efuse_uuid_parse      (const char *str, struct efuse_uuid *uuid);
+extern void       efuse_uuid_format     (const struct efuse_uuid *uuid, char *str);
+extern void       efuse_uuid_hex        (const struct efuse_uuid *uuid, char *hex);
+extern unsigned long long efuse_uuid_mac(const struct efuse_uuid *uuid);
+extern void       efuse_uuid_set_mac    (struct efuse_uuid *uuid, unsigned long long mac);
+extern int        efuse_uuid_generate   (int board_id, const unsigned long long *macs, int cnt,
+                                         char *out, size_t out_size);
+
+// default context를 사용하는 기존 API.
 extern int  efuse_set_board_str (char *bd_name);
 extern int  efuse_set_board     (int board_id);
+extern int  efuse_set_journal   (struct efuse_journal *journal);
+extern int  efuse_set_owner     (struct efuse_owner *owner);
+extern int  efuse_set_label     (struct efuse_label *label);
+extern efuse_ctx *efuse_get_ctx (void);
 extern int  efuse_get_board     (void);
 extern int  efuse_valid_check   (const char *efuse_data);
 extern void efuse_get_mac       (const char *efuse_data, char *mac);
@@ -0,0 +1,424 @@
+//------------------------------------------------------------------------------
+/**
+ * @file lib_efuse.hpp
+ * @author charles-park (charles.park@hardkernel.com)
+ * @brief efuse library C++17 wrapper (header only).
+ * @version 0.2
+ * @date 2023-09-22
+ *
+ * @package apt install cups cups-bsd
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+//------------------------------------------------------------------------------
+#ifndef __LIB_EFUSE_HPP__
+#define __LIB_EFUSE_HPP__
+
+//------------------------------------------------------------------------------
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+extern "C" {
+#include "lib_efuse.h"
+#include "lib_efuse_board.h"
+}
+
+//------------------------------------------------------------------------------
+namespace efuse {
+
+//------------------------------------------------------------------------------
+// device 접근 방식
+//   Ioctl : /dev/efuse ioctl (uuid flash slot, m1/c4)
+//   Emmc  : eMMC boot partition pwrite, force_ro unlock/lock (m1s/m2)
+//   Sysfs : sysfs file pwrite (c5)
+//------------------------------------------------------------------------------
+enum class Access { Ioctl, Emmc, Sysfs };
+
+//------------------------------------------------------------------------------
+// board 상수. lib_efuse_board.c의 board table과 동일해야 함 (make test에서 traits_check()).
+//------------------------------------------------------------------------------
+template <int BoardId> struct BoardTraits;
+
+template <> struct BoardTraits<eBOARD_ID_M1> {
+    static constexpr const char *name       = "m1";
+    static constexpr const char *rw_control = "/dev/efuse";
+    static constexpr const char *rw_file    = "/sys/class/efuse/uuid";
+    static constexpr unsigned long long mac_start = 0x001E06510000ULL;
+    static constexpr int    mac_block_cnt   = 2;
+    static constexpr int    rw_offset       = 0;
+    static constexpr int    legacy_block    = -1;
+    static constexpr Access access          = Access::Ioctl;
+};
+
+template <> struct BoardTraits<eBOARD_ID_M1S> {
+    static constexpr const char *name       = "m1s";
+    static constexpr const char *rw_control = "/sys/class/block/mmcblk0boot0/force_ro";
+    static constexpr const char *rw_file    = "/dev/mmcblk0boot0";
+    static constexpr unsigned long long mac_start = 0x001E06530000ULL;
+    static constexpr int    mac_block_cnt   = 2;
+    static constexpr int    rw_offset       = 0;
+    static constexpr int    legacy_block    = -1;
+    static constexpr Access access          = Access::Emmc;
+};
+
+template <> struct BoardTraits<eBOARD_ID_M2> {
+    static constexpr const char *name       = "m2";
+    static constexpr const char *rw_control = "/sys/class/block/mmcblk0boot1/force_ro";
+    static constexpr const char *rw_file    = "/dev/mmcblk0boot1";
+    static constexpr unsigned long long mac_start = 0x001E06550000ULL;
+    static constexpr int    mac_block_cnt   = 2;
+    static constexpr int    rw_offset       = 8191 * 512;
+    static constexpr int    legacy_block    = -1;
+    static constexpr Access access          = Access::Emmc;
+};
+
+template <> struct BoardTraits<eBOARD_ID_C4> {
+    static constexpr const char *name       = "c4";
+    static constexpr const char *rw_control = "/dev/efuse";
+    static constexpr const char *rw_file    = "/sys/class/efuse/uuid";
+    static constexpr unsigned long long mac_start = 0x001E064A0000ULL;
+    static constexpr int    mac_block_cnt   = 3;
+    static constexpr int    rw_offset       = 0;
+    static constexpr int    legacy_block    = 0x48;     // 0x001E0648xxxx
+    static constexpr Access access          = Access::Ioctl;
+};
+
+template <> struct BoardTraits<eBOARD_ID_C5> {
+    static constexpr const char *name       = "c5";
+    static constexpr const char *rw_control = "/dev/efuse";
+    static constexpr const char *rw_file    = "/sys/class/efuse/uuid";
+    static constexpr unsigned long long mac_start = 0x001E06570000ULL;
+    static constexpr int    mac_block_cnt   = 2;
+    static constexpr int    rw_offset       = 0;
+    static constexpr int    legacy_block    = -1;
+    static constexpr Access access          = Access::Sysfs;
+};
+
+//------------------------------------------------------------------------------
+// uuid 문자열 검사 (constexpr). lib_efuse_uuid.c의 efuse_uuid_parse와 같은 형식.
+//------------------------------------------------------------------------------
+constexpr int hex_val (char c)
+{
+    return (c >= '0' && c <= '9') ? c - '0' :
+           (c >= 'A' && c <= 'F') ? c - 'A' + 10 :
+           (c >= 'a' && c <= 'f') ? c - 'a' + 10 : -1;
+}
+
+constexpr bool uuid_format_ok (std::string_view uuid)
+{
+    if (uuid.size () != EFUSE_UUID_SIZE)
+        return false;
+    for (std::size_t i = 0; i < uuid.size (); i++) {
+        if ((i == 8) || (i == 13) || (i == 18) || (i == 23)) {
+            if (uuid[i] != '-')
+                return false;
+        } else if (hex_val (uuid[i]) < 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// uuid 마지막 12문자 -> mac. 형식 error는 0.
+constexpr unsigned long long uuid_mac (std::string_view uuid)
+{
+    unsigned long long mac = 0;
+
+    if (!uuid_format_ok (uuid))
+        return 0;
+    for (std::size_t i = EFUSE_UUID_SIZE - MAC_STR_SIZE; i < EFUSE_UUID_SIZE; i++)
+        mac = (mac << 4) | (unsigned long long)hex_val (uuid[i]);
+    return mac;
+}
+
+//------------------------------------------------------------------------------
+// traits + compile time 계산 값
+//------------------------------------------------------------------------------
+template <int BoardId>
+struct Board : BoardTraits<BoardId> {
+    using traits = BoardTraits<BoardId>;
+
+    static constexpr int    id          = BoardId;
+    static constexpr int    mac_cnt     = traits::mac_block_cnt * 65536;
+    static constexpr unsigned long long mac_end = traits::mac_start + mac_cnt;
+    static constexpr int    size_byte   = EFUSE_UUID_SIZE;
+
+    static_assert ((traits::mac_start >> 24) == 0x001E06, "not odroid mac");
+    static_assert ((traits::mac_start & 0xFFFF) == 0, "mac block align");
+    static_assert (traits::rw_offset >= 0, "rw offset");
+
+    static constexpr bool mac_in_range (unsigned long long mac)
+    {
+        if ((mac >= traits::mac_start) && (mac < mac_end))
+            return true;
+        return (traits::legacy_block >= 0) &&
+               ((mac >> 16) == ((0x001E06ULL << 8) | (unsigned long long)traits::legacy_block));
+    }
+
+    // efuse_ctx_valid_check와 같은 기준 (uuid 형식 + board mac 범위).
+    static constexpr bool valid (std::string_view uuid)
+    {
+        return uuid_format_ok (uuid) && mac_in_range (uuid_mac (uuid));
+    }
+};
+
+//------------------------------------------------------------------------------
+// board device (RAII). 생성시 ctx open, 소멸시 close.
+//------------------------------------------------------------------------------
+template <int BoardId>
+class Efuse {
+public:
+    using board = Board<BoardId>;
+
+    Efuse () : ctx_ (efuse_ctx_open (BoardId))
+    {
+        if (ctx_ != nullptr) {
+            efuse_ctx_set_path   (ctx_, board::rw_control, board::rw_file);
+            efuse_ctx_set_offset (ctx_, board::rw_offset);
+        }
+    }
+    // device path 변경 (test jig 등)
+    Efuse (const char *rw_control, const char *rw_file) : Efuse ()
+    {
+        if (ctx_ != nullptr)
+            efuse_ctx_set_path (ctx_, rw_control, rw_file);
+    }
+    ~Efuse () { if (ctx_ != nullptr) efuse_ctx_close (ctx_); }
+
+    Efuse (const Efuse &) = delete;
+    Efuse &operator= (const Efuse &) = delete;
+    Efuse (Efuse &&o) noexcept : ctx_ (std::exchange (o.ctx_, nullptr)) {}
+    Efuse &operator= (Efuse &&o) noexcept
+    {
+        if (this != &o) {
+            if (ctx_ != nullptr)
+                efuse_ctx_close (ctx_);
+            ctx_ = std::exchange (o.ctx_, nullptr);
+        }
+        return *this;
+    }
+
+    explicit operator bool () const { return ctx_ != nullptr; }
+    efuse_ctx *native () const      { return ctx_; }
+    static constexpr int id ()      { return BoardId; }
+    static constexpr Access access (){ return board::access; }
+
+    bool set_io (const struct efuse_io *io)
+    {
+        return (ctx_ != nullptr) && efuse_ctx_set_io (ctx_, io);
+    }
+
+    std::optional<std::string> read () const
+    {
+        char data [EFUSE_UUID_SIZE +1] = { 0 };
+
+        if ((ctx_ == nullptr) || !efuse_ctx_control (ctx_, data, EFUSE_READ))
+            return std::nullopt;
+        return std::string (data, strnlen (data, EFUSE_UUID_SIZE));
+    }
+
+    // board mac 범위 밖의 uuid는 device 접근 없이 fail.
+    bool write (std::string_view uuid)
+    {
+        char data [EFUSE_UUID_SIZE +1] = { 0 };
+
+        if ((ctx_ == nullptr) || !board::valid (uuid))
+            return false;
+        std::memcpy (data, uuid.data (), EFUSE_UUID_SIZE);
+        if constexpr (board::access == Access::Emmc) {
+            // unlock/write/lock을 한 session(같은 descriptor)에서 처리.
+            Session s (ctx_, true);
+            return s && efuse_ctx_control (ctx_, data, EFUSE_WRITE);
+        } else {
+            return efuse_ctx_control (ctx_, data, EFUSE_WRITE);
+        }
+    }
+
+    bool erase ()
+    {
+        char data [EFUSE_UUID_SIZE +1] = { 0 };
+
+        return (ctx_ != nullptr) && efuse_ctx_control (ctx_, data, EFUSE_ERASE);
+    }
+
+    // return : eEFUSE_WV_xxx
+    int write_verify (std::string_view uuid, std::string *read_back = nullptr)
+    {
+        char data [EFUSE_UUID_SIZE +1] = { 0 }, rdata [EFUSE_UUID_SIZE +1] = { 0 };
+        int ret;
+
+        if ((ctx_ == nullptr) || !board::valid (uuid))
+            return eEFUSE_WV_ERROR;
+        std::memcpy (data, uuid.data (), EFUSE_UUID_SIZE);
+        ret = efuse_ctx_write_verify (ctx_, data, rdata);
+        if (read_back != nullptr)
+            read_back->assign (rdata, strnlen (rdata, EFUSE_UUID_SIZE));
+        return ret;
+    }
+
+    static constexpr bool valid (std::string_view uuid) { return board::valid (uuid); }
+
+    static constexpr std::string_view mac (std::string_view uuid)
+    {
+        return uuid_format_ok (uuid) ?
+            uuid.substr (EFUSE_UUID_SIZE - MAC_STR_SIZE, MAC_STR_SIZE) : std::string_view ();
+    }
+
+    //--------------------------------------------------------------------------
+    // efuse_ctx_begin/end RAII. 여러 operation을 같은 descriptor로 처리.
+    //--------------------------------------------------------------------------
+    class Session {
+    public:
+        Session (efuse_ctx *ctx, bool write)
+            : ctx_ ((ctx != nullptr) && efuse_ctx_begin (ctx, write) ? ctx : nullptr) {}
+        ~Session () { if (ctx_ != nullptr) efuse_ctx_end (ctx_); }
+        Session (const Session &) = delete;
+        Session &operator= (const Session &) = delete;
+        explicit operator bool () const { return ctx_ != nullptr; }
+    private:
+        efuse_ctx *ctx_;
+    };
+
+    Session session (bool write) { return Session (ctx_, write); }
+
+private:
+    efuse_ctx *ctx_;
+};
+
+//------------------------------------------------------------------------------
+// runtime board id -> compile time board. f(Board<N>{}) 호출.
+//------------------------------------------------------------------------------
+template <class F>
+bool visit_board (int board_id, F &&f)
+{
+    switch (board_id) {
+        case eBOARD_ID_M1:  f (Board<eBOARD_ID_M1>{});  return true;
+        case eBOARD_ID_M1S: f (Board<eBOARD_ID_M1S>{}); return true;
+        case eBOARD_ID_M2:  f (Board<eBOARD_ID_M2>{});  return true;
+        case eBOARD_ID_C4:  f (Board<eBOARD_ID_C4>{});  return true;
+        case eBOARD_ID_C5:  f (Board<eBOARD_ID_C5>{});  return true;
+        default :           return false;
+    }
+}
+
+//------------------------------------------------------------------------------
+// C library board table과 traits 비교 (모든 항목). return : true = 일치
+//------------------------------------------------------------------------------
+inline bool traits_check ()
+{
+    bool ok = true;
+
+    for (int id = 0; id < eBOARD_ID_END; id++) {
+        ok = visit_board (id, [&ok] (auto b) {
+            using B = decltype (b);
+            constexpr int dev_type = (B::access == Access::Ioctl) ? eBOARD_DEV_IOCTL :
+                                     (B::access == Access::Emmc)  ? eBOARD_DEV_EMMC  :
+                                                                    eBOARD_DEV_SYSFS;
+            const struct efuse_board *info = efuse_board_info (B::id);
+            unsigned long long mac_start = 0;
+            const char *ctl = nullptr, *file = nullptr;
+            int mac_cnt = 0;
+            efuse_ctx *ctx;
+
+            if (info == nullptr) {
+                ok = false;
+                return;
+            }
+            ok = ok && !std::strcmp (info->name, B::name) &&
+                 !std::strcmp (info->rw_control, B::rw_control) &&
+                 !std::strcmp (info->rw_file, B::rw_file) &&
+                 (info->dev_type == dev_type) &&
+                 (info->mac_block_cnt == B::mac_block_cnt) &&
+                 (info->mac_rw_offset == B::rw_offset) &&
+                 (info->mac_legacy == ((B::legacy_block < 0) ? 0 : B::legacy_block)) &&
+                 (info->size_byte == B::size_byte);
+
+            efuse_get_mac_range (B::id, &mac_start, &mac_cnt);
+            ok = ok && (mac_start == B::mac_start) && (mac_cnt == B::mac_cnt);
+
+            // ctx 기본값 (Efuse<N> 생성시 설정하는 값과 같음)
+            if ((ctx = efuse_ctx_open (B::id)) == nullptr) {
+                ok = false;
+                return;
+            }
+            efuse_ctx_get_path (ctx, &ctl, &file);
+            ok = ok && !std::strcmp (ctl, B::rw_control) && !std::strcmp (file, B::rw_file) &&
+                 (efuse_ctx_get_offset (ctx) == B::rw_offset);
+            efuse_ctx_close (ctx);
+        }) && ok;
+    }
+    return ok;
+}
+
+//------------------------------------------------------------------------------
+// board를 runtime에 선택하는 경우 (type erasure).
+//------------------------------------------------------------------------------
+class AnyEfuse {
+public:
+    explicit AnyEfuse (int board_id)
+    {
+        visit_board (board_id, [this] (auto b) {
+            impl_ = std::make_unique<Model<decltype (b)::id>> ();
+        });
+    }
+
+    explicit operator bool () const { return impl_ && impl_->ok (); }
+    int  board () const             { return impl_ ? impl_->board () : -1; }
+    efuse_ctx *native () const      { return impl_ ? impl_->native () : nullptr; }
+    bool set_io (const struct efuse_io *io)     { return impl_ && impl_->set_io (io); }
+    std::optional<std::string> read () const    { return impl_ ? impl_->read () : std::nullopt; }
+    bool write (std::string_view uuid)          { return impl_ && impl_->write (uuid); }
+    bool erase ()                               { return impl_ && impl_->erase (); }
+    bool valid (std::string_view uuid) const    { return impl_ && impl_->valid (uuid); }
+    int  write_verify (std::string_view uuid, std::string *read_back = nullptr)
+    {
+        return impl_ ? impl_->write_verify (uuid, read_back) : eEFUSE_WV_ERROR;
+    }
+
+private:
+    struct Concept {
+        virtual ~Concept () = default;
+        virtual bool ok () const = 0;
+        virtual int  board () const = 0;
+        virtual efuse_ctx *native () const = 0;
+        virtual bool set_io (const struct efuse_io *io) = 0;
+        virtual std::optional<std::string> read () const = 0;
+        virtual bool write (std::string_view uuid) = 0;
+        virtual bool erase () = 0;
+        virtual bool valid (std::string_view uuid) const = 0;
+        virtual int  write_verify (std::string_view uuid, std::string *read_back) = 0;
+    };
+
+    template <int BoardId>
+    struct Model final : Concept {
+        Efuse<BoardId> dev;
+
+        bool ok () const override                   { return static_cast<bool> (dev); }
+        int  board () const override                { return BoardId; }
+        efuse_ctx *native () const override         { return dev.native (); }
+        bool set_io (const struct efuse_io *io) override { return dev.set_io (io); }
+        std::optional<std::string> read () const override { return dev.read (); }
+        bool write (std::string_view uuid) override { return dev.write (uuid); }
+        bool erase () override                      { return dev.erase (); }
+        bool valid (std::string_view uuid) const override { return dev.valid (uuid); }
+        int  write_verify (std::string_view uuid, std::string *read_back) override
+        {
+            return dev.write_verify (uuid, read_back);
+        }
+    };
+
+    std::unique_ptr<Concept> impl_;
+};
+
+//------------------------------------------------------------------------------
+} // namespace efuse
+
+//------------------------------------------------------------------------------
+#endif  // #ifndef __LIB_EFUSE_HPP__
+//------------------------------------------------------------------------------
@@ -0,0 +1,398 @@
+//------------------------------------------------------------------------------
+/**
+ * @file lib_efuse_alloc.c
+ * @author charles-park (charles.park@hardkernel.com)
+ * @brief efuse mac address allocator (mmap bitmap per board).
+ * @version 0.2
+ * @date 2023-09-22
+ *
+ * @package apt install cups cups-bsd
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "lib_efuse.h"
+#include "lib_efuse_alloc.h"
+
+//------------------------------------------------------------------------------
+// Debug msg
+//------------------------------------------------------------------------------
+#if defined (__LIB_EFUSE_APP__)
+    #define dbg_msg(fmt, args...)   printf(fmt, ##args)
+#else
+    #define dbg_msg(fmt, args...)
+#endif
+
+//------------------------------------------------------------------------------
+// map file layout : [header page][used bitmap][committed bitmap]
+// bitmap은 64bit word 단위로 atomic 처리 (MAP_SHARED, process간 공유).
+//------------------------------------------------------------------------------
+#define ALLOC_MAGIC     0x414D4645  // "EFMA"
+#define ALLOC_VERSION   1
+#define ALLOC_HDR_SIZE  4096
+
+struct alloc_hdr {
+    unsigned int        magic;
+    unsigned int        version;
+    unsigned int        board_id;
+    unsigned int        mac_cnt;
+    unsigned long long  mac_start;
+    // 다음 검색을 시작할 word index. 재시작시 rescan 없이 이어서 할당.
+    unsigned int        hint;
+};
+
+struct efuse_alloc {
+    struct alloc_hdr    *hdr;
+    unsigned long long  *used;
+    unsigned long long  *committed;
+    unsigned int        words;
+    size_t              map_size;
+};
+
+//------------------------------------------------------------------------------
+// function prototype
+//------------------------------------------------------------------------------
+static void alloc_sync      (const void *addr, size_t size);
+static int  alloc_index     (efuse_alloc *alloc, unsigned long long mac);
+static void alloc_set_hint  (efuse_alloc *alloc, unsigned int hint, int lower_only);
+
+efuse_alloc *efuse_alloc_open   (const char *map_file, int board_id);
+void efuse_alloc_close          (efuse_alloc *alloc);
+int  efuse_alloc_reserve_next   (efuse_alloc *alloc, unsigned long long *mac);
+int  efuse_alloc_reserve_batch  (efuse_alloc *alloc, unsigned long long *macs, int cnt);
+int  efuse_alloc_commit         (efuse_alloc *alloc, unsigned long long mac);
+int  efuse_alloc_release        (efuse_alloc *alloc, unsigned long long mac);
+int  efuse_alloc_claim          (efuse_alloc *alloc, unsigned long long mac);
+int  efuse_alloc_recover        (efuse_alloc *alloc);
+int  efuse_alloc_stat           (efuse_alloc *alloc, struct efuse_alloc_stat *stat);
+int  efuse_alloc_generate       (efuse_alloc *alloc, int cnt, unsigned long long *macs,
+                                 char *out, size_t out_size);
+
+//------------------------------------------------------------------------------
+// 변경된 bitmap을 storage에 기록 (power off 대비). msync는 page 단위.
+//------------------------------------------------------------------------------
+static void alloc_sync (const void *addr, size_t size)
+{
+    unsigned long page = (unsigned long)sysconf (_SC_PAGESIZE);
+    unsigned long start = (unsigned long)addr & ~(page - 1);
+
+    msync ((void *)start, ((unsigned long)addr + size) - start, MS_SYNC);
+}
+
+//------------------------------------------------------------------------------
+static int alloc_index (efuse_alloc *alloc, unsigned long long mac)
+{
+    if ((mac < alloc->hdr->mac_start) ||
+        (mac >= alloc->hdr->mac_start + alloc->hdr->mac_cnt))
+        return -1;
+    return (int)(mac - alloc->hdr->mac_start);
+}
+
+//------------------------------------------------------------------------------
+static void alloc_set_hint (efuse_alloc *alloc, unsigned int hint, int lower_only)
+{
+    unsigned int old = __atomic_load_n (&alloc->hdr->hint, __ATOMIC_RELAXED);
+
+    if (!lower_only) {
+        __atomic_store_n (&alloc->hdr->hint, hint % alloc->words, __ATOMIC_RELAXED);
+        return;
+    }
+    while (hint < old) {
+        if (__atomic_compare_exchange_n (&alloc->hdr->hint, &old, hint, 0,
+                                         __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            break;
+    }
+}
+
+//------------------------------------------------------------------------------
+// map file open. 파일이 없으면 board mac 범위로 새로 생성.
+//------------------------------------------------------------------------------
+efuse_alloc *efuse_alloc_open (const char *map_file, int board_id)
+{
+    unsigned long long mac_start;
+    int mac_cnt, fd, is_new = 0;
+    efuse_alloc *alloc;
+    struct stat st;
+    void *map;
+
+    if (!efuse_get_mac_range (board_id, &mac_start, &mac_cnt))
+        return NULL;
+
+    if ((alloc = calloc (1, sizeof(efuse_alloc))) == NULL)
+        return NULL;
+
+    alloc->words    = mac_cnt / 64;
+    alloc->map_size = ALLOC_HDR_SIZE + alloc->words * sizeof(unsigned long long) * 2;
+
+    if ((fd = open (map_file, O_RDWR | O_CREAT | O_CLOEXEC, 0644)) < 0) {
+        dbg_msg ("error, alloc map file open (%s)\n", map_file);
+        goto err_free;
+    }
+    // 동시에 생성하는 process간 초기화 충돌 방지.
+    flock (fd, LOCK_EX);
+    if (fstat (fd, &st) < 0)
+        goto err_close;
+
+    if (st.st_size == 0) {
+        if (ftruncate (fd, alloc->map_size) < 0)
+            goto err_close;
+        is_new = 1;
+    } else if ((size_t)st.st_size != alloc->map_size) {
+        dbg_msg ("error, alloc map size (%s, %ld != %ld)\n",
+            map_file, (long)st.st_size, (long)alloc->map_size);
+        goto err_close;
+    }
+
+    map = mmap (NULL, alloc->map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED)
+        goto err_close;
+
+    alloc->hdr       = (struct alloc_hdr *)map;
+    alloc->used      = (unsigned long long *)((char *)map + ALLOC_HDR_SIZE);
+    alloc->committed = alloc->used + alloc->words;
+
+    // ftruncate 후 magic 기록 전 crash : 초기화 되지 않은 map (flock 상태이므로 사용자 없음)
+    if (!is_new && (alloc->hdr->magic == 0)) {
+        dbg_msg ("alloc map header empty, initialize (%s)\n", map_file);
+        memset (map, 0, alloc->map_size);
+        is_new = 1;
+    }
+    if (is_new) {
+        alloc->hdr->version   = ALLOC_VERSION;
+        alloc->hdr->board_id  = board_id;
+        alloc->hdr->mac_cnt   = mac_cnt;
+        alloc->hdr->mac_start = mac_start;
+        alloc->hdr->hint      = 0;
+        alloc->hdr->magic     = ALLOC_MAGIC;
+        alloc_sync (map, alloc->map_size);
+    } else if ((alloc->hdr->magic     != ALLOC_MAGIC)   ||
+               (alloc->hdr->version   != ALLOC_VERSION) ||
+               (alloc->hdr->board_id  != (unsigned int)board_id) ||
+               (alloc->hdr->mac_cnt   != (unsigned int)mac_cnt)  ||
+               (alloc->hdr->mac_start != mac_start)) {
+        dbg_msg ("error, alloc map header mismatch (%s)\n", map_file);
+        munmap (map, alloc->map_size);
+        goto err_close;
+    }
+    flock (fd, LOCK_UN);
+    close (fd);
+    return alloc;
+
+err_close:
+    flock (fd, LOCK_UN);
+    close (fd);
+err_free:
+    free (alloc);
+    return NULL;
+}
+
+//------------------------------------------------------------------------------
+void efuse_alloc_close (efuse_alloc *alloc)
+{
+    if (alloc == NULL)
+        return;
+    munmap (alloc->hdr, alloc->map_size);
+    free (alloc);
+}
+
+//------------------------------------------------------------------------------
+int efuse_alloc_reserve_next (efuse_alloc *alloc, unsigned long long *mac)
+{
+    return efuse_alloc_reserve_batch (alloc, mac, 1) == 1 ? 1 : 0;
+}
+
+//------------------------------------------------------------------------------
+// hint word부터 free bit를 찾아 한번의 CAS로 word 내의 여러 bit를 reserve.
+// return : reserve된 mac 개수 (mac 범위가 부족하면 cnt 보다 작을 수 있음)
+//------------------------------------------------------------------------------
+int efuse_alloc_reserve_batch (efuse_alloc *alloc, unsigned long long *macs, int cnt)
+{
+    unsigned int idx, scanned = 0;
+    unsigned long long word, take, bits;
+    int got = 0, need;
+
+    if ((alloc == NULL) || (macs == NULL) || (cnt <= 0))
+        return 0;
+
+    idx = __atomic_load_n (&alloc->hdr->hint, __ATOMIC_RELAXED) % alloc->words;
+    while ((got < cnt) && (scanned <= alloc->words)) {
+        word = __atomic_load_n (&alloc->used[idx], __ATOMIC_ACQUIRE);
+        if (word == ~0ULL) {
+            idx = (idx + 1) % alloc->words;
+            scanned++;
+            continue;
+        }
+        for (take = 0, bits = ~word, need = cnt - got; bits && need; need--) {
+            take |= bits & (~bits + 1);
+            bits &= bits - 1;
+        }
+        // 다른 thread/process가 먼저 변경한 경우 같은 word 재시도.
+        if (!__atomic_compare_exchange_n (&alloc->used[idx], &word, word | take, 0,
+                                          __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+            continue;
+
+        for (bits = take; bits; bits &= bits - 1)
+            macs[got++] = alloc->hdr->mac_start +
+                          (unsigned long long)idx * 64 + __builtin_ctzll (bits);
+
+        if ((word | take) == ~0ULL) {
+            idx = (idx + 1) % alloc->words;
+            scanned++;
+        }
+    }
+    if (got) {
+        alloc_set_hint (alloc, idx, 0);
+        alloc_sync (alloc->used, alloc->words * sizeof(unsigned long long));
+    }
+    return got;
+}
+
+//------------------------------------------------------------------------------
+// efuse write가 완료된 mac 표시. reserve 되지 않은 mac은 commit 불가.
+//------------------------------------------------------------------------------
+int efuse_alloc_commit (efuse_alloc *alloc, unsigned long long mac)
+{
+    int index = alloc_index (alloc, mac);
+    unsigned long long bit;
+
+    if (index < 0)
+        return 0;
+
+    bit = 1ULL << (index % 64);
+    if (!(__atomic_load_n (&alloc->used[index / 64], __ATOMIC_ACQUIRE) & bit)) {
+        dbg_msg ("error, commit mac is not reserved. (%012llX)\n", mac);
+        return 0;
+    }
+    __atomic_fetch_or (&alloc->committed[index / 64], bit, __ATOMIC_ACQ_REL);
+    alloc_sync (&alloc->committed[index / 64], sizeof(unsigned long long));
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+// 사용하지 않은 reserve mac 반환. commit된 mac은 반환 불가.
+//------------------------------------------------------------------------------
+int efuse_alloc_release (efuse_alloc *alloc, unsigned long long mac)
+{
+    int index = alloc_index (alloc, mac);
+    unsigned long long bit;
+
+    if (index < 0)
+        return 0;
+
+    bit = 1ULL << (index % 64);
+    if (__atomic_load_n (&alloc->committed[index / 64], __ATOMIC_ACQUIRE) & bit) {
+        dbg_msg ("error, release mac is committed. (%012llX)\n", mac);
+        return 0;
+    }
+    if (!(__atomic_fetch_and (&alloc->used[index / 64], ~bit, __ATOMIC_ACQ_REL) & bit))
+        return 0;
+
+    alloc_set_hint (alloc, index / 64, 1);
+    alloc_sync (&alloc->used[index / 64], sizeof(unsigned long long));
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+// 이미 사용된 mac(기존 CSV 등) 등록. 다른 곳에서 사용중이면 fail.
+//------------------------------------------------------------------------------
+int efuse_alloc_claim (efuse_alloc *alloc, unsigned long long mac)
+{
+    int index = alloc_index (alloc, mac);
+    unsigned long long bit;
+
+    if (index < 0)
+        return 0;
+
+    bit = 1ULL << (index % 64);
+    if (__atomic_fetch_or (&alloc->used[index / 64], bit, __ATOMIC_ACQ_REL) & bit)
+        return 0;
+
+    alloc_sync (&alloc->used[index / 64], sizeof(unsigned long long));
+    return efuse_alloc_commit (alloc, mac);
+}
+
+//------------------------------------------------------------------------------
+// crash 등으로 commit 되지 못한 reserve mac을 모두 반환.
+// map file을 사용하는 다른 process가 없을때만 호출하여야 함.
+// return : 반환된 mac 개수
+//------------------------------------------------------------------------------
+int efuse_alloc_recover (efuse_alloc *alloc)
+{
+    unsigned long long pending;
+    unsigned int i;
+    int cnt = 0;
+
+    for (i = 0; i < alloc->words; i++) {
+        pending = __atomic_load_n (&alloc->used[i], __ATOMIC_ACQUIRE) &
+                  ~__atomic_load_n (&alloc->committed[i], __ATOMIC_ACQUIRE);
+        if (!pending)
+            continue;
+        __atomic_fetch_and (&alloc->used[i], ~pending, __ATOMIC_ACQ_REL);
+        cnt += __builtin_popcountll (pending);
+    }
+    alloc_set_hint (alloc, 0, 0);
+    alloc_sync (alloc->used, alloc->words * sizeof(unsigned long long));
+    return cnt;
+}
+
+//------------------------------------------------------------------------------
+int efuse_alloc_stat (efuse_alloc *alloc, struct efuse_alloc_stat *stat)
+{
+    unsigned long long used, committed;
+    unsigned int i;
+
+    if ((alloc == NULL) || (stat == NULL))
+        return 0;
+
+    memset (stat, 0, sizeof(struct efuse_alloc_stat));
+    stat->mac_cnt = alloc->hdr->mac_cnt;
+    for (i = 0; i < alloc->words; i++) {
+        used      = __atomic_load_n (&alloc->used[i], __ATOMIC_RELAXED);
+        committed = __atomic_load_n (&alloc->committed[i], __ATOMIC_RELAXED);
+
+        stat->reserved_cnt  += __builtin_popcountll (used & ~committed);
+        stat->committed_cnt += __builtin_popcountll (committed);
+    }
+    stat->free_cnt = stat->mac_cnt - stat->reserved_cnt - stat->committed_cnt;
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+// mac reserve + write용 uuid record 생성 (efuse_uuid_generate 참조).
+// macs : cnt 개의 reserve 결과. commit은 efuse write 후 호출자가 처리.
+// return : 생성한 record 수 (mac 범위가 부족하면 cnt 보다 작을 수 있음)
+//------------------------------------------------------------------------------
+int efuse_alloc_generate (efuse_alloc *alloc, int cnt, unsigned long long *macs,
+                          char *out, size_t out_size)
+{
+    int i, got;
+
+    if ((alloc == NULL) || (out_size < (size_t)cnt * (EFUSE_UUID_SIZE + 1)))
+        return 0;
+
+    if ((got = efuse_alloc_reserve_batch (alloc, macs, cnt)) <= 0)
+        return 0;
+
+    if (!efuse_uuid_generate (alloc->hdr->board_id, macs, got, out, out_size)) {
+        for (i = 0; i < got; i++)
+            efuse_alloc_release (alloc, macs[i]);
+        return 0;
+    }
+    return got;
+}
+
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
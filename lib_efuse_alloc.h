@@ -0,0 +1,54 @@
+//------------------------------------------------------------------------------
+/**
+ * @file lib_efuse_alloc.h
+ * @author charles-park (charles.park@hardkernel.com)
+ * @brief efuse mac address allocator (mmap bitmap per board).
+ * @version 0.2
+ * @date 2023-09-22
+ *
+ * @package apt install cups cups-bsd
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#ifndef __LIB_EFUSE_ALLOC_H__
+#define __LIB_EFUSE_ALLOC_H__
+
+//------------------------------------------------------------------------------
+#include "lib_efuse.h"
+
+//------------------------------------------------------------------------------
+// map file 1개 = board 1개의 mac 범위.
+// reserve : 사용중(used) 표시, commit : efuse write 완료(committed) 표시.
+// release는 commit되지 않은 mac만 가능. 여러 process/thread가 같은 map file을
+// 동시에 open하여 사용할 수 있음.
+//------------------------------------------------------------------------------
+typedef struct efuse_alloc efuse_alloc;
+
+struct efuse_alloc_stat {
+    int     mac_cnt;
+    int     free_cnt;
+    int     reserved_cnt;   // reserve 후 commit 되지 않은 mac
+    int     committed_cnt;
+};
+
+//------------------------------------------------------------------------------
+//	function prototype
+//------------------------------------------------------------------------------
+extern efuse_alloc *efuse_alloc_open    (const char *map_file, int board_id);
+extern void  efuse_alloc_close          (efuse_alloc *alloc);
+extern int   efuse_alloc_reserve_next   (efuse_alloc *alloc, unsigned long long *mac);
+extern int   efuse_alloc_reserve_batch  (efuse_alloc *alloc, unsigned long long *macs, int cnt);
+extern int   efuse_alloc_commit         (efuse_alloc *alloc, unsigned long long mac);
+extern int   efuse_alloc_release        (efuse_alloc *alloc, unsigned long long mac);
+extern int   efuse_alloc_claim          (efuse_alloc *alloc, unsigned long long mac);
+extern int   efuse_alloc_recover        (efuse_alloc *alloc);
+extern int   efuse_alloc_stat           (efuse_alloc *alloc, struct efuse_alloc_stat *stat);
+extern int   efuse_alloc_generate       (efuse_alloc *alloc, int cnt, unsigned long long *macs,
+                                         char *out, size_t out_size);
+
+//------------------------------------------------------------------------------
+#endif  // #ifndef __LIB_EFUSE_ALLOC_H__
+//------------------------------------------------------------------------------
@@ -0,0 +1,278 @@
+//------------------------------------------------------------------------------
+/**
+ * @file lib_efuse_audit.c
+ * @author charles-park (charles.park@hardkernel.com)
+ * @brief efuse uuid batch validator and board classifier.
+ * @version 0.2
+ * @date 2023-09-22
+ *
+ * @package apt install cups cups-bsd
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "lib_efuse.h"
+#include "lib_efuse_audit.h"
+#include "lib_efuse_board.h"
+
+//------------------------------------------------------------------------------
+// Debug msg
+//------------------------------------------------------------------------------
+#if defined (__LIB_EFUSE_APP__)
+    #define dbg_msg(fmt, args...)   printf(fmt, ##args)
+#else
+    #define dbg_msg(fmt, args...)
+#endif
+
+//------------------------------------------------------------------------------
+// odroid mac 4번째 byte(0x001E06xx) -> board id. 할당되지 않은 block은 eAUDIT_UNKNOWN.
+//------------------------------------------------------------------------------
+static signed char BoardIndex [256];
+static pthread_once_t BoardIndexOnce = PTHREAD_ONCE_INIT;
+
+struct audit_chunk {
+    const char              *buf;
+    size_t                  size;
+    long                    base;
+    efuse_audit_cb          cb;
+    void                    *arg;
+    struct efuse_audit_stat stat;
+};
+
+//------------------------------------------------------------------------------
+// function prototype
+//------------------------------------------------------------------------------
+static void  board_index_init   (void);
+static void  audit_record       (struct audit_chunk *chunk, const char *line, int len);
+static void  audit_chunk_run    (struct audit_chunk *chunk);
+static void *audit_thread       (void *arg);
+static void  audit_stat_add     (struct efuse_audit_stat *dst, const struct efuse_audit_stat *src);
+
+int  efuse_audit_classify       (const char *uuid);
+int  efuse_audit_mac            (unsigned long long mac);
+int  efuse_audit_buffer         (const char *buf, size_t size,
+                                 struct efuse_audit_stat *stat,
+                                 efuse_audit_cb cb, void *arg);
+int  efuse_audit_file           (const char *path, int threads,
+                                 struct efuse_audit_stat *stat,
+                                 efuse_audit_cb cb, void *arg);
+
+//------------------------------------------------------------------------------
+static void board_index_init (void)
+{
+    unsigned long long mac_start;
+    int board_id, mac_cnt, block, legacy;
+
+    memset (BoardIndex, eAUDIT_UNKNOWN, sizeof(BoardIndex));
+    for (board_id = 0; board_id < eBOARD_ID_END; board_id++) {
+        if (!efuse_get_mac_range (board_id, &mac_start, &mac_cnt))
+            continue;
+        for (block = 0; block < mac_cnt / 65536; block++)
+            BoardIndex[((mac_start >> 16) + block) & 0xFF] = board_id;
+        // 이전 생산품 mac block (c4)
+        if ((legacy = efuse_board_info (board_id)->mac_legacy))
+            BoardIndex[legacy] = board_id;
+    }
+}
+
+//------------------------------------------------------------------------------
+// mac(0x001E06xxxxxx) -> eBOARD_ID_xxx 또는 eAUDIT_FOREIGN/eAUDIT_UNKNOWN
+//------------------------------------------------------------------------------
+int efuse_audit_mac (unsigned long long mac)
+{
+    pthread_once (&BoardIndexOnce, board_index_init);
+
+    if ((mac >> 24) != 0x001E06)
+        return eAUDIT_FOREIGN;
+    return BoardIndex[(mac >> 16) & 0xFF];
+}
+
+//------------------------------------------------------------------------------
+// uuid 문자열(36) -> eBOARD_ID_xxx 또는 eAUDIT_xxx
+//------------------------------------------------------------------------------
+int efuse_audit_classify (const char *uuid)
+{
+    struct efuse_uuid bin;
+
+    if (!efuse_uuid_parse (uuid, &bin))
+        return eAUDIT_INVALID;
+    return efuse_audit_mac (efuse_uuid_mac (&bin));
+}
+
+//------------------------------------------------------------------------------
+// line 1개 처리. uuid 뒤에는 '\r' 또는 구분자(',', ' ', '\t')만 허용.
+//------------------------------------------------------------------------------
+static void audit_record (struct audit_chunk *chunk, const char *line, int len)
+{
+    struct efuse_audit_stat *stat = &chunk->stat;
+    struct efuse_uuid bin;
+    unsigned long long mac;
+    int result;
+
+    stat->records++;
+    if ((len < EFUSE_UUID_SIZE) ||
+        ((len > EFUSE_UUID_SIZE) && !strchr ("\r,\t ", line[EFUSE_UUID_SIZE])) ||
+        !efuse_uuid_parse (line, &bin)) {
+        result = eAUDIT_INVALID;
+    } else {
+        mac    = efuse_uuid_mac (&bin);
+        result = ((mac >> 24) == 0x001E06) ? BoardIndex[(mac >> 16) & 0xFF] : eAUDIT_FOREIGN;
+        if ((result >= 0) && ((int)((mac >> 16) & 0xFF) == efuse_board_info (result)->mac_legacy))
+            stat->c4_legacy++;
+    }
+
+    switch (result) {
+        case eAUDIT_INVALID:    stat->invalid++;    break;
+        case eAUDIT_FOREIGN:    stat->foreign++;    break;
+        case eAUDIT_UNKNOWN:    stat->unknown++;    break;
+        default :
+            stat->valid++;
+            stat->board[result]++;
+            return;
+    }
+    if (chunk->cb != NULL)
+        chunk->cb (chunk->arg, chunk->base + (line - chunk->buf), line, len, result);
+}
+
+//------------------------------------------------------------------------------
+static void audit_chunk_run (struct audit_chunk *chunk)
+{
+    const char *p = chunk->buf, *end = chunk->buf + chunk->size, *nl;
+
+    pthread_once (&BoardIndexOnce, board_index_init);
+    memset (&chunk->stat, 0, sizeof(chunk->stat));
+
+    while (p < end) {
+        if ((nl = memchr (p, '\n', end - p)) == NULL)
+            nl = end;
+        // 빈 line은 record로 계산하지 않음.
+        if ((nl > p) && !((nl - p == 1) && (*p == '\r')))
+            audit_record (chunk, p, nl - p);
+        p = nl + 1;
+    }
+}
+
+//------------------------------------------------------------------------------
+static void *audit_thread (void *arg)
+{
+    audit_chunk_run ((struct audit_chunk *)arg);
+    return NULL;
+}
+
+//------------------------------------------------------------------------------
+static void audit_stat_add (struct efuse_audit_stat *dst, const struct efuse_audit_stat *src)
+{
+    int i;
+
+    dst->records   += src->records;
+    dst->valid     += src->valid;
+    dst->c4_legacy += src->c4_legacy;
+    dst->invalid   += src->invalid;
+    dst->foreign   += src->foreign;
+    dst->unknown   += src->unknown;
+    for (i = 0; i < eBOARD_ID_END; i++)
+        dst->board[i] += src->board[i];
+}
+
+//------------------------------------------------------------------------------
+// 줄 단위 uuid buffer 검사. return : valid record 수
+//------------------------------------------------------------------------------
+int efuse_audit_buffer (const char *buf, size_t size,
+                        struct efuse_audit_stat *stat,
+                        efuse_audit_cb cb, void *arg)
+{
+    struct audit_chunk chunk = { buf, size, 0, cb, arg, { 0 } };
+
+    audit_chunk_run (&chunk);
+    if (stat != NULL)
+        *stat = chunk.stat;
+    return chunk.stat.valid;
+}
+
+//------------------------------------------------------------------------------
+// audit file을 mmap 하여 threads 개수로 나누어 검사 (line 경계 기준).
+// return : 1 = success, 0 = file error
+//------------------------------------------------------------------------------
+int efuse_audit_file (const char *path, int threads,
+                      struct efuse_audit_stat *stat,
+                      efuse_audit_cb cb, void *arg)
+{
+    struct audit_chunk chunk [AUDIT_THREAD_MAX];
+    pthread_t tid [AUDIT_THREAD_MAX];
+    int created [AUDIT_THREAD_MAX];
+    const char *map, *p, *end, *next;
+    struct stat st;
+    int fd, i, cnt;
+
+    if (stat == NULL)
+        return 0;
+    memset (stat, 0, sizeof(struct efuse_audit_stat));
+
+    if ((fd = open (path, O_RDONLY | O_CLOEXEC)) < 0) {
+        dbg_msg ("error, audit file open (%s)\n", path);
+        return 0;
+    }
+    if (fstat (fd, &st) < 0) {
+        close (fd);
+        return 0;
+    }
+    if (st.st_size == 0) {
+        close (fd);
+        return 1;
+    }
+    map = mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close (fd);
+    if (map == MAP_FAILED)
+        return 0;
+    madvise ((void *)map, st.st_size, MADV_SEQUENTIAL);
+
+    if (threads < 1)                    threads = 1;
+    if (threads > AUDIT_THREAD_MAX)     threads = AUDIT_THREAD_MAX;
+
+    // chunk 경계를 다음 line 시작으로 맞춤.
+    end = map + st.st_size;
+    for (i = 0, cnt = 0, p = map; (i < threads) && (p < end); i++, cnt++) {
+        next = (i == threads - 1) ? end : p + (st.st_size / threads);
+        if (next < end) {
+            if ((next = memchr (next, '\n', end - next)) == NULL)
+                next = end;
+            else
+                next++;
+        }
+        chunk[cnt].buf  = p;
+        chunk[cnt].size = next - p;
+        chunk[cnt].base = p - map;
+        chunk[cnt].cb   = cb;
+        chunk[cnt].arg  = arg;
+        p = next;
+    }
+    for (i = 0; i < cnt; i++) {
+        created[i] = (i > 0) && !pthread_create (&tid[i], NULL, audit_thread, &chunk[i]);
+        if ((i > 0) && !created[i])
+            audit_chunk_run (&chunk[i]);
+    }
+    // 첫번째 chunk는 현재 thread에서 처리.
+    audit_chunk_run (&chunk[0]);
+    for (i = 0; i < cnt; i++) {
+        if (created[i])
+            pthread_join (tid[i], NULL);
+        audit_stat_add (stat, &chunk[i].stat);
+    }
+    munmap ((void *)map, st.st_size);
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
@@ -0,0 +1,62 @@
+//------------------------------------------------------------------------------
+/**
+ * @file lib_efuse_audit.h
+ * @author charles-park (charles.park@hardkernel.com)
+ * @brief efuse uuid batch validator and board classifier.
+ * @version 0.2
+ * @date 2023-09-22
+ *
+ * @package apt install cups cups-bsd
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#ifndef __LIB_EFUSE_AUDIT_H__
+#define __LIB_EFUSE_AUDIT_H__
+
+//------------------------------------------------------------------------------
+#include "lib_efuse.h"
+
+//------------------------------------------------------------------------------
+#define AUDIT_THREAD_MAX    64
+
+// efuse_audit_classify() result (0 이상은 eBOARD_ID_xxx)
+enum {
+    eAUDIT_INVALID = -1,    // uuid 형식 error
+    eAUDIT_FOREIGN = -2,    // odroid mac(00:1E:06) 아님
+    eAUDIT_UNKNOWN = -3,    // odroid mac 이지만 board 할당 범위 밖
+};
+
+struct efuse_audit_stat {
+    long    records;
+    long    valid;
+    long    board [eBOARD_ID_END];
+    long    c4_legacy;      // board[eBOARD_ID_C4]에 포함 (0x001E0648xxxx)
+    long    invalid;
+    long    foreign;
+    long    unknown;
+};
+
+//------------------------------------------------------------------------------
+// 분류 실패 record 통보. offset = file(buffer) 내 line 시작 위치.
+// multi thread audit의 경우 여러 thread에서 동시에 호출될 수 있음.
+//------------------------------------------------------------------------------
+typedef void (*efuse_audit_cb) (void *arg, long offset, const char *line, int len, int result);
+
+//------------------------------------------------------------------------------
+//	function prototype
+//------------------------------------------------------------------------------
+extern int  efuse_audit_classify    (const char *uuid);
+extern int  efuse_audit_mac         (unsigned long long mac);
+extern int  efuse_audit_buffer      (const char *buf, size_t size,
+                                     struct efuse_audit_stat *stat,
+                                     efuse_audit_cb cb, void *arg);
+extern int  efuse_audit_file        (const char *path, int threads,
+                                     struct efuse_audit_stat *stat,
+                                     efuse_audit_cb cb, void *arg);
+
+//------------------------------------------------------------------------------
+#endif  // #ifndef __LIB_EFUSE_AUDIT_H__
+//------------------------------------------------------------------------------
@@ -0,0 +1,448 @@
+//------------------------------------------------------------------------------
+/**
+ * @file lib_efuse_batch.c
+ * @author charles-park (charles.park@hardkernel.com)
+ * @brief efuse batch command stream (stdin -> json lines).
+ * @version 0.2
+ * @date 2023-09-22
+ *
+ * @package apt install cups cups-bsd
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <limits.h>
+#include <pthread.h>
+
+#include "lib_efuse.h"
+#include "lib_efuse_batch.h"
+#include "lib_efuse_board.h"
+
+//------------------------------------------------------------------------------
+// Debug msg
+//------------------------------------------------------------------------------
+#if defined (__LIB_EFUSE_APP__)
+    #define dbg_msg(fmt, args...)   printf(fmt, ##args)
+#else
+    #define dbg_msg(fmt, args...)
+#endif
+
+//------------------------------------------------------------------------------
+enum {
+    eBATCH_OP_READ = 0,
+    eBATCH_OP_WRITE,
+    eBATCH_OP_VERIFY,
+    eBATCH_OP_ERASE,
+    eBATCH_OP_CHECK,
+    eBATCH_OP_MAC,
+    eBATCH_OP_END
+};
+
+static const char *BatchOpName [eBATCH_OP_END] = {
+    "read", "write", "verify", "erase", "check", "mac",
+};
+
+static const struct efuse_io *BatchIo = NULL;
+static efuse_ctx_init_cb BatchInit = NULL;
+static void *BatchInitArg = NULL;
+
+struct batch_cmd {
+    long        seq;
+    int         board_id;       // -1 = parse error
+    int         op;
+    int         done;
+    int         status;
+    int         valid;          // check 결과
+    const char  *error;         // parse/device error 설명
+    char        data [EFUSE_UUID_SIZE +1];
+    char        mac  [MAC_STR_SIZE +1];
+};
+
+// lane 1개 = device 1개. 같은 device를 사용하는 board(M1/C4/C5 등)는 같은 lane.
+struct batch_lane {
+    pthread_t   thread;
+    int         started;
+    long        cursor;         // 다음에 확인할 seq
+    efuse_ctx   *ctx [eBOARD_ID_END];
+};
+
+struct batch_state {
+    struct batch_cmd    ring [BATCH_WINDOW];
+    struct batch_lane   lane [eBOARD_ID_END];
+    int                 lane_of [eBOARD_ID_END];
+    long                read_cnt;
+    long                print_cnt;
+    int                 eof;
+    FILE                *out;
+    struct efuse_batch_report   report;
+    pthread_mutex_t     mutex;
+    pthread_cond_t      cond_cmd;   // 새 명령 입력 / 입력 종료
+    pthread_cond_t      cond_done;  // 명령 처리 완료
+    pthread_cond_t      cond_space; // ring 공간 확보
+};
+
+struct batch_lane_arg {
+    struct batch_state  *st;
+    int                 lane_id;
+};
+
+//------------------------------------------------------------------------------
+// function prototype
+//------------------------------------------------------------------------------
+static void  batch_lane_map (struct batch_state *st);
+static int   batch_parse    (char *line, struct batch_cmd *cmd);
+static void  batch_exec     (efuse_ctx *ctx, struct batch_cmd *cmd);
+static void *batch_lane     (void *arg);
+static void *batch_printer  (void *arg);
+static void  batch_print_str(FILE *out, const char *key, const char *str);
+static void  batch_print    (FILE *out, const struct batch_cmd *cmd);
+
+int  efuse_batch_run    (FILE *in, FILE *out, struct efuse_batch_report *report);
+void efuse_batch_set_io (const struct efuse_io *io);
+void efuse_batch_set_ctx_init (efuse_ctx_init_cb cb, void *arg);
+
+//------------------------------------------------------------------------------
+// board -> lane. rw_file이 같은 board는 첫번째 board의 lane 사용.
+//------------------------------------------------------------------------------
+static void batch_lane_map (struct batch_state *st)
+{
+    char file [eBOARD_ID_END][PATH_MAX];
+    const char *path;
+    efuse_ctx *ctx;
+    int i, j;
+
+    for (i = 0; i < eBOARD_ID_END; i++) {
+        file[i][0] = 0;
+        st->lane_of[i] = i;
+        if ((ctx = efuse_ctx_open (i)) == NULL)
+            continue;
+        efuse_ctx_get_path (ctx, NULL, &path);
+        strncpy (file[i], path, PATH_MAX -1);
+        file[i][PATH_MAX -1] = 0;
+        efuse_ctx_close (ctx);
+
+        for (j = 0; j < i; j++) {
+            if (file[j][0] && !strcmp (file[i], file[j])) {
+                st->lane_of[i] = st->lane_of[j];
+                break;
+            }
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+// "<board> <op> [data]" -> cmd. return : 1 = 명령, 0 = 빈 줄/comment
+//------------------------------------------------------------------------------
+static int batch_parse (char *line, struct batch_cmd *cmd)
+{
+    char *save, *board, *op, *data, *p;
+    int i;
+
+    if ((p = strchr (line, '#')) != NULL)
+        *p = 0;
+    if ((board = strtok_r (line, " \t\r\n", &save)) == NULL)
+        return 0;
+
+    op   = strtok_r (NULL, " \t\r\n", &save);
+    data = strtok_r (NULL, " \t\r\n", &save);
+
+    cmd->board_id = efuse_board_find (board);
+    cmd->op       = -1;
+    for (i = 0; (op != NULL) && (i < eBATCH_OP_END); i++)
+        if (!strcasecmp (op, BatchOpName[i]))
+            cmd->op = i;
+
+    if (cmd->board_id < 0)
+        cmd->error = "unknown board";
+    else if (cmd->op < 0)
+        cmd->error = "unknown op";
+    else if (((cmd->op == eBATCH_OP_WRITE) || (cmd->op == eBATCH_OP_VERIFY)) &&
+             ((data == NULL) || (strlen (data) != EFUSE_UUID_SIZE)))
+        cmd->error = "invalid data";
+    else if (data != NULL)
+        strncpy (cmd->data, data, EFUSE_UUID_SIZE);
+
+    if (cmd->error != NULL)
+        cmd->board_id = -1;
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+// 명령 1개 실행. check/mac은 read 1회로 처리.
+//------------------------------------------------------------------------------
+static void batch_exec (efuse_ctx *ctx, struct batch_cmd *cmd)
+{
+    char read_data [EFUSE_UUID_SIZE +1];
+    int wv;
+
+    if (ctx == NULL) {
+        cmd->error = "board open";
+        return;
+    }
+    switch (cmd->op) {
+        case eBATCH_OP_WRITE:
+            cmd->status = efuse_ctx_control (ctx, cmd->data, EFUSE_WRITE);
+            break;
+        case eBATCH_OP_VERIFY:
+            memset (read_data, 0, sizeof(read_data));
+            wv = efuse_ctx_write_verify (ctx, cmd->data, read_data);
+            cmd->status = (wv == eEFUSE_WV_WRITTEN) || (wv == eEFUSE_WV_UNCHANGED);
+            if (wv == eEFUSE_WV_MISMATCH)
+                cmd->error = "verify mismatch";
+            memcpy (cmd->data, read_data, sizeof(read_data));
+            break;
+        case eBATCH_OP_ERASE:
+            cmd->status = efuse_ctx_control (ctx, cmd->data, EFUSE_ERASE);
+            break;
+        default :
+            memset (cmd->data, 0, sizeof(cmd->data));
+            cmd->status = efuse_ctx_control (ctx, cmd->data, EFUSE_READ);
+            if (cmd->status && (cmd->op == eBATCH_OP_CHECK))
+                cmd->valid = efuse_ctx_valid_check (ctx, cmd->data);
+            if (cmd->status && (cmd->op == eBATCH_OP_MAC))
+                efuse_ctx_get_mac (ctx, cmd->data, cmd->mac);
+            break;
+    }
+    if (!cmd->status && (cmd->error == NULL))
+        cmd->error = (efuse_ctx_last_error (ctx) != eEFUSE_OK) ?
+                        efuse_strerror (efuse_ctx_last_error (ctx)) : "device access";
+}
+
+//------------------------------------------------------------------------------
+// device별 lane. ring에서 자기 lane 명령만 입력 순서대로 처리.
+//------------------------------------------------------------------------------
+static void *batch_lane (void *arg)
+{
+    struct batch_lane_arg *la = (struct batch_lane_arg *)arg;
+    struct batch_state *st = la->st;
+    struct batch_lane *lane = &st->lane[la->lane_id];
+    struct batch_cmd *cmd, work;
+    int lane_id = la->lane_id, i;
+
+    free (la);
+    pthread_mutex_lock (&st->mutex);
+    while (1) {
+        if (lane->cursor == st->read_cnt) {
+            if (st->eof)
+                break;
+            pthread_cond_wait (&st->cond_cmd, &st->mutex);
+            continue;
+        }
+        cmd = &st->ring[lane->cursor % BATCH_WINDOW];
+        // 이미 출력되어 재사용된 slot은 다른 board의 명령이었음.
+        if ((cmd->seq != lane->cursor) || (cmd->board_id < 0) ||
+            (st->lane_of[cmd->board_id] != lane_id)) {
+            lane->cursor++;
+            continue;
+        }
+        work = *cmd;
+        pthread_mutex_unlock (&st->mutex);
+
+        if (lane->ctx[work.board_id] == NULL) {
+            lane->ctx[work.board_id] = efuse_ctx_open (work.board_id);
+            if ((lane->ctx[work.board_id] != NULL) && (BatchIo != NULL))
+                efuse_ctx_set_io (lane->ctx[work.board_id], BatchIo);
+            if ((lane->ctx[work.board_id] != NULL) && (BatchInit != NULL))
+                BatchInit (BatchInitArg, lane->ctx[work.board_id]);
+        }
+        batch_exec (lane->ctx[work.board_id], &work);
+
+        pthread_mutex_lock (&st->mutex);
+        *cmd = work;
+        cmd->done = 1;
+        lane->cursor++;
+        pthread_cond_broadcast (&st->cond_done);
+    }
+    pthread_mutex_unlock (&st->mutex);
+
+    for (i = 0; i < eBOARD_ID_END; i++)
+        if (lane->ctx[i] != NULL)
+            efuse_ctx_close (lane->ctx[i]);
+    return NULL;
+}
+
+//------------------------------------------------------------------------------
+// ,"key":"str" 출력. device data는 임의의 byte일 수 있으므로 json escape,
+// 출력 가능한 ascii 외의 byte는 \u00XX.
+//------------------------------------------------------------------------------
+static void batch_print_str (FILE *out, const char *key, const char *str)
+{
+    const unsigned char *p;
+
+    fprintf (out, ",\"%s\":\"", key);
+    for (p = (const unsigned char *)str; *p; p++) {
+        if ((*p == '"') || (*p == '\\'))
+            fprintf (out, "\\%c", *p);
+        else if ((*p < 0x20) || (*p > 0x7E))
+            fprintf (out, "\\u%04x", *p);
+        else
+            fputc (*p, out);
+    }
+    fputc ('"', out);
+}
+
+//------------------------------------------------------------------------------
+static void batch_print (FILE *out, const struct batch_cmd *cmd)
+{
+    fprintf (out, "{\"seq\":%ld", cmd->seq);
+    if (cmd->op >= 0)
+        fprintf (out, ",\"op\":\"%s\"", BatchOpName[cmd->op]);
+    if (cmd->board_id >= 0)
+        fprintf (out, ",\"board\":\"%s\"", efuse_board_name (cmd->board_id));
+    fprintf (out, ",\"status\":\"%s\"", cmd->status ? "success" : "error");
+    if (cmd->error != NULL)
+        batch_print_str (out, "error", cmd->error);
+    if (cmd->status && (cmd->op != eBATCH_OP_ERASE))
+        batch_print_str (out, "data", cmd->data);
+    if (cmd->status && (cmd->op == eBATCH_OP_CHECK))
+        fprintf (out, ",\"valid\":%s", cmd->valid ? "true" : "false");
+    if (cmd->status && (cmd->op == eBATCH_OP_MAC))
+        batch_print_str (out, "mac", cmd->mac);
+    fprintf (out, "}\n");
+    fflush  (out);
+}
+
+//------------------------------------------------------------------------------
+// 입력 순서대로 출력. 앞의 명령이 끝나지 않으면 뒤의 결과는 대기.
+//------------------------------------------------------------------------------
+static void *batch_printer (void *arg)
+{
+    struct batch_state *st = (struct batch_state *)arg;
+    struct batch_cmd *cmd, work;
+
+    pthread_mutex_lock (&st->mutex);
+    while (1) {
+        cmd = &st->ring[st->print_cnt % BATCH_WINDOW];
+        if ((st->print_cnt < st->read_cnt) && cmd->done) {
+            work = *cmd;
+            pthread_mutex_unlock (&st->mutex);
+
+            batch_print (st->out, &work);
+
+            pthread_mutex_lock (&st->mutex);
+            st->report.cmd_cnt++;
+            if (work.status)    st->report.ok_cnt++;
+            else                st->report.fail_cnt++;
+            st->print_cnt++;
+            pthread_cond_signal (&st->cond_space);
+            continue;
+        }
+        if (st->eof && (st->print_cnt == st->read_cnt))
+            break;
+        pthread_cond_wait (&st->cond_done, &st->mutex);
+    }
+    pthread_mutex_unlock (&st->mutex);
+    return NULL;
+}
+
+//------------------------------------------------------------------------------
+// in의 명령을 모두 처리 (EOF까지). return : 1 = 모든 명령 success, 0 = 실패 포함
+//------------------------------------------------------------------------------
+int efuse_batch_run (FILE *in, FILE *out, struct efuse_batch_report *report)
+{
+    struct batch_lane_arg *la;
+    struct batch_lane *lane;
+    struct batch_state *st;
+    struct batch_cmd cmd;
+    pthread_t printer;
+    char line [256];
+    int i, ret;
+
+    if ((st = calloc (1, sizeof(struct batch_state))) == NULL)
+        return 0;
+
+    st->out = out;
+    batch_lane_map (st);
+    pthread_mutex_init (&st->mutex, NULL);
+    pthread_cond_init  (&st->cond_cmd,   NULL);
+    pthread_cond_init  (&st->cond_done,  NULL);
+    pthread_cond_init  (&st->cond_space, NULL);
+    if (pthread_create (&printer, NULL, batch_printer, st)) {
+        free (st);
+        return 0;
+    }
+
+    while (fgets (line, sizeof(line), in) != NULL) {
+        memset (&cmd, 0, sizeof(cmd));
+        if (!batch_parse (line, &cmd))
+            continue;
+
+        pthread_mutex_lock (&st->mutex);
+        while (st->read_cnt - st->print_cnt >= BATCH_WINDOW)
+            pthread_cond_wait (&st->cond_space, &st->mutex);
+
+        cmd.seq  = st->read_cnt;
+        cmd.done = (cmd.board_id < 0);
+        st->ring[cmd.seq % BATCH_WINDOW] = cmd;
+        st->read_cnt++;
+
+        // lane의 첫 명령에서 lane thread 생성.
+        lane = (cmd.board_id >= 0) ? &st->lane[st->lane_of[cmd.board_id]] : NULL;
+        if ((lane != NULL) && !lane->started) {
+            lane->cursor = cmd.seq;
+            if ((la = malloc (sizeof(struct batch_lane_arg))) != NULL) {
+                la->st      = st;
+                la->lane_id = st->lane_of[cmd.board_id];
+                if (!pthread_create (&lane->thread, NULL, batch_lane, la))
+                    lane->started = 1;
+                else
+                    free (la);
+            }
+        }
+        if ((lane != NULL) && !lane->started) {
+            st->ring[cmd.seq % BATCH_WINDOW].error = "lane create";
+            st->ring[cmd.seq % BATCH_WINDOW].done  = 1;
+        }
+        pthread_cond_broadcast (&st->cond_cmd);
+        pthread_cond_broadcast (&st->cond_done);
+        pthread_mutex_unlock (&st->mutex);
+    }
+
+    pthread_mutex_lock (&st->mutex);
+    st->eof = 1;
+    pthread_cond_broadcast (&st->cond_cmd);
+    pthread_cond_broadcast (&st->cond_done);
+    pthread_mutex_unlock (&st->mutex);
+
+    for (i = 0; i < eBOARD_ID_END; i++)
+        if (st->lane[i].started)
+            pthread_join (st->lane[i].thread, NULL);
+    pthread_join (printer, NULL);
+
+    if (report != NULL)
+        *report = st->report;
+    ret = (st->report.fail_cnt == 0);
+
+    pthread_cond_destroy  (&st->cond_space);
+    pthread_cond_destroy  (&st->cond_done);
+    pthread_cond_destroy  (&st->cond_cmd);
+    pthread_mutex_destroy (&st->mutex);
+    free (st);
+    return ret;
+}
+
+//------------------------------------------------------------------------------
+// lane context의 I/O backend (NULL = kernel). efuse_batch_run() 전에 설정.
+//------------------------------------------------------------------------------
+void efuse_batch_set_io (const struct efuse_io *io)
+{
+    BatchIo = io;
+}
+
+//------------------------------------------------------------------------------
+// lane context 생성시 호출 (I/O backend 설정 후, lane thread). efuse_batch_run() 전에 설정.
+//------------------------------------------------------------------------------
+void efuse_batch_set_ctx_init (efuse_ctx_init_cb cb, void *arg)
+{
+    BatchInit    = cb;
+    BatchInitArg = arg;
+}
+
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
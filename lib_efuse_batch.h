@@ -0,0 +1,48 @@
+//------------------------------------------------------------------------------
+/**
+ * @file lib_efuse_batch.h
+ * @author charles-park (charles.park@hardkernel.com)
+ * @brief efuse batch command stream (stdin -> json lines).
+ * @version 0.2
+ * @date 2023-09-22
+ *
+ * @package apt install cups cups-bsd
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#ifndef __LIB_EFUSE_BATCH_H__
+#define __LIB_EFUSE_BATCH_H__
+
+//------------------------------------------------------------------------------
+#include <stdio.h>
+#include "lib_efuse.h"
+
+//------------------------------------------------------------------------------
+// 입력 : 한 줄에 명령 1개. "<board> <op> [data]", '#' 이후는 comment.
+//        board = m1, m1s, m2, c4, c5 / op = read, write, verify, erase, check, mac
+// 출력 : 명령 1개당 json 1줄, 입력 순서와 동일.
+//
+// device(rw_file)별 lane thread가 명령을 순서대로 처리하고, 서로 다른 device의
+// 명령은 동시에 처리됨. 입력과 출력 사이에 최대 BATCH_WINDOW 개의 명령이 대기.
+//------------------------------------------------------------------------------
+#define BATCH_WINDOW    128
+
+struct efuse_batch_report {
+    long    cmd_cnt;
+    long    ok_cnt;
+    long    fail_cnt;
+};
+
+//------------------------------------------------------------------------------
+//	function prototype
+//------------------------------------------------------------------------------
+extern int  efuse_batch_run     (FILE *in, FILE *out, struct efuse_batch_report *report);
+extern void efuse_batch_set_io  (const struct efuse_io *io);
+extern void efuse_batch_set_ctx_init (efuse_ctx_init_cb cb, void *arg);
+
+//------------------------------------------------------------------------------
+#endif  // #ifndef __LIB_EFUSE_BATCH_H__
+//------------------------------------------------------------------------------
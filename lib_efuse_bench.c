@@ -0,0 +1,580 @@
+//------------------------------------------------------------------------------
+/**
+ * @file lib_efuse_bench.c
+ * @author charles-park (charles.park@hardkernel.com)
+ * @brief efuse library benchmark (simulated / file-backed device).
+ * @version 0.2
+ * @date 2023-09-22
+ *
+ * @package apt install cups cups-bsd
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <limits.h>
+#include <getopt.h>
+#include <time.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+
+#include "lib_efuse.h"
+#include "lib_efuse_sim.h"
+#include "lib_efuse_uring.h"
+#include "lib_efuse_trace.h"
+#include "lib_efuse_board.h"
+#include "lib_efuse_prov.h"
+
+//------------------------------------------------------------------------------
+enum {
+    eBENCH_READ = 0,
+    eBENCH_WRITE,
+    eBENCH_ERASE,
+    eBENCH_CHECK,
+    eBENCH_MAC,
+    eBENCH_WRITE_VERIFY,
+    eBENCH_END
+};
+
+static const char *BenchOpName [eBENCH_END] = {
+    "read", "write", "erase", "check", "mac", "write_verify"
+};
+
+static const char *SimOpName [eSIM_OP_END] = {
+    "access", "open", "close", "pread", "pwrite", "ioctl", "fdatasync"
+};
+
+// log2(ns) histogram bucket 수
+#define HIST_BUCKET     32
+
+//------------------------------------------------------------------------------
+static int          OPT_ITERATION   = 10000;
+static int          OPT_BOARD_ID    = -1;
+static long         OPT_LATENCY_US  = 0;
+static const char  *OPT_BACKING_DIR = NULL;
+static const char  *OPT_OUTPUT      = NULL;
+static const char  *OPT_CLI         = NULL;
+static int          OPT_URING_DEV   = 0;
+static const char  *OPT_TRACE       = NULL;
+
+static FILE *BenchOut = NULL;
+
+//------------------------------------------------------------------------------
+static void print_usage (const char *prog)
+{
+    puts("");
+    printf("Usage: %s [-nblfoxuT]\n", prog);
+    puts("");
+
+    puts("  -n --iteration <cnt>    iteration count per operation (default 10000)\n"
+         "  -b --board <name>       board name (default all), m1, m1s, m2, c4, c5\n"
+         "  -l --latency <usec>     simulated device latency per syscall\n"
+         "  -f --file <dir>         file-backed simulation device directory\n"
+         "  -o --output <file>      result file (default stdout, json lines)\n"
+         "  -x --cli <path>         compare with the cli app (<path> -b <board> --prov)\n"
+         "                          same job on a file-backed device (-f dir, default /tmp)\n"
+         "                          m1s, m2 only, max 1000 iteration\n"
+         "  -u --uring <max dev>    m2 file-backed write_verify, sync vs io_uring\n"
+         "                          device count 1, 2, 4 ... <max dev> (-f dir, default /tmp)\n"
+         "  -T --trace <file>       replay the recorded trace (lib_efuse --trace)\n"
+         "                          on the simulation device at max speed\n"
+         "\n"
+         "   e.g) lib_efuse_bench -n 100000\n"
+         "        lib_efuse_bench -b m1s -l 50 -f /tmp/efuse_sim\n"
+         "        lib_efuse_bench -b m1s -n 200 -x ./lib_efuse-release\n"
+         "        lib_efuse_bench -n 2000 -u 64 -f /var/tmp\n"
+         "        lib_efuse_bench -T m1s.trace\n"
+    );
+    exit(1);
+}
+
+//------------------------------------------------------------------------------
+static void parse_opts (int argc, char *argv[])
+{
+    while (1) {
+        static const struct option lopts[] = {
+            { "iteration",  1, 0, 'n' },
+            { "board",      1, 0, 'b' },
+            { "latency",    1, 0, 'l' },
+            { "file",       1, 0, 'f' },
+            { "output",     1, 0, 'o' },
+            { "cli",        1, 0, 'x' },
+            { "uring",      1, 0, 'u' },
+            { "trace",      1, 0, 'T' },
+            { NULL, 0, 0, 0 },
+        };
+        int c;
+
+        c = getopt_long(argc, argv, "n:b:l:f:o:x:u:T:", lopts, NULL);
+
+        if (c == -1)
+            break;
+
+        switch (c) {
+        case 'n':
+            OPT_ITERATION = atoi (optarg);
+            break;
+        case 'b':
+            if ((OPT_BOARD_ID = efuse_board_find (optarg)) < 0)
+                print_usage(argv[0]);
+            break;
+        case 'l':
+            OPT_LATENCY_US = atol (optarg);
+            break;
+        case 'f':
+            OPT_BACKING_DIR = optarg;
+            break;
+        case 'o':
+            OPT_OUTPUT = optarg;
+            break;
+        case 'x':
+            OPT_CLI = optarg;
+            break;
+        case 'u':
+            OPT_URING_DEV = atoi (optarg);
+            break;
+        case 'T':
+            OPT_TRACE = optarg;
+            break;
+        default:
+            print_usage(argv[0]);
+            break;
+        }
+    }
+    if (OPT_ITERATION < 1)
+        print_usage(argv[0]);
+}
+
+//------------------------------------------------------------------------------
+static long long time_ns (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec * 1000000000LL) + ts.tv_nsec;
+}
+
+//------------------------------------------------------------------------------
+static int cmp_ll (const void *a, const void *b)
+{
+    long long x = *(const long long *)a, y = *(const long long *)b;
+
+    return (x > y) - (x < y);
+}
+
+//------------------------------------------------------------------------------
+// 1회 operation 실행. return : 1 = success
+//------------------------------------------------------------------------------
+static int bench_op_exec (efuse_ctx *ctx, int op, const char *uuid)
+{
+    char efuse_data [EFUSE_UUID_SIZE +1], mac [MAC_STR_SIZE];
+
+    memcpy (efuse_data, uuid, sizeof(efuse_data));
+    switch (op) {
+        case eBENCH_READ:   return efuse_ctx_control (ctx, efuse_data, EFUSE_READ);
+        case eBENCH_WRITE:  return efuse_ctx_control (ctx, efuse_data, EFUSE_WRITE);
+        case eBENCH_ERASE:  return efuse_ctx_control (ctx, efuse_data, EFUSE_ERASE);
+        case eBENCH_CHECK:  return efuse_ctx_valid_check (ctx, efuse_data);
+        case eBENCH_MAC:
+            efuse_ctx_get_mac (ctx, efuse_data, mac);
+            return 1;
+        case eBENCH_WRITE_VERIFY:
+            return efuse_ctx_write_verify (ctx, efuse_data, NULL) == eEFUSE_WV_WRITTEN;
+        default :
+            return 0;
+    }
+}
+
+//------------------------------------------------------------------------------
+static void bench_report (int board_id, int op, const char *backend,
+                          long long *lat, int cnt, int fail, long long total_ns,
+                          const long *syscalls)
+{
+    int hist [HIST_BUCKET], i, b;
+    long long sum = 0;
+
+    memset (hist, 0, sizeof(hist));
+    for (i = 0; i < cnt; i++) {
+        sum += lat[i];
+        b = lat[i] > 0 ? 63 - __builtin_clzll (lat[i]) : 0;
+        hist[b < HIST_BUCKET ? b : HIST_BUCKET - 1]++;
+    }
+    qsort (lat, cnt, sizeof(long long), cmp_ll);
+
+    fprintf (BenchOut,
+        "{\"version\":\"%s\",\"backend\":\"%s\",\"board\":\"%s\",\"op\":\"%s\","
+        "\"iteration\":%d,\"fail\":%d,\"ops_per_sec\":%.1f,"
+        "\"min_ns\":%lld,\"mean_ns\":%lld,\"p50_ns\":%lld,\"p99_ns\":%lld,"
+        "\"p999_ns\":%lld,\"max_ns\":%lld,\"syscalls\":{",
+        LIB_EFUSE_VERSION, backend, efuse_board_name (board_id), BenchOpName[op],
+        cnt, fail, total_ns ? (double)cnt * 1e9 / total_ns : 0.0,
+        lat[0], sum / cnt, lat[cnt / 2], lat[(cnt * 99) / 100],
+        lat[(cnt * 999) / 1000], lat[cnt - 1]);
+
+    for (i = 0; i < eSIM_OP_END; i++)
+        fprintf (BenchOut, "%s\"%s\":%.2f", i ? "," : "", SimOpName[i],
+            (double)syscalls[i] / cnt);
+
+    // log2(ns) bucket : hist[n] = 2^n ~ 2^(n+1) ns
+    fprintf (BenchOut, "},\"hist_log2_ns\":[");
+    for (i = 0; i < HIST_BUCKET; i++)
+        fprintf (BenchOut, "%s%d", i ? "," : "", hist[i]);
+    fprintf (BenchOut, "]}\n");
+    fflush (BenchOut);
+}
+
+//------------------------------------------------------------------------------
+static int bench_board (int board_id, long long *lat)
+{
+    char uuid [2][EFUSE_UUID_SIZE +1];
+    long base [eSIM_OP_END], syscalls [eSIM_OP_END];
+    unsigned long long mac_start;
+    long long start, total;
+    int op, i, j, fail, ioctl_dev;
+    efuse_sim *sim;
+    efuse_ctx *ctx;
+
+    if ((sim = efuse_sim_create (OPT_BACKING_DIR)) == NULL)
+        return 0;
+    if ((ctx = efuse_ctx_open (board_id)) == NULL) {
+        efuse_sim_destroy (sim);
+        return 0;
+    }
+    if (!efuse_sim_attach (sim, ctx)) {
+        efuse_ctx_close (ctx);
+        efuse_sim_destroy (sim);
+        return 0;
+    }
+    for (i = 0; i < eSIM_OP_END; i++)
+        efuse_sim_set_latency (sim, i, OPT_LATENCY_US);
+
+    efuse_get_mac_range (board_id, &mac_start, NULL);
+    // write_verify는 매번 실제 write가 되도록 2개의 uuid를 번갈아 사용.
+    snprintf (uuid[0], sizeof(uuid[0]), "dcbaa404-91bd-4a63-b5f1-%012llX", mac_start);
+    snprintf (uuid[1], sizeof(uuid[1]), "dcbaa404-91bd-4a63-b5f1-%012llX", mac_start + 1);
+
+    // m1/c4 uuid flash는 4회 write후 교체 필요 (측정 시간에서 제외).
+    ioctl_dev = (efuse_board_info (board_id)->dev_type == eBOARD_DEV_IOCTL);
+
+    for (op = 0; op < eBENCH_END; op++) {
+        efuse_sim_format (sim);
+        bench_op_exec (ctx, eBENCH_WRITE, uuid[1]);
+
+        for (j = 0; j < eSIM_OP_END; j++) {
+            base[j] = efuse_sim_get_count (sim, j);
+            syscalls[j] = 0;
+        }
+        for (i = 0, fail = 0, total = 0; i < OPT_ITERATION; i++) {
+            if (ioctl_dev && ((op == eBENCH_WRITE) || (op == eBENCH_WRITE_VERIFY)) &&
+                !(i % (UUID_FLASH_SIZE / UUID_WRITE_SIZE))) {
+                for (j = 0; j < eSIM_OP_END; j++)
+                    syscalls[j] += efuse_sim_get_count (sim, j) - base[j];
+                efuse_sim_format (sim);
+                for (j = 0; j < eSIM_OP_END; j++)
+                    base[j] = efuse_sim_get_count (sim, j);
+            }
+            start  = time_ns ();
+            fail  += bench_op_exec (ctx, op, uuid[i % 2]) ? 0 : 1;
+            lat[i] = time_ns () - start;
+            total += lat[i];
+        }
+        for (j = 0; j < eSIM_OP_END; j++)
+            syscalls[j] += efuse_sim_get_count (sim, j) - base[j];
+
+        bench_report (board_id, op, efuse_sim_io (sim)->name,
+            lat, OPT_ITERATION, fail, total, syscalls);
+    }
+    efuse_ctx_close (ctx);
+    efuse_sim_destroy (sim);
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+// cli app 1회 실행 (--prov, job 1개). in-process 호출과의 비교용.
+//------------------------------------------------------------------------------
+static int bench_cli_exec (int board_id, const char *prov_file)
+{
+    char *argv[] = { (char *)OPT_CLI, "-b", (char *)efuse_board_name (board_id),
+                     "--prov", (char *)prov_file, "-t", "1", NULL };
+    posix_spawn_file_actions_t fa;
+    extern char **environ;
+    int status, ret;
+    pid_t pid;
+
+    posix_spawn_file_actions_init (&fa);
+    posix_spawn_file_actions_addopen (&fa, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+    posix_spawn_file_actions_addopen (&fa, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+    ret = posix_spawn (&pid, OPT_CLI, &fa, NULL, argv, environ);
+    posix_spawn_file_actions_destroy (&fa);
+
+    if (ret || (waitpid (pid, &status, 0) != pid))
+        return 0;
+    return WIFEXITED (status) && !WEXITSTATUS (status);
+}
+
+//------------------------------------------------------------------------------
+// in-process 1회 실행 (cli --prov와 같은 job). 이미 기록된 uuid이므로 read back 확인만.
+//------------------------------------------------------------------------------
+static int bench_prov_exec (int board_id, const char *rw_control, const char *rw_file,
+                            const char *uuid)
+{
+    struct efuse_prov_job job;
+
+    if (!efuse_prov_job_init (&job, board_id, rw_control, rw_file, uuid))
+        return 0;
+    efuse_prov_run (&job, 1, 1, NULL);
+    return job.status && (job.wv_status == eEFUSE_WV_UNCHANGED);
+}
+
+//------------------------------------------------------------------------------
+// file-backed device(force_ro file + boot partition file) 1개에 같은 provisioning job을
+// in-process(efuse_prov_run)와 cli(--prov)로 실행하여 process 생성/초기화 비용 비교.
+// 양쪽 모두 kernel file I/O 사용, syscall 수는 측정하지 않음. emmc board(m1s, m2)만 가능.
+//------------------------------------------------------------------------------
+static void bench_cli (int board_id, long long *lat)
+{
+    const char *dir = OPT_BACKING_DIR ? OPT_BACKING_DIR : "/tmp";
+    char path [3][PATH_MAX], uuid [EFUSE_UUID_SIZE +1];
+    long syscalls [eSIM_OP_END];
+    unsigned long long mac_start;
+    int i, fd, fail, cnt = OPT_ITERATION > 1000 ? 1000 : OPT_ITERATION;
+    long long start, total;
+    FILE *fp;
+
+    if (efuse_board_info (board_id)->dev_type != eBOARD_DEV_EMMC) {
+        fprintf (stderr, "skip, %s board cli bench (emmc board only).\n",
+            efuse_board_name (board_id));
+        return;
+    }
+    snprintf (path[0], sizeof(path[0]), "%s/efuse_cli_ro",   dir);
+    snprintf (path[1], sizeof(path[1]), "%s/efuse_cli_dev",  dir);
+    snprintf (path[2], sizeof(path[2]), "%s/efuse_cli.prov", dir);
+    efuse_get_mac_range (board_id, &mac_start, NULL);
+    snprintf (uuid, sizeof(uuid), "dcbaa404-91bd-4a63-b5f1-%012llX", mac_start);
+
+    if ((fd = open (path[0], O_RDWR | O_CREAT | O_TRUNC, 0644)) < 0)
+        goto out;
+    i = write (fd, "1", 1);
+    close (fd);
+    if ((i != 1) || ((fd = open (path[1], O_RDWR | O_CREAT | O_TRUNC, 0644)) < 0))
+        goto out;
+    close (fd);
+    if ((fp = fopen (path[2], "w")) == NULL)
+        goto out;
+    fprintf (fp, "%s %s %s\n", uuid, path[0], path[1]);
+    fclose (fp);
+
+    // 첫 write는 측정에서 제외, 이후 같은 uuid는 read back 확인만 (unchanged)
+    memset (syscalls, 0, sizeof(syscalls));
+    bench_prov_exec (board_id, path[0], path[1], uuid);
+    if (!bench_prov_exec (board_id, path[0], path[1], uuid)) {
+        fprintf (stderr, "error, %s board cli bench setup.\n", efuse_board_name (board_id));
+        goto out;
+    }
+    for (i = 0, fail = 0, total = 0; i < cnt; i++) {
+        start  = time_ns ();
+        fail  += bench_prov_exec (board_id, path[0], path[1], uuid) ? 0 : 1;
+        lat[i] = time_ns () - start;
+        total += lat[i];
+    }
+    bench_report (board_id, eBENCH_WRITE_VERIFY, "file", lat, cnt, fail, total, syscalls);
+
+    for (i = 0, fail = 0, total = 0; i < cnt; i++) {
+        start  = time_ns ();
+        fail  += bench_cli_exec (board_id, path[2]) ? 0 : 1;
+        lat[i] = time_ns () - start;
+        total += lat[i];
+    }
+    bench_report (board_id, eBENCH_WRITE_VERIFY, "cli", lat, cnt, fail, total, syscalls);
+out:
+    for (i = 0; i < 3; i++)
+        unlink (path[i]);
+}
+
+//------------------------------------------------------------------------------
+// m2 board n개를 file-backed device(force_ro file + boot partition file)로 구성.
+// 매 round마다 uuid를 바꿔 모든 device가 실제 write/sync/read back 되도록 함.
+// sync : device별 efuse_ctx_write_verify() 순서대로, io_uring : 한번에 submit.
+// io_uring 요청이 sync path로 처리된 경우 (URING_DEV_MIN 미만 등) io_uring_fallback.
+//------------------------------------------------------------------------------
+static void bench_uring (int dev_cnt)
+{
+    const char *dir = OPT_BACKING_DIR ? OPT_BACKING_DIR : "/tmp";
+    char path [2][PATH_MAX], (*uuid)[EFUSE_UUID_SIZE +1];
+    struct efuse_uring_req *req;
+    unsigned long long mac_start;
+    long long start, total;
+    int i, fd, round, rounds, fail, uring, used, ok = 1;
+    efuse_ctx **ctx;
+
+    ctx  = calloc (dev_cnt, sizeof(efuse_ctx *));
+    req  = calloc (dev_cnt, sizeof(struct efuse_uring_req));
+    uuid = calloc (dev_cnt * 2, sizeof(*uuid));
+    if ((ctx == NULL) || (req == NULL) || (uuid == NULL))
+        goto out;
+
+    efuse_get_mac_range (eBOARD_ID_M2, &mac_start, NULL);
+    for (i = 0; i < dev_cnt; i++) {
+        snprintf (path[0], sizeof(path[0]), "%s/efuse_uring_ro%d", dir, i);
+        snprintf (path[1], sizeof(path[1]), "%s/efuse_uring_dev%d", dir, i);
+        if ((fd = open (path[0], O_RDWR | O_CREAT | O_TRUNC, 0644)) < 0) {
+            ok = 0;
+            break;
+        }
+        if (write (fd, "1", 1) != 1)
+            ok = 0;
+        close (fd);
+        if ((fd = open (path[1], O_RDWR | O_CREAT | O_TRUNC, 0644)) < 0) {
+            ok = 0;
+            break;
+        }
+        close (fd);
+        if ((ctx[i] = efuse_ctx_open (eBOARD_ID_M2)) == NULL) {
+            ok = 0;
+            break;
+        }
+        efuse_ctx_set_path (ctx[i], path[0], path[1]);
+        snprintf (uuid[i * 2],     EFUSE_UUID_SIZE +1, "dcbaa404-91bd-4a63-b5f1-%012llX",
+                  mac_start + i * 2);
+        snprintf (uuid[i * 2 + 1], EFUSE_UUID_SIZE +1, "dcbaa404-91bd-4a63-b5f1-%012llX",
+                  mac_start + i * 2 + 1);
+        req[i].ctx = ctx[i];
+    }
+    if (!ok) {
+        fprintf (stderr, "error, uring bench device setup (%s)\n", dir);
+        goto out;
+    }
+    rounds = OPT_ITERATION / dev_cnt;
+    if (rounds < 10)
+        rounds = 10;
+
+    for (uring = 0; uring < 2; uring++) {
+        for (round = 0, fail = 0, total = 0, used = 0; round < rounds; round++) {
+            for (i = 0; i < dev_cnt; i++)
+                req[i].efuse_data = uuid[i * 2 + (round % 2)];
+
+            start = time_ns ();
+            if (uring)
+                fail += dev_cnt - efuse_uring_write_verify (req, dev_cnt);
+            else
+                for (i = 0; i < dev_cnt; i++)
+                    fail += efuse_ctx_write_verify (ctx[i], req[i].efuse_data, NULL)
+                            != eEFUSE_WV_WRITTEN;
+            total += time_ns () - start;
+            for (i = 0; uring && (i < dev_cnt); i++)
+                used |= req[i].uring;
+        }
+        fprintf (BenchOut,
+            "{\"version\":\"%s\",\"backend\":\"%s\",\"board\":\"%s\","
+            "\"op\":\"write_verify\",\"devices\":%d,\"rounds\":%d,\"fail\":%d,"
+            "\"ops_per_sec\":%.1f,\"batch_mean_ns\":%lld}\n",
+            LIB_EFUSE_VERSION,
+            uring ? (used ? "io_uring" : "io_uring_fallback") : "sync",
+            efuse_board_name (eBOARD_ID_M2), dev_cnt, rounds, fail,
+            total ? (double)rounds * dev_cnt * 1e9 / total : 0.0, total / rounds);
+        fflush (BenchOut);
+    }
+out:
+    for (i = 0; (ctx != NULL) && (i < dev_cnt); i++) {
+        if (ctx[i] == NULL)
+            continue;
+        efuse_ctx_close (ctx[i]);
+        snprintf (path[0], sizeof(path[0]), "%s/efuse_uring_ro%d", dir, i);
+        snprintf (path[1], sizeof(path[1]), "%s/efuse_uring_dev%d", dir, i);
+        unlink (path[0]);
+        unlink (path[1]);
+    }
+    free (ctx);
+    free (req);
+    free (uuid);
+}
+
+//------------------------------------------------------------------------------
+// 기록된 trace를 최대 속도로 실행. operation별 기록/replay 시간 비교.
+//------------------------------------------------------------------------------
+static int bench_trace (const char *path)
+{
+    struct efuse_trace_report r;
+    int i;
+
+    if (!efuse_trace_replay (path, 0, &r)) {
+        fprintf (stderr, "error, trace replay (%s)\n", path);
+        return 0;
+    }
+    for (i = 0; i < eSIM_OP_END; i++) {
+        if (!r.op_cnt[i])
+            continue;
+        fprintf (BenchOut,
+            "{\"version\":\"%s\",\"backend\":\"trace_replay\",\"trace\":\"%s\","
+            "\"op\":\"%s\",\"count\":%ld,\"record_mean_ns\":%lld,\"record_max_ns\":%lld,"
+            "\"replay_mean_ns\":%lld,\"replay_max_ns\":%lld}\n",
+            LIB_EFUSE_VERSION, path, efuse_trace_op_name (i), r.op_cnt[i],
+            r.rec_ns[i] / r.op_cnt[i], r.rec_max_ns[i],
+            r.play_ns[i] / r.op_cnt[i], r.play_max_ns[i]);
+    }
+    fprintf (BenchOut,
+        "{\"version\":\"%s\",\"backend\":\"trace_replay\",\"trace\":\"%s\","
+        "\"op\":\"total\",\"record_span_ns\":%lld,\"replay_span_ns\":%lld,"
+        "\"mismatch\":%ld,\"skipped\":%ld}\n",
+        LIB_EFUSE_VERSION, path, r.rec_span_ns, r.play_span_ns, r.mismatch, r.skipped);
+    fflush (BenchOut);
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+int main (int argc, char **argv)
+{
+    long long *lat;
+    int board_id;
+
+    parse_opts (argc, argv);
+
+    BenchOut = (OPT_OUTPUT != NULL) ? fopen (OPT_OUTPUT, "w") : fdopen (dup (STDOUT_FILENO), "w");
+    if (BenchOut == NULL) {
+        printf ("error, output file open (%s)\n", OPT_OUTPUT ? OPT_OUTPUT : "stdout");
+        return 1;
+    }
+    // library의 console message는 결과 출력과 분리.
+    if (freopen ("/dev/null", "w", stdout) == NULL)
+        return 1;
+
+    if (OPT_TRACE != NULL) {
+        int ok = bench_trace (OPT_TRACE);
+
+        fclose (BenchOut);
+        return ok ? 0 : 1;
+    }
+    if (OPT_URING_DEV > 0) {
+        int dev_cnt;
+
+        for (dev_cnt = 1; dev_cnt < OPT_URING_DEV; dev_cnt *= 2)
+            bench_uring (dev_cnt);
+        bench_uring (OPT_URING_DEV);
+        fclose (BenchOut);
+        return 0;
+    }
+
+    if ((lat = malloc (sizeof(long long) * OPT_ITERATION)) == NULL)
+        return 1;
+
+    for (board_id = 0; board_id < eBOARD_ID_END; board_id++) {
+        if ((OPT_BOARD_ID >= 0) && (OPT_BOARD_ID != board_id))
+            continue;
+        if (!bench_board (board_id, lat))
+            fprintf (stderr, "error, %s board bench setup.\n", efuse_board_name (board_id));
+        if (OPT_CLI != NULL)
+            bench_cli (board_id, lat);
+    }
+    free (lat);
+    fclose (BenchOut);
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
@@ -0,0 +1,281 @@
+//------------------------------------------------------------------------------
+/**
+ * @file lib_efuse_board.c
+ * @author charles-park (charles.park@hardkernel.com)
+ * @brief ODROID board descriptor table and board auto detection.
+ * @version 0.2
+ * @date 2023-09-22
+ *
+ * @package apt install cups cups-bsd
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+
+#include "lib_efuse.h"
+#include "lib_efuse_board.h"
+
+//------------------------------------------------------------------------------
+// Debug msg
+//------------------------------------------------------------------------------
+#if defined (__LIB_EFUSE_APP__)
+    #define dbg_msg(fmt, args...)   printf(fmt, ##args)
+#else
+    #define dbg_msg(fmt, args...)
+#endif
+
+//------------------------------------------------------------------------------
+// device-tree compatible/model file 최대 크기
+#define BOARD_DT_SIZE   1024
+
+//------------------------------------------------------------------------------
+// board descriptor table (eBOARD_ID_xxx 순서)
+//------------------------------------------------------------------------------
+static const struct efuse_board BoardTable [eBOARD_ID_END] = {
+    // ODROID_M1
+    [eBOARD_ID_M1] = {
+        .name           = "m1",
+        .dt_name        = "odroid-m1",
+        .dev_type       = eBOARD_DEV_IOCTL,
+        .rw_control     = "/dev/efuse",
+        .rw_file        = "/sys/class/efuse/uuid",
+        .ioc_mstr       = IOC_MSTR_WRITE_M1,
+        .mac_start_str  = "001E0651",   // 65536개
+        .mac_block_cnt  = 2,            // 2개의 block reserved (13만개)
+        .mac_rw_offset  = 0,
+        .size_byte      = EFUSE_UUID_SIZE,
+    },
+    // ODROID_M1S
+    [eBOARD_ID_M1S] = {
+        .name           = "m1s",
+        .dt_name        = "odroid-m1s",
+        .dev_type       = eBOARD_DEV_EMMC,
+        .rw_control     = "/sys/class/block/mmcblk0boot0/force_ro",
+        .rw_file        = "/dev/mmcblk0boot0",
+        .mac_start_str  = "001E0653",   // 65536개
+        .mac_block_cnt  = 2,            // 2개의 block reserved (13만개)
+        .mac_rw_offset  = 0,
+        .size_byte      = EFUSE_UUID_SIZE,
+    },
+    // ODROID_M2
+    [eBOARD_ID_M2] = {
+        .name           = "m2",
+        .dt_name        = "odroid-m2",
+        .dev_type       = eBOARD_DEV_EMMC,
+        .rw_control     = "/sys/class/block/mmcblk0boot1/force_ro",
+        .rw_file        = "/dev/mmcblk0boot1",
+        .mac_start_str  = "001E0655",   // 65536개
+        .mac_block_cnt  = 2,            // 2개의 block reserved (13만개)
+        .mac_rw_offset  = (8191 * 512),
+        .size_byte      = EFUSE_UUID_SIZE,
+    },
+    // ODROID_C4 (2024/11/14, C4 Jig upgrade)
+    [eBOARD_ID_C4] = {
+        .name           = "c4",
+        .dt_name        = "odroid-c4",
+        .dev_type       = eBOARD_DEV_IOCTL,
+        .rw_control     = "/dev/efuse",
+        .rw_file        = "/sys/class/efuse/uuid",
+        .ioc_mstr       = IOC_MSTR_WRITE_C4,
+        .mac_start_str  = "001E064A",   // 65536개
+        .mac_block_cnt  = 3,            // 3개의 block reserved (13만개)
+        .mac_legacy     = 0x48,         // 2024/11/14 Jig upgrade 이전 생산품
+        .mac_rw_offset  = 0,
+        .size_byte      = EFUSE_UUID_SIZE,
+    },
+    // ODROID_C5
+    [eBOARD_ID_C5] = {
+        .name           = "c5",
+        .dt_name        = "odroid-c5",
+        .dev_type       = eBOARD_DEV_SYSFS,
+        .rw_control     = "/dev/efuse",
+        .rw_file        = "/sys/class/efuse/uuid",
+        .mac_start_str  = "001E0657",   // 65536개
+        .mac_block_cnt  = 2,            // 2개의 block reserved (13만개)
+        .mac_rw_offset  = 0,
+        .size_byte      = EFUSE_UUID_SIZE,
+    },
+};
+
+static pthread_once_t BoardOnce = PTHREAD_ONCE_INIT;
+static int            BoardDetected = -1;
+
+//------------------------------------------------------------------------------
+//	function prototype
+//------------------------------------------------------------------------------
+static int  dt_read             (const char *dt_path, const char *name, char *buf, int size);
+static int  dt_compatible       (const char *token);
+static int  dt_model            (char *model);
+static int  dev_present         (void);
+static void board_detect_once   (void);
+
+const struct efuse_board *efuse_board_info (int board_id);
+const char *efuse_board_name    (int board_id);
+int  efuse_board_find           (const char *name);
+int  efuse_board_match          (const char *dt_path);
+int  efuse_board_detect         (void);
+
+//------------------------------------------------------------------------------
+// return : read size (buf는 항상 '\0'으로 끝남), -1 = 없음
+//------------------------------------------------------------------------------
+static int dt_read (const char *dt_path, const char *name, char *buf, int size)
+{
+    char path [PATH_MAX];
+    int fd, len;
+
+    snprintf (path, sizeof(path), "%s/%s", dt_path, name);
+    if ((fd = open (path, O_RDONLY | O_CLOEXEC)) < 0)
+        return -1;
+    len = read (fd, buf, size - 1);
+    close (fd);
+    if (len < 0)
+        return -1;
+    buf[len] = 0;
+    return len;
+}
+
+//------------------------------------------------------------------------------
+// compatible 항목 1개. "hardkernel,odroid-m1", "rockchip,rk3568-odroid-m1" 등
+//------------------------------------------------------------------------------
+static int dt_compatible (const char *token)
+{
+    int id, len = strlen (token), n;
+
+    for (id = 0; id < eBOARD_ID_END; id++) {
+        n = strlen (BoardTable[id].dt_name);
+        if ((len > n) && !strcmp (&token[len - n], BoardTable[id].dt_name) &&
+            ((token[len - n - 1] == ',') || (token[len - n - 1] == '-')))
+            return id;
+    }
+    return -1;
+}
+
+//------------------------------------------------------------------------------
+// model. "Hardkernel ODROID-M1S" (odroid-m1 뒤에 문자가 이어지면 다른 board)
+//------------------------------------------------------------------------------
+static int dt_model (char *model)
+{
+    char *p;
+    int id, n;
+
+    // dt_name은 소문자
+    for (p = model; *p; p++)
+        *p = tolower ((unsigned char)*p);
+
+    for (id = 0; id < eBOARD_ID_END; id++) {
+        n = strlen (BoardTable[id].dt_name);
+        for (p = model; (p = strstr (p, BoardTable[id].dt_name)) != NULL; p++) {
+            if (!isalnum ((unsigned char)p[n]))
+                return id;
+        }
+    }
+    return -1;
+}
+
+//------------------------------------------------------------------------------
+// device-tree가 없는 경우. device file이 있는 board가 1개일 때만 선택.
+//------------------------------------------------------------------------------
+static int dev_present (void)
+{
+    int id, found = -1;
+
+    for (id = 0; id < eBOARD_ID_END; id++) {
+        if (access (BoardTable[id].rw_control, F_OK) || access (BoardTable[id].rw_file, F_OK))
+            continue;
+        if (found >= 0)
+            return -1;
+        found = id;
+    }
+    return found;
+}
+
+//------------------------------------------------------------------------------
+const struct efuse_board *efuse_board_info (int board_id)
+{
+    if ((board_id < 0) || (board_id >= eBOARD_ID_END))
+        return NULL;
+    return &BoardTable[board_id];
+}
+
+//------------------------------------------------------------------------------
+const char *efuse_board_name (int board_id)
+{
+    if ((board_id < 0) || (board_id >= eBOARD_ID_END))
+        return "unknown";
+    return BoardTable[board_id].name;
+}
+
+//------------------------------------------------------------------------------
+// return : eBOARD_ID_xxx (대소문자 구분 없음), -1 = 없음
+//------------------------------------------------------------------------------
+int efuse_board_find (const char *name)
+{
+    int id;
+
+    for (id = 0; (name != NULL) && (id < eBOARD_ID_END); id++) {
+        if (!strcasecmp (name, BoardTable[id].name))
+            return id;
+    }
+    return -1;
+}
+
+//------------------------------------------------------------------------------
+// device-tree (compatible, model) 에서 board 확인. 없으면 device file로 확인.
+// dt_path : NULL = BOARD_DT_PATH
+// return : eBOARD_ID_xxx, -1 = 알 수 없음
+//------------------------------------------------------------------------------
+int efuse_board_match (const char *dt_path)
+{
+    char buf [BOARD_DT_SIZE];
+    int len, pos, id = -1;
+
+    if (dt_path == NULL)
+        dt_path = BOARD_DT_PATH;
+
+    // compatible은 '\0'으로 구분된 list
+    if ((len = dt_read (dt_path, "compatible", buf, sizeof(buf))) > 0) {
+        for (pos = 0; (pos < len) && (id < 0); pos += strlen (&buf[pos]) + 1)
+            id = dt_compatible (&buf[pos]);
+    }
+    if ((id < 0) && (dt_read (dt_path, "model", buf, sizeof(buf)) > 0))
+        id = dt_model (buf);
+    if (id < 0)
+        return dev_present ();
+
+    if (access (BoardTable[id].rw_file, F_OK)) {
+        dbg_msg ("board %s, efuse device not found. (%s)\n",
+            BoardTable[id].name, BoardTable[id].rw_file);
+    }
+    return id;
+}
+
+//------------------------------------------------------------------------------
+static void board_detect_once (void)
+{
+    BoardDetected = efuse_board_match (NULL);
+    dbg_msg ("board detect : %s\n", efuse_board_name (BoardDetected));
+}
+
+//------------------------------------------------------------------------------
+// 실행중인 board. process당 1회만 확인 (이후 cache 사용).
+// return : eBOARD_ID_xxx, -1 = 알 수 없음
+//------------------------------------------------------------------------------
+int efuse_board_detect (void)
+{
+    pthread_once (&BoardOnce, board_detect_once);
+    return BoardDetected;
+}
+
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
@@ -0,0 +1,62 @@
+//------------------------------------------------------------------------------
+/**
+ * @file lib_efuse_board.h
+ * @author charles-park (charles.park@hardkernel.com)
+ * @brief ODROID board descriptor table and board auto detection.
+ * @version 0.2
+ * @date 2023-09-22
+ *
+ * @package apt install cups cups-bsd
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#ifndef __LIB_EFUSE_BOARD_H__
+#define __LIB_EFUSE_BOARD_H__
+
+//------------------------------------------------------------------------------
+#include "lib_efuse.h"
+
+//------------------------------------------------------------------------------
+// board별 설정은 모두 descriptor table (lib_efuse_board.c) 에 있음.
+// 새 board는 eBOARD_ID_xxx 추가 후 table에 1줄 추가.
+//------------------------------------------------------------------------------
+#define BOARD_DT_PATH   "/proc/device-tree"
+
+// efuse device 종류
+enum {
+    eBOARD_DEV_IOCTL = 0,   // /dev/efuse ioctl write + /sys/class/efuse/uuid read
+    eBOARD_DEV_EMMC,        // force_ro + mmcblk boot partition
+    eBOARD_DEV_SYSFS,       // /sys/class/efuse/uuid read/write
+    eBOARD_DEV_END
+};
+
+struct efuse_board {
+    const char  *name;          // -b option, batch/journal/metrics board 이름
+    const char  *dt_name;       // device-tree compatible/model의 board 이름
+    int         dev_type;       // eBOARD_DEV_xxx
+    const char  *rw_control;
+    const char  *rw_file;
+    const char  *ioc_mstr;      // ioctl write master string (eBOARD_DEV_IOCTL)
+
+    const char  *mac_start_str; // 0x001E06xx, block 1개 = 65536개
+    int         mac_block_cnt;
+    int         mac_legacy;     // 이전 생산 mac block (0 = 없음)
+    int         mac_rw_offset;
+    int         size_byte;
+};
+
+//------------------------------------------------------------------------------
+//	function prototype
+//------------------------------------------------------------------------------
+extern const struct efuse_board *efuse_board_info (int board_id);
+extern const char *efuse_board_name (int board_id);
+extern int  efuse_board_find        (const char *name);
+extern int  efuse_board_match       (const char *dt_path);
+extern int  efuse_board_detect      (void);
+
+//------------------------------------------------------------------------------
+#endif  // #ifndef __LIB_EFUSE_BOARD_H__
+//------------------------------------------------------------------------------
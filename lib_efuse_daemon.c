@@ -0,0 +1,404 @@
+//------------------------------------------------------------------------------
+/**
+ * @file lib_efuse_daemon.c
+ * @author charles-park (charles.park@hardkernel.com)
+ * @brief efuse provisioning daemon (unix socket server/client).
+ * @version 0.2
+ * @date 2023-09-22
+ *
+ * @package apt install cups cups-bsd
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/un.h>
+
+#include "lib_efuse.h"
+#include "lib_efuse_daemon.h"
+
+//------------------------------------------------------------------------------
+// Debug msg
+//------------------------------------------------------------------------------
+#if defined (__LIB_EFUSE_APP__)
+    #define dbg_msg(fmt, args...)   printf(fmt, ##args)
+#else
+    #define dbg_msg(fmt, args...)
+#endif
+
+//------------------------------------------------------------------------------
+// board별 context는 최초 요청시 생성 후 daemon 종료시까지 유지.
+// read session (SrvWarm)을 열어두고 read/check/mac 요청은 같은 descriptor 사용
+// (path 확인, open/close 생략). write/erase는 write session으로 처리 후 종료하여
+// emmc hidden partition은 요청마다 다시 lock.
+//------------------------------------------------------------------------------
+static efuse_ctx *SrvCtx  [eBOARD_ID_END];
+static int        SrvWarm [eBOARD_ID_END];
+static const struct efuse_io *SrvIo = NULL;
+static efuse_ctx_init_cb SrvInit = NULL;
+static void *SrvInitArg = NULL;
+
+static volatile sig_atomic_t SrvStop = 0;
+
+//------------------------------------------------------------------------------
+// function prototype
+//------------------------------------------------------------------------------
+static int  srv_sock_addr   (struct sockaddr_un *addr, const char *sock_path);
+static int  srv_unlink      (const char *sock_path);
+static int  srv_listen      (const char *sock_path);
+static int  srv_warm        (int board_id);
+static void srv_cool        (int board_id);
+static int  srv_read        (int board_id, char *efuse_data);
+static int  srv_write       (int board_id, char *efuse_data, char control);
+static void srv_request     (struct efuse_srv_msg *msg);
+
+int  efuse_daemon_run       (const char *sock_path);
+void efuse_daemon_stop      (void);
+void efuse_daemon_set_io    (const struct efuse_io *io);
+void efuse_daemon_set_ctx_init (efuse_ctx_init_cb cb, void *arg);
+int  efuse_client_request   (const char *sock_path, int cmd, int board_id,
+                             char *efuse_data);
+
+//------------------------------------------------------------------------------
+static int srv_sock_addr (struct sockaddr_un *addr, const char *sock_path)
+{
+    memset (addr, 0, sizeof(struct sockaddr_un));
+    addr->sun_family = AF_UNIX;
+
+    if (strlen (sock_path) >= sizeof(addr->sun_path)) {
+        dbg_msg ("error, socket path too long. (%s)\n", sock_path);
+        return 0;
+    }
+    strcpy (addr->sun_path, sock_path);
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+// 이전 실행에서 남은 socket만 삭제 (같은 이름의 일반 file 등은 유지).
+// return : 1 = 삭제 또는 없음, 0 = socket이 아닌 file 존재
+//------------------------------------------------------------------------------
+static int srv_unlink (const char *sock_path)
+{
+    struct stat st;
+
+    if (lstat (sock_path, &st) < 0)
+        return 1;
+    if (!S_ISSOCK (st.st_mode)) {
+        errno = EEXIST;
+        return 0;
+    }
+    unlink (sock_path);
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+static int srv_listen (const char *sock_path)
+{
+    struct sockaddr_un addr;
+    int fd;
+
+    if (!srv_sock_addr (&addr, sock_path))
+        return -1;
+
+    if ((fd = socket (AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0)) < 0) {
+        dbg_msg ("error, socket create. (%s)\n", strerror(errno));
+        return -1;
+    }
+    if (!srv_unlink (sock_path)) {
+        dbg_msg ("error, not a socket. (%s)\n", sock_path);
+        close (fd);
+        return -1;
+    }
+    if (bind (fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        dbg_msg ("error, socket bind. (%s, %s)\n", sock_path, strerror(errno));
+        close (fd);
+        return -1;
+    }
+    // listen 전에 권한 변경 (umask와 무관하게 다른 user는 write/erase 요청 불가)
+    if (chmod (sock_path, EFUSE_SOCKET_MODE) < 0) {
+        dbg_msg ("error, socket chmod. (%s, %s)\n", sock_path, strerror(errno));
+        close (fd);
+        srv_unlink (sock_path);
+        return -1;
+    }
+    if (listen (fd, EFUSE_SRV_CLIENT_MAX) < 0) {
+        dbg_msg ("error, socket listen. (%s)\n", strerror(errno));
+        close (fd);
+        srv_unlink (sock_path);
+        return -1;
+    }
+    return fd;
+}
+
+//------------------------------------------------------------------------------
+// read session 시작. 실패시 (device 없음 등) 다음 요청에서 다시 시도.
+//------------------------------------------------------------------------------
+static int srv_warm (int board_id)
+{
+    if (!SrvWarm[board_id])
+        SrvWarm[board_id] = efuse_ctx_begin (SrvCtx[board_id], 0);
+    return SrvWarm[board_id];
+}
+
+//------------------------------------------------------------------------------
+static void srv_cool (int board_id)
+{
+    if (SrvWarm[board_id])
+        efuse_ctx_end (SrvCtx[board_id]);
+    SrvWarm[board_id] = 0;
+}
+
+//------------------------------------------------------------------------------
+// session descriptor로 read. 실패하면 (device 교체, 제거 등) 새로 open 하여 1회 재시도.
+//------------------------------------------------------------------------------
+static int srv_read (int board_id, char *efuse_data)
+{
+    efuse_ctx *ctx = SrvCtx[board_id];
+
+    srv_warm (board_id);
+    if (efuse_ctx_control (ctx, efuse_data, EFUSE_READ))
+        return 1;
+    if (!SrvWarm[board_id])
+        return 0;
+
+    srv_cool (board_id);
+    srv_warm (board_id);
+    return efuse_ctx_control (ctx, efuse_data, EFUSE_READ);
+}
+
+//------------------------------------------------------------------------------
+// write session으로 write/erase 후 session 종료 (lock 복구 실패도 error).
+//------------------------------------------------------------------------------
+static int srv_write (int board_id, char *efuse_data, char control)
+{
+    efuse_ctx *ctx = SrvCtx[board_id];
+    int status;
+
+    srv_cool (board_id);
+    if (!efuse_ctx_begin (ctx, 1))
+        return 0;
+    status = efuse_ctx_control (ctx, efuse_data, control);
+    if (!efuse_ctx_end (ctx))
+        status = 0;
+    return status;
+}
+
+//------------------------------------------------------------------------------
+// request를 처리하여 같은 msg에 response를 채움.
+//------------------------------------------------------------------------------
+static void srv_request (struct efuse_srv_msg *msg)
+{
+    char efuse_data [EFUSE_UUID_SIZE +1];
+    efuse_ctx *ctx;
+    int status = 0;
+
+    msg->status = 0;
+    if ((msg->magic != EFUSE_SRV_MAGIC) || (msg->board_id >= eBOARD_ID_END)) {
+        msg->len = 0;
+        return;
+    }
+    if (SrvCtx[msg->board_id] == NULL) {
+        SrvCtx[msg->board_id] = efuse_ctx_open (msg->board_id);
+        if ((SrvCtx[msg->board_id] != NULL) && (SrvIo != NULL))
+            efuse_ctx_set_io (SrvCtx[msg->board_id], SrvIo);
+        if ((SrvCtx[msg->board_id] != NULL) && (SrvInit != NULL))
+            SrvInit (SrvInitArg, SrvCtx[msg->board_id]);
+    }
+    if ((ctx = SrvCtx[msg->board_id]) == NULL) {
+        msg->len = 0;
+        return;
+    }
+
+    memset (efuse_data, 0, sizeof(efuse_data));
+    switch (msg->cmd) {
+        case EFUSE_SRV_WRITE:
+            if (msg->len != EFUSE_UUID_SIZE)
+                break;
+            memcpy (efuse_data, msg->data, EFUSE_UUID_SIZE);
+            status = srv_write (msg->board_id, efuse_data, EFUSE_WRITE);
+            break;
+        case EFUSE_SRV_ERASE:
+            status = srv_write (msg->board_id, efuse_data, EFUSE_ERASE);
+            break;
+        case EFUSE_SRV_READ:
+            status = srv_read (msg->board_id, efuse_data);
+            break;
+        case EFUSE_SRV_CHECK:
+            if (srv_read (msg->board_id, efuse_data))
+                status = efuse_ctx_valid_check (ctx, efuse_data);
+            break;
+        case EFUSE_SRV_MAC:
+            if ((status = srv_read (msg->board_id, efuse_data))) {
+                char mac [MAC_STR_SIZE];
+
+                efuse_ctx_get_mac (ctx, efuse_data, mac);
+                memset (efuse_data, 0, sizeof(efuse_data));
+                memcpy (efuse_data, mac, MAC_STR_SIZE);
+            }
+            break;
+        default :
+            dbg_msg ("Unknown request cmd.(%d)\n", msg->cmd);
+            break;
+    }
+    msg->status = status ? 1 : 0;
+    msg->len    = strnlen (efuse_data, EFUSE_UUID_SIZE);
+    memcpy (msg->data, efuse_data, EFUSE_UUID_SIZE);
+}
+
+//------------------------------------------------------------------------------
+// daemon main loop. efuse_daemon_stop() 또는 error 발생시 return.
+//------------------------------------------------------------------------------
+int efuse_daemon_run (const char *sock_path)
+{
+    struct pollfd fds [EFUSE_SRV_CLIENT_MAX +1];
+    struct efuse_srv_msg msg;
+    int i, nfds, ret;
+
+    if ((fds[0].fd = srv_listen (sock_path)) < 0)
+        return 0;
+    fds[0].events = POLLIN;
+    nfds = 1;
+
+    dbg_msg ("efuse daemon start. (%s)\n", sock_path);
+    SrvStop = 0;
+    while (!SrvStop) {
+        if ((ret = poll (fds, nfds, 1000)) <= 0) {
+            if ((ret < 0) && (errno != EINTR))
+                break;
+            continue;
+        }
+        // new client
+        if (fds[0].revents & POLLIN) {
+            int cfd = accept (fds[0].fd, NULL, NULL);
+
+            if (cfd >= 0) {
+                if (nfds > EFUSE_SRV_CLIENT_MAX) {
+                    dbg_msg ("error, client full.\n");
+                    close (cfd);
+                } else {
+                    fds[nfds].fd = cfd;
+                    fds[nfds].events = POLLIN;
+                    fds[nfds].revents = 0;
+                    nfds++;
+                }
+            }
+        }
+        for (i = 1; i < nfds; i++) {
+            if (!fds[i].revents)
+                continue;
+
+            memset (&msg, 0, sizeof(msg));
+            ret = recv (fds[i].fd, &msg, sizeof(msg), 0);
+            if (ret == (int)sizeof(msg)) {
+                srv_request (&msg);
+                send (fds[i].fd, &msg, sizeof(msg), MSG_NOSIGNAL);
+                continue;
+            }
+            if ((ret < 0) && (errno == EINTR))
+                continue;
+            // client closed or bad frame
+            close (fds[i].fd);
+            fds[i] = fds[--nfds];
+            i--;
+        }
+    }
+    for (i = 0; i < nfds; i++)
+        close (fds[i].fd);
+    srv_unlink (sock_path);
+
+    for (i = 0; i < eBOARD_ID_END; i++) {
+        efuse_ctx_close (SrvCtx[i]);
+        SrvCtx[i]  = NULL;
+        SrvWarm[i] = 0;
+    }
+    dbg_msg ("efuse daemon stop.\n");
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+// signal handler에서 호출 가능.
+//------------------------------------------------------------------------------
+void efuse_daemon_stop (void)
+{
+    SrvStop = 1;
+}
+
+//------------------------------------------------------------------------------
+// board context의 I/O backend (NULL = kernel). efuse_daemon_run() 전에 설정.
+//------------------------------------------------------------------------------
+void efuse_daemon_set_io (const struct efuse_io *io)
+{
+    SrvIo = io;
+}
+
+//------------------------------------------------------------------------------
+// board context 생성시 호출 (I/O backend 설정 후). efuse_daemon_run() 전에 설정.
+//------------------------------------------------------------------------------
+void efuse_daemon_set_ctx_init (efuse_ctx_init_cb cb, void *arg)
+{
+    SrvInit    = cb;
+    SrvInitArg = arg;
+}
+
+//------------------------------------------------------------------------------
+// daemon에 request 1개를 보내고 response를 기다림.
+// efuse_data : write data(input) 또는 read/mac data(output, EFUSE_UUID_SIZE+1)
+// return : 1 = success, 0 = fail, -1 = daemon 연결 실패
+//------------------------------------------------------------------------------
+int efuse_client_request (const char *sock_path, int cmd, int board_id,
+                          char *efuse_data)
+{
+    struct sockaddr_un addr;
+    struct efuse_srv_msg msg;
+    int fd;
+
+    if (!srv_sock_addr (&addr, sock_path))
+        return -1;
+
+    if ((fd = socket (AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0)) < 0)
+        return -1;
+
+    if (connect (fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        dbg_msg ("error, daemon connect. (%s, %s)\n", sock_path, strerror(errno));
+        close (fd);
+        return -1;
+    }
+
+    memset (&msg, 0, sizeof(msg));
+    msg.magic    = EFUSE_SRV_MAGIC;
+    msg.cmd      = cmd;
+    msg.board_id = board_id;
+    if ((cmd == EFUSE_SRV_WRITE) && (efuse_data != NULL)) {
+        msg.len = strnlen (efuse_data, EFUSE_UUID_SIZE);
+        memcpy (msg.data, efuse_data, msg.len);
+    }
+
+    if ((send (fd, &msg, sizeof(msg), MSG_NOSIGNAL) != sizeof(msg)) ||
+        (recv (fd, &msg, sizeof(msg), 0) != sizeof(msg)) ||
+        (msg.magic != EFUSE_SRV_MAGIC)) {
+        dbg_msg ("error, daemon request. (%s)\n", strerror(errno));
+        close (fd);
+        return -1;
+    }
+    close (fd);
+
+    if ((efuse_data != NULL) && (cmd != EFUSE_SRV_WRITE)) {
+        memset (efuse_data, 0, EFUSE_UUID_SIZE +1);
+        memcpy (efuse_data, msg.data, msg.len);
+    }
+    return msg.status;
+}
+
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
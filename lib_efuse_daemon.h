@@ -0,0 +1,61 @@
+//------------------------------------------------------------------------------
+/**
+ * @file lib_efuse_daemon.h
+ * @author charles-park (charles.park@hardkernel.com)
+ * @brief efuse provisioning daemon (unix socket server/client).
+ * @version 0.2
+ * @date 2023-09-22
+ *
+ * @package apt install cups cups-bsd
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#ifndef __LIB_EFUSE_DAEMON_H__
+#define __LIB_EFUSE_DAEMON_H__
+
+//------------------------------------------------------------------------------
+#include "lib_efuse.h"
+
+//------------------------------------------------------------------------------
+#define EFUSE_SOCKET_PATH   "/run/lib_efuse.sock"
+#define EFUSE_SOCKET_MODE   0600    // daemon user만 요청 가능
+
+#define EFUSE_SRV_MAGIC     0x4546  // "EF"
+#define EFUSE_SRV_CLIENT_MAX 16
+
+// request command
+#define EFUSE_SRV_READ      0
+#define EFUSE_SRV_ERASE     1
+#define EFUSE_SRV_WRITE     2
+#define EFUSE_SRV_CHECK     3
+#define EFUSE_SRV_MAC       4
+
+//------------------------------------------------------------------------------
+// SOCK_SEQPACKET 1 frame = 1 message. request/response 동일 구조.
+// len : data의 유효 byte 수. (response status 1 = success, 0 = fail)
+//------------------------------------------------------------------------------
+struct efuse_srv_msg {
+    unsigned short  magic;
+    unsigned char   cmd;
+    unsigned char   board_id;
+    unsigned char   status;
+    unsigned char   len;
+    char            data [EFUSE_UUID_SIZE];
+}   __attribute__((packed));
+
+//------------------------------------------------------------------------------
+//	function prototype
+//------------------------------------------------------------------------------
+extern int  efuse_daemon_run        (const char *sock_path);
+extern void efuse_daemon_stop       (void);
+extern void efuse_daemon_set_io     (const struct efuse_io *io);
+extern void efuse_daemon_set_ctx_init (efuse_ctx_init_cb cb, void *arg);
+extern int  efuse_client_request    (const char *sock_path, int cmd, int board_id,
+                                     char *efuse_data);
+
+//------------------------------------------------------------------------------
+#endif  // #ifndef __LIB_EFUSE_DAEMON_H__
+//------------------------------------------------------------------------------
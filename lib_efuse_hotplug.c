@@ -0,0 +1,524 @@
+//------------------------------------------------------------------------------
+/**
+ * @file lib_efuse_hotplug.c
+ * @author charles-park (charles.park@hardkernel.com)
+ * @brief efuse hotplug provisioning (kernel uevent driven).
+ * @version 0.2
+ * @date 2023-09-22
+ *
+ * @package apt install cups cups-bsd
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <linux/netlink.h>
+
+#include "lib_efuse.h"
+#include "lib_efuse_hotplug.h"
+
+//------------------------------------------------------------------------------
+// Debug msg
+//------------------------------------------------------------------------------
+#if defined (__LIB_EFUSE_APP__)
+    #define dbg_msg(fmt, args...)   printf(fmt, ##args)
+#else
+    #define dbg_msg(fmt, args...)
+#endif
+
+//------------------------------------------------------------------------------
+// kernel uevent multicast group (udev가 재전송하는 group 2는 사용하지 않음)
+#define UEVENT_GROUP_KERNEL     1
+#define UEVENT_RCVBUF_SIZE      (1024 * 1024)
+
+//------------------------------------------------------------------------------
+struct hp_state;
+
+struct hp_slot {
+    struct hp_state *st;
+    int             index;
+    efuse_ctx       *ctx;
+    char            rw_control  [PATH_MAX];
+    char            rw_file     [PATH_MAX];
+
+    pthread_t       thread;
+    int             started;
+    int             busy;       // provisioning thread 동작중
+    int             again;      // 동작중 재장착 event, 끝난 후 다시 실행
+    int             present;    // add event (또는 시작시 존재) 후 remove 전까지
+};
+
+struct hp_state {
+    struct hp_slot  slots [HOTPLUG_SLOT_MAX];
+    int             slot_cnt;
+    efuse_hotplug_cb cb;
+    void            *arg;
+
+    pthread_mutex_t mutex;
+    long            event_cnt;
+    long            trigger_cnt;
+    long            ok_cnt;
+    long            fail_cnt;
+};
+
+// efuse_hotplug_stop()은 signal handler에서 호출 가능 (pipe write만 사용).
+static int HpStop   = 0;
+static int HpStopFd = -1;
+
+//------------------------------------------------------------------------------
+// function prototype
+//------------------------------------------------------------------------------
+static void  hp_copy        (char *dst, size_t size, const char *src);
+static int   hp_unlink      (const char *local_path);
+static int   hp_match       (const struct hp_slot *slot, const struct efuse_uevent *ev);
+static void *hp_slot_thread (void *arg);
+static void  hp_trigger     (struct hp_slot *slot);
+static void  hp_event       (struct hp_state *st, const struct efuse_uevent *ev);
+static void  hp_scan        (struct hp_state *st);
+
+int  efuse_uevent_open      (const char *local_path);
+void efuse_uevent_close     (int fd, const char *local_path);
+int  efuse_uevent_recv      (int fd, struct efuse_uevent *ev);
+int  efuse_uevent_parse     (const char *msg, int len, struct efuse_uevent *ev);
+int  efuse_uevent_send      (const char *local_path, const char *action,
+                             const char *subsystem, const char *devname);
+int  efuse_hotplug_run      (int uevent_fd, const struct efuse_hotplug_slot *slots,
+                             int slot_cnt, efuse_hotplug_cb cb, void *arg,
+                             struct efuse_hotplug_report *report);
+void efuse_hotplug_stop     (void);
+
+//------------------------------------------------------------------------------
+static void hp_copy (char *dst, size_t size, const char *src)
+{
+    size_t len = strnlen (src, size - 1);
+
+    memcpy (dst, src, len);
+    dst[len] = 0;
+}
+
+//------------------------------------------------------------------------------
+// 이전 실행에서 남은 socket만 삭제 (같은 이름의 일반 file 등은 유지).
+// return : 1 = 삭제 또는 없음, 0 = socket이 아닌 file 존재
+//------------------------------------------------------------------------------
+static int hp_unlink (const char *local_path)
+{
+    struct stat st;
+
+    if (lstat (local_path, &st) < 0)
+        return 1;
+    if (!S_ISSOCK (st.st_mode)) {
+        errno = EEXIST;
+        return 0;
+    }
+    unlink (local_path);
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+// uevent 수신 socket open.
+// local_path : NULL이면 kernel netlink (NETLINK_KOBJECT_UEVENT),
+//              아니면 해당 path의 unix datagram socket (test용 event 주입)
+// return : fd, -1 = error
+//------------------------------------------------------------------------------
+int efuse_uevent_open (const char *local_path)
+{
+    struct sockaddr_nl nl;
+    struct sockaddr_un un;
+    int fd, size = UEVENT_RCVBUF_SIZE;
+
+    if (local_path == NULL) {
+        fd = socket (AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_KOBJECT_UEVENT);
+        if (fd < 0) {
+            dbg_msg ("error, uevent socket create. (%s)\n", strerror(errno));
+            return -1;
+        }
+        // 여러 board가 한번에 연결되는 경우 event 유실 방지.
+        setsockopt (fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+
+        memset (&nl, 0, sizeof(nl));
+        nl.nl_family = AF_NETLINK;
+        nl.nl_groups = UEVENT_GROUP_KERNEL;
+        if (bind (fd, (struct sockaddr *)&nl, sizeof(nl)) < 0) {
+            dbg_msg ("error, uevent socket bind. (%s)\n", strerror(errno));
+            close (fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    memset (&un, 0, sizeof(un));
+    un.sun_family = AF_UNIX;
+    if (strlen (local_path) >= sizeof(un.sun_path)) {
+        dbg_msg ("error, socket path too long. (%s)\n", local_path);
+        return -1;
+    }
+    strcpy (un.sun_path, local_path);
+
+    if ((fd = socket (AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0)) < 0)
+        return -1;
+    if (!hp_unlink (local_path)) {
+        dbg_msg ("error, not a socket. (%s)\n", local_path);
+        close (fd);
+        return -1;
+    }
+    if (bind (fd, (struct sockaddr *)&un, sizeof(un)) < 0) {
+        dbg_msg ("error, socket bind. (%s, %s)\n", local_path, strerror(errno));
+        close (fd);
+        return -1;
+    }
+    return fd;
+}
+
+//------------------------------------------------------------------------------
+void efuse_uevent_close (int fd, const char *local_path)
+{
+    if (fd >= 0)
+        close (fd);
+    if (local_path != NULL)
+        hp_unlink (local_path);
+}
+
+//------------------------------------------------------------------------------
+// kernel uevent message 분석.
+// "action@devpath\0ACTION=add\0DEVPATH=...\0SUBSYSTEM=block\0DEVNAME=mmcblk0boot0\0..."
+// return : 1 = success, 0 = ACTION 없음 (udev message 등)
+//------------------------------------------------------------------------------
+int efuse_uevent_parse (const char *msg, int len, struct efuse_uevent *ev)
+{
+    const char *p = msg, *end = msg + len;
+
+    memset (ev, 0, sizeof(struct efuse_uevent));
+    while (p < end) {
+        size_t n = strnlen (p, end - p);
+
+        if      (!strncmp (p, "ACTION=", 7))
+            hp_copy (ev->action,    sizeof(ev->action),    p + 7);
+        else if (!strncmp (p, "SUBSYSTEM=", 10))
+            hp_copy (ev->subsystem, sizeof(ev->subsystem), p + 10);
+        else if (!strncmp (p, "DEVNAME=", 8))
+            hp_copy (ev->devname,   sizeof(ev->devname),   p + 8);
+        else if (!strncmp (p, "DEVPATH=", 8))
+            hp_copy (ev->devpath,   sizeof(ev->devpath),   p + 8);
+        p += n + 1;
+    }
+    return ev->action[0] ? 1 : 0;
+}
+
+//------------------------------------------------------------------------------
+// uevent 1개 수신. netlink는 kernel(nl_pid 0)이 보낸 message만 사용.
+// return : 1 = event, 0 = 무시된 message, -1 = error (errno)
+//------------------------------------------------------------------------------
+int efuse_uevent_recv (int fd, struct efuse_uevent *ev)
+{
+    char buf [UEVENT_MSG_SIZE];
+    struct sockaddr_storage addr;
+    socklen_t addr_len = sizeof(addr);
+    ssize_t len;
+
+    memset (&addr, 0, sizeof(addr));
+    len = recvfrom (fd, buf, sizeof(buf) - 1, 0, (struct sockaddr *)&addr, &addr_len);
+    if (len < 0)
+        return -1;
+
+    if ((addr.ss_family == AF_NETLINK) && ((struct sockaddr_nl *)&addr)->nl_pid)
+        return 0;
+
+    buf[len] = 0;
+    return efuse_uevent_parse (buf, len, ev);
+}
+
+//------------------------------------------------------------------------------
+// local uevent socket에 kernel 형식의 event 전송 (kernel uevent 대신 test/jig 용도).
+//------------------------------------------------------------------------------
+int efuse_uevent_send (const char *local_path, const char *action,
+                       const char *subsystem, const char *devname)
+{
+    char msg [UEVENT_MSG_SIZE];
+    struct sockaddr_un un;
+    int fd, len;
+    ssize_t ret;
+
+    memset (&un, 0, sizeof(un));
+    un.sun_family = AF_UNIX;
+    if (strlen (local_path) >= sizeof(un.sun_path))
+        return 0;
+    strcpy (un.sun_path, local_path);
+
+    len = snprintf (msg, sizeof(msg),
+            "%s@/devices/virtual/%s/%s%cACTION=%s%cDEVPATH=/devices/virtual/%s/%s%c"
+            "SUBSYSTEM=%s%cDEVNAME=%s",
+            action, subsystem, devname, 0, action, 0, subsystem, devname, 0,
+            subsystem, 0, devname);
+    if ((len < 0) || (len >= (int)sizeof(msg)))
+        return 0;
+
+    if ((fd = socket (AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0)) < 0)
+        return 0;
+    ret = sendto (fd, msg, len + 1, 0, (struct sockaddr *)&un, sizeof(un));
+    close (fd);
+    return (ret == len + 1) ? 1 : 0;
+}
+
+//------------------------------------------------------------------------------
+// event의 device node(/dev/DEVNAME)가 slot의 control 또는 data file 인지 확인.
+//------------------------------------------------------------------------------
+static int hp_match (const struct hp_slot *slot, const struct efuse_uevent *ev)
+{
+    char node [PATH_MAX];
+
+    if (!ev->devname[0])
+        return 0;
+    snprintf (node, sizeof(node), "/dev/%s", ev->devname);
+    return !strcmp (node, slot->rw_control) || !strcmp (node, slot->rw_file);
+}
+
+//------------------------------------------------------------------------------
+static void *hp_slot_thread (void *arg)
+{
+    struct hp_slot *slot = (struct hp_slot *)arg;
+    struct hp_state *st = slot->st;
+    int ret;
+
+    while (1) {
+        ret = st->cb (st->arg, slot->index, slot->ctx);
+
+        pthread_mutex_lock (&st->mutex);
+        if (ret)    st->ok_cnt++;
+        else        st->fail_cnt++;
+        if (!slot->again) {
+            slot->busy = 0;
+            pthread_mutex_unlock (&st->mutex);
+            break;
+        }
+        slot->again = 0;
+        st->trigger_cnt++;
+        pthread_mutex_unlock (&st->mutex);
+    }
+    return NULL;
+}
+
+//------------------------------------------------------------------------------
+// provisioning 시작. 동작중이면 끝난 후 한번 더 실행 (board 교체).
+//------------------------------------------------------------------------------
+static void hp_trigger (struct hp_slot *slot)
+{
+    struct hp_state *st = slot->st;
+
+    pthread_mutex_lock (&st->mutex);
+    if (slot->busy) {
+        slot->again = 1;
+        pthread_mutex_unlock (&st->mutex);
+        return;
+    }
+    slot->busy = 1;
+    st->trigger_cnt++;
+    pthread_mutex_unlock (&st->mutex);
+
+    if (slot->started)
+        pthread_join (slot->thread, NULL);
+    slot->started = 0;
+
+    if (pthread_create (&slot->thread, NULL, hp_slot_thread, slot)) {
+        dbg_msg ("error, hotplug slot %d thread create.\n", slot->index);
+        pthread_mutex_lock (&st->mutex);
+        slot->busy = 0;
+        st->fail_cnt++;
+        pthread_mutex_unlock (&st->mutex);
+        return;
+    }
+    slot->started = 1;
+}
+
+//------------------------------------------------------------------------------
+// devtmpfs는 uevent 전송 전에 /dev node를 생성하므로 add event 시점에 access 가능.
+// 나머지 file(force_ro 등)이 늦게 생성되는 경우는 ctx retry 설정으로 처리.
+//------------------------------------------------------------------------------
+static void hp_event (struct hp_state *st, const struct efuse_uevent *ev)
+{
+    struct hp_slot *slot;
+    int i;
+
+    for (i = 0; i < st->slot_cnt; i++) {
+        slot = &st->slots[i];
+        if (!hp_match (slot, ev))
+            continue;
+
+        dbg_msg ("hotplug slot %d : %s %s (%s)\n", i, ev->action, ev->devname, ev->subsystem);
+        if (!strcmp (ev->action, "remove")) {
+            slot->present = 0;
+            continue;
+        }
+        if (strcmp (ev->action, "add") || slot->present)
+            continue;
+        slot->present = 1;
+        hp_trigger (slot);
+    }
+}
+
+//------------------------------------------------------------------------------
+// 시작 전에 이미 연결된 device는 add event가 없으므로 한번 확인 후 provisioning.
+//------------------------------------------------------------------------------
+static void hp_scan (struct hp_state *st)
+{
+    struct hp_slot *slot;
+    int i;
+
+    for (i = 0; i < st->slot_cnt; i++) {
+        slot = &st->slots[i];
+        if (access (slot->rw_control, F_OK) || access (slot->rw_file, F_OK))
+            continue;
+
+        dbg_msg ("hotplug slot %d : present %s\n", i, slot->rw_file);
+        slot->present = 1;
+        hp_trigger (slot);
+    }
+}
+
+//------------------------------------------------------------------------------
+// uevent를 기다리다가 slot의 device가 연결되면 cb로 provisioning.
+// efuse_hotplug_stop() 또는 uevent socket error 발생시 동작중인 provisioning이
+// 끝나기를 기다린 후 return.
+// uevent_fd : efuse_uevent_open()
+//------------------------------------------------------------------------------
+int efuse_hotplug_run (int uevent_fd, const struct efuse_hotplug_slot *slots,
+                       int slot_cnt, efuse_hotplug_cb cb, void *arg,
+                       struct efuse_hotplug_report *report)
+{
+    struct hp_state *st;
+    struct efuse_uevent ev;
+    struct pollfd fds [2];
+    const char *rw_control, *rw_file;
+    int i, ret = 1, stop_pipe [2];
+
+    if ((uevent_fd < 0) || (slot_cnt <= 0) || (slot_cnt > HOTPLUG_SLOT_MAX) || (cb == NULL))
+        return 0;
+    if ((st = calloc (1, sizeof(struct hp_state))) == NULL)
+        return 0;
+
+    st->slot_cnt = slot_cnt;
+    st->cb       = cb;
+    st->arg      = arg;
+    pthread_mutex_init (&st->mutex, NULL);
+
+    for (i = 0; i < slot_cnt; i++) {
+        struct hp_slot *slot = &st->slots[i];
+
+        slot->st    = st;
+        slot->index = i;
+        if (((slot->ctx = efuse_ctx_open (slots[i].board_id)) == NULL) ||
+            !efuse_ctx_set_path (slot->ctx, slots[i].rw_control, slots[i].rw_file)) {
+            dbg_msg ("error, hotplug slot %d context.\n", i);
+            ret = 0;
+            goto out;
+        }
+        efuse_ctx_get_path (slot->ctx, &rw_control, &rw_file);
+        hp_copy (slot->rw_control, sizeof(slot->rw_control), rw_control);
+        hp_copy (slot->rw_file,    sizeof(slot->rw_file),    rw_file);
+    }
+
+    if (pipe (stop_pipe) < 0) {
+        ret = 0;
+        goto out;
+    }
+    for (i = 0; i < 2; i++)
+        fcntl (stop_pipe[i], F_SETFD, FD_CLOEXEC);
+    fcntl (stop_pipe[1], F_SETFL, O_NONBLOCK);
+    fds[0].fd     = uevent_fd;
+    fds[0].events = POLLIN;
+    fds[1].fd     = stop_pipe[0];
+    fds[1].events = POLLIN;
+
+    dbg_msg ("efuse hotplug start. (%d slots)\n", slot_cnt);
+    __atomic_store_n (&HpStop,   0, __ATOMIC_RELAXED);
+    __atomic_store_n (&HpStopFd, stop_pipe[1], __ATOMIC_RELEASE);
+    hp_scan (st);
+    while (!__atomic_load_n (&HpStop, __ATOMIC_RELAXED)) {
+        if (poll (fds, 2, -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            ret = 0;
+            break;
+        }
+        if (fds[1].revents) {
+            char c;
+            ssize_t n = read (stop_pipe[0], &c, 1);
+
+            (void)n;
+            break;
+        }
+        if (!fds[0].revents)
+            continue;
+
+        switch (efuse_uevent_recv (uevent_fd, &ev)) {
+            case 1:
+                st->event_cnt++;
+                hp_event (st, &ev);
+                break;
+            case 0:
+                break;
+            default :
+                // kernel buffer overflow는 일부 event 유실, 계속 동작.
+                if (errno == ENOBUFS) {
+                    dbg_msg ("error, uevent buffer overflow.\n");
+                    break;
+                }
+                if (errno == EINTR)
+                    break;
+                dbg_msg ("error, uevent recv. (%s)\n", strerror(errno));
+                ret = 0;
+                __atomic_store_n (&HpStop, 1, __ATOMIC_RELAXED);
+                break;
+        }
+    }
+    __atomic_store_n (&HpStopFd, -1, __ATOMIC_RELEASE);
+    close (stop_pipe[0]);
+    close (stop_pipe[1]);
+    dbg_msg ("efuse hotplug stop.\n");
+out:
+    for (i = 0; i < slot_cnt; i++) {
+        if (st->slots[i].started)
+            pthread_join (st->slots[i].thread, NULL);
+        efuse_ctx_close (st->slots[i].ctx);
+    }
+    if (report != NULL) {
+        report->event_cnt   = st->event_cnt;
+        report->trigger_cnt = st->trigger_cnt;
+        report->ok_cnt      = st->ok_cnt;
+        report->fail_cnt    = st->fail_cnt;
+    }
+    pthread_mutex_destroy (&st->mutex);
+    free (st);
+    return ret;
+}
+
+//------------------------------------------------------------------------------
+// signal handler에서 호출 가능.
+//------------------------------------------------------------------------------
+void efuse_hotplug_stop (void)
+{
+    int fd = __atomic_load_n (&HpStopFd, __ATOMIC_ACQUIRE);
+
+    __atomic_store_n (&HpStop, 1, __ATOMIC_RELAXED);
+    if (fd >= 0) {
+        ssize_t ret = write (fd, "", 1);
+        (void)ret;
+    }
+}
+
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
@@ -0,0 +1,76 @@
+//------------------------------------------------------------------------------
+/**
+ * @file lib_efuse_hotplug.h
+ * @author charles-park (charles.park@hardkernel.com)
+ * @brief efuse hotplug provisioning (kernel uevent driven).
+ * @version 0.2
+ * @date 2023-09-22
+ *
+ * @package apt install cups cups-bsd
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#ifndef __LIB_EFUSE_HOTPLUG_H__
+#define __LIB_EFUSE_HOTPLUG_H__
+
+//------------------------------------------------------------------------------
+#include "lib_efuse.h"
+
+//------------------------------------------------------------------------------
+#define HOTPLUG_SLOT_MAX    32
+#define UEVENT_MSG_SIZE     4096
+
+//------------------------------------------------------------------------------
+// uevent 1개. kernel message의 ACTION/SUBSYSTEM/DEVNAME/DEVPATH만 사용.
+//------------------------------------------------------------------------------
+struct efuse_uevent {
+    char    action      [16];   // add, remove, change ...
+    char    subsystem   [32];   // block, misc ...
+    char    devname     [64];   // /dev 기준 이름 (e.g. mmcblk0boot0, efuse)
+    char    devpath     [256];  // /sys 기준 path
+};
+
+//------------------------------------------------------------------------------
+// jig의 DUT 자리 1개. rw_control/rw_file이 NULL이면 board 기본 device 사용.
+// device node(/dev/xxx)가 생성되는 add event로 provisioning 시작.
+// hotplug 시작 전에 이미 있는 device (rw_control, rw_file 모두 존재)는 바로 시작.
+//------------------------------------------------------------------------------
+struct efuse_hotplug_slot {
+    int         board_id;
+    const char  *rw_control;
+    const char  *rw_file;
+};
+
+struct efuse_hotplug_report {
+    long        event_cnt;      // 수신한 uevent
+    long        trigger_cnt;    // provisioning 시작
+    long        ok_cnt;
+    long        fail_cnt;
+};
+
+//------------------------------------------------------------------------------
+// provisioning callback. slot별 thread에서 호출 (다른 slot과 동시 실행 가능).
+// ctx : slot의 board/device path로 설정된 context, return : 1 = success
+//------------------------------------------------------------------------------
+typedef int (*efuse_hotplug_cb) (void *arg, int slot, efuse_ctx *ctx);
+
+//------------------------------------------------------------------------------
+//	function prototype
+//------------------------------------------------------------------------------
+extern int  efuse_uevent_open   (const char *local_path);
+extern void efuse_uevent_close  (int fd, const char *local_path);
+extern int  efuse_uevent_recv   (int fd, struct efuse_uevent *ev);
+extern int  efuse_uevent_parse  (const char *msg, int len, struct efuse_uevent *ev);
+extern int  efuse_uevent_send   (const char *local_path, const char *action,
+                                 const char *subsystem, const char *devname);
+extern int  efuse_hotplug_run   (int uevent_fd, const struct efuse_hotplug_slot *slots,
+                                 int slot_cnt, efuse_hotplug_cb cb, void *arg,
+                                 struct efuse_hotplug_report *report);
+extern void efuse_hotplug_stop  (void);
+
+//------------------------------------------------------------------------------
+#endif  // #ifndef __LIB_EFUSE_HOTPLUG_H__
+//------------------------------------------------------------------------------
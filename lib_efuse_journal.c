@@ -0,0 +1,628 @@
+//------------------------------------------------------------------------------
+/**
+ * @file lib_efuse_journal.c
+ * @author charles-park (charles.park@hardkernel.com)
+ * @brief efuse provisioning intent journal (group commit, in-flight replay).
+ * @version 0.2
+ * @date 2023-09-22
+ *
+ * @package apt install cups cups-bsd
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "lib_efuse.h"
+#include "lib_efuse_journal.h"
+#include "lib_efuse_board.h"
+
+//------------------------------------------------------------------------------
+// Debug msg
+//------------------------------------------------------------------------------
+#if defined (__LIB_EFUSE_APP__)
+    #define dbg_msg(fmt, args...)   printf(fmt, ##args)
+#else
+    #define dbg_msg(fmt, args...)
+#endif
+
+//------------------------------------------------------------------------------
+// record 1개 최대 크기 (device path 포함)
+#define JOURNAL_LINE_MAX    (PATH_MAX + 128)
+
+// in-flight operation table
+struct jrn_table {
+    struct efuse_journal_entry  *ent;
+    int                 cnt, cap;
+    unsigned long long  next_id;
+};
+
+struct efuse_journal {
+    char                path [PATH_MAX];
+    int                 fd;
+    off_t               size;
+    int                 error;          // write/sync 실패 후에는 모든 intent 실패
+
+    // group commit. record는 mutex 안에서 바로 write, fdatasync는 leader 1개가
+    // 그때까지 write된 모든 record를 대상으로 실행하고 나머지는 완료를 기다림.
+    pthread_mutex_t     mutex;
+    pthread_cond_t      cond;
+    unsigned long long  append_seq;
+    unsigned long long  durable_seq;
+    int                 flushing;
+
+    struct jrn_table    table;
+};
+
+static const char *JournalOpName [eJOURNAL_OP_END] = {
+    "write", "erase", "write_verify",
+};
+
+static const char *JournalStateName [eJOURNAL_STATE_END] = {
+    "intent", "written", "verified", "mismatch", "failed", "resolved",
+};
+
+static unsigned int     CrcTable [256];
+static pthread_once_t   CrcOnce = PTHREAD_ONCE_INIT;
+
+//------------------------------------------------------------------------------
+// function prototype
+//------------------------------------------------------------------------------
+static void crc_init        (void);
+static unsigned int crc32   (const char *data, size_t len);
+static int  name_index      (const char **names, int cnt, const char *name);
+static int  jrn_terminal    (int op, int state);
+static int  jrn_find        (const struct jrn_table *t, unsigned long long id);
+static struct efuse_journal_entry *jrn_add (struct jrn_table *t, unsigned long long id);
+static void jrn_remove      (struct jrn_table *t, int idx);
+static int  jrn_apply       (struct jrn_table *t, const char *line, size_t len);
+static int  jrn_load        (const char *path, struct jrn_table *t);
+static int  jrn_record      (char *line, const char *body);
+static int  jrn_intent_body (char *body, size_t size, const struct efuse_journal_entry *e);
+static int  write_all       (int fd, const char *buf, size_t len);
+static int  jrn_append      (efuse_journal *j, const char *body);
+static int  jrn_wait        (efuse_journal *j, unsigned long long seq);
+static int  jrn_compact     (efuse_journal *j);
+
+efuse_journal *efuse_journal_open (const char *path);
+void efuse_journal_close    (efuse_journal *journal);
+unsigned long long efuse_journal_intent (efuse_journal *journal, int op, int board_id,
+                                         const char *uuid, const char *device, int wait);
+int  efuse_journal_state    (efuse_journal *journal, unsigned long long id, int state);
+int  efuse_journal_sync     (efuse_journal *journal);
+int  efuse_journal_inflight (efuse_journal *journal, efuse_journal_cb cb, void *arg);
+int  efuse_journal_replay   (const char *path, efuse_journal_cb cb, void *arg);
+const char *efuse_journal_op_name    (int op);
+const char *efuse_journal_state_name (int state);
+
+//------------------------------------------------------------------------------
+static void crc_init (void)
+{
+    unsigned int c;
+    int i, k;
+
+    for (i = 0; i < 256; i++) {
+        for (c = i, k = 0; k < 8; k++)
+            c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+        CrcTable[i] = c;
+    }
+}
+
+//------------------------------------------------------------------------------
+static unsigned int crc32 (const char *data, size_t len)
+{
+    unsigned int c = 0xFFFFFFFF;
+
+    pthread_once (&CrcOnce, crc_init);
+    while (len--)
+        c = CrcTable[(c ^ (unsigned char)*data++) & 0xFF] ^ (c >> 8);
+    return c ^ 0xFFFFFFFF;
+}
+
+//------------------------------------------------------------------------------
+static int name_index (const char **names, int cnt, const char *name)
+{
+    int i;
+
+    for (i = 0; i < cnt; i++)
+        if (!strcmp (names[i], name))
+            return i;
+    return -1;
+}
+
+//------------------------------------------------------------------------------
+// 더 이상 board 확인이 필요 없는 state. write/erase는 written에서 완료.
+//------------------------------------------------------------------------------
+static int jrn_terminal (int op, int state)
+{
+    switch (state) {
+        case eJOURNAL_INTENT:   return 0;
+        case eJOURNAL_WRITTEN:  return op != eJOURNAL_OP_WRITE_VERIFY;
+        default :               return 1;
+    }
+}
+
+//------------------------------------------------------------------------------
+static int jrn_find (const struct jrn_table *t, unsigned long long id)
+{
+    int i;
+
+    for (i = 0; i < t->cnt; i++)
+        if (t->ent[i].id == id)
+            return i;
+    return -1;
+}
+
+//------------------------------------------------------------------------------
+static struct efuse_journal_entry *jrn_add (struct jrn_table *t, unsigned long long id)
+{
+    struct efuse_journal_entry *e;
+    int idx = jrn_find (t, id);
+
+    if (idx >= 0)
+        return &t->ent[idx];
+    if (t->cnt == t->cap) {
+        int cap = t->cap ? t->cap * 2 : 16;
+
+        if ((e = realloc (t->ent, sizeof(*e) * cap)) == NULL)
+            return NULL;
+        t->ent = e;
+        t->cap = cap;
+    }
+    e = &t->ent[t->cnt++];
+    memset (e, 0, sizeof(*e));
+    e->id = id;
+    return e;
+}
+
+//------------------------------------------------------------------------------
+// id 순서 유지 (replay 출력 순서)
+static void jrn_remove (struct jrn_table *t, int idx)
+{
+    memmove (&t->ent[idx], &t->ent[idx + 1], sizeof(t->ent[0]) * (t->cnt - idx - 1));
+    t->cnt--;
+}
+
+//------------------------------------------------------------------------------
+// record 1개 ('\n' 제외)를 table에 반영. return : 0 = crc/형식 error
+//------------------------------------------------------------------------------
+static int jrn_apply (struct jrn_table *t, const char *line, size_t len)
+{
+    char body [JOURNAL_LINE_MAX], state [16], op [16], board [8], uuid [EFUSE_UUID_SIZE +1];
+    struct efuse_journal_entry *e;
+    unsigned long long id;
+    unsigned int crc;
+    long long tm;
+    int n, idx, s;
+
+    if ((len < 10) || (len - 9 >= sizeof(body)) || (line[8] != ' '))
+        return 0;
+    memcpy (body, line + 9, len - 9);
+    body[len - 9] = 0;
+    if ((sscanf (line, "%8x", &crc) != 1) || (crc != crc32 (body, len - 9)))
+        return 0;
+    if (sscanf (body, "%llu %15s%n", &id, state, &n) != 2)
+        return 0;
+
+    if (!strcmp (state, "base")) {
+        if (id > t->next_id)
+            t->next_id = id;
+        return 1;
+    }
+    if (id >= t->next_id)
+        t->next_id = id + 1;
+    if ((s = name_index (JournalStateName, eJOURNAL_STATE_END, state)) < 0)
+        return 0;
+
+    if (s == eJOURNAL_INTENT) {
+        int o, b, m;
+
+        if ((sscanf (body + n, " %15s %7s %lld %36s %n", op, board, &tm, uuid, &m) != 4) ||
+            ((o = name_index (JournalOpName, eJOURNAL_OP_END, op)) < 0) ||
+            ((b = efuse_board_find (board)) < 0))
+            return 0;
+        if ((e = jrn_add (t, id)) == NULL)
+            return 0;
+        e->op       = o;
+        e->board_id = b;
+        e->state    = s;
+        e->time     = tm;
+        snprintf (e->uuid,   sizeof(e->uuid),   "%s", strcmp (uuid, "-") ? uuid : "");
+        snprintf (e->device, sizeof(e->device), "%s", body + n + m);
+        return 1;
+    }
+    // 이미 완료되어 compact된 operation의 record는 무시.
+    if ((idx = jrn_find (t, id)) < 0)
+        return 1;
+    t->ent[idx].state = s;
+    if (jrn_terminal (t->ent[idx].op, s))
+        jrn_remove (t, idx);
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+// journal file -> table. file이 없으면 빈 table. return : 0 = read error
+//------------------------------------------------------------------------------
+static int jrn_load (const char *path, struct jrn_table *t)
+{
+    struct stat st;
+    char *buf, *p, *end, *nl;
+    int fd, bad = 0;
+    ssize_t n = 0, r;
+
+    if ((fd = open (path, O_RDONLY | O_CLOEXEC)) < 0)
+        return errno == ENOENT;
+    if ((fstat (fd, &st) < 0) || ((buf = malloc (st.st_size + 1)) == NULL)) {
+        close (fd);
+        return 0;
+    }
+    while (n < st.st_size) {
+        if ((r = read (fd, buf + n, st.st_size - n)) < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        if (r == 0)
+            break;
+        n += r;
+    }
+    close (fd);
+
+    // '\n'으로 끝나지 않은 마지막 record는 기록 도중 중단된 것이므로 무시.
+    for (p = buf, end = buf + n; (p < end) && ((nl = memchr (p, '\n', end - p)) != NULL);
+         p = nl + 1) {
+        if ((nl > p) && !jrn_apply (t, p, nl - p))
+            bad++;
+    }
+    if (bad || (p < end)) {
+        dbg_msg ("journal, %d broken record(s), %ld byte(s) incomplete. (%s)\n",
+            bad, (long)(end - p), path);
+    }
+    free (buf);
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+// body -> "<crc32> <body>\n". return : line 길이
+//------------------------------------------------------------------------------
+static int jrn_record (char *line, const char *body)
+{
+    return snprintf (line, JOURNAL_LINE_MAX, "%08x %s\n", crc32 (body, strlen (body)), body);
+}
+
+//------------------------------------------------------------------------------
+static int jrn_intent_body (char *body, size_t size, const struct efuse_journal_entry *e)
+{
+    return snprintf (body, size, "%llu %s %s %s %lld %s %s", e->id,
+                JournalStateName[eJOURNAL_INTENT], JournalOpName[e->op],
+                efuse_board_name (e->board_id), e->time,
+                e->uuid[0] ? e->uuid : "-", e->device);
+}
+
+//------------------------------------------------------------------------------
+static int write_all (int fd, const char *buf, size_t len)
+{
+    ssize_t n;
+
+    while (len) {
+        if ((n = write (fd, buf, len)) < 0) {
+            if (errno == EINTR)
+                continue;
+            return 0;
+        }
+        buf += n;
+        len -= n;
+    }
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+// mutex lock 상태에서 호출. write 실패시 일부만 기록된 record 뒤에 다음 record가
+// 붙지 않도록 journal 사용 중지. return : 0 = error
+//------------------------------------------------------------------------------
+static int jrn_append (efuse_journal *j, const char *body)
+{
+    char line [JOURNAL_LINE_MAX];
+    int len;
+
+    if (j->error)
+        return 0;
+    len = jrn_record (line, body);
+    if (!write_all (j->fd, line, len)) {
+        dbg_msg ("error, journal write. (%s, %s)\n", j->path, strerror (errno));
+        j->error = 1;
+        return 0;
+    }
+    j->size += len;
+    j->append_seq++;
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+// mutex lock 상태에서 호출. seq 까지의 record가 disk에 기록될 때까지 대기.
+// 다른 thread가 fdatasync 중이면 그 결과를 기다린 후, 그 sync에 포함되지 않은
+// record가 있으면 대기하던 thread 중 하나가 다음 sync를 실행 (group commit).
+//------------------------------------------------------------------------------
+static int jrn_wait (efuse_journal *j, unsigned long long seq)
+{
+    unsigned long long target;
+    int ret;
+
+    while (!j->error && (j->durable_seq < seq)) {
+        if (j->flushing) {
+            pthread_cond_wait (&j->cond, &j->mutex);
+            continue;
+        }
+        j->flushing = 1;
+        target = j->append_seq;
+        pthread_mutex_unlock (&j->mutex);
+        ret = fdatasync (j->fd);
+        pthread_mutex_lock (&j->mutex);
+        j->flushing = 0;
+        if (ret) {
+            dbg_msg ("error, journal sync. (%s, %s)\n", j->path, strerror (errno));
+            j->error = 1;
+        } else if (target > j->durable_seq)
+            j->durable_seq = target;
+        pthread_cond_broadcast (&j->cond);
+    }
+    return !j->error;
+}
+
+//------------------------------------------------------------------------------
+// mutex lock 상태(sync 중 아님)에서 호출. in-flight record만으로 새 file 작성 후
+// rename. 완료된 operation의 record는 모두 제거됨.
+//------------------------------------------------------------------------------
+static int jrn_compact (efuse_journal *j)
+{
+    char tmp [PATH_MAX + 8], dir [PATH_MAX], body [JOURNAL_LINE_MAX], line [JOURNAL_LINE_MAX];
+    char *slash;
+    off_t size = 0;
+    int fd, dfd, len, i, ok;
+
+    snprintf (tmp, sizeof(tmp), "%s.tmp", j->path);
+    if ((fd = open (tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)) < 0) {
+        dbg_msg ("error, journal create. (%s, %s)\n", tmp, strerror (errno));
+        return 0;
+    }
+    snprintf (body, sizeof(body), "%llu base", j->table.next_id);
+    len = jrn_record (line, body);
+    ok  = write_all (fd, line, len);
+    size += len;
+    for (i = 0; ok && (i < j->table.cnt); i++) {
+        const struct efuse_journal_entry *e = &j->table.ent[i];
+
+        jrn_intent_body (body, sizeof(body), e);
+        len = jrn_record (line, body);
+        ok  = write_all (fd, line, len);
+        size += len;
+        if (ok && (e->state != eJOURNAL_INTENT)) {
+            snprintf (body, sizeof(body), "%llu %s", e->id, JournalStateName[e->state]);
+            len = jrn_record (line, body);
+            ok  = write_all (fd, line, len);
+            size += len;
+        }
+    }
+    if (!ok || fdatasync (fd) || rename (tmp, j->path)) {
+        dbg_msg ("error, journal compact. (%s, %s)\n", j->path, strerror (errno));
+        close (fd);
+        unlink (tmp);
+        return 0;
+    }
+    // rename이 disk에 기록되도록 directory sync
+    snprintf (dir, sizeof(dir), "%s", j->path);
+    if ((slash = strrchr (dir, '/')) != NULL)
+        *(slash == dir ? slash + 1 : slash) = 0;
+    else
+        snprintf (dir, sizeof(dir), ".");
+    if ((dfd = open (dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC)) >= 0) {
+        fsync (dfd);
+        close (dfd);
+    }
+    if (j->fd >= 0)
+        close (j->fd);
+    j->fd          = fd;
+    j->size        = size;
+    j->durable_seq = j->append_seq;
+    pthread_cond_broadcast (&j->cond);
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+// journal open. 이전 실행의 in-flight operation은 유지 (efuse_journal_inflight).
+//------------------------------------------------------------------------------
+efuse_journal *efuse_journal_open (const char *path)
+{
+    efuse_journal *j;
+
+    if ((path == NULL) || (strlen (path) >= PATH_MAX))
+        return NULL;
+    if ((j = calloc (1, sizeof(efuse_journal))) == NULL)
+        return NULL;
+
+    snprintf (j->path, sizeof(j->path), "%s", path);
+    j->fd = -1;
+    j->table.next_id = 1;
+    pthread_mutex_init (&j->mutex, NULL);
+    pthread_cond_init  (&j->cond, NULL);
+
+    if (!jrn_load (path, &j->table) || !jrn_compact (j)) {
+        dbg_msg ("error, journal open. (%s)\n", path);
+        efuse_journal_close (j);
+        return NULL;
+    }
+    return j;
+}
+
+//------------------------------------------------------------------------------
+void efuse_journal_close (efuse_journal *journal)
+{
+    if (journal == NULL)
+        return;
+    if (journal->fd >= 0) {
+        efuse_journal_sync (journal);
+        close (journal->fd);
+    }
+    pthread_mutex_destroy (&journal->mutex);
+    pthread_cond_destroy  (&journal->cond);
+    free (journal->table.ent);
+    free (journal);
+}
+
+//------------------------------------------------------------------------------
+// device write 전 intent 기록. wait = 1 이면 disk 기록 후 return.
+// uuid : write data (erase = NULL), device : device(rw_file) path
+// return : operation id, 0 = error (device write 하지 않아야 함)
+//------------------------------------------------------------------------------
+unsigned long long efuse_journal_intent (efuse_journal *journal, int op, int board_id,
+                                         const char *uuid, const char *device, int wait)
+{
+    struct efuse_journal_entry entry, *e;
+    char body [JOURNAL_LINE_MAX];
+    unsigned long long seq;
+
+    if ((journal == NULL) || (op < 0) || (op >= eJOURNAL_OP_END) ||
+        (board_id < 0) || (board_id >= eBOARD_ID_END) || (device == NULL) ||
+        (strlen (device) >= sizeof(entry.device)) || strchr (device, '\n'))
+        return 0;
+
+    memset (&entry, 0, sizeof(entry));
+    entry.op       = op;
+    entry.board_id = board_id;
+    entry.state    = eJOURNAL_INTENT;
+    entry.time     = time (NULL);
+    if (uuid != NULL) {
+        struct efuse_uuid bin;
+
+        if (!efuse_uuid_parse (uuid, &bin))
+            return 0;
+        efuse_uuid_format (&bin, entry.uuid);
+    }
+    snprintf (entry.device, sizeof(entry.device), "%s", device);
+
+    pthread_mutex_lock (&journal->mutex);
+    // 완료된 record가 많아지면 다시 작성 (다른 thread sync 중에는 다음 기회에)
+    if ((journal->size > JOURNAL_COMPACT_SIZE) && !journal->flushing && !journal->error)
+        jrn_compact (journal);
+
+    entry.id = journal->table.next_id++;
+    jrn_intent_body (body, sizeof(body), &entry);
+    if (!jrn_append (journal, body) || ((e = jrn_add (&journal->table, entry.id)) == NULL)) {
+        pthread_mutex_unlock (&journal->mutex);
+        return 0;
+    }
+    *e  = entry;
+    seq = journal->append_seq;
+    if (wait && !jrn_wait (journal, seq)) {
+        pthread_mutex_unlock (&journal->mutex);
+        return 0;
+    }
+    pthread_mutex_unlock (&journal->mutex);
+    return entry.id;
+}
+
+//------------------------------------------------------------------------------
+// operation 상태 기록. disk 기록은 다음 intent sync 또는 efuse_journal_sync()에서.
+// (기록 전 전원 차단시 해당 operation은 in-flight로 남음)
+//------------------------------------------------------------------------------
+int efuse_journal_state (efuse_journal *journal, unsigned long long id, int state)
+{
+    char body [64];
+    int idx, ret;
+
+    if ((journal == NULL) || (state <= eJOURNAL_INTENT) || (state >= eJOURNAL_STATE_END))
+        return 0;
+
+    pthread_mutex_lock (&journal->mutex);
+    if ((idx = jrn_find (&journal->table, id)) < 0) {
+        pthread_mutex_unlock (&journal->mutex);
+        return 0;
+    }
+    snprintf (body, sizeof(body), "%llu %s", id, JournalStateName[state]);
+    if ((ret = jrn_append (journal, body))) {
+        journal->table.ent[idx].state = state;
+        if (jrn_terminal (journal->table.ent[idx].op, state))
+            jrn_remove (&journal->table, idx);
+    }
+    pthread_mutex_unlock (&journal->mutex);
+    return ret;
+}
+
+//------------------------------------------------------------------------------
+// 지금까지 기록된 모든 record를 disk에 기록.
+//------------------------------------------------------------------------------
+int efuse_journal_sync (efuse_journal *journal)
+{
+    int ret;
+
+    if (journal == NULL)
+        return 0;
+    pthread_mutex_lock (&journal->mutex);
+    ret = jrn_wait (journal, journal->append_seq);
+    pthread_mutex_unlock (&journal->mutex);
+    return ret;
+}
+
+//------------------------------------------------------------------------------
+// 완료되지 않은 operation 목록 (id 순서). return : in-flight 수
+//------------------------------------------------------------------------------
+int efuse_journal_inflight (efuse_journal *journal, efuse_journal_cb cb, void *arg)
+{
+    int i, cnt;
+
+    if (journal == NULL)
+        return 0;
+    pthread_mutex_lock (&journal->mutex);
+    cnt = journal->table.cnt;
+    for (i = 0; (cb != NULL) && (i < cnt); i++)
+        cb (arg, &journal->table.ent[i]);
+    pthread_mutex_unlock (&journal->mutex);
+    return cnt;
+}
+
+//------------------------------------------------------------------------------
+// journal file의 in-flight operation 목록 (file 변경 없음).
+// return : in-flight 수, -1 = file read error
+//------------------------------------------------------------------------------
+int efuse_journal_replay (const char *path, efuse_journal_cb cb, void *arg)
+{
+    struct jrn_table t;
+    int i, cnt;
+
+    memset (&t, 0, sizeof(t));
+    if (!jrn_load (path, &t)) {
+        free (t.ent);
+        return -1;
+    }
+    for (i = 0; (cb != NULL) && (i < t.cnt); i++)
+        cb (arg, &t.ent[i]);
+    cnt = t.cnt;
+    free (t.ent);
+    return cnt;
+}
+
+//------------------------------------------------------------------------------
+const char *efuse_journal_op_name (int op)
+{
+    return ((op >= 0) && (op < eJOURNAL_OP_END)) ? JournalOpName[op] : "unknown";
+}
+
+//------------------------------------------------------------------------------
+const char *efuse_journal_state_name (int state)
+{
+    return ((state >= 0) && (state < eJOURNAL_STATE_END)) ? JournalStateName[state] : "unknown";
+}
+
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
@@ -0,0 +1,86 @@
+//------------------------------------------------------------------------------
+/**
+ * @file lib_efuse_journal.h
+ * @author charles-park (charles.park@hardkernel.com)
+ * @brief efuse provisioning intent journal (group commit, in-flight replay).
+ * @version 0.2
+ * @date 2023-09-22
+ *
+ * @package apt install cups cups-bsd
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#ifndef __LIB_EFUSE_JOURNAL_H__
+#define __LIB_EFUSE_JOURNAL_H__
+
+//------------------------------------------------------------------------------
+#include <limits.h>
+#include "lib_efuse.h"
+
+//------------------------------------------------------------------------------
+// append only journal. device write 전에 intent가 disk에 기록(fdatasync)된 후
+// write 진행, 이후 written/verified 등 상태 record는 다음 sync에 같이 기록.
+// 여러 thread의 intent는 fdatasync 1회로 같이 기록 (group commit).
+// efuse_journal_intent (wait = 0)은 기록만 하고 return, 여러 intent를 기록한 후
+// efuse_journal_sync() 1회로 disk 기록 (device write 전에 반드시 호출).
+//
+// 완료되지 않은 operation(in-flight)만 memory에 유지하며, journal file은 open
+// 시점과 JOURNAL_COMPACT_SIZE 초과시 in-flight record만 남기고 다시 작성.
+// 따라서 replay는 file 전체 rescan 없이 짧은 file만 읽음.
+//
+// record (1 line) : "<crc32> <id> <state> [<op> <board> <time> <uuid> <device>]"
+// crc가 다른 record(전원 차단시 마지막 line 등)는 무시.
+//------------------------------------------------------------------------------
+#define JOURNAL_COMPACT_SIZE    (1024 * 1024)
+
+typedef struct efuse_journal efuse_journal;
+
+enum {
+    eJOURNAL_OP_WRITE = 0,      // efuse_ctx_control (EFUSE_WRITE)
+    eJOURNAL_OP_ERASE,          // efuse_ctx_control (EFUSE_ERASE)
+    eJOURNAL_OP_WRITE_VERIFY,   // efuse_ctx_write_verify
+    eJOURNAL_OP_END
+};
+
+enum {
+    eJOURNAL_INTENT = 0,        // device write 시작 전
+    eJOURNAL_WRITTEN,           // device write 완료 (write/erase는 여기서 완료)
+    eJOURNAL_VERIFIED,          // read back 같음
+    eJOURNAL_MISMATCH,          // read back 다름
+    eJOURNAL_FAILED,            // device error (board 상태 확인 필요시 read)
+    eJOURNAL_RESOLVED,          // in-flight를 수동 확인 후 종료
+    eJOURNAL_STATE_END
+};
+
+struct efuse_journal_entry {
+    unsigned long long  id;
+    int                 op;
+    int                 state;          // 마지막 기록된 state
+    int                 board_id;
+    long long           time;           // intent 기록 시간 (unix time)
+    char                uuid   [EFUSE_UUID_SIZE +1];    // erase = ""
+    char                device [PATH_MAX];
+};
+
+typedef void (*efuse_journal_cb) (void *arg, const struct efuse_journal_entry *entry);
+
+//------------------------------------------------------------------------------
+//	function prototype
+//------------------------------------------------------------------------------
+extern efuse_journal *efuse_journal_open (const char *path);
+extern void efuse_journal_close     (efuse_journal *journal);
+extern unsigned long long efuse_journal_intent (efuse_journal *journal, int op, int board_id,
+                                     const char *uuid, const char *device, int wait);
+extern int  efuse_journal_state     (efuse_journal *journal, unsigned long long id, int state);
+extern int  efuse_journal_sync      (efuse_journal *journal);
+extern int  efuse_journal_inflight  (efuse_journal *journal, efuse_journal_cb cb, void *arg);
+extern int  efuse_journal_replay    (const char *path, efuse_journal_cb cb, void *arg);
+extern const char *efuse_journal_op_name    (int op);
+extern const char *efuse_journal_state_name (int state);
+
+//------------------------------------------------------------------------------
+#endif  // #ifndef __LIB_EFUSE_JOURNAL_H__
+//------------------------------------------------------------------------------
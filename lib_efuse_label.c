@@ -0,0 +1,420 @@
+//------------------------------------------------------------------------------
+/**
+ * @file lib_efuse_label.c
+ * @author charles-park (charles.park@hardkernel.com)
+ * @brief mac label print queue (lpr/cups spooler, async worker).
+ * @version 0.2
+ * @date 2023-09-22
+ *
+ * @package apt install cups cups-bsd
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <spawn.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/wait.h>
+
+#include "lib_efuse.h"
+#include "lib_efuse_board.h"
+#include "lib_efuse_label.h"
+
+//------------------------------------------------------------------------------
+// Debug msg
+//------------------------------------------------------------------------------
+#if defined (__LIB_EFUSE_APP__)
+    #define dbg_msg(fmt, args...)   printf(fmt, ##args)
+#else
+    #define dbg_msg(fmt, args...)
+#endif
+
+//------------------------------------------------------------------------------
+extern char **environ;
+
+struct efuse_label {
+    struct efuse_label_cfg  cfg;
+    char                    printer   [PATH_MAX];
+    char                    spool_dir [PATH_MAX];
+
+    char                    (*ring)[LABEL_SIZE];
+    int                     head;       // 다음 worker 처리 위치
+    int                     cnt;        // queue에 있는 label
+    int                     busy;       // worker가 spooler에 전달중인 label
+    int                     stop;
+    long                    seq;        // spool_dir job 번호
+    char                    *job;       // spooler job 1개 (batch_max * LABEL_SIZE)
+    struct efuse_label_stat stat;
+
+    pthread_t               worker;
+    pthread_mutex_t         mutex;
+    pthread_cond_t          cond_job;   // 새 label / 종료
+    pthread_cond_t          cond_space; // queue 공간 확보
+    pthread_cond_t          cond_done;  // spooler 전달 완료
+};
+
+//------------------------------------------------------------------------------
+//	function prototype
+//------------------------------------------------------------------------------
+static long long mono_ns        (void);
+static int  label_write_all     (int fd, const char *buf, int len);
+static int  label_lpr           (efuse_label *label, const char *buf, int len);
+static int  label_spool_file    (efuse_label *label, const char *buf, int len);
+static void *label_worker       (void *arg);
+
+efuse_label *efuse_label_open   (const struct efuse_label_cfg *cfg);
+int  efuse_label_close          (efuse_label *label);
+int  efuse_label_render         (int board_id, const char *efuse_data, char *buf, int size);
+int  efuse_label_push           (efuse_label *label, int board_id, const char *efuse_data);
+void efuse_label_flush          (efuse_label *label);
+void efuse_label_get_stat       (efuse_label *label, struct efuse_label_stat *stat);
+
+//------------------------------------------------------------------------------
+static long long mono_ns (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+//------------------------------------------------------------------------------
+static int label_write_all (int fd, const char *buf, int len)
+{
+    int ret;
+
+    while (len > 0) {
+        if ((ret = write (fd, buf, len)) < 0) {
+            if (errno == EINTR)
+                continue;
+            return 0;
+        }
+        buf += ret, len -= ret;
+    }
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+// lpr [-P printer] 의 stdin으로 label 전달. job 1개 = label 여러개.
+//------------------------------------------------------------------------------
+static int label_lpr (efuse_label *label, const char *buf, int len)
+{
+    char *argv[] = { "lpr", "-P", label->printer, NULL };
+    posix_spawn_file_actions_t fa;
+    int fds[2], status, ret;
+    pid_t pid;
+
+    if (!label->printer[0])
+        argv[1] = NULL;
+    if (pipe (fds))
+        return 0;
+    // write 쪽은 lpr에 전달되지 않도록 (stdin은 dup2로 전달)
+    fcntl (fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl (fds[1], F_SETFD, FD_CLOEXEC);
+
+    posix_spawn_file_actions_init (&fa);
+    posix_spawn_file_actions_adddup2 (&fa, fds[0], STDIN_FILENO);
+    ret = posix_spawnp (&pid, "lpr", &fa, NULL, argv, environ);
+    posix_spawn_file_actions_destroy (&fa);
+    close (fds[0]);
+    if (ret) {
+        dbg_msg ("error, lpr spawn. (%s)\n", strerror (ret));
+        close (fds[1]);
+        return 0;
+    }
+    ret = label_write_all (fds[1], buf, len);
+    close (fds[1]);
+
+    while (waitpid (pid, &status, 0) < 0) {
+        if (errno != EINTR)
+            return 0;
+    }
+    return ret && WIFEXITED(status) && (WEXITSTATUS(status) == 0);
+}
+
+//------------------------------------------------------------------------------
+// spooler 대신 file로 저장 (printer 없는 test/bench). 완성된 file만 보이도록 rename.
+//------------------------------------------------------------------------------
+static int label_spool_file (efuse_label *label, const char *buf, int len)
+{
+    char tmp [PATH_MAX + 32], path [PATH_MAX + 32];
+    struct timespec ts;
+    int fd, ret;
+
+    snprintf (path, sizeof(path), "%s/label-%d-%06ld.zpl",
+        label->spool_dir, (int)getpid (), label->seq++);
+    snprintf (tmp,  sizeof(tmp),  "%s/.label-%d.tmp", label->spool_dir, (int)getpid ());
+
+    if ((fd = open (tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)) < 0)
+        return 0;
+    ret = label_write_all (fd, buf, len);
+    if (close (fd) || !ret || rename (tmp, path)) {
+        unlink (tmp);
+        return 0;
+    }
+    // printer 출력 시간 재현
+    if (label->cfg.spool_ms > 0) {
+        ts.tv_sec  = label->cfg.spool_ms / 1000;
+        ts.tv_nsec = (label->cfg.spool_ms % 1000) * 1000000L;
+        while (nanosleep (&ts, &ts) && (errno == EINTR))
+            ;
+    }
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+// queue에 있는 label을 최대 batch_max개씩 spooler job 1개로 전달.
+// spooler를 기다리는 동안 들어온 label은 다음 job에 같이 묶임.
+//------------------------------------------------------------------------------
+static void *label_worker (void *arg)
+{
+    efuse_label *label = (efuse_label *)arg;
+    char *buf = label->job;
+    int i, n, len, ok;
+    sigset_t set;
+
+    // lpr이 먼저 종료된 경우 write error로 처리 (process 종료 방지)
+    sigemptyset (&set);
+    sigaddset (&set, SIGPIPE);
+    pthread_sigmask (SIG_BLOCK, &set, NULL);
+
+    pthread_mutex_lock (&label->mutex);
+    while (1) {
+        while (!label->cnt && !label->stop)
+            pthread_cond_wait (&label->cond_job, &label->mutex);
+        if (!label->cnt)
+            break;
+
+        n = (label->cnt < label->cfg.batch_max) ? label->cnt : label->cfg.batch_max;
+        for (i = 0, len = 0; i < n; i++) {
+            strcpy (&buf[len], label->ring[label->head]);
+            len += strlen (&buf[len]);
+            label->head = (label->head + 1) % label->cfg.queue_max;
+        }
+        label->cnt -= n;
+        label->busy = n;
+        pthread_cond_broadcast (&label->cond_space);
+        pthread_mutex_unlock (&label->mutex);
+
+        ok = label->spool_dir[0] ? label_spool_file (label, buf, len) :
+                                   label_lpr (label, buf, len);
+        if (!ok) {
+            dbg_msg ("error, label print. %d label(s)\n", n);
+        }
+
+        pthread_mutex_lock (&label->mutex);
+        label->stat.jobs++;
+        if (ok)     label->stat.printed += n;
+        else        label->stat.failed  += n;
+        label->busy = 0;
+        pthread_cond_broadcast (&label->cond_done);
+    }
+    pthread_mutex_unlock (&label->mutex);
+    return NULL;
+}
+
+//------------------------------------------------------------------------------
+// cfg : NULL = default printer, LABEL_QUEUE_MAX, LABEL_BATCH_MAX, 무제한 대기
+//------------------------------------------------------------------------------
+efuse_label *efuse_label_open (const struct efuse_label_cfg *cfg)
+{
+    struct efuse_label_cfg def = { .push_timeout_ms = -1 };
+    pthread_condattr_t attr;
+    efuse_label *label;
+
+    if ((label = calloc (1, sizeof(efuse_label))) == NULL)
+        return NULL;
+    label->cfg = cfg ? *cfg : def;
+    if (label->cfg.queue_max <= 0)
+        label->cfg.queue_max = LABEL_QUEUE_MAX;
+    if (label->cfg.batch_max <= 0)
+        label->cfg.batch_max = LABEL_BATCH_MAX;
+    if (label->cfg.printer != NULL)
+        snprintf (label->printer, sizeof(label->printer), "%s", label->cfg.printer);
+    if (label->cfg.spool_dir != NULL)
+        snprintf (label->spool_dir, sizeof(label->spool_dir), "%s", label->cfg.spool_dir);
+    label->cfg.printer   = NULL;
+    label->cfg.spool_dir = NULL;
+
+    label->ring = calloc (label->cfg.queue_max, LABEL_SIZE);
+    label->job  = malloc (label->cfg.batch_max * LABEL_SIZE);
+    if ((label->ring == NULL) || (label->job == NULL)) {
+        free (label->ring);
+        free (label->job);
+        free (label);
+        return NULL;
+    }
+    pthread_mutex_init (&label->mutex, NULL);
+    pthread_condattr_init (&attr);
+    pthread_condattr_setclock (&attr, CLOCK_MONOTONIC);
+    pthread_cond_init (&label->cond_job,   NULL);
+    pthread_cond_init (&label->cond_space, &attr);
+    pthread_cond_init (&label->cond_done,  NULL);
+    pthread_condattr_destroy (&attr);
+
+    if (pthread_create (&label->worker, NULL, label_worker, label)) {
+        dbg_msg ("error, label worker create.\n");
+        pthread_cond_destroy  (&label->cond_done);
+        pthread_cond_destroy  (&label->cond_space);
+        pthread_cond_destroy  (&label->cond_job);
+        pthread_mutex_destroy (&label->mutex);
+        free (label->ring);
+        free (label->job);
+        free (label);
+        return NULL;
+    }
+    return label;
+}
+
+//------------------------------------------------------------------------------
+// queue의 label을 모두 spooler에 전달한 후 종료.
+// return : 0 = 출력하지 못한 label 있음 (failed, dropped)
+//------------------------------------------------------------------------------
+int efuse_label_close (efuse_label *label)
+{
+    int ret;
+
+    if (label == NULL)
+        return 1;
+
+    pthread_mutex_lock (&label->mutex);
+    label->stop = 1;
+    pthread_cond_broadcast (&label->cond_job);
+    pthread_cond_broadcast (&label->cond_space);
+    pthread_mutex_unlock (&label->mutex);
+    pthread_join (label->worker, NULL);
+
+    ret = !label->stat.failed && !label->stat.dropped;
+    pthread_cond_destroy  (&label->cond_done);
+    pthread_cond_destroy  (&label->cond_space);
+    pthread_cond_destroy  (&label->cond_job);
+    pthread_mutex_destroy (&label->mutex);
+    free (label->ring);
+    free (label->job);
+    free (label);
+    return ret;
+}
+
+//------------------------------------------------------------------------------
+// ZPL label 1개 (board 이름, mac, mac barcode).
+// return : label 길이, 0 = uuid 형식 error
+//------------------------------------------------------------------------------
+int efuse_label_render (int board_id, const char *efuse_data, char *buf, int size)
+{
+    struct efuse_uuid uuid;
+    unsigned long long mac;
+    char name [16];
+    int i, len;
+
+    if (!efuse_uuid_parse (efuse_data, &uuid))
+        return 0;
+    mac = efuse_uuid_mac (&uuid);
+
+    snprintf (name, sizeof(name), "%s", efuse_board_name (board_id));
+    for (i = 0; name[i]; i++)
+        name[i] = toupper ((unsigned char)name[i]);
+
+    len = snprintf (buf, size,
+        "^XA^CF0,30"
+        "^FO20,20^FDODROID-%s^FS"
+        "^FO20,60^FDMAC %02llX:%02llX:%02llX:%02llX:%02llX:%02llX^FS"
+        "^FO20,100^BY2^BCN,60,N,N,N^FD%012llX^FS"
+        "^XZ\n",
+        name,
+        (mac >> 40) & 0xFF, (mac >> 32) & 0xFF, (mac >> 24) & 0xFF,
+        (mac >> 16) & 0xFF, (mac >>  8) & 0xFF,  mac        & 0xFF, mac);
+    return (len < size) ? len : 0;
+}
+
+//------------------------------------------------------------------------------
+// label 생성 후 queue에 추가. queue가 가득 차면 push_timeout_ms 동안 대기.
+// return : 0 = 실패 (errno EINVAL = uuid 형식, ETIMEDOUT/EAGAIN = queue full,
+//          ESHUTDOWN = close 중)
+//------------------------------------------------------------------------------
+int efuse_label_push (efuse_label *label, int board_id, const char *efuse_data)
+{
+    char buf [LABEL_SIZE];
+    struct timespec ts;
+    long long t0, deadline = 0;
+    int timeout_ms, err = 0;
+
+    if (!efuse_label_render (board_id, efuse_data, buf, sizeof(buf))) {
+        errno = EINVAL;
+        return 0;
+    }
+
+    pthread_mutex_lock (&label->mutex);
+    t0 = mono_ns ();
+    timeout_ms = label->cfg.push_timeout_ms;
+    if (timeout_ms > 0)
+        deadline = t0 + timeout_ms * 1000000LL;
+
+    while ((label->cnt >= label->cfg.queue_max) && !label->stop) {
+        if (!timeout_ms) {
+            err = EAGAIN;
+            break;
+        }
+        if (timeout_ms < 0) {
+            pthread_cond_wait (&label->cond_space, &label->mutex);
+            continue;
+        }
+        ts.tv_sec  = deadline / 1000000000LL;
+        ts.tv_nsec = deadline % 1000000000LL;
+        if (pthread_cond_timedwait (&label->cond_space, &label->mutex, &ts) == ETIMEDOUT) {
+            if (label->cnt >= label->cfg.queue_max)
+                err = ETIMEDOUT;
+            break;
+        }
+    }
+    if (label->stop)
+        err = ESHUTDOWN;
+    label->stat.wait_ns += mono_ns () - t0;
+
+    if (err) {
+        label->stat.dropped++;
+        pthread_mutex_unlock (&label->mutex);
+        errno = err;
+        return 0;
+    }
+    memcpy (label->ring[(label->head + label->cnt) % label->cfg.queue_max], buf, sizeof(buf));
+    label->cnt++;
+    label->stat.queued++;
+    if (label->cnt > label->stat.depth_max)
+        label->stat.depth_max = label->cnt;
+    pthread_cond_signal (&label->cond_job);
+    pthread_mutex_unlock (&label->mutex);
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+// 지금까지 push된 label이 모두 spooler에 전달될 때까지 대기.
+//------------------------------------------------------------------------------
+void efuse_label_flush (efuse_label *label)
+{
+    pthread_mutex_lock (&label->mutex);
+    while (label->cnt || label->busy)
+        pthread_cond_wait (&label->cond_done, &label->mutex);
+    pthread_mutex_unlock (&label->mutex);
+}
+
+//------------------------------------------------------------------------------
+void efuse_label_get_stat (efuse_label *label, struct efuse_label_stat *stat)
+{
+    pthread_mutex_lock (&label->mutex);
+    *stat = label->stat;
+    pthread_mutex_unlock (&label->mutex);
+}
+
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
@@ -0,0 +1,68 @@
+//------------------------------------------------------------------------------
+/**
+ * @file lib_efuse_label.h
+ * @author charles-park (charles.park@hardkernel.com)
+ * @brief mac label print queue (lpr/cups spooler, async worker).
+ * @version 0.2
+ * @date 2023-09-22
+ *
+ * @package apt install cups cups-bsd
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#ifndef __LIB_EFUSE_LABEL_H__
+#define __LIB_EFUSE_LABEL_H__
+
+//------------------------------------------------------------------------------
+#include "lib_efuse.h"
+
+//------------------------------------------------------------------------------
+// write/verify가 끝난 board의 mac label을 queue에 넣고, worker thread가
+// spooler(lpr)에 전달. worker가 spooler를 기다리는 동안 다음 board write 진행.
+// - queue에 쌓인 label은 spooler job 1개로 묶어서 전달 (최대 batch_max개).
+// - queue가 가득 차면 push가 대기 (printer가 느리면 write도 같이 늦어짐).
+// - spool_dir 설정시 lpr 대신 file로 저장 (printer 없는 test, bench용 spooler).
+//------------------------------------------------------------------------------
+#define LABEL_SIZE          256
+#define LABEL_QUEUE_MAX     16
+#define LABEL_BATCH_MAX     8
+
+typedef struct efuse_label efuse_label;
+
+struct efuse_label_cfg {
+    const char  *printer;       // lpr -P <printer>, NULL = default printer
+    const char  *spool_dir;     // NULL이 아니면 lpr 대신 <dir>/label-<pid>-<seq>.zpl
+    int         spool_ms;       // spool_dir 사용시 job 1개 처리 시간 (printer 재현)
+    int         queue_max;      // 0 = LABEL_QUEUE_MAX
+    int         batch_max;      // 0 = LABEL_BATCH_MAX
+    int         push_timeout_ms;// queue full 대기, -1 = 무제한, 0 = 대기 없음
+};
+
+struct efuse_label_stat {
+    long        queued;
+    long        printed;
+    long        failed;         // spooler 실패 (label 출력 안됨)
+    long        dropped;        // queue full timeout, close 이후 push
+    long        jobs;           // spooler job 수
+    int         depth_max;      // 최대 queue 사용량
+    long long   wait_ns;        // push 대기 시간 합 (backpressure)
+};
+
+//------------------------------------------------------------------------------
+//	function prototype
+//------------------------------------------------------------------------------
+extern efuse_label *efuse_label_open    (const struct efuse_label_cfg *cfg);
+extern int  efuse_label_close           (efuse_label *label);
+extern int  efuse_label_render          (int board_id, const char *efuse_data,
+                                         char *buf, int size);
+extern int  efuse_label_push            (efuse_label *label, int board_id,
+                                         const char *efuse_data);
+extern void efuse_label_flush           (efuse_label *label);
+extern void efuse_label_get_stat        (efuse_label *label, struct efuse_label_stat *stat);
+
+//------------------------------------------------------------------------------
+#endif  // #ifndef __LIB_EFUSE_LABEL_H__
+//------------------------------------------------------------------------------
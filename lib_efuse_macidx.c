@@ -0,0 +1,436 @@
+//------------------------------------------------------------------------------
+/**
+ * @file lib_efuse_macidx.c
+ * @author charles-park (charles.park@hardkernel.com)
+ * @brief efuse issued mac index (duplicate / hole detection).
+ * @version 0.2
+ * @date 2023-09-22
+ *
+ * @package apt install cups cups-bsd
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "lib_efuse.h"
+#include "lib_efuse_audit.h"
+#include "lib_efuse_macidx.h"
+
+//------------------------------------------------------------------------------
+// Debug msg
+//------------------------------------------------------------------------------
+#if defined (__LIB_EFUSE_APP__)
+    #define dbg_msg(fmt, args...)   printf(fmt, ##args)
+#else
+    #define dbg_msg(fmt, args...)
+#endif
+
+//------------------------------------------------------------------------------
+// index file layout : [header page][block 0 bitmap][block 1 bitmap]...
+// block 1개 = mac 65536개 = 8KB bitmap.
+//------------------------------------------------------------------------------
+#define MACIDX_MAGIC        0x584D4645  // "EFMX"
+#define MACIDX_VERSION      1
+#define MACIDX_HDR_SIZE     4096
+#define MACIDX_BLOCK_MAX    32
+#define MACIDX_LOG_MAX      64
+#define MACIDX_BLOCK_MACS   65536
+#define MACIDX_BLOCK_WORDS  (MACIDX_BLOCK_MACS / 64)
+
+struct macidx_block {
+    unsigned int    block;      // mac 4번째 byte (0x001E06xx)
+    int             board_id;
+    unsigned int    count;
+    unsigned int    dups;
+    unsigned int    last;       // 마지막 발급 index + 1, 0 = 발급 없음
+};
+
+struct macidx_log {
+    unsigned long long  dev;
+    unsigned long long  ino;
+    long long           offset; // ingest 완료 위치 (다음 line 시작)
+    unsigned long long  seq;    // 최근 사용 순서 (table full시 교체 기준)
+};
+
+struct macidx_hdr {
+    unsigned int        magic;
+    unsigned int        version;
+    unsigned int        block_cnt;
+    unsigned int        log_cnt;
+    unsigned long long  log_seq;
+    unsigned char       slot [256];     // mac block -> bitmap slot + 1 (0 = 범위 밖)
+    struct macidx_block blk  [MACIDX_BLOCK_MAX];
+    struct macidx_log   log  [MACIDX_LOG_MAX];
+};
+
+struct efuse_macidx {
+    struct macidx_hdr   *hdr;
+    unsigned long long  *bits;
+    size_t              map_size;
+    int                 fd;
+};
+
+//------------------------------------------------------------------------------
+// function prototype
+//------------------------------------------------------------------------------
+static int  macidx_blocks   (struct macidx_hdr *hdr);
+static struct macidx_log *macidx_log_get (efuse_macidx *idx, const struct stat *st);
+static int  macidx_line_mac (const char *line, const char *end, unsigned long long *mac);
+
+efuse_macidx *efuse_macidx_open (const char *idx_file);
+void efuse_macidx_close         (efuse_macidx *idx);
+int  efuse_macidx_add           (efuse_macidx *idx, unsigned long long mac);
+int  efuse_macidx_test          (efuse_macidx *idx, unsigned long long mac);
+long efuse_macidx_ingest        (efuse_macidx *idx, const char *log_path,
+                                 efuse_macidx_cb cb, void *arg);
+int  efuse_macidx_stat          (efuse_macidx *idx, int board_id,
+                                 struct efuse_macidx_stat *stat);
+int  efuse_macidx_holes         (efuse_macidx *idx, int board_id,
+                                 efuse_macidx_hole_cb cb, void *arg);
+
+//------------------------------------------------------------------------------
+// board에 할당된 mac block 목록 생성 (audit classifier와 동일한 기준).
+//------------------------------------------------------------------------------
+static int macidx_blocks (struct macidx_hdr *hdr)
+{
+    int block, board_id;
+
+    memset (hdr->slot, 0, sizeof(hdr->slot));
+    for (block = 0, hdr->block_cnt = 0; block < 256; block++) {
+        board_id = efuse_audit_mac ((0x001E06ULL << 24) | ((unsigned long long)block << 16));
+        if (board_id < 0)
+            continue;
+        if (hdr->block_cnt >= MACIDX_BLOCK_MAX)
+            return 0;
+        hdr->blk[hdr->block_cnt].block    = block;
+        hdr->blk[hdr->block_cnt].board_id = board_id;
+        hdr->slot[block] = ++hdr->block_cnt;
+    }
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+// index file open. 파일이 없으면 새로 생성. 닫을때까지 flock 유지.
+//------------------------------------------------------------------------------
+efuse_macidx *efuse_macidx_open (const char *idx_file)
+{
+    struct macidx_hdr cur;
+    efuse_macidx *idx;
+    struct stat st;
+    unsigned int i;
+    int is_new;
+    void *map;
+
+    memset (&cur, 0, sizeof(cur));
+    if (!macidx_blocks (&cur))
+        return NULL;
+
+    if ((idx = calloc (1, sizeof(efuse_macidx))) == NULL)
+        return NULL;
+
+    idx->map_size = MACIDX_HDR_SIZE + (size_t)cur.block_cnt * MACIDX_BLOCK_MACS / 8;
+    if ((idx->fd = open (idx_file, O_RDWR | O_CREAT | O_CLOEXEC, 0644)) < 0) {
+        dbg_msg ("error, mac index file open (%s)\n", idx_file);
+        goto err_free;
+    }
+    if (flock (idx->fd, LOCK_EX | LOCK_NB) < 0) {
+        dbg_msg ("error, mac index file is busy (%s)\n", idx_file);
+        goto err_close;
+    }
+    if (fstat (idx->fd, &st) < 0)
+        goto err_close;
+
+    if ((is_new = (st.st_size == 0))) {
+        if (ftruncate (idx->fd, idx->map_size) < 0)
+            goto err_close;
+    } else if ((size_t)st.st_size != idx->map_size) {
+        dbg_msg ("error, mac index size (%s, %ld != %ld)\n",
+            idx_file, (long)st.st_size, (long)idx->map_size);
+        goto err_close;
+    }
+
+    map = mmap (NULL, idx->map_size, PROT_READ | PROT_WRITE, MAP_SHARED, idx->fd, 0);
+    if (map == MAP_FAILED)
+        goto err_close;
+
+    idx->hdr  = (struct macidx_hdr *)map;
+    idx->bits = (unsigned long long *)((char *)map + MACIDX_HDR_SIZE);
+
+    // ftruncate 후 magic 기록 전 crash : 초기화 되지 않은 index (flock 상태)
+    if (!is_new && (idx->hdr->magic == 0)) {
+        dbg_msg ("mac index header empty, initialize (%s)\n", idx_file);
+        memset (map, 0, idx->map_size);
+        is_new = 1;
+    }
+    if (is_new) {
+        memcpy (idx->hdr, &cur, sizeof(cur));
+        idx->hdr->version = MACIDX_VERSION;
+        idx->hdr->magic   = MACIDX_MAGIC;
+        msync (map, idx->map_size, MS_SYNC);
+        return idx;
+    }
+    // board mac 범위가 변경된 경우 기존 index 사용 불가.
+    if ((idx->hdr->magic   != MACIDX_MAGIC)   ||
+        (idx->hdr->version != MACIDX_VERSION) ||
+        (idx->hdr->block_cnt != cur.block_cnt))
+        goto err_unmap;
+    for (i = 0; i < cur.block_cnt; i++) {
+        if ((idx->hdr->blk[i].block    != cur.blk[i].block) ||
+            (idx->hdr->blk[i].board_id != cur.blk[i].board_id))
+            goto err_unmap;
+    }
+    return idx;
+
+err_unmap:
+    dbg_msg ("error, mac index header mismatch (%s)\n", idx_file);
+    munmap (map, idx->map_size);
+err_close:
+    close (idx->fd);
+err_free:
+    free (idx);
+    return NULL;
+}
+
+//------------------------------------------------------------------------------
+void efuse_macidx_close (efuse_macidx *idx)
+{
+    if (idx == NULL)
+        return;
+    msync (idx->hdr, idx->map_size, MS_SYNC);
+    munmap (idx->hdr, idx->map_size);
+    close (idx->fd);
+    free (idx);
+}
+
+//------------------------------------------------------------------------------
+// 발급 mac 등록. return : eMACIDX_NEW / eMACIDX_DUP / eMACIDX_RANGE
+//------------------------------------------------------------------------------
+int efuse_macidx_add (efuse_macidx *idx, unsigned long long mac)
+{
+    struct macidx_block *blk;
+    unsigned long long *word, bit;
+    unsigned int slot, index;
+
+    if ((mac >> 24) != 0x001E06)
+        return eMACIDX_RANGE;
+    if ((slot = idx->hdr->slot[(mac >> 16) & 0xFF]) == 0)
+        return eMACIDX_RANGE;
+
+    blk   = &idx->hdr->blk[slot - 1];
+    index = mac & 0xFFFF;
+    word  = &idx->bits[(slot - 1) * MACIDX_BLOCK_WORDS + index / 64];
+    bit   = 1ULL << (index % 64);
+
+    if (*word & bit) {
+        blk->dups++;
+        return eMACIDX_DUP;
+    }
+    *word |= bit;
+    blk->count++;
+    if (blk->last < index + 1)
+        blk->last = index + 1;
+    return eMACIDX_NEW;
+}
+
+//------------------------------------------------------------------------------
+int efuse_macidx_test (efuse_macidx *idx, unsigned long long mac)
+{
+    unsigned int slot, index;
+
+    if (((mac >> 24) != 0x001E06) || !(slot = idx->hdr->slot[(mac >> 16) & 0xFF]))
+        return 0;
+
+    index = mac & 0xFFFF;
+    return (idx->bits[(slot - 1) * MACIDX_BLOCK_WORDS + index / 64] >> (index % 64)) & 1;
+}
+
+//------------------------------------------------------------------------------
+// log file의 ingest 위치 정보. table이 가득 찬 경우 가장 오래된 항목 교체.
+//------------------------------------------------------------------------------
+static struct macidx_log *macidx_log_get (efuse_macidx *idx, const struct stat *st)
+{
+    struct macidx_hdr *hdr = idx->hdr;
+    struct macidx_log *log = NULL;
+    unsigned int i;
+
+    for (i = 0; i < hdr->log_cnt; i++) {
+        if ((hdr->log[i].dev == (unsigned long long)st->st_dev) &&
+            (hdr->log[i].ino == (unsigned long long)st->st_ino)) {
+            log = &hdr->log[i];
+            break;
+        }
+    }
+    if (log == NULL) {
+        if (hdr->log_cnt < MACIDX_LOG_MAX) {
+            log = &hdr->log[hdr->log_cnt++];
+        } else {
+            for (i = 1, log = &hdr->log[0]; i < MACIDX_LOG_MAX; i++)
+                if (hdr->log[i].seq < log->seq)
+                    log = &hdr->log[i];
+        }
+        log->dev    = st->st_dev;
+        log->ino    = st->st_ino;
+        log->offset = 0;
+    }
+    // log rotate(truncate)된 경우 처음부터 다시 읽음.
+    if (log->offset > (long long)st->st_size)
+        log->offset = 0;
+    log->seq = ++hdr->log_seq;
+    return log;
+}
+
+//------------------------------------------------------------------------------
+// line 안의 uuid 검색 ("... efuse = XXXXXXXX-XXXX-..." 등 station log 형식 무관).
+//------------------------------------------------------------------------------
+static int macidx_line_mac (const char *line, const char *end, unsigned long long *mac)
+{
+    const char *p = line + 8;
+    struct efuse_uuid bin;
+
+    // uuid의 첫번째 '-' 위치(8) 기준으로 후보 검색.
+    while ((end - p) >= (EFUSE_UUID_SIZE - 8)) {
+        if ((p = memchr (p, '-', end - p - (EFUSE_UUID_SIZE - 8) + 1)) == NULL)
+            break;
+        if (efuse_uuid_parse (p - 8, &bin)) {
+            *mac = efuse_uuid_mac (&bin);
+            return 1;
+        }
+        p++;
+    }
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+// log file의 추가된 line만 ingest. 마지막 '\n' 이후의 미완성 line은 다음에 처리.
+// return : 처리한 uuid record 수, -1 = file error
+//------------------------------------------------------------------------------
+long efuse_macidx_ingest (efuse_macidx *idx, const char *log_path,
+                          efuse_macidx_cb cb, void *arg)
+{
+    const char *map, *p, *end, *nl;
+    struct macidx_log *log;
+    unsigned long long mac;
+    struct stat st;
+    long records = 0;
+    int fd, slot;
+
+    if ((fd = open (log_path, O_RDONLY | O_CLOEXEC)) < 0) {
+        dbg_msg ("error, log file open (%s)\n", log_path);
+        return -1;
+    }
+    if (fstat (fd, &st) < 0) {
+        close (fd);
+        return -1;
+    }
+    log = macidx_log_get (idx, &st);
+    if (log->offset == (long long)st.st_size) {
+        close (fd);
+        return 0;
+    }
+    map = mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close (fd);
+    if (map == MAP_FAILED)
+        return -1;
+    madvise ((void *)map, st.st_size, MADV_SEQUENTIAL);
+
+    end = map + st.st_size;
+    for (p = map + log->offset; p < end; p = nl + 1) {
+        if ((nl = memchr (p, '\n', end - p)) == NULL)
+            break;
+        if (macidx_line_mac (p, nl, &mac)) {
+            records++;
+            if ((efuse_macidx_add (idx, mac) == eMACIDX_DUP) && (cb != NULL)) {
+                slot = idx->hdr->slot[(mac >> 16) & 0xFF];
+                cb (arg, log_path, p - map, mac, idx->hdr->blk[slot - 1].board_id);
+            }
+        }
+        log->offset = nl + 1 - map;
+    }
+    munmap ((void *)map, st.st_size);
+    msync (idx->hdr, idx->map_size, MS_SYNC);
+    return records;
+}
+
+//------------------------------------------------------------------------------
+// board별 통계. hole 수 = 마지막 발급 mac 이하 중 발급되지 않은 mac 수.
+//------------------------------------------------------------------------------
+int efuse_macidx_stat (efuse_macidx *idx, int board_id, struct efuse_macidx_stat *stat)
+{
+    struct macidx_block *blk;
+    unsigned long long mac;
+    unsigned int i;
+
+    if ((idx == NULL) || (stat == NULL) ||
+        !efuse_get_mac_range (board_id, &stat->mac_start, NULL))
+        return 0;
+
+    stat->issued = stat->dups = stat->holes = 0;
+    stat->mac_last = 0;
+    for (i = 0; i < idx->hdr->block_cnt; i++) {
+        blk = &idx->hdr->blk[i];
+        if (blk->board_id != board_id)
+            continue;
+        stat->issued += blk->count;
+        stat->dups   += blk->dups;
+        stat->holes  += blk->last - blk->count;
+        mac = (0x001E06ULL << 24) | ((unsigned long long)blk->block << 16) | (blk->last - 1);
+        if (blk->last && (mac > stat->mac_last))
+            stat->mac_last = mac;
+    }
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+// board의 hole 범위 목록. return : hole 범위 개수
+//------------------------------------------------------------------------------
+int efuse_macidx_holes (efuse_macidx *idx, int board_id,
+                        efuse_macidx_hole_cb cb, void *arg)
+{
+    const unsigned long long *bits;
+    struct macidx_block *blk;
+    unsigned int i, pos, start;
+    int ranges = 0;
+
+    if ((idx == NULL) || (board_id < 0) || (board_id >= eBOARD_ID_END))
+        return 0;
+
+    for (i = 0; i < idx->hdr->block_cnt; i++) {
+        blk  = &idx->hdr->blk[i];
+        bits = &idx->bits[i * MACIDX_BLOCK_WORDS];
+        if ((blk->board_id != board_id) || (blk->count == blk->last))
+            continue;
+
+        for (pos = 0; pos < blk->last; ) {
+            // 발급된 mac은 word 단위로 건너뜀.
+            if (!(pos % 64) && (bits[pos / 64] == ~0ULL)) {
+                pos += 64;
+                continue;
+            }
+            if ((bits[pos / 64] >> (pos % 64)) & 1) {
+                pos++;
+                continue;
+            }
+            for (start = pos; (pos < blk->last) && !((bits[pos / 64] >> (pos % 64)) & 1); pos++)
+                ;
+            ranges++;
+            if (cb != NULL)
+                cb (arg, (0x001E06ULL << 24) | ((unsigned long long)blk->block << 16) | start,
+                    pos - start);
+        }
+    }
+    return ranges;
+}
+
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
@@ -0,0 +1,69 @@
+//------------------------------------------------------------------------------
+/**
+ * @file lib_efuse_macidx.h
+ * @author charles-park (charles.park@hardkernel.com)
+ * @brief efuse issued mac index (duplicate / hole detection).
+ * @version 0.2
+ * @date 2023-09-22
+ *
+ * @package apt install cups cups-bsd
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#ifndef __LIB_EFUSE_MACIDX_H__
+#define __LIB_EFUSE_MACIDX_H__
+
+//------------------------------------------------------------------------------
+#include "lib_efuse.h"
+
+//------------------------------------------------------------------------------
+// 발급된(log에 기록된) mac의 persistent bitmap index.
+// odroid mac block(0x001E06xx) 중 board에 할당된 block만 bitmap으로 유지.
+// log file은 (dev, inode) 별로 읽은 위치를 기억하여 추가된 부분만 ingest.
+// index file은 한 process만 open 가능 (flock).
+//------------------------------------------------------------------------------
+typedef struct efuse_macidx efuse_macidx;
+
+// efuse_macidx_add() result
+enum {
+    eMACIDX_RANGE = 0,  // index 범위 밖의 mac
+    eMACIDX_NEW,
+    eMACIDX_DUP,
+};
+
+struct efuse_macidx_stat {
+    long    issued;
+    long    dups;
+    long    holes;      // 각 block의 마지막 발급 mac 이하에서 발급되지 않은 mac
+    unsigned long long  mac_start;
+    unsigned long long  mac_last;   // 마지막(최대) 발급 mac, 없으면 0
+};
+
+//------------------------------------------------------------------------------
+// ingest 중 중복 mac 통보. offset = log file 내 line 시작 위치.
+//------------------------------------------------------------------------------
+typedef void (*efuse_macidx_cb) (void *arg, const char *log_path, long offset,
+                                 unsigned long long mac, int board_id);
+// hole 통보 (mac_start 부터 cnt 개)
+typedef void (*efuse_macidx_hole_cb) (void *arg, unsigned long long mac_start, int cnt);
+
+//------------------------------------------------------------------------------
+//	function prototype
+//------------------------------------------------------------------------------
+extern efuse_macidx *efuse_macidx_open  (const char *idx_file);
+extern void  efuse_macidx_close         (efuse_macidx *idx);
+extern int   efuse_macidx_add           (efuse_macidx *idx, unsigned long long mac);
+extern int   efuse_macidx_test          (efuse_macidx *idx, unsigned long long mac);
+extern long  efuse_macidx_ingest        (efuse_macidx *idx, const char *log_path,
+                                         efuse_macidx_cb cb, void *arg);
+extern int   efuse_macidx_stat          (efuse_macidx *idx, int board_id,
+                                         struct efuse_macidx_stat *stat);
+extern int   efuse_macidx_holes         (efuse_macidx *idx, int board_id,
+                                         efuse_macidx_hole_cb cb, void *arg);
+
+//------------------------------------------------------------------------------
+#endif  // #ifndef __LIB_EFUSE_MACIDX_H__
+//------------------------------------------------------------------------------
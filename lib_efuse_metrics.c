@@ -0,0 +1,339 @@
+//------------------------------------------------------------------------------
+/**
+ * @file lib_efuse_metrics.c
+ * @author charles-park (charles.park@hardkernel.com)
+ * @brief efuse per-phase timing metrics (prometheus text export).
+ * @version 0.2
+ * @date 2023-09-22
+ *
+ * @package apt install cups cups-bsd
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "lib_efuse.h"
+#include "lib_efuse_metrics.h"
+#include "lib_efuse_board.h"
+
+//------------------------------------------------------------------------------
+// Debug msg
+//------------------------------------------------------------------------------
+#if defined (__LIB_EFUSE_APP__)
+    #define dbg_msg(fmt, args...)   printf(fmt, ##args)
+#else
+    #define dbg_msg(fmt, args...)
+#endif
+
+//------------------------------------------------------------------------------
+// thread별 counter block. block은 해당 thread만 write 하므로 lock/atomic RMW 없음.
+// thread 종료시 block은 다음 thread가 재사용 (누적값 유지).
+// block이 모두 사용중이면 공용 block에 atomic add.
+//------------------------------------------------------------------------------
+#define METRIC_THREAD_MAX   64
+
+struct metric_block {
+    int                     in_use;
+    struct efuse_metrics    data;
+};
+
+static struct metric_block  MetricBlock [METRIC_THREAD_MAX];
+static struct efuse_metrics MetricShared;
+
+static __thread struct metric_block *MetricTls;
+static __thread int         MetricTlsFull;
+static pthread_key_t        MetricKey;
+static pthread_once_t       MetricOnce = PTHREAD_ONCE_INIT;
+
+static const char *MetricPhaseName [eMETRIC_END] = {
+    "access", "lock", "read", "write", "slot_scan", "slot_write",
+    "slot_erase", "sync", "verify", "control", "write_verify",
+};
+
+// 주기적 export thread (efuse_metrics_start)
+static struct {
+    pthread_t       thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t  cond;
+    int             running;
+    int             quit;
+    int             interval_ms;
+    char            path [PATH_MAX];
+} MetricExport = { .mutex = PTHREAD_MUTEX_INITIALIZER, .cond = PTHREAD_COND_INITIALIZER };
+
+//------------------------------------------------------------------------------
+// function prototype
+//------------------------------------------------------------------------------
+static void metric_release      (void *arg);
+static void metric_key_init     (void);
+static struct metric_block *metric_block (void);
+static void *metric_export_thread (void *arg);
+
+long long   efuse_metrics_now       (void);
+void        efuse_metrics_add       (int board_id, int phase, long long start_ns);
+void        efuse_metrics_snapshot  (struct efuse_metrics *metrics);
+const char *efuse_metrics_phase_name(int phase);
+int         efuse_metrics_write     (FILE *out);
+int         efuse_metrics_export    (const char *path);
+int         efuse_metrics_start     (const char *path, int interval_ms);
+void        efuse_metrics_stop      (void);
+
+//------------------------------------------------------------------------------
+static void metric_release (void *arg)
+{
+    __atomic_store_n (&((struct metric_block *)arg)->in_use, 0, __ATOMIC_RELEASE);
+}
+
+//------------------------------------------------------------------------------
+static void metric_key_init (void)
+{
+    pthread_key_create (&MetricKey, metric_release);
+}
+
+//------------------------------------------------------------------------------
+// 현재 thread의 block. 최초 호출시 빈 block 할당. NULL = 공용 block 사용.
+//------------------------------------------------------------------------------
+static struct metric_block *metric_block (void)
+{
+    int i, expect;
+
+    if ((MetricTls != NULL) || MetricTlsFull)
+        return MetricTls;
+
+    pthread_once (&MetricOnce, metric_key_init);
+    for (i = 0; i < METRIC_THREAD_MAX; i++) {
+        expect = 0;
+        if (__atomic_compare_exchange_n (&MetricBlock[i].in_use, &expect, 1, 0,
+                                         __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            MetricTls = &MetricBlock[i];
+            pthread_setspecific (MetricKey, MetricTls);
+            return MetricTls;
+        }
+    }
+    MetricTlsFull = 1;
+    return NULL;
+}
+
+//------------------------------------------------------------------------------
+long long efuse_metrics_now (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+//------------------------------------------------------------------------------
+// start_ns(efuse_metrics_now) 부터 현재까지의 시간을 board/phase에 기록.
+//------------------------------------------------------------------------------
+void efuse_metrics_add (int board_id, int phase, long long start_ns)
+{
+    long long ns = efuse_metrics_now () - start_ns;
+    unsigned long long us;
+    struct metric_block *blk;
+    struct efuse_metric *m;
+    int b;
+
+    if ((board_id < 0) || (board_id >= eBOARD_ID_END) || (phase < 0) || (phase >= eMETRIC_END))
+        return;
+    if (ns < 0)
+        ns = 0;
+
+    us = ns / 1000;
+    b  = us ? 64 - __builtin_clzll (us) : 0;
+    if (b >= METRIC_BUCKET_CNT)
+        b = METRIC_BUCKET_CNT - 1;
+
+    if ((blk = metric_block ()) != NULL) {
+        // 읽는 thread가 중간값을 보지 않도록 store만 atomic (일반 store와 동일 비용).
+        m = &blk->data.m[board_id][phase];
+        __atomic_store_n (&m->count,     m->count + 1,     __ATOMIC_RELAXED);
+        __atomic_store_n (&m->sum_ns,    m->sum_ns + ns,   __ATOMIC_RELAXED);
+        __atomic_store_n (&m->bucket[b], m->bucket[b] + 1, __ATOMIC_RELAXED);
+        return;
+    }
+    m = &MetricShared.m[board_id][phase];
+    __atomic_fetch_add (&m->count,     1,  __ATOMIC_RELAXED);
+    __atomic_fetch_add (&m->sum_ns,    ns, __ATOMIC_RELAXED);
+    __atomic_fetch_add (&m->bucket[b], 1,  __ATOMIC_RELAXED);
+}
+
+//------------------------------------------------------------------------------
+// 모든 thread block의 합계. 진행중인 기록과 동시에 호출 가능 (lock 없음).
+//------------------------------------------------------------------------------
+void efuse_metrics_snapshot (struct efuse_metrics *metrics)
+{
+    const struct efuse_metric *src;
+    struct efuse_metric *dst;
+    int i, b, p, k;
+
+    memset (metrics, 0, sizeof(struct efuse_metrics));
+    for (i = 0; i <= METRIC_THREAD_MAX; i++) {
+        const struct efuse_metrics *data = (i < METRIC_THREAD_MAX) ?
+                                            &MetricBlock[i].data : &MetricShared;
+
+        for (b = 0; b < eBOARD_ID_END; b++) {
+            for (p = 0; p < eMETRIC_END; p++) {
+                src = &data->m[b][p];
+                dst = &metrics->m[b][p];
+                if (!__atomic_load_n (&src->count, __ATOMIC_RELAXED))
+                    continue;
+                dst->count  += __atomic_load_n (&src->count,  __ATOMIC_RELAXED);
+                dst->sum_ns += __atomic_load_n (&src->sum_ns, __ATOMIC_RELAXED);
+                for (k = 0; k < METRIC_BUCKET_CNT; k++)
+                    dst->bucket[k] += __atomic_load_n (&src->bucket[k], __ATOMIC_RELAXED);
+            }
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+const char *efuse_metrics_phase_name (int phase)
+{
+    if ((phase < 0) || (phase >= eMETRIC_END))
+        return "unknown";
+    return MetricPhaseName[phase];
+}
+
+//------------------------------------------------------------------------------
+// prometheus text format (histogram). 기록이 있는 board/phase만 출력.
+//------------------------------------------------------------------------------
+int efuse_metrics_write (FILE *out)
+{
+    struct efuse_metrics *metrics = malloc (sizeof(struct efuse_metrics));
+    const struct efuse_metric *m;
+    unsigned long cum;
+    int b, p, k;
+
+    if (metrics == NULL)
+        return 0;
+    efuse_metrics_snapshot (metrics);
+
+    fprintf (out, "# HELP efuse_phase_duration_seconds efuse operation phase duration.\n");
+    fprintf (out, "# TYPE efuse_phase_duration_seconds histogram\n");
+    for (b = 0; b < eBOARD_ID_END; b++) {
+        for (p = 0; p < eMETRIC_END; p++) {
+            m = &metrics->m[b][p];
+            if (!m->count)
+                continue;
+            for (k = 0, cum = 0; k < METRIC_BUCKET_CNT - 1; k++) {
+                cum += m->bucket[k];
+                fprintf (out, "efuse_phase_duration_seconds_bucket"
+                              "{board=\"%s\",phase=\"%s\",le=\"%g\"} %lu\n",
+                    efuse_board_name (b), MetricPhaseName[p], (double)(1UL << k) * 1e-6, cum);
+            }
+            fprintf (out, "efuse_phase_duration_seconds_bucket"
+                          "{board=\"%s\",phase=\"%s\",le=\"+Inf\"} %lu\n",
+                efuse_board_name (b), MetricPhaseName[p], m->count);
+            fprintf (out, "efuse_phase_duration_seconds_sum{board=\"%s\",phase=\"%s\"} %.9f\n",
+                efuse_board_name (b), MetricPhaseName[p], m->sum_ns * 1e-9);
+            fprintf (out, "efuse_phase_duration_seconds_count{board=\"%s\",phase=\"%s\"} %lu\n",
+                efuse_board_name (b), MetricPhaseName[p], m->count);
+        }
+    }
+    free (metrics);
+    return ferror (out) ? 0 : 1;
+}
+
+//------------------------------------------------------------------------------
+// prometheus text file 저장 (node_exporter textfile collector).
+// 임시 file에 쓴 후 rename 하므로 읽는 쪽은 항상 완전한 file을 읽음.
+//------------------------------------------------------------------------------
+int efuse_metrics_export (const char *path)
+{
+    char tmp [PATH_MAX];
+    FILE *fp;
+    int ret;
+
+    if ((snprintf (tmp, sizeof(tmp), "%s.tmp", path) >= (int)sizeof(tmp)) ||
+        ((fp = fopen (tmp, "w")) == NULL)) {
+        dbg_msg ("error, metrics file open. (%s)\n", path);
+        return 0;
+    }
+    ret = efuse_metrics_write (fp);
+    if (fclose (fp) || !ret || rename (tmp, path)) {
+        unlink (tmp);
+        return 0;
+    }
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+static void *metric_export_thread (void *arg)
+{
+    struct timespec ts;
+    long long ns;
+
+    (void)arg;
+    pthread_mutex_lock (&MetricExport.mutex);
+    while (!MetricExport.quit) {
+        pthread_mutex_unlock (&MetricExport.mutex);
+        efuse_metrics_export (MetricExport.path);
+        pthread_mutex_lock (&MetricExport.mutex);
+
+        clock_gettime (CLOCK_REALTIME, &ts);
+        ns = ts.tv_nsec + MetricExport.interval_ms * 1000000LL;
+        ts.tv_sec += ns / 1000000000LL;
+        ts.tv_nsec = ns % 1000000000LL;
+        while (!MetricExport.quit &&
+               (pthread_cond_timedwait (&MetricExport.cond, &MetricExport.mutex, &ts) != ETIMEDOUT))
+            ;
+    }
+    pthread_mutex_unlock (&MetricExport.mutex);
+    return NULL;
+}
+
+//------------------------------------------------------------------------------
+// interval_ms 마다 path에 export. efuse_metrics_stop()에서 마지막으로 한번 더 저장.
+//------------------------------------------------------------------------------
+int efuse_metrics_start (const char *path, int interval_ms)
+{
+    if ((interval_ms <= 0) || (strlen (path) >= sizeof(MetricExport.path)))
+        return 0;
+
+    pthread_mutex_lock (&MetricExport.mutex);
+    if (MetricExport.running) {
+        pthread_mutex_unlock (&MetricExport.mutex);
+        return 0;
+    }
+    strcpy (MetricExport.path, path);
+    MetricExport.interval_ms = interval_ms;
+    MetricExport.quit        = 0;
+    if (pthread_create (&MetricExport.thread, NULL, metric_export_thread, NULL)) {
+        pthread_mutex_unlock (&MetricExport.mutex);
+        return 0;
+    }
+    MetricExport.running = 1;
+    pthread_mutex_unlock (&MetricExport.mutex);
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+void efuse_metrics_stop (void)
+{
+    pthread_mutex_lock (&MetricExport.mutex);
+    if (!MetricExport.running) {
+        pthread_mutex_unlock (&MetricExport.mutex);
+        return;
+    }
+    MetricExport.quit = 1;
+    pthread_cond_signal (&MetricExport.cond);
+    pthread_mutex_unlock (&MetricExport.mutex);
+
+    pthread_join (MetricExport.thread, NULL);
+    MetricExport.running = 0;
+    efuse_metrics_export (MetricExport.path);
+}
+
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
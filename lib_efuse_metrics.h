@@ -0,0 +1,69 @@
+//------------------------------------------------------------------------------
+/**
+ * @file lib_efuse_metrics.h
+ * @author charles-park (charles.park@hardkernel.com)
+ * @brief efuse per-phase timing metrics (prometheus text export).
+ * @version 0.2
+ * @date 2023-09-22
+ *
+ * @package apt install cups cups-bsd
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#ifndef __LIB_EFUSE_METRICS_H__
+#define __LIB_EFUSE_METRICS_H__
+
+//------------------------------------------------------------------------------
+#include <stdio.h>
+#include "lib_efuse.h"
+
+//------------------------------------------------------------------------------
+// 측정 구간. CONTROL/WRITE_VERIFY는 다른 구간을 포함 (중복 집계).
+//------------------------------------------------------------------------------
+enum {
+    eMETRIC_ACCESS = 0,     // device/control file 존재 확인
+    eMETRIC_LOCK,           // efuse_lock (emmc force_ro write)
+    eMETRIC_READ,           // uuid pread
+    eMETRIC_WRITE,          // uuid pwrite (m1s, m2, c5)
+    eMETRIC_SLOT_SCAN,      // IOC_DUMP slot 조회 (m1, c4)
+    eMETRIC_SLOT_WRITE,     // IOC_WRITE slot 탐색 + write (m1, c4)
+    eMETRIC_SLOT_ERASE,     // IOC_ERASE (m1, c4)
+    eMETRIC_SYNC,           // fdatasync
+    eMETRIC_VERIFY,         // write_verify의 read back
+    eMETRIC_CONTROL,        // efuse_ctx_control 전체
+    eMETRIC_WRITE_VERIFY,   // efuse_ctx_write_verify 전체
+    eMETRIC_END
+};
+
+// histogram bucket : bucket[i] = 2^(i-1) ~ 2^i usec (마지막 bucket은 그 이상)
+#define METRIC_BUCKET_CNT   24
+
+//------------------------------------------------------------------------------
+struct efuse_metric {
+    unsigned long       count;
+    unsigned long long  sum_ns;
+    unsigned long       bucket [METRIC_BUCKET_CNT];
+};
+
+struct efuse_metrics {
+    struct efuse_metric m [eBOARD_ID_END][eMETRIC_END];
+};
+
+//------------------------------------------------------------------------------
+//	function prototype
+//------------------------------------------------------------------------------
+extern long long    efuse_metrics_now       (void);
+extern void         efuse_metrics_add       (int board_id, int phase, long long start_ns);
+extern void         efuse_metrics_snapshot  (struct efuse_metrics *metrics);
+extern const char  *efuse_metrics_phase_name(int phase);
+extern int          efuse_metrics_write     (FILE *out);
+extern int          efuse_metrics_export    (const char *path);
+extern int          efuse_metrics_start     (const char *path, int interval_ms);
+extern void         efuse_metrics_stop      (void);
+
+//------------------------------------------------------------------------------
+#endif  // #ifndef __LIB_EFUSE_METRICS_H__
+//------------------------------------------------------------------------------
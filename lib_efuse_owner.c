@@ -0,0 +1,632 @@
+//------------------------------------------------------------------------------
+/**
+ * @file lib_efuse_owner.c
+ * @author charles-park (charles.park@hardkernel.com)
+ * @brief efuse device ownership between processes (shared memory table).
+ * @version 0.2
+ * @date 2023-09-22
+ *
+ * @package apt install cups cups-bsd
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include "lib_efuse.h"
+#include "lib_efuse_owner.h"
+
+//------------------------------------------------------------------------------
+// Debug msg
+//------------------------------------------------------------------------------
+#if defined (__LIB_EFUSE_APP__)
+    #define dbg_msg(fmt, args...)   printf(fmt, ##args)
+#else
+    #define dbg_msg(fmt, args...)
+#endif
+
+//------------------------------------------------------------------------------
+#define OWNER_MAGIC     0x4F464645  // "EFFO"
+#define OWNER_VERSION   1
+
+// 대기중 cancel/deadline/종료된 owner 확인 주기
+#define OWNER_SLICE_MS  10
+
+// process 구분 (pid 재사용 구분을 위해 process 시작 시간 같이 비교)
+struct owner_id {
+    int                 pid;        // 0 = 없음
+    int                 reserved;
+    unsigned long long  start;      // /proc/<pid>/stat starttime
+};
+
+struct owner_wait {
+    struct owner_id     id;
+    unsigned long long  ticket;
+};
+
+struct owner_slot {
+    pthread_mutex_t     lock;       // robust, process shared
+    unsigned int        seq;        // futex. owner 변경/대기 취소시 증가
+    unsigned long long  key;        // device hash, 0 = 빈 slot
+    char                device [OWNER_DEVICE_SIZE];
+
+    struct owner_id     owner;
+    unsigned long long  owner_ticket;
+    long long           since;      // unix time
+    long long           used;       // CLOCK_MONOTONIC ns (빈 slot 재사용 순서)
+
+    unsigned long long  next_ticket;
+    int                 nwait;
+    struct owner_wait   wait [OWNER_WAIT_MAX];
+
+    unsigned long long  acquired, contended, stale;
+};
+
+struct owner_table {
+    unsigned int        magic;
+    unsigned int        version;
+    unsigned int        slot_max;
+    unsigned int        slot_size;  // build간 struct 크기 확인
+    pthread_mutex_t     lock;       // slot 할당
+    struct owner_slot   slot [OWNER_SLOT_MAX];
+};
+
+struct efuse_owner {
+    struct owner_table  *table;
+};
+
+// thread별 process id cache (fork 후 다시 계산)
+static __thread struct owner_id SelfId;
+
+//------------------------------------------------------------------------------
+//	function prototype
+//------------------------------------------------------------------------------
+static long long    mono_ns         (void);
+static unsigned long long proc_start (int pid);
+static const struct owner_id *owner_self (void);
+static int  owner_alive             (const struct owner_id *id);
+static void slot_lock               (pthread_mutex_t *m);
+static int  mutex_init              (pthread_mutex_t *m);
+static void slot_wake               (struct owner_slot *s);
+static void slot_wait               (struct owner_slot *s, unsigned int seq, int ms);
+static void slot_check              (struct owner_slot *s);
+static void slot_take               (struct owner_slot *s, struct efuse_owner_lock *lock,
+                                     unsigned long long ticket);
+static void slot_dequeue            (struct owner_slot *s, unsigned long long ticket);
+static int  slot_find               (struct owner_table *t, unsigned long long key);
+static int  slot_assign             (struct owner_table *t, unsigned long long key,
+                                     const char *device);
+static unsigned long long device_key (const char *device, char *name);
+
+efuse_owner *efuse_owner_open (const char *path);
+void efuse_owner_close          (efuse_owner *owner);
+void efuse_owner_lock_init      (struct efuse_owner_lock *lock);
+int  efuse_owner_acquire        (efuse_owner *owner, struct efuse_owner_lock *lock,
+                                 const char *device, int timeout_ms, const int *cancel);
+int  efuse_owner_release        (efuse_owner *owner, struct efuse_owner_lock *lock);
+int  efuse_owner_list           (efuse_owner *owner, efuse_owner_cb cb, void *arg);
+
+//------------------------------------------------------------------------------
+static long long mono_ns (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+//------------------------------------------------------------------------------
+// /proc/<pid>/stat 22번째 항목 (starttime). return : 0 = process 없음 (종료)
+//------------------------------------------------------------------------------
+static unsigned long long proc_start (int pid)
+{
+    char path[64], buf[512], *p;
+    unsigned long long start = 0;
+    int fd, n, field;
+
+    snprintf (path, sizeof(path), "/proc/%d/stat", pid);
+    if ((fd = open (path, O_RDONLY | O_CLOEXEC)) < 0)
+        return 0;
+    n = read (fd, buf, sizeof(buf) - 1);
+    close (fd);
+    if (n <= 0)
+        return 0;
+    buf[n] = 0;
+
+    // comm에 ' ', ')'가 있을 수 있으므로 마지막 ')' 이후 3번째 항목부터 계산.
+    // 종료 후 아직 wait 되지 않은 process (zombie)도 종료로 처리.
+    if (((p = strrchr (buf, ')')) == NULL) || (p[1] != ' ') || (p[2] == 'Z') || (p[2] == 'X'))
+        return 0;
+    for (field = 2; *p && (field < 22); p++) {
+        if (*p == ' ')
+            field++;
+    }
+    if (field == 22)
+        start = strtoull (p, NULL, 10);
+    return start;
+}
+
+//------------------------------------------------------------------------------
+static const struct owner_id *owner_self (void)
+{
+    int pid = getpid ();
+
+    if (SelfId.pid != pid) {
+        SelfId.pid   = pid;
+        SelfId.start = proc_start (pid);
+    }
+    return &SelfId;
+}
+
+//------------------------------------------------------------------------------
+// 같은 process는 항상 alive (thread 종료시 release는 사용자 책임).
+//------------------------------------------------------------------------------
+static int owner_alive (const struct owner_id *id)
+{
+    if (id->pid == owner_self ()->pid)
+        return 1;
+    if ((kill (id->pid, 0) < 0) && (errno == ESRCH))
+        return 0;
+    return proc_start (id->pid) == id->start;
+}
+
+//------------------------------------------------------------------------------
+// lock을 가진 process가 종료된 경우 slot 상태는 slot_check()에서 정리.
+//------------------------------------------------------------------------------
+static void slot_lock (pthread_mutex_t *m)
+{
+    if (pthread_mutex_lock (m) == EOWNERDEAD)
+        pthread_mutex_consistent (m);
+}
+
+//------------------------------------------------------------------------------
+static int mutex_init (pthread_mutex_t *m)
+{
+    pthread_mutexattr_t attr;
+    int ret;
+
+    pthread_mutexattr_init (&attr);
+    pthread_mutexattr_setpshared (&attr, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust  (&attr, PTHREAD_MUTEX_ROBUST);
+    ret = pthread_mutex_init (m, &attr);
+    pthread_mutexattr_destroy (&attr);
+    return ret == 0;
+}
+
+//------------------------------------------------------------------------------
+// 다른 process도 대기하므로 shared futex (FUTEX_PRIVATE_FLAG 사용 안함).
+//------------------------------------------------------------------------------
+static void slot_wake (struct owner_slot *s)
+{
+    syscall (SYS_futex, &s->seq, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+static void slot_wait (struct owner_slot *s, unsigned int seq, int ms)
+{
+    struct timespec ts = { ms / 1000, (ms % 1000) * 1000000L };
+
+    syscall (SYS_futex, &s->seq, FUTEX_WAIT, seq, &ts, NULL, 0);
+}
+
+//------------------------------------------------------------------------------
+// 종료된 대기자 제거, 종료된 owner 회수. slot lock 상태에서 호출.
+//------------------------------------------------------------------------------
+static void slot_check (struct owner_slot *s)
+{
+    int i;
+
+    for (i = 0; i < s->nwait; i++) {
+        if (owner_alive (&s->wait[i].id))
+            continue;
+        memmove (&s->wait[i], &s->wait[i + 1], (s->nwait - i - 1) * sizeof(s->wait[0]));
+        s->nwait--, i--;
+    }
+    if (s->owner.pid && !owner_alive (&s->owner)) {
+        dbg_msg ("owner, stale owner pid %d recovered. (%s)\n", s->owner.pid, s->device);
+        memset (&s->owner, 0, sizeof(s->owner));
+        s->owner_ticket = 0;
+        s->stale++;
+        s->seq++;
+    }
+}
+
+//------------------------------------------------------------------------------
+static void slot_take (struct owner_slot *s, struct efuse_owner_lock *lock,
+                       unsigned long long ticket)
+{
+    s->owner        = *owner_self ();
+    s->owner_ticket = ticket;
+    s->since        = time (NULL);
+    s->used         = mono_ns ();
+    s->acquired++;
+    lock->ticket    = ticket;
+}
+
+//------------------------------------------------------------------------------
+static void slot_dequeue (struct owner_slot *s, unsigned long long ticket)
+{
+    int i;
+
+    for (i = 0; i < s->nwait; i++) {
+        if (s->wait[i].ticket != ticket)
+            continue;
+        memmove (&s->wait[i], &s->wait[i + 1], (s->nwait - i - 1) * sizeof(s->wait[0]));
+        s->nwait--;
+        return;
+    }
+}
+
+//------------------------------------------------------------------------------
+// key는 slot lock 없이 비교, 사용 전 slot lock 상태에서 다시 확인.
+//------------------------------------------------------------------------------
+static int slot_find (struct owner_table *t, unsigned long long key)
+{
+    int i;
+
+    for (i = 0; i < OWNER_SLOT_MAX; i++) {
+        if (__atomic_load_n (&t->slot[i].key, __ATOMIC_ACQUIRE) == key)
+            return i;
+    }
+    return -1;
+}
+
+//------------------------------------------------------------------------------
+// 빈 slot이 없으면 owner/대기자가 없는 slot 중 가장 오래 사용하지 않은 slot 재사용.
+// return : slot index, -1 = 모든 slot 사용중
+//------------------------------------------------------------------------------
+static int slot_assign (struct owner_table *t, unsigned long long key, const char *device)
+{
+    struct owner_slot *s;
+    int i, idx = -1;
+
+    slot_lock (&t->lock);
+    if ((idx = slot_find (t, key)) >= 0)
+        goto out;
+
+    // 후보 slot은 lock을 유지 (slot lock 2개를 같이 가지는 경우는 여기만 있음)
+    for (i = 0; i < OWNER_SLOT_MAX; i++) {
+        s = &t->slot[i];
+        slot_lock (&s->lock);
+        if (!s->key) {
+            if (idx >= 0)
+                pthread_mutex_unlock (&t->slot[idx].lock);
+            idx = i;
+            break;
+        }
+        slot_check (s);
+        if (!s->owner.pid && !s->nwait && ((idx < 0) || (s->used < t->slot[idx].used))) {
+            if (idx >= 0)
+                pthread_mutex_unlock (&t->slot[idx].lock);
+            idx = i;
+            continue;
+        }
+        pthread_mutex_unlock (&s->lock);
+    }
+    if (idx < 0)
+        goto out;
+    s = &t->slot[idx];
+    // 다른 process가 cache한 index는 key 비교로 무효화 됨.
+    s->owner_ticket = 0;
+    s->since        = 0;
+    s->used         = mono_ns ();
+    s->acquired     = s->contended = s->stale = 0;
+    memset (&s->owner, 0, sizeof(s->owner));
+    snprintf (s->device, sizeof(s->device), "%s", device);
+    __atomic_store_n (&s->key, key, __ATOMIC_RELEASE);
+    pthread_mutex_unlock (&s->lock);
+out:
+    pthread_mutex_unlock (&t->lock);
+    return idx;
+}
+
+//------------------------------------------------------------------------------
+// device path의 realpath (symlink, /sys/class/block/xxx 등 같은 device로 처리)
+// FNV-1a hash. device가 아직 없으면 입력 path 사용.
+// name : OWNER_DEVICE_SIZE, 길면 뒷부분 저장
+//------------------------------------------------------------------------------
+static unsigned long long device_key (const char *device, char *name)
+{
+    char path[PATH_MAX];
+    unsigned long long key = 0xcbf29ce484222325ULL;
+    const char *p;
+    size_t len;
+
+    if (realpath (device, path) == NULL) {
+        strncpy (path, device, sizeof(path) - 1);
+        path[sizeof(path) - 1] = 0;
+    }
+    for (p = path; *p; p++)
+        key = (key ^ (unsigned char)*p) * 0x100000001b3ULL;
+
+    len = strlen (path);
+    p   = (len < OWNER_DEVICE_SIZE) ? path : path + len - (OWNER_DEVICE_SIZE - 1);
+    strcpy (name, p);
+    return key ? key : 1;
+}
+
+//------------------------------------------------------------------------------
+// owner table open. 파일이 없으면 생성 (다른 user의 process도 사용하도록 0666).
+// path = NULL 이면 OWNER_TABLE_PATH.
+//------------------------------------------------------------------------------
+efuse_owner *efuse_owner_open (const char *path)
+{
+    struct owner_table *t;
+    efuse_owner *owner;
+    struct stat st;
+    int fd, i, is_new = 0;
+    void *map;
+
+    if (path == NULL)
+        path = OWNER_TABLE_PATH;
+    if ((owner = calloc (1, sizeof(efuse_owner))) == NULL)
+        return NULL;
+
+    if ((fd = open (path, O_RDWR | O_CREAT | O_CLOEXEC, 0666)) < 0) {
+        dbg_msg ("error, owner table open (%s, %s)\n", path, strerror (errno));
+        goto err_free;
+    }
+    // 동시에 생성하는 process간 초기화 충돌 방지.
+    flock (fd, LOCK_EX);
+    if (fstat (fd, &st) < 0)
+        goto err_close;
+
+    if (st.st_size == 0) {
+        if (ftruncate (fd, sizeof(struct owner_table)) < 0)
+            goto err_close;
+        fchmod (fd, 0666);
+        is_new = 1;
+    } else if ((size_t)st.st_size != sizeof(struct owner_table)) {
+        dbg_msg ("error, owner table size (%s, %ld != %ld)\n",
+            path, (long)st.st_size, (long)sizeof(struct owner_table));
+        goto err_close;
+    }
+
+    map = mmap (NULL, sizeof(struct owner_table), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED)
+        goto err_close;
+    t = (struct owner_table *)map;
+
+    // ftruncate 후 magic 기록 전 crash : 초기화 되지 않은 table (flock 상태)
+    if (!is_new && (__atomic_load_n (&t->magic, __ATOMIC_ACQUIRE) == 0)) {
+        dbg_msg ("owner table header empty, initialize (%s)\n", path);
+        memset (t, 0, sizeof(struct owner_table));
+        is_new = 1;
+    }
+    if (is_new) {
+        mutex_init (&t->lock);
+        for (i = 0; i < OWNER_SLOT_MAX; i++)
+            mutex_init (&t->slot[i].lock);
+        t->version   = OWNER_VERSION;
+        t->slot_max  = OWNER_SLOT_MAX;
+        t->slot_size = sizeof(struct owner_slot);
+        __atomic_store_n (&t->magic, OWNER_MAGIC, __ATOMIC_RELEASE);
+    } else if ((t->magic     != OWNER_MAGIC)    ||
+               (t->version   != OWNER_VERSION)  ||
+               (t->slot_max  != OWNER_SLOT_MAX) ||
+               (t->slot_size != sizeof(struct owner_slot))) {
+        dbg_msg ("error, owner table header mismatch (%s)\n", path);
+        munmap (map, sizeof(struct owner_table));
+        goto err_close;
+    }
+    flock (fd, LOCK_UN);
+    close (fd);
+    owner->table = t;
+    return owner;
+
+err_close:
+    flock (fd, LOCK_UN);
+    close (fd);
+err_free:
+    free (owner);
+    return NULL;
+}
+
+//------------------------------------------------------------------------------
+// 이 process가 가진 owner는 release 하지 않음 (release 후 close).
+//------------------------------------------------------------------------------
+void efuse_owner_close (efuse_owner *owner)
+{
+    if (owner == NULL)
+        return;
+    munmap (owner->table, sizeof(struct owner_table));
+    free (owner);
+}
+
+//------------------------------------------------------------------------------
+// device path 변경시 다시 초기화 (key 다시 계산).
+//------------------------------------------------------------------------------
+void efuse_owner_lock_init (struct efuse_owner_lock *lock)
+{
+    lock->key    = 0;
+    lock->ticket = 0;
+    lock->slot   = -1;
+}
+
+//------------------------------------------------------------------------------
+// device owner 획득. 다른 owner가 있거나 먼저 대기중인 요청이 있으면 순서대로 대기.
+// timeout_ms : 0 = 대기하지 않음, -1 = 무제한
+// cancel     : NULL 이 아니고 0이 아니면 대기 중단 (OWNER_SLICE_MS 단위 확인)
+// return : 1 = 획득 (이미 owner인 경우 포함),
+//          0 = errno EBUSY(대기 안함), ETIMEDOUT, ECANCELED, ENOSPC(table full)
+//------------------------------------------------------------------------------
+int efuse_owner_acquire (efuse_owner *owner, struct efuse_owner_lock *lock,
+                         const char *device, int timeout_ms, const int *cancel)
+{
+    struct owner_table *t = owner->table;
+    char name[OWNER_DEVICE_SIZE];
+    long long deadline = (timeout_ms > 0) ? mono_ns () + timeout_ms * 1000000LL : 0;
+    struct owner_slot *s;
+    unsigned long long ticket;
+    unsigned int seq;
+    int err = 0, ms;
+
+    if (lock->ticket)
+        return 1;
+    if (!lock->key) {
+        lock->key  = device_key (device, name);
+        lock->slot = -1;
+    }
+
+    while (1) {
+        if ((lock->slot < 0) || (lock->slot >= OWNER_SLOT_MAX)) {
+            if ((lock->slot = slot_find (t, lock->key)) < 0) {
+                device_key (device, name);
+                lock->slot = slot_assign (t, lock->key, name);
+            }
+            if (lock->slot < 0) {
+                dbg_msg ("error, owner table full. (%s)\n", device);
+                errno = ENOSPC;
+                return 0;
+            }
+        }
+        s = &t->slot[lock->slot];
+        slot_lock (&s->lock);
+        if (s->key == lock->key)
+            break;
+        // 재사용된 slot
+        pthread_mutex_unlock (&s->lock);
+        lock->slot = -1;
+    }
+
+    // 경쟁 없음 (owner, 대기자 없음)
+    if (!s->owner.pid && !s->nwait) {
+        slot_take (s, lock, ++s->next_ticket);
+        pthread_mutex_unlock (&s->lock);
+        return 1;
+    }
+    slot_check (s);
+    if (!s->owner.pid && !s->nwait) {
+        slot_take (s, lock, ++s->next_ticket);
+        pthread_mutex_unlock (&s->lock);
+        slot_wake (s);
+        return 1;
+    }
+    if ((timeout_ms == 0) || (s->nwait >= OWNER_WAIT_MAX)) {
+        pthread_mutex_unlock (&s->lock);
+        errno = EBUSY;
+        return 0;
+    }
+
+    ticket = ++s->next_ticket;
+    s->wait[s->nwait].id     = *owner_self ();
+    s->wait[s->nwait].ticket = ticket;
+    s->nwait++;
+
+    while (1) {
+        slot_check (s);
+        // 가장 먼저 대기한 요청 (wait[]는 ticket 순서)
+        if (!s->owner.pid && (s->wait[0].ticket == ticket)) {
+            slot_dequeue (s, ticket);
+            slot_take (s, lock, ticket);
+            s->contended++;
+            pthread_mutex_unlock (&s->lock);
+            return 1;
+        }
+        ms = OWNER_SLICE_MS;
+        if (cancel != NULL && __atomic_load_n (cancel, __ATOMIC_ACQUIRE))
+            err = ECANCELED;
+        else if (deadline) {
+            long long left = deadline - mono_ns ();
+
+            if (left <= 0)
+                err = ETIMEDOUT;
+            else if (left < ms * 1000000LL)
+                ms = (int)(left / 1000000LL) + 1;
+        }
+        if (err) {
+            // 다음 대기자가 먼저가 될 수 있으므로 깨움
+            slot_dequeue (s, ticket);
+            s->seq++;
+            pthread_mutex_unlock (&s->lock);
+            slot_wake (s);
+            errno = err;
+            return 0;
+        }
+        seq = s->seq;
+        pthread_mutex_unlock (&s->lock);
+        slot_wait (s, seq, ms);
+        slot_lock (&s->lock);
+    }
+}
+
+//------------------------------------------------------------------------------
+// return : 0 = owner 아님 (이미 release 됨)
+//------------------------------------------------------------------------------
+int efuse_owner_release (efuse_owner *owner, struct efuse_owner_lock *lock)
+{
+    struct owner_slot *s;
+    int ret = 0, wake = 0;
+
+    if (!lock->ticket || (lock->slot < 0))
+        return 0;
+
+    s = &owner->table->slot[lock->slot];
+    slot_lock (&s->lock);
+    if ((s->key == lock->key) && (s->owner_ticket == lock->ticket) &&
+        (s->owner.pid == owner_self ()->pid)) {
+        memset (&s->owner, 0, sizeof(s->owner));
+        s->owner_ticket = 0;
+        s->used = mono_ns ();
+        s->seq++;
+        wake = s->nwait > 0;
+        ret  = 1;
+    }
+    pthread_mutex_unlock (&s->lock);
+    if (wake)
+        slot_wake (s);
+    lock->ticket = 0;
+    return ret;
+}
+
+//------------------------------------------------------------------------------
+// 사용중인 slot 정보. return : slot 개수
+//------------------------------------------------------------------------------
+int efuse_owner_list (efuse_owner *owner, efuse_owner_cb cb, void *arg)
+{
+    struct efuse_owner_info info;
+    struct owner_slot *s;
+    int i, cnt = 0;
+
+    for (i = 0; i < OWNER_SLOT_MAX; i++) {
+        s = &owner->table->slot[i];
+        if (!__atomic_load_n (&s->key, __ATOMIC_ACQUIRE))
+            continue;
+
+        slot_lock (&s->lock);
+        slot_check (s);
+        memset (&info, 0, sizeof(info));
+        memcpy (info.device, s->device, sizeof(info.device));
+        info.pid       = s->owner.pid;
+        info.waiters   = s->nwait;
+        info.since     = s->owner.pid ? s->since : 0;
+        info.acquired  = s->acquired;
+        info.contended = s->contended;
+        info.stale     = s->stale;
+        pthread_mutex_unlock (&s->lock);
+
+        cnt++;
+        if (cb != NULL)
+            cb (arg, &info);
+    }
+    return cnt;
+}
+
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
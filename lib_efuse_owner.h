@@ -0,0 +1,71 @@
+//------------------------------------------------------------------------------
+/**
+ * @file lib_efuse_owner.h
+ * @author charles-park (charles.park@hardkernel.com)
+ * @brief efuse device ownership between processes (shared memory table).
+ * @version 0.2
+ * @date 2023-09-22
+ *
+ * @package apt install cups cups-bsd
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#ifndef __LIB_EFUSE_OWNER_H__
+#define __LIB_EFUSE_OWNER_H__
+
+//------------------------------------------------------------------------------
+#include "lib_efuse.h"
+
+//------------------------------------------------------------------------------
+// 같은 host의 여러 process/thread가 같은 device(force_ro, /dev/efuse)를
+// 동시에 unlock/write/lock 하지 않도록 device 단위 owner를 관리.
+//
+// owner table은 모든 process가 mmap 하는 file (default /dev/shm).
+// device(rw_control의 realpath)별 slot 1개, slot마다 robust mutex 사용.
+// - 경쟁이 없으면 slot mutex lock/unlock 1회로 acquire (syscall 없음).
+// - 대기 순서대로 owner 전달 (ticket FIFO, 대기중 새 요청이 앞서지 않음).
+// - owner process가 종료(crash)된 경우 대기중인 process가 확인 후 회수.
+//------------------------------------------------------------------------------
+#define OWNER_TABLE_PATH    "/dev/shm/lib_efuse.owner"
+#define OWNER_SLOT_MAX      128
+#define OWNER_WAIT_MAX      32
+#define OWNER_DEVICE_SIZE   128
+
+typedef struct efuse_owner efuse_owner;
+
+// 사용자(ctx) 1개의 device lock 상태. key = 0 이면 acquire시 device path로 계산.
+struct efuse_owner_lock {
+    unsigned long long  key;
+    unsigned long long  ticket;     // 0 = owner 아님
+    int                 slot;       // table index (-1 = 없음)
+};
+
+struct efuse_owner_info {
+    char                device [OWNER_DEVICE_SIZE];
+    int                 pid;        // 0 = owner 없음
+    int                 waiters;
+    long long           since;      // owner 획득 시간 (unix time)
+    unsigned long long  acquired;
+    unsigned long long  contended;  // 대기 후 획득
+    unsigned long long  stale;      // 종료된 owner 회수
+};
+
+typedef void (*efuse_owner_cb) (void *arg, const struct efuse_owner_info *info);
+
+//------------------------------------------------------------------------------
+//	function prototype
+//------------------------------------------------------------------------------
+extern efuse_owner *efuse_owner_open (const char *path);
+extern void efuse_owner_close       (efuse_owner *owner);
+extern void efuse_owner_lock_init   (struct efuse_owner_lock *lock);
+extern int  efuse_owner_acquire     (efuse_owner *owner, struct efuse_owner_lock *lock,
+                                     const char *device, int timeout_ms, const int *cancel);
+extern int  efuse_owner_release     (efuse_owner *owner, struct efuse_owner_lock *lock);
+extern int  efuse_owner_list        (efuse_owner *owner, efuse_owner_cb cb, void *arg);
+
+//------------------------------------------------------------------------------
+#endif  // #ifndef __LIB_EFUSE_OWNER_H__
+//------------------------------------------------------------------------------
@@ -0,0 +1,205 @@
+//------------------------------------------------------------------------------
+/**
+ * @file lib_efuse_prov.c
+ * @author charles-park (charles.park@hardkernel.com)
+ * @brief efuse multi-device provisioning engine.
+ * @version 0.2
+ * @date 2023-09-22
+ *
+ * @package apt install cups cups-bsd
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "lib_efuse.h"
+#include "lib_efuse_prov.h"
+
+//------------------------------------------------------------------------------
+// Debug msg
+//------------------------------------------------------------------------------
+#if defined (__LIB_EFUSE_APP__)
+    #define dbg_msg(fmt, args...)   printf(fmt, ##args)
+#else
+    #define dbg_msg(fmt, args...)
+#endif
+
+//------------------------------------------------------------------------------
+// worker pool 공유 data. job index는 next_job 하나만 lock으로 보호.
+//------------------------------------------------------------------------------
+struct prov_pool {
+    struct efuse_prov_job   *jobs;
+    int                     job_cnt;
+    int                     next_job;
+    pthread_mutex_t         mutex;
+};
+
+static efuse_ctx_init_cb ProvInit = NULL;
+static void *ProvInitArg = NULL;
+
+//------------------------------------------------------------------------------
+// function prototype
+//------------------------------------------------------------------------------
+static long  time_us        (void);
+static void  prov_job_exec  (struct efuse_prov_job *job);
+static void *prov_worker    (void *arg);
+
+int  efuse_prov_job_init    (struct efuse_prov_job *job, int board_id,
+                             const char *rw_control, const char *rw_file,
+                             const char *uuid);
+int  efuse_prov_run         (struct efuse_prov_job *jobs, int job_cnt,
+                             int worker_cnt, struct efuse_prov_report *report);
+void efuse_prov_set_ctx_init (efuse_ctx_init_cb cb, void *arg);
+
+//------------------------------------------------------------------------------
+static long time_us (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec * 1000000L) + (ts.tv_nsec / 1000L);
+}
+
+//------------------------------------------------------------------------------
+// write(같은 data이면 생략) -> read back 확인 -> mac range check.
+//------------------------------------------------------------------------------
+static void prov_job_exec (struct efuse_prov_job *job)
+{
+    long start = time_us ();
+    efuse_ctx *ctx;
+
+    job->status = 0;
+    memset (job->read_data, 0, sizeof(job->read_data));
+
+    if ((ctx = efuse_ctx_open (job->board_id)) == NULL)
+        goto out;
+
+    if (!efuse_ctx_set_path (ctx, job->rw_control, job->rw_file))
+        goto out_close;
+    if (ProvInit != NULL)
+        ProvInit (ProvInitArg, ctx);
+
+    job->wv_status = efuse_ctx_write_verify (ctx, job->uuid, job->read_data);
+    if ((job->wv_status != eEFUSE_WV_WRITTEN) && (job->wv_status != eEFUSE_WV_UNCHANGED))
+        goto out_close;
+
+    job->status = efuse_ctx_valid_check (ctx, job->read_data);
+
+out_close:
+    efuse_ctx_close (ctx);
+out:
+    job->elapsed_us = time_us () - start;
+}
+
+//------------------------------------------------------------------------------
+static void *prov_worker (void *arg)
+{
+    struct prov_pool *pool = (struct prov_pool *)arg;
+    int idx;
+
+    while (1) {
+        pthread_mutex_lock (&pool->mutex);
+        idx = pool->next_job++;
+        pthread_mutex_unlock (&pool->mutex);
+
+        if (idx >= pool->job_cnt)
+            break;
+        prov_job_exec (&pool->jobs[idx]);
+    }
+    return NULL;
+}
+
+//------------------------------------------------------------------------------
+int efuse_prov_job_init (struct efuse_prov_job *job, int board_id,
+                         const char *rw_control, const char *rw_file,
+                         const char *uuid)
+{
+    memset (job, 0, sizeof(struct efuse_prov_job));
+
+    if ((uuid == NULL) || (strlen (uuid) != EFUSE_UUID_SIZE)) {
+        dbg_msg ("error, uuid size != %d\n", EFUSE_UUID_SIZE);
+        return 0;
+    }
+    job->board_id   = board_id;
+    job->rw_control = rw_control;
+    job->rw_file    = rw_file;
+    memcpy (job->uuid, uuid, EFUSE_UUID_SIZE);
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+// job list를 worker_cnt개의 thread로 처리. 모든 job이 끝나면 return.
+// return : 성공한 job 개수.
+//------------------------------------------------------------------------------
+int efuse_prov_run (struct efuse_prov_job *jobs, int job_cnt,
+                    int worker_cnt, struct efuse_prov_report *report)
+{
+    pthread_t threads [PROV_WORKER_MAX];
+    struct prov_pool pool;
+    long start = time_us ();
+    int i, started, ok_cnt = 0;
+
+    if ((jobs == NULL) || (job_cnt <= 0))
+        return 0;
+
+    if (worker_cnt > job_cnt)           worker_cnt = job_cnt;
+    if (worker_cnt > PROV_WORKER_MAX)   worker_cnt = PROV_WORKER_MAX;
+    if (worker_cnt < 1)                 worker_cnt = 1;
+
+    pool.jobs     = jobs;
+    pool.job_cnt  = job_cnt;
+    pool.next_job = 0;
+    pthread_mutex_init (&pool.mutex, NULL);
+
+    for (i = 0, started = 0; i < worker_cnt; i++) {
+        if (pthread_create (&threads[started], NULL, prov_worker, &pool)) {
+            dbg_msg ("error, worker thread create. (%d)\n", i);
+            continue;
+        }
+        started++;
+    }
+    // thread 생성 실패시 현재 thread에서 남은 job 처리.
+    if (!started)
+        prov_worker (&pool);
+
+    for (i = 0; i < started; i++)
+        pthread_join (threads[i], NULL);
+
+    pthread_mutex_destroy (&pool.mutex);
+
+    if (report != NULL)
+        memset (report, 0, sizeof(struct efuse_prov_report));
+
+    for (i = 0; i < job_cnt; i++) {
+        if (jobs[i].status)
+            ok_cnt++;
+        if ((report != NULL) && (jobs[i].elapsed_us > report->max_job_us))
+            report->max_job_us = jobs[i].elapsed_us;
+    }
+    if (report != NULL) {
+        report->job_cnt  = job_cnt;
+        report->ok_cnt   = ok_cnt;
+        report->fail_cnt = job_cnt - ok_cnt;
+        report->wall_us  = time_us () - start;
+    }
+    return ok_cnt;
+}
+
+//------------------------------------------------------------------------------
+// job context 생성시 호출 (device path 설정 후, worker thread). efuse_prov_run() 전에 설정.
+//------------------------------------------------------------------------------
+void efuse_prov_set_ctx_init (efuse_ctx_init_cb cb, void *arg)
+{
+    ProvInit    = cb;
+    ProvInitArg = arg;
+}
+
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
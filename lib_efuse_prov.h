@@ -0,0 +1,63 @@
+//------------------------------------------------------------------------------
+/**
+ * @file lib_efuse_prov.h
+ * @author charles-park (charles.park@hardkernel.com)
+ * @brief efuse multi-device provisioning engine.
+ * @version 0.2
+ * @date 2023-09-22
+ *
+ * @package apt install cups cups-bsd
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#ifndef __LIB_EFUSE_PROV_H__
+#define __LIB_EFUSE_PROV_H__
+
+//------------------------------------------------------------------------------
+#include "lib_efuse.h"
+
+//------------------------------------------------------------------------------
+#define PROV_WORKER_MAX     32
+
+//------------------------------------------------------------------------------
+// provisioning job. rw_control/rw_file이 NULL이면 board 기본 device 사용.
+// 같은 device를 사용하는 job을 하나의 list에 중복하여 넣으면 안됨.
+//------------------------------------------------------------------------------
+struct efuse_prov_job {
+    // input
+    int         board_id;
+    const char  *rw_control;
+    const char  *rw_file;
+    char        uuid [EFUSE_UUID_SIZE +1];
+
+    // result
+    int         status;         // 1 = write/verify success, 0 = fail
+    int         wv_status;      // eEFUSE_WV_xxx
+    char        read_data [EFUSE_UUID_SIZE +1];
+    long        elapsed_us;
+};
+
+struct efuse_prov_report {
+    int         job_cnt;
+    int         ok_cnt;
+    int         fail_cnt;
+    long        wall_us;        // 전체 job 처리 시간
+    long        max_job_us;     // 가장 오래 걸린 job 시간
+};
+
+//------------------------------------------------------------------------------
+//	function prototype
+//------------------------------------------------------------------------------
+extern int  efuse_prov_job_init (struct efuse_prov_job *job, int board_id,
+                                 const char *rw_control, const char *rw_file,
+                                 const char *uuid);
+extern int  efuse_prov_run      (struct efuse_prov_job *jobs, int job_cnt,
+                                 int worker_cnt, struct efuse_prov_report *report);
+extern void efuse_prov_set_ctx_init (efuse_ctx_init_cb cb, void *arg);
+
+//------------------------------------------------------------------------------
+#endif  // #ifndef __LIB_EFUSE_PROV_H__
+//------------------------------------------------------------------------------
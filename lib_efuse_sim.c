@@ -0,0 +1,712 @@
+//------------------------------------------------------------------------------
+/**
+ * @file lib_efuse_sim.c
+ * @author charles-park (charles.park@hardkernel.com)
+ * @brief efuse device simulator (in-memory / file-backed I/O backend).
+ * @version 0.2
+ * @date 2023-09-22
+ *
+ * @package apt install cups cups-bsd
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "lib_efuse.h"
+#include "lib_efuse_sim.h"
+#include "lib_efuse_board.h"
+
+//------------------------------------------------------------------------------
+// Debug msg
+//------------------------------------------------------------------------------
+#if defined (__LIB_EFUSE_APP__)
+    #define dbg_msg(fmt, args...)   printf(fmt, ##args)
+#else
+    #define dbg_msg(fmt, args...)
+#endif
+
+//------------------------------------------------------------------------------
+#define SIM_DEV_MAX     32
+#define SIM_FD_MAX      256
+#define SIM_FD_BASE     0x4000  // 실제 fd와 구분하기 위한 가상 fd 시작값
+
+// uuid flash slot pattern (slot 32bytes)
+#define SIM_SLOT_EMPTY  0x00
+#define SIM_SLOT_ERASED 0xFF
+
+//------------------------------------------------------------------------------
+// device memory layout
+//   eSIM_DEV_IOCTL : uuid flash (UUID_FLASH_SIZE)
+//   eSIM_DEV_EMMC  : boot partition (SIM_EMMC_BOOT_SIZE) + force_ro(1byte)
+//   eSIM_DEV_SYSFS : uuid (EFUSE_UUID_SIZE)
+//------------------------------------------------------------------------------
+struct sim_dev {
+    int             type;
+    char            rw_control  [PATH_MAX];
+    char            rw_file     [PATH_MAX];
+
+    unsigned char   *mem;
+    size_t          mem_size;
+    unsigned char   *force_ro;
+    pthread_mutex_t mutex;
+};
+
+struct sim_fd {
+    struct sim_dev  *dev;
+    int             is_control;
+};
+
+struct efuse_sim {
+    struct efuse_io io;
+    char            backing_dir [PATH_MAX];
+
+    struct sim_dev  *devs [SIM_DEV_MAX];
+    int             dev_cnt;
+
+    struct sim_fd   fds [SIM_FD_MAX];
+    pthread_mutex_t mutex;
+
+    long            latency_us  [eSIM_OP_END];
+    long            count       [eSIM_OP_END];
+
+    // fault injection (efuse_sim_set_fault)
+    int             fault_cnt   [eSIM_OP_END];
+    int             fault_errno [eSIM_OP_END];
+
+    int             dump_mode;  // eSIM_DUMP_xxx
+};
+
+//------------------------------------------------------------------------------
+// function prototype
+//------------------------------------------------------------------------------
+static int   sim_op         (efuse_sim *sim, int op);
+static unsigned char sim_cksum (const unsigned char *data);
+static int   sim_slot_state (const unsigned char *slot);
+static void *sim_mem_alloc  (efuse_sim *sim, const char *name, size_t size);
+static struct sim_dev *sim_find (efuse_sim *sim, const char *path, int *is_control);
+static struct sim_fd  *sim_fd   (efuse_sim *sim, int fd);
+static ssize_t sim_uuid_read (struct sim_dev *dev, void *buf, size_t size, off_t offset);
+static int   sim_ioctl_dev  (struct sim_dev *dev, int dump_mode, unsigned long request, void *arg);
+
+static int     sim_access   (void *priv, const char *path);
+static int     sim_open     (void *priv, const char *path, int flags);
+static int     sim_close    (void *priv, int fd);
+static ssize_t sim_pread    (void *priv, int fd, void *buf, size_t size, off_t offset);
+static ssize_t sim_pwrite   (void *priv, int fd, const void *buf, size_t size, off_t offset);
+static int     sim_ioctl    (void *priv, int fd, unsigned long request, void *arg);
+static int     sim_fdatasync(void *priv, int fd);
+
+efuse_sim *efuse_sim_create     (const char *backing_dir);
+void  efuse_sim_destroy         (efuse_sim *sim);
+int   efuse_sim_add_device      (efuse_sim *sim, int dev_type,
+                                 const char *rw_control, const char *rw_file);
+int   efuse_sim_attach          (efuse_sim *sim, efuse_ctx *ctx);
+int   efuse_sim_dev_type        (int board_id);
+const struct efuse_io *efuse_sim_io (efuse_sim *sim);
+void  efuse_sim_set_latency     (efuse_sim *sim, int op, long usec);
+void  efuse_sim_set_fault       (efuse_sim *sim, int op, int cnt, int errnum);
+void  efuse_sim_set_dump        (efuse_sim *sim, int mode);
+long  efuse_sim_get_count       (efuse_sim *sim, int op);
+void  efuse_sim_reset_count     (efuse_sim *sim);
+void  efuse_sim_format          (efuse_sim *sim);
+
+//------------------------------------------------------------------------------
+// operation count 증가 및 설정된 latency 만큼 대기.
+// return : 0 = 정상, -1 = fault injection (errno 설정)
+//------------------------------------------------------------------------------
+static int sim_op (efuse_sim *sim, int op)
+{
+    long usec = __atomic_load_n (&sim->latency_us[op], __ATOMIC_RELAXED);
+    int cnt;
+
+    __atomic_fetch_add (&sim->count[op], 1, __ATOMIC_RELAXED);
+    if (usec > 0) {
+        struct timespec ts = { usec / 1000000L, (usec % 1000000L) * 1000L };
+
+        while (nanosleep (&ts, &ts) && (errno == EINTR))
+            ;
+    }
+
+    // fault_cnt : -1 = 항상 실패, n = 다음 n회 실패
+    cnt = __atomic_load_n (&sim->fault_cnt[op], __ATOMIC_RELAXED);
+    while (cnt) {
+        if ((cnt < 0) || __atomic_compare_exchange_n (&sim->fault_cnt[op], &cnt, cnt - 1,
+                                0, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            errno = __atomic_load_n (&sim->fault_errno[op], __ATOMIC_RELAXED);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+static unsigned char sim_cksum (const unsigned char *data)
+{
+    unsigned char sum = 0;
+    int i;
+
+    for (i = 0; i < UUID_WRITE_SIZE; i++)
+        sum += data [i];
+
+    return sum;
+}
+
+//------------------------------------------------------------------------------
+// return : SIM_SLOT_EMPTY, SIM_SLOT_ERASED, 1 = valid data
+//------------------------------------------------------------------------------
+static int sim_slot_state (const unsigned char *slot)
+{
+    int i, empty = 1, erased = 1;
+
+    for (i = 0; i < UUID_WRITE_SIZE; i++) {
+        if (slot[i] != SIM_SLOT_EMPTY)  empty  = 0;
+        if (slot[i] != SIM_SLOT_ERASED) erased = 0;
+    }
+    if (empty)  return SIM_SLOT_EMPTY;
+    if (erased) return SIM_SLOT_ERASED;
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+// backing_dir가 있으면 device memory를 file에 mmap (process 재시작후 유지).
+//------------------------------------------------------------------------------
+static void *sim_mem_alloc (efuse_sim *sim, const char *name, size_t size)
+{
+    char path [PATH_MAX], *p;
+    void *mem;
+    int fd, len;
+
+    if (!sim->backing_dir[0])
+        return calloc (1, size);
+
+    len = snprintf (path, sizeof(path), "%s/%s.img", sim->backing_dir, name);
+    if ((len < 0) || (len >= (int)sizeof(path)))
+        return NULL;
+
+    // device path의 '/'를 '_'로 변경하여 file 이름으로 사용.
+    for (p = path + strlen (sim->backing_dir) + 1; *p; p++)
+        if (*p == '/')  *p = '_';
+
+    if ((fd = open (path, O_RDWR | O_CREAT | O_CLOEXEC, 0644)) < 0) {
+        dbg_msg ("error, sim backing file open (%s)\n", path);
+        return NULL;
+    }
+    if (ftruncate (fd, size) < 0) {
+        close (fd);
+        return NULL;
+    }
+    mem = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close (fd);
+    return (mem == MAP_FAILED) ? NULL : mem;
+}
+
+//------------------------------------------------------------------------------
+// sim->devs/dev_cnt는 efuse_sim_add_device에서 변경되므로 sim->mutex lock 후 호출.
+//------------------------------------------------------------------------------
+static struct sim_dev *sim_find (efuse_sim *sim, const char *path, int *is_control)
+{
+    int i;
+
+    for (i = 0; i < sim->dev_cnt; i++) {
+        if (!strcmp (sim->devs[i]->rw_control, path)) {
+            *is_control = 1;
+            return sim->devs[i];
+        }
+        if (!strcmp (sim->devs[i]->rw_file, path)) {
+            *is_control = 0;
+            return sim->devs[i];
+        }
+    }
+    return NULL;
+}
+
+//------------------------------------------------------------------------------
+static struct sim_fd *sim_fd (efuse_sim *sim, int fd)
+{
+    fd -= SIM_FD_BASE;
+    if ((fd < 0) || (fd >= SIM_FD_MAX) || (sim->fds[fd].dev == NULL)) {
+        errno = EBADF;
+        return NULL;
+    }
+    return &sim->fds[fd];
+}
+
+//------------------------------------------------------------------------------
+// /sys/class/efuse/uuid read. 마지막 valid slot을 uuid 형식(8-4-4-4-12)으로 변환.
+//------------------------------------------------------------------------------
+static ssize_t sim_uuid_read (struct sim_dev *dev, void *buf, size_t size, off_t offset)
+{
+    const unsigned char *slot = NULL;
+    char uuid [EFUSE_UUID_SIZE];
+    int i, s, cnt;
+
+    for (s = 0; s < UUID_FLASH_SIZE; s += UUID_WRITE_SIZE)
+        if (sim_slot_state (&dev->mem[s]) == 1)
+            slot = &dev->mem[s];
+
+    for (i = 0, cnt = 0; i < EFUSE_UUID_SIZE; i++) {
+        if ((i == 8) || (i == 13) || (i == 18) || (i == 23))
+            uuid[i] = '-';
+        else
+            uuid[i] = (slot != NULL) ? slot[cnt++] : '0';
+    }
+    if (offset >= EFUSE_UUID_SIZE)
+        return 0;
+    if (size > (size_t)(EFUSE_UUID_SIZE - offset))
+        size = EFUSE_UUID_SIZE - offset;
+    memcpy (buf, &uuid[offset], size);
+    return size;
+}
+
+//------------------------------------------------------------------------------
+// /dev/efuse ioctl. slot은 empty 상태에서만 write 가능 (erase후 재사용 불가).
+// dump_mode : IOC_DUMP 응답 (write/erase는 항상 실제 flash 상태 기준)
+//------------------------------------------------------------------------------
+static int sim_ioctl_dev (struct sim_dev *dev, int dump_mode, unsigned long request, void *arg)
+{
+    struct ioc_data *data = (struct ioc_data *)arg;
+    int offset = data->offset, len = data->len;
+
+    switch (request) {
+        case IOC_WRITE:
+            if (memcmp (data->mstr, IOC_MSTR_WRITE_M1, 4) &&
+                memcmp (data->mstr, IOC_MSTR_WRITE_C4, 4))
+                break;
+            if ((len != UUID_WRITE_SIZE) || (offset < 0) ||
+                (offset >= UUID_FLASH_SIZE) || (offset % UUID_WRITE_SIZE))
+                break;
+            if (sim_cksum ((unsigned char *)data->uuid) != data->cksum)
+                break;
+            if (sim_slot_state (&dev->mem[offset]) != SIM_SLOT_EMPTY)
+                break;
+            memcpy (&dev->mem[offset], data->uuid, UUID_WRITE_SIZE);
+            return 0;
+
+        case IOC_ERASE:
+            if ((offset < 0) || (offset >= UUID_FLASH_SIZE) || (offset % UUID_WRITE_SIZE))
+                break;
+            memset (&dev->mem[offset], SIM_SLOT_ERASED, UUID_WRITE_SIZE);
+            return 0;
+
+        case IOC_DUMP:
+            // ioc_data header 뒤의 buffer에 flash[offset .. offset+len] 복사.
+            if (memcmp (data->mstr, IOC_MSTR_DUMP, 4) || (offset < 0) ||
+                (len <= 0) || (offset + len > UUID_FLASH_SIZE))
+                break;
+            switch (dump_mode) {
+                case eSIM_DUMP_NONE:
+                    errno = ENOTTY;
+                    return -1;
+                case eSIM_DUMP_ZERO:
+                    break;
+                case eSIM_DUMP_ERASED:
+                    memset (data->uuid, SIM_SLOT_ERASED, len);
+                    break;
+                default :
+                    memcpy (data->uuid, &dev->mem[offset], len);
+                    break;
+            }
+            return 0;
+
+        default :
+            errno = ENOTTY;
+            return -1;
+    }
+    errno = EIO;
+    return -1;
+}
+
+//------------------------------------------------------------------------------
+static int sim_access (void *priv, const char *path)
+{
+    efuse_sim *sim = (efuse_sim *)priv;
+    struct sim_dev *dev;
+    int is_control;
+
+    if (sim_op (sim, eSIM_OP_ACCESS))
+        return -1;
+    pthread_mutex_lock (&sim->mutex);
+    dev = sim_find (sim, path, &is_control);
+    pthread_mutex_unlock (&sim->mutex);
+    if (dev == NULL) {
+        errno = ENOENT;
+        return -1;
+    }
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+static int sim_open (void *priv, const char *path, int flags)
+{
+    efuse_sim *sim = (efuse_sim *)priv;
+    struct sim_dev *dev;
+    int i, is_control;
+
+    (void)flags;
+    if (sim_op (sim, eSIM_OP_OPEN))
+        return -1;
+    pthread_mutex_lock (&sim->mutex);
+    if ((dev = sim_find (sim, path, &is_control)) == NULL) {
+        pthread_mutex_unlock (&sim->mutex);
+        errno = ENOENT;
+        return -1;
+    }
+    for (i = 0; i < SIM_FD_MAX; i++) {
+        if (sim->fds[i].dev == NULL) {
+            sim->fds[i].dev        = dev;
+            sim->fds[i].is_control = is_control;
+            break;
+        }
+    }
+    pthread_mutex_unlock (&sim->mutex);
+
+    if (i == SIM_FD_MAX) {
+        errno = EMFILE;
+        return -1;
+    }
+    return SIM_FD_BASE + i;
+}
+
+//------------------------------------------------------------------------------
+static int sim_close (void *priv, int fd)
+{
+    efuse_sim *sim = (efuse_sim *)priv;
+    struct sim_fd *f;
+    int fault, err;
+
+    // close(2)와 같이 error를 return 하는 경우에도 descriptor는 해제.
+    fault = sim_op (sim, eSIM_OP_CLOSE);
+    err   = errno;
+    pthread_mutex_lock (&sim->mutex);
+    if ((f = sim_fd (sim, fd)) != NULL)
+        f->dev = NULL;
+    pthread_mutex_unlock (&sim->mutex);
+    if (fault)
+        errno = err;
+    return ((f != NULL) && !fault) ? 0 : -1;
+}
+
+//------------------------------------------------------------------------------
+static ssize_t sim_pread (void *priv, int fd, void *buf, size_t size, off_t offset)
+{
+    efuse_sim *sim = (efuse_sim *)priv;
+    struct sim_fd *f;
+    struct sim_dev *dev;
+    ssize_t ret = -1;
+
+    if (sim_op (sim, eSIM_OP_PREAD))
+        return -1;
+    if ((f = sim_fd (sim, fd)) == NULL)
+        return -1;
+
+    dev = f->dev;
+    pthread_mutex_lock (&dev->mutex);
+    if (f->is_control) {
+        if (dev->type == eSIM_DEV_EMMC) {
+            char ro [2] = { *dev->force_ro ? '1' : '0', '\n' };
+
+            ret = (offset < 2) ? ((size > (size_t)(2 - offset)) ? 2 - offset : (ssize_t)size) : 0;
+            memcpy (buf, &ro[offset < 2 ? offset : 0], ret);
+        } else
+            errno = EINVAL;
+    } else if (dev->type == eSIM_DEV_IOCTL) {
+        ret = sim_uuid_read (dev, buf, size, offset);
+    } else {
+        if (offset >= (off_t)dev->mem_size)
+            ret = 0;
+        else {
+            ret = (size > dev->mem_size - offset) ? (ssize_t)(dev->mem_size - offset) : (ssize_t)size;
+            memcpy (buf, &dev->mem[offset], ret);
+        }
+    }
+    pthread_mutex_unlock (&dev->mutex);
+    return ret;
+}
+
+//------------------------------------------------------------------------------
+static ssize_t sim_pwrite (void *priv, int fd, const void *buf, size_t size, off_t offset)
+{
+    efuse_sim *sim = (efuse_sim *)priv;
+    struct sim_fd *f;
+    struct sim_dev *dev;
+    ssize_t ret = -1;
+
+    if (sim_op (sim, eSIM_OP_PWRITE))
+        return -1;
+    if ((f = sim_fd (sim, fd)) == NULL)
+        return -1;
+
+    dev = f->dev;
+    pthread_mutex_lock (&dev->mutex);
+    if (f->is_control) {
+        // force_ro : "0" = unlock, "1" = lock
+        if ((dev->type == eSIM_DEV_EMMC) && size && ((*(char *)buf == '0') || (*(char *)buf == '1'))) {
+            *dev->force_ro = (*(char *)buf == '1');
+            ret = size;
+        } else
+            errno = EINVAL;
+    } else if (dev->type == eSIM_DEV_IOCTL) {
+        errno = EPERM;
+    } else if ((dev->type == eSIM_DEV_EMMC) && *dev->force_ro) {
+        errno = EPERM;
+    } else if (offset + size > dev->mem_size) {
+        errno = ENOSPC;
+    } else {
+        memcpy (&dev->mem[offset], buf, size);
+        ret = size;
+    }
+    pthread_mutex_unlock (&dev->mutex);
+    return ret;
+}
+
+//------------------------------------------------------------------------------
+static int sim_ioctl (void *priv, int fd, unsigned long request, void *arg)
+{
+    efuse_sim *sim = (efuse_sim *)priv;
+    struct sim_fd *f;
+    int ret = -1;
+
+    if (sim_op (sim, eSIM_OP_IOCTL))
+        return -1;
+    if ((f = sim_fd (sim, fd)) == NULL)
+        return -1;
+
+    if (!f->is_control || (f->dev->type != eSIM_DEV_IOCTL)) {
+        errno = ENOTTY;
+        return -1;
+    }
+    pthread_mutex_lock (&f->dev->mutex);
+    ret = sim_ioctl_dev (f->dev, __atomic_load_n (&sim->dump_mode, __ATOMIC_RELAXED),
+                         request, arg);
+    pthread_mutex_unlock (&f->dev->mutex);
+    return ret;
+}
+
+//------------------------------------------------------------------------------
+// file-backed device는 mmap(MAP_SHARED) 이므로 별도 sync 동작 없음.
+//------------------------------------------------------------------------------
+static int sim_fdatasync (void *priv, int fd)
+{
+    efuse_sim *sim = (efuse_sim *)priv;
+
+    if (sim_op (sim, eSIM_OP_SYNC))
+        return -1;
+    return (sim_fd (sim, fd) != NULL) ? 0 : -1;
+}
+
+//------------------------------------------------------------------------------
+// backing_dir : NULL이면 in-memory, 아니면 해당 directory에 device image 생성.
+//------------------------------------------------------------------------------
+efuse_sim *efuse_sim_create (const char *backing_dir)
+{
+    efuse_sim *sim = calloc (1, sizeof(efuse_sim));
+
+    if (sim == NULL)
+        return NULL;
+
+    if (backing_dir != NULL) {
+        if (strlen (backing_dir) >= sizeof(sim->backing_dir)) {
+            free (sim);
+            return NULL;
+        }
+        strcpy (sim->backing_dir, backing_dir);
+    }
+    pthread_mutex_init (&sim->mutex, NULL);
+
+    sim->io.name   = sim->backing_dir[0] ? "sim-file" : "sim-memory";
+    sim->io.priv   = sim;
+    sim->io.access = sim_access;
+    sim->io.open   = sim_open;
+    sim->io.close  = sim_close;
+    sim->io.pread  = sim_pread;
+    sim->io.pwrite = sim_pwrite;
+    sim->io.ioctl  = sim_ioctl;
+    sim->io.fdatasync = sim_fdatasync;
+    return sim;
+}
+
+//------------------------------------------------------------------------------
+void efuse_sim_destroy (efuse_sim *sim)
+{
+    struct sim_dev *dev;
+    int i;
+
+    if (sim == NULL)
+        return;
+
+    for (i = 0; i < sim->dev_cnt; i++) {
+        dev = sim->devs[i];
+        if (sim->backing_dir[0])
+            munmap (dev->mem, dev->mem_size + 1);
+        else
+            free (dev->mem);
+        pthread_mutex_destroy (&dev->mutex);
+        free (dev);
+    }
+    pthread_mutex_destroy (&sim->mutex);
+    free (sim);
+}
+
+//------------------------------------------------------------------------------
+// simulation device 추가. 이미 등록된 path이면 기존 device 사용.
+//------------------------------------------------------------------------------
+int efuse_sim_add_device (efuse_sim *sim, int dev_type,
+                          const char *rw_control, const char *rw_file)
+{
+    struct sim_dev *dev;
+    int is_control;
+
+    if ((dev_type < 0) || (dev_type >= eSIM_DEV_END))
+        return 0;
+    if ((strlen (rw_control) >= PATH_MAX) || (strlen (rw_file) >= PATH_MAX))
+        return 0;
+
+    pthread_mutex_lock (&sim->mutex);
+    if ((dev = sim_find (sim, rw_file, &is_control)) != NULL) {
+        pthread_mutex_unlock (&sim->mutex);
+        return (dev->type == dev_type) ? 1 : 0;
+    }
+    if ((sim->dev_cnt >= SIM_DEV_MAX) || ((dev = calloc (1, sizeof(struct sim_dev))) == NULL)) {
+        pthread_mutex_unlock (&sim->mutex);
+        return 0;
+    }
+    dev->type = dev_type;
+    strcpy (dev->rw_control, rw_control);
+    strcpy (dev->rw_file,    rw_file);
+
+    switch (dev_type) {
+        case eSIM_DEV_IOCTL:    dev->mem_size = UUID_FLASH_SIZE;    break;
+        case eSIM_DEV_EMMC:     dev->mem_size = SIM_EMMC_BOOT_SIZE; break;
+        default :               dev->mem_size = EFUSE_UUID_SIZE;    break;
+    }
+    // mem 마지막 1byte는 force_ro 상태 (기본 lock)
+    if ((dev->mem = sim_mem_alloc (sim, rw_file, dev->mem_size + 1)) == NULL) {
+        pthread_mutex_unlock (&sim->mutex);
+        free (dev);
+        return 0;
+    }
+    dev->force_ro = &dev->mem[dev->mem_size];
+    if (dev_type == eSIM_DEV_EMMC)
+        *dev->force_ro = 1;
+
+    pthread_mutex_init (&dev->mutex, NULL);
+    sim->devs[sim->dev_cnt++] = dev;
+    pthread_mutex_unlock (&sim->mutex);
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+// board의 efuse device 종류 (lib_efuse_board.c) -> simulation device 종류.
+//------------------------------------------------------------------------------
+int efuse_sim_dev_type (int board_id)
+{
+    const struct efuse_board *board = efuse_board_info (board_id);
+
+    switch (board ? board->dev_type : eBOARD_DEV_SYSFS) {
+        case eBOARD_DEV_IOCTL:  return eSIM_DEV_IOCTL;
+        case eBOARD_DEV_EMMC:   return eSIM_DEV_EMMC;
+        default :               return eSIM_DEV_SYSFS;
+    }
+}
+
+//------------------------------------------------------------------------------
+// ctx의 board/device path로 simulation device를 등록하고 ctx backend를 sim으로 변경.
+//------------------------------------------------------------------------------
+int efuse_sim_attach (efuse_sim *sim, efuse_ctx *ctx)
+{
+    const char *rw_control, *rw_file;
+
+    efuse_ctx_get_path (ctx, &rw_control, &rw_file);
+    if (!efuse_sim_add_device (sim, efuse_sim_dev_type (efuse_ctx_get_board (ctx)),
+                               rw_control, rw_file))
+        return 0;
+
+    return efuse_ctx_set_io (ctx, &sim->io);
+}
+
+//------------------------------------------------------------------------------
+const struct efuse_io *efuse_sim_io (efuse_sim *sim)
+{
+    return &sim->io;
+}
+
+//------------------------------------------------------------------------------
+void efuse_sim_set_latency (efuse_sim *sim, int op, long usec)
+{
+    if ((op >= 0) && (op < eSIM_OP_END))
+        __atomic_store_n (&sim->latency_us[op], usec, __ATOMIC_RELAXED);
+}
+
+//------------------------------------------------------------------------------
+// operation fault injection. cnt : 실패 횟수 (-1 = 해제 전까지 항상, 0 = 해제)
+// errnum : 실패시 errno (e.g. EIO, ENOENT)
+//------------------------------------------------------------------------------
+void efuse_sim_set_fault (efuse_sim *sim, int op, int cnt, int errnum)
+{
+    if ((op < 0) || (op >= eSIM_OP_END))
+        return;
+    __atomic_store_n (&sim->fault_errno[op], errnum, __ATOMIC_RELAXED);
+    __atomic_store_n (&sim->fault_cnt[op],   cnt,    __ATOMIC_RELAXED);
+}
+
+//------------------------------------------------------------------------------
+// IOC_DUMP 응답 변경 (eSIM_DUMP_xxx). slot scan을 믿지 않는 경우의 test 용도.
+//------------------------------------------------------------------------------
+void efuse_sim_set_dump (efuse_sim *sim, int mode)
+{
+    if ((mode >= 0) && (mode < eSIM_DUMP_END))
+        __atomic_store_n (&sim->dump_mode, mode, __ATOMIC_RELAXED);
+}
+
+//------------------------------------------------------------------------------
+long efuse_sim_get_count (efuse_sim *sim, int op)
+{
+    if ((op < 0) || (op >= eSIM_OP_END))
+        return 0;
+    return __atomic_load_n (&sim->count[op], __ATOMIC_RELAXED);
+}
+
+//------------------------------------------------------------------------------
+void efuse_sim_reset_count (efuse_sim *sim)
+{
+    int i;
+
+    for (i = 0; i < eSIM_OP_END; i++)
+        __atomic_store_n (&sim->count[i], 0, __ATOMIC_RELAXED);
+}
+
+//------------------------------------------------------------------------------
+// 모든 device를 새 부품 상태로 초기화 (uuid flash empty, force_ro lock).
+//------------------------------------------------------------------------------
+void efuse_sim_format (efuse_sim *sim)
+{
+    struct sim_dev *dev;
+    int i;
+
+    pthread_mutex_lock (&sim->mutex);
+    for (i = 0; i < sim->dev_cnt; i++) {
+        dev = sim->devs[i];
+        pthread_mutex_lock (&dev->mutex);
+        memset (dev->mem, 0, dev->mem_size);
+        *dev->force_ro = (dev->type == eSIM_DEV_EMMC);
+        pthread_mutex_unlock (&dev->mutex);
+    }
+    pthread_mutex_unlock (&sim->mutex);
+}
+
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
@@ -0,0 +1,78 @@
+//------------------------------------------------------------------------------
+/**
+ * @file lib_efuse_sim.h
+ * @author charles-park (charles.park@hardkernel.com)
+ * @brief efuse device simulator (in-memory / file-backed I/O backend).
+ * @version 0.2
+ * @date 2023-09-22
+ *
+ * @package apt install cups cups-bsd
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#ifndef __LIB_EFUSE_SIM_H__
+#define __LIB_EFUSE_SIM_H__
+
+//------------------------------------------------------------------------------
+#include "lib_efuse.h"
+
+//------------------------------------------------------------------------------
+// simulation device type
+//------------------------------------------------------------------------------
+enum {
+    eSIM_DEV_IOCTL = 0, // m1, c4 : /dev/efuse ioctl + /sys/class/efuse/uuid read
+    eSIM_DEV_EMMC,      // m1s, m2 : force_ro + mmcblk boot partition
+    eSIM_DEV_SYSFS,     // c5 : /sys/class/efuse/uuid read/write
+    eSIM_DEV_END
+};
+
+// latency/count 대상 operation
+enum {
+    eSIM_OP_ACCESS = 0,
+    eSIM_OP_OPEN,
+    eSIM_OP_CLOSE,
+    eSIM_OP_PREAD,
+    eSIM_OP_PWRITE,
+    eSIM_OP_IOCTL,
+    eSIM_OP_SYNC,
+    eSIM_OP_END
+};
+
+// IOC_DUMP 응답 (efuse_sim_set_dump). flash 내용과 다른 dump를 돌려주는 kernel 재현.
+enum {
+    eSIM_DUMP_FLASH = 0,    // flash 내용 그대로 (기본)
+    eSIM_DUMP_NONE,         // IOC_DUMP 미지원 (ENOTTY)
+    eSIM_DUMP_ZERO,         // 성공 return, buffer는 채우지 않음
+    eSIM_DUMP_ERASED,       // 모든 byte 0xFF (blank가 0xFF로 읽히는 flash)
+    eSIM_DUMP_END
+};
+
+// emmc boot partition size (4MB)
+#define SIM_EMMC_BOOT_SIZE  (4096 * 1024)
+
+//------------------------------------------------------------------------------
+typedef struct efuse_sim efuse_sim;
+
+//------------------------------------------------------------------------------
+//	function prototype
+//------------------------------------------------------------------------------
+extern efuse_sim *efuse_sim_create      (const char *backing_dir);
+extern void  efuse_sim_destroy          (efuse_sim *sim);
+extern int   efuse_sim_add_device       (efuse_sim *sim, int dev_type,
+                                         const char *rw_control, const char *rw_file);
+extern int   efuse_sim_attach           (efuse_sim *sim, efuse_ctx *ctx);
+extern int   efuse_sim_dev_type         (int board_id);
+extern const struct efuse_io *efuse_sim_io (efuse_sim *sim);
+extern void  efuse_sim_set_latency      (efuse_sim *sim, int op, long usec);
+extern void  efuse_sim_set_fault        (efuse_sim *sim, int op, int cnt, int errnum);
+extern void  efuse_sim_set_dump         (efuse_sim *sim, int mode);
+extern long  efuse_sim_get_count        (efuse_sim *sim, int op);
+extern void  efuse_sim_reset_count      (efuse_sim *sim);
+extern void  efuse_sim_format           (efuse_sim *sim);
+
+//------------------------------------------------------------------------------
+#endif  // #ifndef __LIB_EFUSE_SIM_H__
+//------------------------------------------------------------------------------
@@ -0,0 +1,673 @@
+//------------------------------------------------------------------------------
+/**
+ * @file lib_efuse_trace.c
+ * @author charles-park (charles.park@hardkernel.com)
+ * @brief efuse device operation trace record / replay (simulation device).
+ * @version 0.2
+ * @date 2023-09-22
+ *
+ * @package apt install cups cups-bsd
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "lib_efuse.h"
+#include "lib_efuse_sim.h"
+#include "lib_efuse_trace.h"
+
+//------------------------------------------------------------------------------
+// Debug msg
+//------------------------------------------------------------------------------
+#if defined (__LIB_EFUSE_APP__)
+    #define dbg_msg(fmt, args...)   printf(fmt, ##args)
+#else
+    #define dbg_msg(fmt, args...)
+#endif
+
+//------------------------------------------------------------------------------
+#define TRACE_MAGIC     0x52544645  // "EFTR"
+#define TRACE_VERSION   1
+#define TRACE_BUF_SIZE  (64 * 1024)
+
+// record type (1 byte) + record
+#define TRACE_REC_DEV   'D'
+#define TRACE_REC_OP    'O'
+
+// replay시 open된 fd 최대 개수
+#define TRACE_FD_MAX    256
+
+// replay 시작 시간 맞춤시 sleep 대신 busy wait 하는 구간
+#define TRACE_SLACK_NS  100000
+
+struct trace_hdr {
+    unsigned int        magic;
+    unsigned int        version;
+    long long           start;      // unix time (sec)
+};
+
+// device record. 뒤에 rw_control, rw_file ('\0' 포함)
+struct trace_dev_rec {
+    unsigned char       dev;
+    unsigned char       dev_type;   // eSIM_DEV_xxx
+    unsigned short      control_len;
+    unsigned short      file_len;
+};
+
+// attach된 ctx별 backend
+struct trace_io {
+    struct efuse_io     io;
+    efuse_trace         *trace;
+    const struct efuse_io *inner;
+    int                 dev;
+    char                rw_control  [PATH_MAX];
+    char                rw_file     [PATH_MAX];
+    struct trace_io     *next;
+};
+
+struct efuse_trace {
+    FILE                *fp;
+    pthread_mutex_t     mutex;
+    long long           t0;         // CLOCK_MONOTONIC ns
+    int                 error;
+    int                 dev_cnt;
+    unsigned int        tid_cnt;
+    struct trace_io     *ios;
+};
+
+// replay용 op (data 포함)
+struct trace_play_op {
+    struct efuse_trace_op   op;
+    unsigned char           data [TRACE_DATA_MAX];
+    long                    seq;    // 기록 순서 (정렬시 같은 시간 구분)
+};
+
+struct trace_play_dev {
+    char                rw_control  [PATH_MAX];
+    char                rw_file     [PATH_MAX];
+    int                 dev_type;
+};
+
+static const char *TraceOpName [eSIM_OP_END] = {
+    "access", "open", "close", "pread", "pwrite", "ioctl", "fdatasync"
+};
+
+// thread 구분 번호 (trace 내 순번, 0 = 미할당)
+static __thread unsigned int TraceTid;
+static unsigned int TraceTidCnt;
+
+//------------------------------------------------------------------------------
+//	function prototype
+//------------------------------------------------------------------------------
+static long long mono_ns        (void);
+static void trace_sleep_until   (long long t_ns);
+static void trace_write         (efuse_trace *t, const void *rec, size_t size,
+                                 const void *data, size_t data_len);
+static void trace_op            (struct trace_io *tio, struct efuse_trace_op *op,
+                                 long long t0, const void *data, size_t data_len);
+static int  trace_path          (const struct trace_io *tio, const char *path);
+
+static int     trace_access     (void *priv, const char *path);
+static int     trace_open       (void *priv, const char *path, int flags);
+static int     trace_close      (void *priv, int fd);
+static ssize_t trace_pread      (void *priv, int fd, void *buf, size_t size, off_t offset);
+static ssize_t trace_pwrite     (void *priv, int fd, const void *buf, size_t size, off_t offset);
+static int     trace_ioctl      (void *priv, int fd, unsigned long request, void *arg);
+static int     trace_fdatasync  (void *priv, int fd);
+
+static int  play_cmp            (const void *a, const void *b);
+static int  play_load           (FILE *fp, struct trace_play_dev *devs, int *dev_cnt,
+                                 struct trace_play_op **ops, long *op_cnt);
+static int *play_fd             (int (*fds)[2], int rec_fd, int alloc);
+static long long play_op        (const struct efuse_io *io, const struct trace_play_dev *dev,
+                                 const struct trace_play_op *p, int (*fds)[2], int *skip);
+
+efuse_trace *efuse_trace_open   (const char *path);
+int  efuse_trace_close          (efuse_trace *trace);
+int  efuse_trace_attach         (efuse_trace *trace, efuse_ctx *ctx);
+int  efuse_trace_replay         (const char *path, double speed,
+                                 struct efuse_trace_report *report);
+const char *efuse_trace_op_name (int op);
+
+//------------------------------------------------------------------------------
+static long long mono_ns (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+//------------------------------------------------------------------------------
+// timer slack (default 50us) 만큼 먼저 깨어나서 나머지는 busy wait.
+//------------------------------------------------------------------------------
+static void trace_sleep_until (long long t_ns)
+{
+    long long wake = t_ns - TRACE_SLACK_NS;
+    struct timespec ts = { wake / 1000000000LL, wake % 1000000000LL };
+
+    if (wake > mono_ns ()) {
+        while (clock_nanosleep (CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+            ;
+    }
+    while (mono_ns () < t_ns)
+        ;
+}
+
+//------------------------------------------------------------------------------
+// write 실패 후에는 기록하지 않음 (trace 실패가 device operation에 영향 없음).
+//------------------------------------------------------------------------------
+static void trace_write (efuse_trace *t, const void *rec, size_t size,
+                         const void *data, size_t data_len)
+{
+    if (t->error)
+        return;
+    if ((fwrite (rec, size, 1, t->fp) != 1) ||
+        (data_len && (fwrite (data, data_len, 1, t->fp) != 1))) {
+        dbg_msg ("error, trace write. (%s)\n", strerror (errno));
+        t->error = 1;
+    }
+}
+
+//------------------------------------------------------------------------------
+static void trace_op (struct trace_io *tio, struct efuse_trace_op *op,
+                      long long t0, const void *data, size_t data_len)
+{
+    efuse_trace *t = tio->trace;
+    long long t1 = mono_ns ();
+    char type = TRACE_REC_OP;
+    int err = errno;
+
+    if (!TraceTid)
+        TraceTid = __atomic_add_fetch (&TraceTidCnt, 1, __ATOMIC_RELAXED);
+
+    op->dev      = tio->dev;
+    op->tid      = TraceTid;
+    op->err      = (op->result < 0) ? err : 0;
+    op->start_ns = t0 - t->t0;
+    op->dur_ns   = t1 - t0;
+    op->data_len = (data_len > TRACE_DATA_MAX) ? TRACE_DATA_MAX : data_len;
+
+    pthread_mutex_lock (&t->mutex);
+    trace_write (t, &type, 1, NULL, 0);
+    trace_write (t, op, sizeof(*op), data, op->data_len);
+    pthread_mutex_unlock (&t->mutex);
+    errno = err;
+}
+
+//------------------------------------------------------------------------------
+// return : 1 = rw_control, 0 = rw_file, 2 = 다른 path
+//------------------------------------------------------------------------------
+static int trace_path (const struct trace_io *tio, const char *path)
+{
+    if (!strcmp (path, tio->rw_control))
+        return 1;
+    return strcmp (path, tio->rw_file) ? 2 : 0;
+}
+
+//------------------------------------------------------------------------------
+static int trace_access (void *priv, const char *path)
+{
+    struct trace_io *tio = (struct trace_io *)priv;
+    struct efuse_trace_op op = { .op = eSIM_OP_ACCESS, .fd = -1 };
+    long long t0 = mono_ns ();
+
+    op.result  = tio->inner->access (tio->inner->priv, path);
+    op.control = trace_path (tio, path);
+    trace_op (tio, &op, t0, NULL, 0);
+    return (int)op.result;
+}
+
+static int trace_open (void *priv, const char *path, int flags)
+{
+    struct trace_io *tio = (struct trace_io *)priv;
+    struct efuse_trace_op op = { .op = eSIM_OP_OPEN };
+    long long t0 = mono_ns ();
+
+    op.result  = tio->inner->open (tio->inner->priv, path, flags);
+    op.fd      = (int)op.result;
+    op.flags   = flags;
+    op.control = trace_path (tio, path);
+    trace_op (tio, &op, t0, NULL, 0);
+    return (int)op.result;
+}
+
+static int trace_close (void *priv, int fd)
+{
+    struct trace_io *tio = (struct trace_io *)priv;
+    struct efuse_trace_op op = { .op = eSIM_OP_CLOSE, .fd = fd };
+    long long t0 = mono_ns ();
+
+    op.result = tio->inner->close (tio->inner->priv, fd);
+    trace_op (tio, &op, t0, NULL, 0);
+    return (int)op.result;
+}
+
+static ssize_t trace_pread (void *priv, int fd, void *buf, size_t size, off_t offset)
+{
+    struct trace_io *tio = (struct trace_io *)priv;
+    struct efuse_trace_op op = { .op = eSIM_OP_PREAD, .fd = fd };
+    long long t0 = mono_ns ();
+
+    op.result = tio->inner->pread (tio->inner->priv, fd, buf, size, offset);
+    op.size   = size;
+    op.offset = offset;
+    trace_op (tio, &op, t0, NULL, 0);
+    return (ssize_t)op.result;
+}
+
+static ssize_t trace_pwrite (void *priv, int fd, const void *buf, size_t size, off_t offset)
+{
+    struct trace_io *tio = (struct trace_io *)priv;
+    struct efuse_trace_op op = { .op = eSIM_OP_PWRITE, .fd = fd };
+    long long t0 = mono_ns ();
+
+    op.result = tio->inner->pwrite (tio->inner->priv, fd, buf, size, offset);
+    op.size   = size;
+    op.offset = offset;
+    trace_op (tio, &op, t0, buf, size);
+    return (ssize_t)op.result;
+}
+
+// arg는 ioctl 전 data를 기록 (IOC_DUMP 결과는 replay에서 다시 만들어짐)
+static int trace_ioctl (void *priv, int fd, unsigned long request, void *arg)
+{
+    struct trace_io *tio = (struct trace_io *)priv;
+    struct efuse_trace_op op = { .op = eSIM_OP_IOCTL, .fd = fd };
+    unsigned char data [sizeof(struct ioc_data)];
+    long long t0;
+
+    memcpy (data, arg, sizeof(data));
+    t0 = mono_ns ();
+    op.result  = tio->inner->ioctl (tio->inner->priv, fd, request, arg);
+    op.request = request;
+    trace_op (tio, &op, t0, data, sizeof(data));
+    return (int)op.result;
+}
+
+static int trace_fdatasync (void *priv, int fd)
+{
+    struct trace_io *tio = (struct trace_io *)priv;
+    struct efuse_trace_op op = { .op = eSIM_OP_SYNC, .fd = fd };
+    long long t0 = mono_ns ();
+
+    op.result = tio->inner->fdatasync (tio->inner->priv, fd);
+    trace_op (tio, &op, t0, NULL, 0);
+    return (int)op.result;
+}
+
+//------------------------------------------------------------------------------
+// trace file 생성 (기존 file은 덮어씀).
+//------------------------------------------------------------------------------
+efuse_trace *efuse_trace_open (const char *path)
+{
+    struct trace_hdr hdr = { TRACE_MAGIC, TRACE_VERSION, 0 };
+    efuse_trace *t = calloc (1, sizeof(efuse_trace));
+
+    if (t == NULL)
+        return NULL;
+    if ((t->fp = fopen (path, "we")) == NULL) {
+        dbg_msg ("error, trace file open. (%s, %s)\n", path, strerror (errno));
+        free (t);
+        return NULL;
+    }
+    setvbuf (t->fp, NULL, _IOFBF, TRACE_BUF_SIZE);
+    pthread_mutex_init (&t->mutex, NULL);
+    t->t0     = mono_ns ();
+    hdr.start = time (NULL);
+    trace_write (t, &hdr, sizeof(hdr), NULL, 0);
+    return t;
+}
+
+//------------------------------------------------------------------------------
+// attach된 ctx는 close 전에 efuse_ctx_close() 또는 backend 복구 (efuse_ctx_set_io).
+// return : 0 = trace file 기록 실패 (일부 operation 누락)
+//------------------------------------------------------------------------------
+int efuse_trace_close (efuse_trace *trace)
+{
+    struct trace_io *tio, *next;
+    int ret;
+
+    if (trace == NULL)
+        return 0;
+    ret = !trace->error;
+    if (fclose (trace->fp))
+        ret = 0;
+    for (tio = trace->ios; tio != NULL; tio = next) {
+        next = tio->next;
+        free (tio);
+    }
+    pthread_mutex_destroy (&trace->mutex);
+    free (trace);
+    return ret;
+}
+
+//------------------------------------------------------------------------------
+// ctx의 현재 backend (kernel, sim 등)를 trace backend로 감쌈.
+// device path는 attach 시점 기준 (efuse_ctx_set_path 후 attach).
+// trace backend는 efuse_io_kernel이 아니므로 io_uring batch는 sync path로 처리.
+// 같은 ctx를 다시 attach 하면 그대로 사용.
+//------------------------------------------------------------------------------
+int efuse_trace_attach (efuse_trace *trace, efuse_ctx *ctx)
+{
+    const char *rw_control, *rw_file;
+    struct trace_dev_rec rec;
+    const struct efuse_io *inner = efuse_ctx_get_backend (ctx);
+    struct trace_io *tio, *p;
+    char type = TRACE_REC_DEV;
+
+    // 이미 이 trace에 attach된 ctx (hotplug slot ctx 등 재사용)
+    pthread_mutex_lock (&trace->mutex);
+    for (p = trace->ios; p != NULL; p = p->next) {
+        if (inner == &p->io)
+            break;
+    }
+    pthread_mutex_unlock (&trace->mutex);
+    if (p != NULL)
+        return 1;
+
+    if ((tio = calloc (1, sizeof(struct trace_io))) == NULL)
+        return 0;
+
+    efuse_ctx_get_path (ctx, &rw_control, &rw_file);
+    snprintf (tio->rw_control, sizeof(tio->rw_control), "%s", rw_control);
+    snprintf (tio->rw_file,    sizeof(tio->rw_file),    "%s", rw_file);
+    tio->trace = trace;
+    tio->inner = inner;
+
+    tio->io.name      = "trace";
+    tio->io.priv      = tio;
+    tio->io.access    = trace_access;
+    tio->io.open      = trace_open;
+    tio->io.close     = trace_close;
+    tio->io.pread     = trace_pread;
+    tio->io.pwrite    = trace_pwrite;
+    tio->io.ioctl     = trace_ioctl;
+    tio->io.fdatasync = trace_fdatasync;
+
+    pthread_mutex_lock (&trace->mutex);
+    // 같은 device는 같은 index 사용
+    for (p = trace->ios; p != NULL; p = p->next) {
+        if (!strcmp (p->rw_control, tio->rw_control) && !strcmp (p->rw_file, tio->rw_file))
+            break;
+    }
+    if (p != NULL) {
+        tio->dev = p->dev;
+    } else if (trace->dev_cnt >= TRACE_DEV_MAX) {
+        pthread_mutex_unlock (&trace->mutex);
+        dbg_msg ("error, trace device max. (%s)\n", rw_file);
+        free (tio);
+        return 0;
+    } else {
+        tio->dev         = trace->dev_cnt++;
+        rec.dev          = tio->dev;
+        rec.dev_type     = efuse_sim_dev_type (efuse_ctx_get_board (ctx));
+        rec.control_len  = strlen (tio->rw_control) + 1;
+        rec.file_len     = strlen (tio->rw_file) + 1;
+        trace_write (trace, &type, 1, NULL, 0);
+        trace_write (trace, &rec, sizeof(rec), tio->rw_control, rec.control_len);
+        trace_write (trace, tio->rw_file, rec.file_len, NULL, 0);
+    }
+    tio->next  = trace->ios;
+    trace->ios = tio;
+    pthread_mutex_unlock (&trace->mutex);
+
+    return efuse_ctx_set_io (ctx, &tio->io);
+}
+
+//------------------------------------------------------------------------------
+// 시작 시간 순서, 같으면 기록 순서.
+//------------------------------------------------------------------------------
+static int play_cmp (const void *a, const void *b)
+{
+    const struct trace_play_op *pa = a, *pb = b;
+
+    if (pa->op.start_ns != pb->op.start_ns)
+        return (pa->op.start_ns < pb->op.start_ns) ? -1 : 1;
+    return (pa->seq < pb->seq) ? -1 : (pa->seq > pb->seq);
+}
+
+//------------------------------------------------------------------------------
+// 마지막 record가 잘린 경우 (기록 중 중단) 앞부분만 사용.
+//------------------------------------------------------------------------------
+static int play_load (FILE *fp, struct trace_play_dev *devs, int *dev_cnt,
+                      struct trace_play_op **ops, long *op_cnt)
+{
+    struct trace_hdr hdr;
+    struct trace_dev_rec rec;
+    struct trace_play_op *p;
+    long cap = 0;
+    int type;
+
+    if ((fread (&hdr, sizeof(hdr), 1, fp) != 1) ||
+        (hdr.magic != TRACE_MAGIC) || (hdr.version != TRACE_VERSION)) {
+        dbg_msg ("error, trace file header.\n");
+        return 0;
+    }
+    *ops = NULL, *op_cnt = 0, *dev_cnt = 0;
+
+    while ((type = fgetc (fp)) != EOF) {
+        if (type == TRACE_REC_DEV) {
+            if ((fread (&rec, sizeof(rec), 1, fp) != 1) || (rec.dev >= TRACE_DEV_MAX) ||
+                (rec.control_len > PATH_MAX) || (rec.file_len > PATH_MAX) ||
+                (fread (devs[rec.dev].rw_control, rec.control_len, 1, fp) != 1) ||
+                (fread (devs[rec.dev].rw_file, rec.file_len, 1, fp) != 1))
+                break;
+            devs[rec.dev].rw_control[PATH_MAX - 1] = 0;
+            devs[rec.dev].rw_file[PATH_MAX - 1]    = 0;
+            devs[rec.dev].dev_type = rec.dev_type;
+            if (rec.dev >= *dev_cnt)
+                *dev_cnt = rec.dev + 1;
+            continue;
+        }
+        if (type != TRACE_REC_OP)
+            break;
+        if (*op_cnt == cap) {
+            cap = cap ? cap * 2 : 4096;
+            if ((p = realloc (*ops, cap * sizeof(*p))) == NULL)
+                break;
+            *ops = p;
+        }
+        p = &(*ops)[*op_cnt];
+        if ((fread (&p->op, sizeof(p->op), 1, fp) != 1) ||
+            (p->op.data_len > TRACE_DATA_MAX) || (p->op.op >= eSIM_OP_END) ||
+            (p->op.data_len && (fread (p->data, p->op.data_len, 1, fp) != 1)))
+            break;
+        p->seq = (*op_cnt)++;
+    }
+    if (!feof (fp)) {
+        dbg_msg ("trace, broken record after %ld op(s).\n", *op_cnt);
+    }
+    qsort (*ops, *op_cnt, sizeof(**ops), play_cmp);
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+// fds[i] = { 기록된 fd, replay fd }. return : replay fd 위치, NULL = 없음
+//------------------------------------------------------------------------------
+static int *play_fd (int (*fds)[2], int rec_fd, int alloc)
+{
+    int i, *empty = NULL;
+
+    for (i = 0; i < TRACE_FD_MAX; i++) {
+        if (fds[i][1] < 0) {
+            if (empty == NULL)
+                empty = &fds[i][0];
+            continue;
+        }
+        if (fds[i][0] == rec_fd)
+            return &fds[i][1];
+    }
+    if (!alloc || (empty == NULL))
+        return NULL;
+    empty[0] = rec_fd;
+    return &empty[1];
+}
+
+//------------------------------------------------------------------------------
+// return : 결과 (기록과 같은 형식), skip = 1 이면 실행하지 않음
+//------------------------------------------------------------------------------
+static long long play_op (const struct efuse_io *io, const struct trace_play_dev *dev,
+                          const struct trace_play_op *p, int (*fds)[2], int *skip)
+{
+    const struct efuse_trace_op *op = &p->op;
+    unsigned char buf [sizeof(struct ioc_dump_data)], *data = buf;
+    const char *path = op->control ? dev->rw_control : dev->rw_file;
+    long long ret = -1;
+    int *fd = NULL;
+
+    *skip = 0;
+    if ((op->op == eSIM_OP_ACCESS) || (op->op == eSIM_OP_OPEN)) {
+        if (op->control > 1) {
+            *skip = 1;
+            return 0;
+        }
+    } else if ((fd = play_fd (fds, op->fd, 0)) == NULL) {
+        *skip = 1;
+        return 0;
+    }
+
+    if (((op->op == eSIM_OP_PREAD) || (op->op == eSIM_OP_PWRITE)) && (op->size > sizeof(buf))) {
+        if ((data = calloc (1, op->size)) == NULL) {
+            *skip = 1;
+            return 0;
+        }
+    }
+    switch (op->op) {
+        case eSIM_OP_ACCESS:
+            ret = io->access (io->priv, path);
+            break;
+        case eSIM_OP_OPEN:
+            ret = io->open (io->priv, path, op->flags);
+            if ((ret >= 0) && (op->fd >= 0) && ((fd = play_fd (fds, op->fd, 1)) != NULL))
+                *fd = (int)ret;
+            break;
+        case eSIM_OP_CLOSE:
+            ret = io->close (io->priv, *fd);
+            *fd = -1;
+            break;
+        case eSIM_OP_PREAD:
+            ret = io->pread (io->priv, *fd, data, op->size, op->offset);
+            break;
+        case eSIM_OP_PWRITE:
+            // data_len 보다 긴 write는 나머지 0으로 채움
+            memset (data, 0, op->size);
+            memcpy (data, p->data, op->data_len);
+            ret = io->pwrite (io->priv, *fd, data, op->size, op->offset);
+            break;
+        case eSIM_OP_IOCTL:
+            memset (buf, 0, sizeof(buf));
+            memcpy (buf, p->data, op->data_len);
+            ret = io->ioctl (io->priv, *fd, op->request, buf);
+            break;
+        case eSIM_OP_SYNC:
+            ret = io->fdatasync (io->priv, *fd);
+            break;
+    }
+    if (data != buf)
+        free (data);
+    return ret;
+}
+
+//------------------------------------------------------------------------------
+// trace file을 simulation device에서 실행.
+// speed : 0 = 최대 속도, 1.0 = 기록된 시작 시간 재현 (2.0 = 2배 빠르게)
+// replay operation 시간은 simulation device (latency 없음) 기준.
+// return : 0 = trace file error
+//------------------------------------------------------------------------------
+int efuse_trace_replay (const char *path, double speed, struct efuse_trace_report *report)
+{
+    struct trace_play_dev *devs;
+    struct trace_play_op *ops = NULL;
+    const struct efuse_io *io;
+    efuse_sim *sim = NULL;
+    int (*fds)[2] = NULL;
+    long i, op_cnt = 0;
+    long long t0, t1, rec_end = 0, ret;
+    int dev_cnt = 0, skip, ok = 0;
+    FILE *fp;
+
+    memset (report, 0, sizeof(*report));
+    if ((fp = fopen (path, "re")) == NULL) {
+        dbg_msg ("error, trace file open. (%s, %s)\n", path, strerror (errno));
+        return 0;
+    }
+    if ((devs = calloc (TRACE_DEV_MAX, sizeof(*devs))) == NULL)
+        goto out;
+    if (!play_load (fp, devs, &dev_cnt, &ops, &op_cnt))
+        goto out;
+
+    if (((fds = malloc (sizeof(*fds) * TRACE_FD_MAX)) == NULL) ||
+        ((sim = efuse_sim_create (NULL)) == NULL))
+        goto out;
+    for (i = 0; i < TRACE_FD_MAX; i++)
+        fds[i][1] = -1;
+    for (i = 0; i < dev_cnt; i++) {
+        if (devs[i].rw_file[0] &&
+            !efuse_sim_add_device (sim, devs[i].dev_type, devs[i].rw_control, devs[i].rw_file))
+            goto out;
+    }
+    io = efuse_sim_io (sim);
+
+    t0 = mono_ns ();
+    for (i = 0; i < op_cnt; i++) {
+        const struct efuse_trace_op *op = &ops[i].op;
+        int n = op->op;
+
+        if (speed > 0)
+            trace_sleep_until (t0 + (long long)(op->start_ns / speed));
+        if (op->start_ns + op->dur_ns > rec_end)
+            rec_end = op->start_ns + op->dur_ns;
+
+        if (op->dev >= dev_cnt) {
+            report->skipped++;
+            continue;
+        }
+        t1  = mono_ns ();
+        ret = play_op (io, &devs[op->dev], &ops[i], fds, &skip);
+        t1  = mono_ns () - t1;
+        if (skip) {
+            report->skipped++;
+            continue;
+        }
+        report->op_cnt[n]++;
+        report->rec_ns[n]  += op->dur_ns;
+        report->play_ns[n] += t1;
+        if (op->dur_ns > report->rec_max_ns[n])
+            report->rec_max_ns[n] = op->dur_ns;
+        if (t1 > report->play_max_ns[n])
+            report->play_max_ns[n] = t1;
+        if ((ret < 0) != (op->result < 0))
+            report->mismatch++;
+    }
+    report->play_span_ns = mono_ns () - t0;
+    report->rec_span_ns  = op_cnt ? rec_end - ops[0].op.start_ns : 0;
+    ok = 1;
+out:
+    if (sim != NULL)
+        efuse_sim_destroy (sim);
+    free (fds);
+    free (ops);
+    free (devs);
+    fclose (fp);
+    return ok;
+}
+
+//------------------------------------------------------------------------------
+const char *efuse_trace_op_name (int op)
+{
+    return ((op >= 0) && (op < eSIM_OP_END)) ? TraceOpName[op] : "unknown";
+}
+
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
@@ -0,0 +1,85 @@
+//------------------------------------------------------------------------------
+/**
+ * @file lib_efuse_trace.h
+ * @author charles-park (charles.park@hardkernel.com)
+ * @brief efuse device operation trace record / replay (simulation device).
+ * @version 0.2
+ * @date 2023-09-22
+ *
+ * @package apt install cups cups-bsd
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#ifndef __LIB_EFUSE_TRACE_H__
+#define __LIB_EFUSE_TRACE_H__
+
+//------------------------------------------------------------------------------
+#include "lib_efuse.h"
+#include "lib_efuse_sim.h"
+
+//------------------------------------------------------------------------------
+// ctx의 I/O backend를 trace backend로 감싸서 device operation을 모두 기록.
+// (efuse_control의 access/open/pread/pwrite, efuse_lock의 force_ro write,
+//  efuse_write_ioctl의 ioctl 등)
+//
+// trace file (binary, little endian) :
+//   header  : magic, version, 시작 시간
+//   device  : ctx attach시 1회 (index, device type, rw_control, rw_file)
+//   op      : struct efuse_trace_op + pwrite/ioctl data (최대 TRACE_DATA_MAX)
+// op record는 완료시 기록되므로 시작 시간 순서가 아닐 수 있음 (replay에서 정렬).
+//
+// replay는 기록된 device를 simulation device로 만들어 같은 순서로 실행.
+// speed = 0 이면 최대 속도, 1.0 이면 기록된 시작 간격 재현.
+// 여러 thread에서 동시에 기록된 operation도 순서대로 1개씩 실행.
+//------------------------------------------------------------------------------
+#define TRACE_DATA_MAX  64
+#define TRACE_DEV_MAX   32
+
+typedef struct efuse_trace efuse_trace;
+
+// op 종류는 simulation operation과 같음 (eSIM_OP_xxx)
+struct efuse_trace_op {
+    unsigned char       op;
+    unsigned char       dev;        // device index
+    unsigned char       control;    // 1 = rw_control, 0 = rw_file (access/open)
+    unsigned char       data_len;   // 뒤에 오는 data 크기
+    int                 fd;         // 기록시 fd (open은 result)
+    int                 flags;      // open flags
+    unsigned int        request;    // ioctl
+    unsigned int        size;       // pread/pwrite size
+    long long           offset;     // pread/pwrite offset
+    long long           result;
+    int                 err;        // result < 0 인 경우 errno
+    unsigned int        tid;        // 기록한 thread (trace 내 순번)
+    long long           start_ns;   // trace 시작 기준
+    long long           dur_ns;
+};
+
+struct efuse_trace_report {
+    long                op_cnt      [eSIM_OP_END];
+    long long           rec_ns      [eSIM_OP_END];  // 기록된 operation 시간 합
+    long long           rec_max_ns  [eSIM_OP_END];
+    long long           play_ns     [eSIM_OP_END];  // replay operation 시간 합
+    long long           play_max_ns [eSIM_OP_END];
+    long                mismatch;                   // 기록과 결과 (성공/실패) 다름
+    long                skipped;                    // 알 수 없는 device/fd
+    long long           rec_span_ns;                // 첫 operation ~ 마지막 완료
+    long long           play_span_ns;
+};
+
+//------------------------------------------------------------------------------
+//	function prototype
+//------------------------------------------------------------------------------
+extern efuse_trace *efuse_trace_open    (const char *path);
+extern int  efuse_trace_close           (efuse_trace *trace);
+extern int  efuse_trace_attach          (efuse_trace *trace, efuse_ctx *ctx);
+extern int  efuse_trace_replay          (const char *path, double speed,
+                                         struct efuse_trace_report *report);
+extern const char *efuse_trace_op_name  (int op);
+
+//------------------------------------------------------------------------------
+#endif  // #ifndef __LIB_EFUSE_TRACE_H__
+//------------------------------------------------------------------------------
@@ -0,0 +1,611 @@
+//------------------------------------------------------------------------------
+/**
+ * @file lib_efuse_uring.c
+ * @author charles-park (charles.park@hardkernel.com)
+ * @brief efuse io_uring batch write/verify (m1s, m2, c5 emmc/sysfs device).
+ * @version 0.2
+ * @date 2023-09-22
+ *
+ * @package apt install cups cups-bsd
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <pthread.h>
+
+#include "lib_efuse.h"
+#include "lib_efuse_uring.h"
+#include "lib_efuse_metrics.h"
+#include "lib_efuse_journal.h"
+#include "lib_efuse_board.h"
+#include "lib_efuse_label.h"
+
+// liburing 없이 system call 직접 사용. header가 없으면 항상 sync path.
+#if defined (__NR_io_uring_setup) && __has_include (<linux/io_uring.h>)
+    #include <linux/io_uring.h>
+    #define URING_SUPPORT
+#endif
+
+//------------------------------------------------------------------------------
+// Debug msg
+//------------------------------------------------------------------------------
+#if defined (__LIB_EFUSE_APP__)
+    #define dbg_msg(fmt, args...)   printf(fmt, ##args)
+#else
+    #define dbg_msg(fmt, args...)
+#endif
+
+//------------------------------------------------------------------------------
+// -1 = 확인 전, 0 = 사용 불가, 1 = 사용 가능
+static int UringState = -1;
+
+#if defined (URING_SUPPORT)
+//------------------------------------------------------------------------------
+// device 1개의 chain 단계. user_data = (device index << 8) | step
+//------------------------------------------------------------------------------
+enum {
+    eSTEP_READ = 0,     // 현재 uuid 확인
+    eSTEP_UNLOCK,       // force_ro = 0 (m1s, m2)
+    eSTEP_WRITE,
+    eSTEP_SYNC,         // fdatasync (m1s, m2)
+    eSTEP_VERIFY,       // read back
+    eSTEP_LOCK,         // force_ro = 1 (m1s, m2)
+    eSTEP_END
+};
+
+// 한번에 submit 하는 device 수 (chain 최대 eSTEP_END -1 개)
+#define URING_DEV_MAX   (URING_ENTRIES / eSTEP_END)
+
+struct uring {
+    int                 fd;
+    unsigned            sq_tail;        // 아직 kernel에 알리지 않은 local tail
+    unsigned            sq_pending;
+    unsigned            *sq_head, *sq_ktail, *sq_mask, *sq_array;
+    unsigned            *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void                *sq_ring, *cq_ring;
+    size_t              sq_size, cq_size, sqes_size;
+};
+
+struct uring_dev {
+    struct efuse_uring_req  *req;
+    const struct efuse_io   *io;
+    int         emmc;               // force_ro 제어 필요 (m1s, m2)
+    int         write;              // 0 = 이미 같은 data (write chain 없음)
+    int         skip;               // owner 사용중, intent 기록 실패. sync path로 처리
+    int         owned;              // device owner 획득 (efuse_ctx_owner_get)
+    struct efuse_journal *journal;
+    unsigned long long journal_id;
+    int         ctl_fd, file_fd;
+    off_t       offset;
+    int         res   [eSTEP_END];
+    char        wdata [EFUSE_UUID_SIZE +1];
+    char        rdata [EFUSE_UUID_SIZE +1];
+};
+
+static const char UringUnlock[] = "0", UringLock[] = "1";
+
+// ring 생성/해제 비용(수십 usec)이 커서 thread별 ring을 재사용. thread 종료시 해제.
+static __thread struct uring *UringTls;
+static pthread_key_t    UringKey;
+static pthread_once_t   UringOnce = PTHREAD_ONCE_INIT;
+#endif  // #if defined (URING_SUPPORT)
+
+//------------------------------------------------------------------------------
+// function prototype
+//------------------------------------------------------------------------------
+#if defined (URING_SUPPORT)
+static int  uring_setup     (struct uring *r, unsigned entries);
+static void uring_teardown  (struct uring *r);
+static void uring_release   (void *arg);
+static void uring_key_init  (void);
+static struct uring *uring_get (void);
+static void uring_prep      (struct uring *r, int op, int fd, const void *buf,
+                             unsigned len, off_t offset, unsigned long long user_data,
+                             int flags);
+static int  uring_wait      (struct uring *r, struct uring_dev *dev, int cnt);
+static int  uring_dev_open  (struct uring_dev *d, struct efuse_uring_req *req);
+static void uring_dev_close (struct uring_dev *d);
+static void uring_chain     (struct uring *r, struct uring_dev *d, int idx);
+static int  uring_round     (struct uring *r, struct uring_dev *dev, int cnt);
+static void uring_result    (struct uring_dev *d);
+static void uring_journal   (const struct uring_dev *d);
+static void uring_label     (const struct efuse_uring_req *req);
+#endif
+
+int efuse_uring_available    (void);
+int efuse_uring_write_verify (struct efuse_uring_req *reqs, int cnt);
+
+#if defined (URING_SUPPORT)
+//------------------------------------------------------------------------------
+static int uring_setup (struct uring *r, unsigned entries)
+{
+    struct io_uring_params p;
+
+    memset (r, 0, sizeof(*r));
+    memset (&p, 0, sizeof(p));
+    r->sq_ring = r->cq_ring = r->sqes = MAP_FAILED;
+
+    if ((r->fd = syscall (__NR_io_uring_setup, entries, &p)) < 0)
+        return 0;
+
+    r->sq_size   = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    r->cq_size   = p.cq_off.cqes  + p.cq_entries * sizeof(struct io_uring_cqe);
+    r->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+
+    // 5.4 이후 kernel은 sq/cq ring을 한번의 mmap으로 사용
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        if (r->cq_size > r->sq_size)
+            r->sq_size = r->cq_size;
+        r->cq_size = r->sq_size;
+    }
+    r->sq_ring = mmap (NULL, r->sq_size, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQ_RING);
+    if (r->sq_ring == MAP_FAILED)
+        goto err;
+    if (p.features & IORING_FEAT_SINGLE_MMAP)
+        r->cq_ring = r->sq_ring;
+    else {
+        r->cq_ring = mmap (NULL, r->cq_size, PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_CQ_RING);
+        if (r->cq_ring == MAP_FAILED)
+            goto err;
+    }
+    r->sqes = mmap (NULL, r->sqes_size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQES);
+    if (r->sqes == MAP_FAILED)
+        goto err;
+
+    r->sq_head    = (unsigned *)((char *)r->sq_ring + p.sq_off.head);
+    r->sq_ktail   = (unsigned *)((char *)r->sq_ring + p.sq_off.tail);
+    r->sq_mask    = (unsigned *)((char *)r->sq_ring + p.sq_off.ring_mask);
+    r->sq_array   = (unsigned *)((char *)r->sq_ring + p.sq_off.array);
+    r->cq_head    = (unsigned *)((char *)r->cq_ring + p.cq_off.head);
+    r->cq_tail    = (unsigned *)((char *)r->cq_ring + p.cq_off.tail);
+    r->cq_mask    = (unsigned *)((char *)r->cq_ring + p.cq_off.ring_mask);
+    r->cqes       = (struct io_uring_cqe *)((char *)r->cq_ring + p.cq_off.cqes);
+    r->sq_tail    = *r->sq_ktail;
+
+#if defined (IORING_REGISTER_IOWQ_MAX_WORKERS)
+    // fdatasync 등 blocking 요청은 io-wq worker에서 실행. 기본 worker 수는
+    // cpu 수 x 4로 제한되므로 device 수만큼 동시 처리되도록 확장 (5.15 이후).
+    {
+        unsigned workers[2] = { URING_DEV_MAX, 0 };
+
+        syscall (__NR_io_uring_register, r->fd, IORING_REGISTER_IOWQ_MAX_WORKERS,
+                 workers, 2);
+    }
+#endif
+    return 1;
+err:
+    uring_teardown (r);
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+static void uring_teardown (struct uring *r)
+{
+    if (r->sqes != MAP_FAILED)
+        munmap (r->sqes, r->sqes_size);
+    if ((r->cq_ring != MAP_FAILED) && (r->cq_ring != r->sq_ring))
+        munmap (r->cq_ring, r->cq_size);
+    if (r->sq_ring != MAP_FAILED)
+        munmap (r->sq_ring, r->sq_size);
+    if (r->fd >= 0)
+        close (r->fd);
+    r->fd = -1;
+}
+
+//------------------------------------------------------------------------------
+static void uring_release (void *arg)
+{
+    struct uring *r = arg;
+
+    uring_teardown (r);
+    free (r);
+}
+
+//------------------------------------------------------------------------------
+static void uring_key_init (void)
+{
+    pthread_key_create (&UringKey, uring_release);
+}
+
+//------------------------------------------------------------------------------
+// 호출 thread의 ring. return : NULL = io_uring 사용 불가
+//------------------------------------------------------------------------------
+static struct uring *uring_get (void)
+{
+    struct uring *r;
+
+    if (UringTls != NULL)
+        return UringTls;
+
+    pthread_once (&UringOnce, uring_key_init);
+    if ((r = malloc (sizeof(struct uring))) == NULL)
+        return NULL;
+    if (!uring_setup (r, URING_ENTRIES)) {
+        free (r);
+        return NULL;
+    }
+    pthread_setspecific (UringKey, r);
+    return UringTls = r;
+}
+
+//------------------------------------------------------------------------------
+// SQE 1개 추가. kernel 알림(tail update)은 uring_wait()에서 한번에.
+// ring 크기는 URING_DEV_MAX로 제한되므로 공간 부족은 발생하지 않음.
+//------------------------------------------------------------------------------
+static void uring_prep (struct uring *r, int op, int fd, const void *buf,
+                        unsigned len, off_t offset, unsigned long long user_data,
+                        int flags)
+{
+    unsigned idx = r->sq_tail & *r->sq_mask;
+    struct io_uring_sqe *sqe = &r->sqes[idx];
+
+    memset (sqe, 0, sizeof(*sqe));
+    sqe->opcode    = op;
+    sqe->flags     = flags;
+    sqe->fd        = fd;
+    sqe->addr      = (unsigned long)buf;
+    sqe->len       = len;
+    sqe->off       = offset;
+    sqe->user_data = user_data;
+    if (op == IORING_OP_FSYNC)
+        sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+
+    r->sq_array[idx] = idx;
+    r->sq_tail++;
+    r->sq_pending++;
+}
+
+//------------------------------------------------------------------------------
+// 추가된 SQE submit 후 cnt개의 completion 수집 (호출 thread에서 모두 처리).
+// submit된 요청은 buffer를 사용중이므로 모두 완료될 때까지 return 하지 않음.
+// return : 0 = submit 실패 (완료되지 않은 요청 없음)
+//------------------------------------------------------------------------------
+static int uring_wait (struct uring *r, struct uring_dev *dev, int cnt)
+{
+    unsigned head, tail;
+    int ret, done = 0, inflight = 0;
+
+    __atomic_store_n (r->sq_ktail, r->sq_tail, __ATOMIC_RELEASE);
+
+    while (done < cnt) {
+        ret = syscall (__NR_io_uring_enter, r->fd, r->sq_pending, 1,
+                        IORING_ENTER_GETEVENTS, NULL, 0);
+        if (ret < 0) {
+            if ((errno == EINTR) || (errno == EAGAIN) || (errno == EBUSY))
+                continue;
+            if (!inflight) {
+                dbg_msg ("error, io_uring_enter (%s)\n", strerror (errno));
+                // submit 되지 않은 SQE는 다음 submit에서 제외
+                r->sq_tail = *r->sq_head;
+                __atomic_store_n (r->sq_ktail, r->sq_tail, __ATOMIC_RELEASE);
+                r->sq_pending = 0;
+                return 0;
+            }
+            continue;
+        }
+        r->sq_pending -= ret;
+        inflight      += ret;
+
+        head = *r->cq_head;
+        tail = __atomic_load_n (r->cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != tail; head++, done++, inflight--) {
+            struct io_uring_cqe *cqe = &r->cqes[head & *r->cq_mask];
+
+            dev[cqe->user_data >> 8].res[cqe->user_data & 0xff] = cqe->res;
+        }
+        __atomic_store_n (r->cq_head, head, __ATOMIC_RELEASE);
+    }
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+// io_uring path 사용 가능한 요청이면 descriptor open. return : 0 = sync path
+//------------------------------------------------------------------------------
+static int uring_dev_open (struct uring_dev *d, struct efuse_uring_req *req)
+{
+    const char *rw_control, *rw_file;
+    const struct efuse_board *board;
+    struct efuse_uuid uuid;
+    int i;
+
+    memset (d, 0, sizeof(*d));
+    d->req    = req;
+    d->ctl_fd = d->file_fd = -1;
+    for (i = 0; i < eSTEP_END; i++)
+        d->res[i] = -ECANCELED;
+
+    if ((req->ctx == NULL) || (req->efuse_data == NULL))
+        return 0;
+
+    // ioctl device (m1, c4)는 sync path
+    board = efuse_board_info (efuse_ctx_get_board (req->ctx));
+    if (board->dev_type == eBOARD_DEV_IOCTL)
+        return 0;
+    // simulator, timeout guard 등은 sync path
+    if ((d->io = efuse_ctx_get_io (req->ctx)) != &efuse_io_kernel)
+        return 0;
+    // uuid 형식 error는 sync path에서 처리 (error code 설정)
+    if (!efuse_uuid_parse (req->efuse_data, &uuid))
+        return 0;
+    efuse_uuid_format (&uuid, d->wdata);
+
+    d->emmc    = (board->dev_type == eBOARD_DEV_EMMC);
+    d->offset  = efuse_ctx_get_offset (req->ctx);
+    d->journal = efuse_ctx_get_journal (req->ctx);
+    efuse_ctx_get_path (req->ctx, &rw_control, &rw_file);
+
+    if ((d->file_fd = d->io->open (d->io->priv, rw_file, O_RDWR)) < 0)
+        return 0;
+    if (d->emmc && ((d->ctl_fd = d->io->open (d->io->priv, rw_control, O_WRONLY)) < 0)) {
+        uring_dev_close (d);
+        return 0;
+    }
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+static void uring_dev_close (struct uring_dev *d)
+{
+    if (d->owned)
+        efuse_ctx_owner_put (d->req->ctx);
+    d->owned = 0;
+    if (d->ctl_fd >= 0)
+        d->io->close (d->io->priv, d->ctl_fd);
+    if (d->file_fd >= 0)
+        d->io->close (d->io->priv, d->file_fd);
+    d->ctl_fd = d->file_fd = -1;
+}
+
+//------------------------------------------------------------------------------
+// unlock -> write -> sync -> read back -> lock. 모두 hard link 이므로 앞 단계가
+// 실패해도 순서대로 실행되며 lock은 항상 복구됨. 결과는 단계별로 확인.
+//------------------------------------------------------------------------------
+static void uring_chain (struct uring *r, struct uring_dev *d, int idx)
+{
+    unsigned long long ud = (unsigned long long)idx << 8;
+
+    if (d->emmc)
+        uring_prep (r, IORING_OP_WRITE, d->ctl_fd, UringUnlock, 1, 0,
+                    ud | eSTEP_UNLOCK, IOSQE_IO_HARDLINK);
+    uring_prep (r, IORING_OP_WRITE, d->file_fd, d->wdata, EFUSE_UUID_SIZE, d->offset,
+                ud | eSTEP_WRITE, IOSQE_IO_HARDLINK);
+    if (d->emmc)
+        uring_prep (r, IORING_OP_FSYNC, d->file_fd, NULL, 0, 0,
+                    ud | eSTEP_SYNC, IOSQE_IO_HARDLINK);
+    uring_prep (r, IORING_OP_READ, d->file_fd, d->rdata, EFUSE_UUID_SIZE, d->offset,
+                ud | eSTEP_VERIFY, d->emmc ? IOSQE_IO_HARDLINK : 0);
+    if (d->emmc)
+        uring_prep (r, IORING_OP_WRITE, d->ctl_fd, UringLock, 1, 0,
+                    ud | eSTEP_LOCK, 0);
+}
+
+//------------------------------------------------------------------------------
+// dev[0 .. cnt-1] (cnt <= URING_DEV_MAX) 처리. return : 0 = io_uring 실패
+//------------------------------------------------------------------------------
+static int uring_round (struct uring *r, struct uring_dev *dev, int cnt)
+{
+    const char *path;
+    int i, j, sqe_cnt;
+
+    // 1. 현재 uuid read (모든 device 동시)
+    for (i = 0; i < cnt; i++) {
+        memset (dev[i].rdata, 0, sizeof(dev[i].rdata));
+        uring_prep (r, IORING_OP_READ, dev[i].file_fd, dev[i].rdata, EFUSE_UUID_SIZE,
+                    dev[i].offset, ((unsigned long long)i << 8) | eSTEP_READ, 0);
+    }
+    if (!uring_wait (r, dev, cnt))
+        return 0;
+
+    // 2. data가 다른 device만 write (read 실패는 data 다름으로 처리)
+    for (i = 0; i < cnt; i++) {
+        if (dev[i].res[eSTEP_READ] == EFUSE_UUID_SIZE) {
+            for (j = 0; j < EFUSE_UUID_SIZE; j++)
+                dev[i].rdata[j] = toupper ((unsigned char)dev[i].rdata[j]);
+            if (!memcmp (dev[i].rdata, dev[i].wdata, EFUSE_UUID_SIZE))
+                continue;
+        }
+        memset (dev[i].rdata, 0, sizeof(dev[i].rdata));
+        dev[i].write = 1;
+        // 다른 process/ctx가 사용중인 device는 sync path에서 순서대로 대기
+        if (!(dev[i].owned = efuse_ctx_owner_get (dev[i].req->ctx, 0))) {
+            dev[i].skip = 1;
+            continue;
+        }
+        if (dev[i].journal == NULL)
+            continue;
+        dev[i].journal_id = efuse_journal_intent (dev[i].journal, eJOURNAL_OP_WRITE_VERIFY,
+                                efuse_ctx_get_board (dev[i].req->ctx), dev[i].wdata,
+                                efuse_ctx_get_path (dev[i].req->ctx, NULL, &path) ? path : "", 0);
+        if (!dev[i].journal_id)
+            dev[i].skip = 1;
+    }
+    // intent는 journal별 fdatasync 1회로 disk 기록 후 write 시작
+    for (i = 0; i < cnt; i++) {
+        if (!dev[i].journal_id || dev[i].skip)
+            continue;
+        for (j = 0; (j < i) && (dev[j].journal != dev[i].journal); j++)
+            ;
+        if ((j == i) && !efuse_journal_sync (dev[i].journal))
+            for (j = i; j < cnt; j++)
+                if (dev[j].journal == dev[i].journal)
+                    dev[j].skip = 1;
+    }
+    for (i = 0, sqe_cnt = 0; i < cnt; i++) {
+        if (!dev[i].write || dev[i].skip)
+            continue;
+        uring_chain (r, &dev[i], i);
+        sqe_cnt += dev[i].emmc ? 5 : 2;
+    }
+    return sqe_cnt ? uring_wait (r, dev, sqe_cnt) : 1;
+}
+
+//------------------------------------------------------------------------------
+// device 결과 -> 요청 결과. device error는 req->uring = 0 (sync path 재처리).
+//------------------------------------------------------------------------------
+static void uring_result (struct uring_dev *d)
+{
+    struct efuse_uring_req *req = d->req;
+    int i;
+
+    if (d->skip)
+        return;
+    req->uring = 1;
+    req->error = eEFUSE_OK;
+    if (!d->write) {
+        req->result = eEFUSE_WV_UNCHANGED;
+    } else if (d->emmc && (d->res[eSTEP_LOCK] != 1)) {
+        // lock 복구 실패는 재시도 하지 않고 보고
+        dbg_msg ("error, force_ro lock (%d)\n", d->res[eSTEP_LOCK]);
+        req->result = eEFUSE_WV_ERROR;
+        req->error  = eEFUSE_ERR_LOCK;
+    } else if ((d->emmc && (d->res[eSTEP_UNLOCK] != 1)) ||
+               (d->res[eSTEP_WRITE]  != EFUSE_UUID_SIZE) ||
+               (d->emmc && (d->res[eSTEP_SYNC] != 0)) ||
+               (d->res[eSTEP_VERIFY] != EFUSE_UUID_SIZE)) {
+        req->uring = 0;
+        return;
+    } else {
+        for (i = 0; i < EFUSE_UUID_SIZE; i++)
+            d->rdata[i] = toupper ((unsigned char)d->rdata[i]);
+        if (memcmp (d->rdata, d->wdata, EFUSE_UUID_SIZE)) {
+            dbg_msg ("error, verify. write = %s, read = %s\n", d->wdata, d->rdata);
+            req->result = eEFUSE_WV_MISMATCH;
+            req->error  = eEFUSE_ERR_IO;
+        } else
+            req->result = eEFUSE_WV_WRITTEN;
+    }
+    memset (req->read_data, 0, sizeof(req->read_data));
+    memcpy (req->read_data, d->rdata, EFUSE_UUID_SIZE);
+}
+
+//------------------------------------------------------------------------------
+// intent를 기록한 device의 결과 기록. sync path로 다시 처리되는 요청은 failed
+// (sync path에서 새로운 intent 기록).
+//------------------------------------------------------------------------------
+static void uring_journal (const struct uring_dev *d)
+{
+    int state = eJOURNAL_FAILED;
+
+    if (!d->journal_id)
+        return;
+    if (d->req->uring && (d->req->result == eEFUSE_WV_WRITTEN))
+        state = eJOURNAL_VERIFIED;
+    if (d->req->uring && (d->req->result == eEFUSE_WV_MISMATCH))
+        state = eJOURNAL_MISMATCH;
+    efuse_journal_state (d->journal, d->journal_id, state);
+}
+
+//------------------------------------------------------------------------------
+// efuse_ctx_write_verify()와 같이 write 확인 후 label 추가 (device close 이후).
+//------------------------------------------------------------------------------
+static void uring_label (const struct efuse_uring_req *req)
+{
+    efuse_label *label = efuse_ctx_get_label (req->ctx);
+
+    if ((label != NULL) &&
+        !efuse_label_push (label, efuse_ctx_get_board (req->ctx), req->efuse_data)) {
+        dbg_msg ("error, label queue. (%s)\n", strerror (errno));
+    }
+}
+#endif  // #if defined (URING_SUPPORT)
+
+//------------------------------------------------------------------------------
+// io_uring 사용 가능 여부 (kernel 지원, io_uring_disabled sysctl 등). 결과 cache.
+//------------------------------------------------------------------------------
+int efuse_uring_available (void)
+{
+    int state = __atomic_load_n (&UringState, __ATOMIC_RELAXED);
+
+#if defined (URING_SUPPORT)
+    if (state < 0) {
+        struct uring r;
+
+        state = uring_setup (&r, 1);
+        if (state)
+            uring_teardown (&r);
+        __atomic_store_n (&UringState, state, __ATOMIC_RELAXED);
+    }
+#else
+    state = 0;
+#endif
+    return state;
+}
+
+//------------------------------------------------------------------------------
+// reqs[0 .. cnt-1] write/verify. 같은 ctx(device)가 중복되면 안됨.
+// cnt < URING_DEV_MIN 이면 sync path (lib_efuse_uring.h 측정 결과 참고).
+// return : 성공 (eEFUSE_WV_WRITTEN, eEFUSE_WV_UNCHANGED) 요청 수
+//------------------------------------------------------------------------------
+int efuse_uring_write_verify (struct efuse_uring_req *reqs, int cnt)
+{
+    int i, ok = 0;
+
+    for (i = 0; i < cnt; i++)
+        reqs[i].uring = 0;
+
+#if defined (URING_SUPPORT)
+    if ((cnt >= URING_DEV_MIN) && efuse_uring_available ()) {
+        struct uring_dev *dev = malloc (sizeof(struct uring_dev) * URING_DEV_MAX);
+        struct uring *r;
+        long long t0;
+        int n, j, ret;
+
+        if ((dev != NULL) && ((r = uring_get ()) != NULL)) {
+            for (i = 0; i < cnt; ) {
+                t0 = efuse_metrics_now ();
+                for (n = 0; (i < cnt) && (n < URING_DEV_MAX); i++)
+                    if (uring_dev_open (&dev[n], &reqs[i]))
+                        n++;
+                ret = n ? uring_round (r, dev, n) : 0;
+                for (j = 0; j < n; j++) {
+                    if (ret)
+                        uring_result (&dev[j]);
+                    uring_journal (&dev[j]);
+                    if (dev[j].req->uring)
+                        efuse_metrics_add (efuse_ctx_get_board (dev[j].req->ctx),
+                                           eMETRIC_WRITE_VERIFY, t0);
+                    uring_dev_close (&dev[j]);
+                    if (dev[j].req->uring && (dev[j].req->result == eEFUSE_WV_WRITTEN))
+                        uring_label (dev[j].req);
+                }
+            }
+        }
+        free (dev);
+    }
+#endif
+    // io_uring 사용 불가, 대상 board가 아니거나 device error인 요청
+    for (i = 0; i < cnt; i++) {
+        if (!reqs[i].uring) {
+            if (reqs[i].ctx == NULL) {
+                reqs[i].result = eEFUSE_WV_ERROR;
+                reqs[i].error  = eEFUSE_ERR_PARAM;
+                continue;
+            }
+            reqs[i].result = efuse_ctx_write_verify (reqs[i].ctx, reqs[i].efuse_data,
+                                                     reqs[i].read_data);
+            reqs[i].error  = efuse_ctx_last_error (reqs[i].ctx);
+        }
+        if ((reqs[i].result == eEFUSE_WV_WRITTEN) || (reqs[i].result == eEFUSE_WV_UNCHANGED))
+            ok++;
+    }
+    return ok;
+}
+
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
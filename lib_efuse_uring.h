@@ -0,0 +1,73 @@
+//------------------------------------------------------------------------------
+/**
+ * @file lib_efuse_uring.h
+ * @author charles-park (charles.park@hardkernel.com)
+ * @brief efuse io_uring batch write/verify (m1s, m2, c5 emmc/sysfs device).
+ * @version 0.2
+ * @date 2023-09-22
+ *
+ * @package apt install cups cups-bsd
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#ifndef __LIB_EFUSE_URING_H__
+#define __LIB_EFUSE_URING_H__
+
+//------------------------------------------------------------------------------
+#include "lib_efuse.h"
+
+//------------------------------------------------------------------------------
+// 여러 device의 efuse_ctx_write_verify()를 io_uring으로 동시에 처리.
+//
+// 1. 모든 device의 현재 uuid read를 한번에 submit (같으면 write 생략)
+// 2. 다른 device는 force_ro unlock -> write -> fdatasync -> read back -> lock
+//    순서의 linked SQE chain으로 submit. lock은 앞 단계 실패와 관계없이 실행.
+// completion은 호출한 thread 1개에서 모두 수집.
+//
+// io_uring 사용 불가(kernel 미지원, 비활성화)이거나 ctx가 m1s/m2/c5 board 및
+// kernel backend가 아닌 경우(simulator, timeout guard 등) 기존 sync path 사용.
+// io_uring path에서 device error가 발생한 요청도 sync path로 다시 처리되므로
+// efuse_ctx_set_retry()의 재시도/timeout 설정은 sync path에서 적용됨.
+// ctx에 owner table이 설정된 경우 write할 device의 owner를 대기 없이 획득,
+// 다른 process/ctx가 사용중인 device는 sync path에서 순서대로 대기 후 처리.
+// ctx에 journal이 설정된 경우 write할 device의 intent를 모두 기록한 후
+// journal별 fdatasync 1회로 disk 기록하고 write chain을 submit.
+// session(efuse_ctx_begin) 중인 ctx는 사용하지 않아야 함.
+//
+// 요청이 URING_DEV_MIN개 미만이면 sync path 사용.
+// io_uring은 device별 fdatasync를 겹쳐서 처리하는 경우에만 이득이 있고,
+// device가 적으면 ring submit/worker 전환 비용이 더 큼.
+// lib_efuse_bench -u 64 -f (file-backed m2, ext4, 1 vCPU) 측정 결과 (ops/s, sync / io_uring) :
+//   1 dev : 14.4k / 9.2k,  2 dev : 14.2k / 12.7k,  4 dev : 11.9k / 11.1k
+//   8 ~ 64 dev : 측정마다 차이가 큼 (io_uring -30% ~ +25%)
+// 같은 sync path를 2번 측정해도 ±30% 차이가 있으므로 8개 미만에서 이득 없음만 확인됨.
+// 실제 emmc는 fdatasync가 ms 단위이므로 더 적은 device에서도 이득이 예상됨 (미측정).
+// 장비에서 측정 후 -DURING_DEV_MIN=n 으로 변경.
+//------------------------------------------------------------------------------
+#define URING_ENTRIES   256
+
+#ifndef URING_DEV_MIN
+    #define URING_DEV_MIN   8
+#endif
+
+struct efuse_uring_req {
+    efuse_ctx   *ctx;
+    const char  *efuse_data;                    // write할 uuid (EFUSE_UUID_SIZE)
+    char        read_data [EFUSE_UUID_SIZE +1]; // read back data
+    int         result;                         // eEFUSE_WV_xxx
+    int         error;                          // eEFUSE_ERR_xxx
+    int         uring;                          // 1 = io_uring path로 처리됨
+};
+
+//------------------------------------------------------------------------------
+//	function prototype
+//------------------------------------------------------------------------------
+extern int  efuse_uring_available       (void);
+extern int  efuse_uring_write_verify    (struct efuse_uring_req *reqs, int cnt);
+
+//------------------------------------------------------------------------------
+#endif  // #ifndef __LIB_EFUSE_URING_H__
+//------------------------------------------------------------------------------
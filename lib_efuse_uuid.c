@@ -0,0 +1,193 @@
+//------------------------------------------------------------------------------
+/**
+ * @file lib_efuse_uuid.c
+ * @author charles-park (charles.park@hardkernel.com)
+ * @brief efuse uuid binary/string conversion.
+ * @version 0.2
+ * @date 2023-09-22
+ *
+ * @package apt install cups cups-bsd
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/random.h>
+
+#include "lib_efuse.h"
+
+//------------------------------------------------------------------------------
+// hex 문자 -> HEX_VALID | 값(0 ~ 15). hex 문자가 아니면 0.
+//------------------------------------------------------------------------------
+#define HEX_VALID   0x10
+
+static const unsigned char HexVal [256] = {
+    ['0'] = 0x10, ['1'] = 0x11, ['2'] = 0x12, ['3'] = 0x13, ['4'] = 0x14,
+    ['5'] = 0x15, ['6'] = 0x16, ['7'] = 0x17, ['8'] = 0x18, ['9'] = 0x19,
+    ['A'] = 0x1A, ['B'] = 0x1B, ['C'] = 0x1C, ['D'] = 0x1D, ['E'] = 0x1E, ['F'] = 0x1F,
+    ['a'] = 0x1A, ['b'] = 0x1B, ['c'] = 0x1C, ['d'] = 0x1D, ['e'] = 0x1E, ['f'] = 0x1F,
+};
+
+static const char HexChar [16] = {
+    '0', '1', '2', '3', '4', '5', '6', '7',
+    '8', '9', 'A', 'B', 'C', 'D', 'E', 'F',
+};
+
+// uuid 문자열(8-4-4-4-12)에서 각 byte의 위치
+static const unsigned char UuidPos [EFUSE_UUID_BIN_SIZE] = {
+    0, 2, 4, 6, 9, 11, 14, 16, 19, 21, 24, 26, 28, 30, 32, 34,
+};
+
+//------------------------------------------------------------------------------
+// function prototype
+//------------------------------------------------------------------------------
+int  efuse_hex_byte     (const char *hex);
+int  efuse_uuid_parse   (const char *str, struct efuse_uuid *uuid);
+void efuse_uuid_format  (const struct efuse_uuid *uuid, char *str);
+void efuse_uuid_hex     (const struct efuse_uuid *uuid, char *hex);
+unsigned long long efuse_uuid_mac (const struct efuse_uuid *uuid);
+void efuse_uuid_set_mac (struct efuse_uuid *uuid, unsigned long long mac);
+int  efuse_uuid_generate(int board_id, const unsigned long long *macs, int cnt,
+                         char *out, size_t out_size);
+
+//------------------------------------------------------------------------------
+// hex 2문자 -> byte. return : 0 ~ 255, hex 문자가 아니면 -1
+//------------------------------------------------------------------------------
+int efuse_hex_byte (const char *hex)
+{
+    int hi = HexVal[(unsigned char)hex[0]], lo = HexVal[(unsigned char)hex[1]];
+
+    return (hi & lo & HEX_VALID) ? ((hi & 0x0F) << 4) | (lo & 0x0F) : -1;
+}
+
+//------------------------------------------------------------------------------
+// 36 문자 uuid 문자열 -> 16 byte. 대소문자 구분 없음.
+// return : 1 = success, 0 = 형식 error
+//------------------------------------------------------------------------------
+int efuse_uuid_parse (const char *str, struct efuse_uuid *uuid)
+{
+    int i, hi, lo, err;
+
+    if (strnlen (str, EFUSE_UUID_SIZE) != EFUSE_UUID_SIZE)
+        return 0;
+
+    // '-' 위치 확인과 hex 변환 결과를 모아서 한번만 판단.
+    err = (str[8] ^ '-') | (str[13] ^ '-') | (str[18] ^ '-') | (str[23] ^ '-');
+    for (i = 0; i < EFUSE_UUID_BIN_SIZE; i++) {
+        hi = HexVal[(unsigned char)str[UuidPos[i]]];
+        lo = HexVal[(unsigned char)str[UuidPos[i] + 1]];
+        err |= ~(hi & lo) & HEX_VALID;
+        uuid->b[i] = (unsigned char)(((hi & 0x0F) << 4) | (lo & 0x0F));
+    }
+    return err ? 0 : 1;
+}
+
+//------------------------------------------------------------------------------
+// 16 byte -> 36 문자 uuid 문자열 (대문자, NULL 포함 EFUSE_UUID_SIZE +1)
+//------------------------------------------------------------------------------
+void efuse_uuid_format (const struct efuse_uuid *uuid, char *str)
+{
+    int i;
+
+    str[8] = str[13] = str[18] = str[23] = '-';
+    for (i = 0; i < EFUSE_UUID_BIN_SIZE; i++) {
+        str[UuidPos[i]]     = HexChar[uuid->b[i] >> 4];
+        str[UuidPos[i] + 1] = HexChar[uuid->b[i] & 0x0F];
+    }
+    str[EFUSE_UUID_SIZE] = 0;
+}
+
+//------------------------------------------------------------------------------
+// 16 byte -> ioc_data.uuid 형식 32 문자 hex ('-' 없음, NULL 없음)
+//------------------------------------------------------------------------------
+void efuse_uuid_hex (const struct efuse_uuid *uuid, char *hex)
+{
+    int i;
+
+    for (i = 0; i < EFUSE_UUID_BIN_SIZE; i++) {
+        hex[i * 2]     = HexChar[uuid->b[i] >> 4];
+        hex[i * 2 + 1] = HexChar[uuid->b[i] & 0x0F];
+    }
+}
+
+//------------------------------------------------------------------------------
+// uuid 마지막 6 byte (mac, 0x001E06xxxxxx)
+//------------------------------------------------------------------------------
+unsigned long long efuse_uuid_mac (const struct efuse_uuid *uuid)
+{
+    const unsigned char *m = &uuid->b[EFUSE_UUID_BIN_SIZE - 6];
+
+    return ((unsigned long long)m[0] << 40) | ((unsigned long long)m[1] << 32) |
+           ((unsigned long long)m[2] << 24) | ((unsigned long long)m[3] << 16) |
+           ((unsigned long long)m[4] <<  8) |  (unsigned long long)m[5];
+}
+
+//------------------------------------------------------------------------------
+void efuse_uuid_set_mac (struct efuse_uuid *uuid, unsigned long long mac)
+{
+    unsigned char *m = &uuid->b[EFUSE_UUID_BIN_SIZE - 6];
+    int i;
+
+    for (i = 5; i >= 0; i--, mac >>= 8)
+        m[i] = (unsigned char)(mac & 0xFF);
+}
+
+//------------------------------------------------------------------------------
+// write용 uuid record 일괄 생성. record = random(v4) 10 byte + board mac 6 byte.
+// out : cnt * (EFUSE_UUID_SIZE +1) byte, 각 record는 NULL로 끝남.
+// random은 batch당 getrandom 1회로 읽어서 out buffer 뒤쪽에 임시 저장 후
+// 앞에서부터 format (record i의 출력은 record i+1의 random 영역 앞에서 끝남).
+// return : 생성한 record 수, 0 = error (board mac 범위 밖, buffer 부족 등)
+//------------------------------------------------------------------------------
+#define UUID_GEN_RAND_SIZE  (EFUSE_UUID_BIN_SIZE - 6)
+#define UUID_GEN_REC_SIZE   (EFUSE_UUID_SIZE + 1)
+
+int efuse_uuid_generate (int board_id, const unsigned long long *macs, int cnt,
+                         char *out, size_t out_size)
+{
+    unsigned long long mac_start;
+    unsigned char *rnd;
+    struct efuse_uuid uuid;
+    size_t len, done;
+    ssize_t ret;
+    int i, mac_cnt;
+
+    if ((macs == NULL) || (out == NULL) || (cnt <= 0) ||
+        (out_size < (size_t)cnt * UUID_GEN_REC_SIZE) ||
+        !efuse_get_mac_range (board_id, &mac_start, &mac_cnt))
+        return 0;
+
+    for (i = 0; i < cnt; i++)
+        if ((macs[i] < mac_start) || (macs[i] >= mac_start + mac_cnt))
+            return 0;
+
+    len = (size_t)cnt * UUID_GEN_RAND_SIZE;
+    rnd = (unsigned char *)out + (size_t)cnt * (UUID_GEN_REC_SIZE - UUID_GEN_RAND_SIZE);
+    for (done = 0; done < len; done += ret) {
+        // 256 byte 이상은 signal에 의해 일부만 읽힐 수 있음.
+        if ((ret = getrandom (rnd + done, len - done, 0)) < 0) {
+            if (errno == EINTR) {
+                ret = 0;
+                continue;
+            }
+            return 0;
+        }
+    }
+
+    for (i = 0; i < cnt; i++, rnd += UUID_GEN_RAND_SIZE) {
+        memcpy (uuid.b, rnd, UUID_GEN_RAND_SIZE);
+        // RFC 4122 version 4, variant 10xx
+        uuid.b[6] = (uuid.b[6] & 0x0F) | 0x40;
+        uuid.b[8] = (uuid.b[8] & 0x3F) | 0x80;
+        efuse_uuid_set_mac (&uuid, macs[i]);
+        efuse_uuid_format (&uuid, out + (size_t)i * UUID_GEN_REC_SIZE);
+    }
+    return cnt;
+}
+
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
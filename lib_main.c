@@ -20,6 +20,7 @@
 #include <limits.h>
 #include <netdb.h>
 #include <pthread.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdarg.h>
 #include <stdlib.h>
@@ -40,6 +41,19 @@
 #include <sys/ioctl.h>
 
 #include "lib_efuse.h"
+#include "lib_efuse_daemon.h"
+#include "lib_efuse_audit.h"
+#include "lib_efuse_macidx.h"
+#include "lib_efuse_batch.h"
+#include "lib_efuse_alloc.h"
+#include "lib_efuse_hotplug.h"
+#include "lib_efuse_metrics.h"
+#include "lib_efuse_journal.h"
+#include "lib_efuse_owner.h"
+#include "lib_efuse_trace.h"
+#include "lib_efuse_label.h"
+#include "lib_efuse_prov.h"
+#include "lib_efuse_board.h"
 
 //------------------------------------------------------------------------------
 #if defined(__LIB_EFUSE_APP__)
@@ -48,6 +62,30 @@
 const char *OPT_BOARD_NAME  = NULL;
 const char *OPT_ADD_CONTROL = NULL;
 const char *OPT_EFUSE_DATA  = NULL;
+const char *OPT_DAEMON_SOCK = NULL;
+const char *OPT_CLIENT_SOCK = NULL;
+const char *OPT_AUDIT_FILE  = NULL;
+const char *OPT_INDEX_FILE  = NULL;
+const char *OPT_HOTPLUG_MAP = NULL;
+const char *OPT_UEVENT_SOCK = NULL;
+const char *OPT_METRICS_FILE = NULL;
+const char *OPT_JOURNAL_FILE = NULL;
+const char *OPT_RESOLVE_ID   = NULL;
+const char *OPT_OWNER_FILE   = NULL;
+const char *OPT_TRACE_FILE   = NULL;
+const char *OPT_REPLAY_FILE  = NULL;
+const char *OPT_LABEL_PRINTER = NULL;
+const char *OPT_LABEL_SPOOL   = NULL;
+const char *OPT_PROV_FILE     = NULL;
+
+static efuse_journal *Journal = NULL;
+static efuse_owner   *Owner   = NULL;
+static efuse_trace   *Trace   = NULL;
+static efuse_label   *Label   = NULL;
+
+static int  OPT_AUDIT_THREADS = 4;
+static int  OPT_BATCH = 0;
+static double OPT_REPLAY_SPEED = 1.0;
 
 static char OPT_EFUSE_CONTROL = 0;
 
@@ -56,21 +94,65 @@ static char OPT_EFUSE_CONTROL = 0;
 static void print_usage(const char *prog)
 {
     puts("");
-    printf("Usage: %s [-rwecbm]\n", prog);
+    printf("Usage: %s [-rwecbmdsati] [log files...]\n", prog);
     puts("");
 
     puts("  -r --efuse_read         efuse read.\n"
          "  -w --efuse_write        efuse write\n"
          "  -e --efuse_erase        efuse erase\n"
          "  -c --efuse_check        efuse data vaild check\n"
-         "  -b --efuse_board        board name (default m1s), m1, m2, m1s, c4\n"
+         "  -b --efuse_board        board name m1, m1s, m2, c4, c5\n"
+         "                          (default detected board, otherwise m1s)\n"
          "  -m --efuse_mac          Display the mac in the read data\n"
+         "  -d --daemon <socket>    run as daemon on the unix socket\n"
+         "  -s --socket <socket>    send request to the daemon\n"
+         "                          (default env EFUSE_SOCKET)\n"
+         "  -a --audit <file>       uuid audit file(1 uuid per line) check\n"
+         "  -t --threads <n>        audit/prov thread count (default 4)\n"
+         "  -i --index <file>       ingest log files to the issued mac index\n"
+         "                          (report duplicated mac, -b : list holes)\n"
+         "     --batch              read commands from stdin, json line per command\n"
+         "                          (<board> <op> [data], op = read, write, verify,\n"
+         "                           erase, check, mac)\n"
+         "     --prov <file|->      write/verify the listed devices in parallel (-b board)\n"
+         "                          (line = <uuid> [<rw_control> <rw_file>])\n"
+         "     --hotplug <map file> provisioning when the board device appears\n"
+         "                          (mac from the allocation map of -b board)\n"
+         "     --uevent <socket>    hotplug event from the local socket\n"
+         "                          instead of kernel uevent (test)\n"
+         "     --metrics <file>     export per-phase timing metrics every second\n"
+         "                          (prometheus text file)\n"
+         "     --journal <file>     record write intent/result before the device write\n"
+         "                          (list in-flight operations of the previous run)\n"
+         "     --resolve <id|all>   close the listed in-flight operations (checked)\n"
+         "     --owner <file>       device owner table shared by the jig processes\n"
+         "                          (e.g. /dev/shm/lib_efuse.owner, no command : list)\n"
+         "     --trace <file>       record the device operations (binary trace file)\n"
+         "     --replay <file>      run the trace file on the simulation device\n"
+         "     --speed <x>          replay speed (default 1 = recorded timing, 0 = max)\n"
+         "     --label <printer>    print the mac label after write/verify (lpr, zpl)\n"
+         "                          (- = default printer, printed while the next write)\n"
+         "     --label_spool <dir>  save the label to the directory instead of lpr (test)\n"
          "\n"
          "   e.g) lib_efuse -b m1s -w dcbaa404-91bd-4a63-b5f1-001e06520000\n"
          "        lib_efuse -b m1s -c \n"
          "        lib_efuse -e\n"
          "        lib_efuse -r\n"
          "        lib_efuse -m\n"
+         "        lib_efuse -d /run/lib_efuse.sock\n"
+         "        lib_efuse -s /run/lib_efuse.sock -b m1s -c\n"
+         "        lib_efuse -a uuid_log.txt -t 8\n"
+         "        lib_efuse -i mac.idx station1.log station2.log\n"
+         "        printf 'm1s check\\nc4 mac\\n' | lib_efuse --batch\n"
+         "        printf '%s /sys/class/block/mmcblk1boot0/force_ro /dev/mmcblk1boot0\\n' \\\n"
+         "               dcbaa404-91bd-4a63-b5f1-001e06530001 | lib_efuse -b m1s --prov - -t 4\n"
+         "        lib_efuse -b m1s --hotplug m1s.map --metrics /var/lib/node_exporter/efuse.prom\n"
+         "        lib_efuse -b m1s --hotplug m1s.map --journal /var/lib/efuse/m1s.journal\n"
+         "        lib_efuse --journal /var/lib/efuse/m1s.journal --resolve all -r\n"
+         "        lib_efuse -b m2 --owner /dev/shm/lib_efuse.owner -w dcbaa404-91bd-4a63-b5f1-001e06520000\n"
+         "        lib_efuse -b m1s --hotplug m1s.map --trace m1s.trace\n"
+         "        lib_efuse --replay m1s.trace --speed 0\n"
+         "        lib_efuse -b m1s --hotplug m1s.map --label zebra\n"
     );
     exit(1);
 }
@@ -104,11 +186,29 @@ static void parse_opts (int argc, char *argv[])
             { "efuse_check",0, 0, 'c' },
             { "efuse_board",1, 0, 'b' },
             { "efuse_mac",  0, 0, 'm' },
+            { "daemon",     1, 0, 'd' },
+            { "socket",     1, 0, 's' },
+            { "audit",      1, 0, 'a' },
+            { "threads",    1, 0, 't' },
+            { "index",      1, 0, 'i' },
+            { "batch",      0, 0, 'B' },
+            { "prov",       1, 0, 'W' },
+            { "hotplug",    1, 0, 'H' },
+            { "uevent",     1, 0, 'U' },
+            { "metrics",    1, 0, 'M' },
+            { "journal",    1, 0, 'J' },
+            { "resolve",    1, 0, 'R' },
+            { "owner",      1, 0, 'O' },
+            { "trace",      1, 0, 'T' },
+            { "replay",     1, 0, 'P' },
+            { "speed",      1, 0, 'S' },
+            { "label",      1, 0, 'L' },
+            { "label_spool",1, 0, 'Q' },
             { NULL, 0, 0, 0 },
         };
         int c;
 
-        c = getopt_long(argc, argv, "rw:ecb:m", lopts, NULL);
+        c = getopt_long(argc, argv, "rw:ecb:md:s:a:t:i:", lopts, NULL);
 
         if (c == -1)
             break;
@@ -135,6 +235,60 @@ static void parse_opts (int argc, char *argv[])
             toupperstr(optarg);
             OPT_BOARD_NAME = optarg;
             break;
+        case 'd':
+            OPT_DAEMON_SOCK   = optarg;
+            break;
+        case 's':
+            OPT_CLIENT_SOCK   = optarg;
+            break;
+        case 'a':
+            OPT_AUDIT_FILE    = optarg;
+            break;
+        case 't':
+            OPT_AUDIT_THREADS = atoi (optarg);
+            break;
+        case 'i':
+            OPT_INDEX_FILE    = optarg;
+            break;
+        case 'B':
+            OPT_BATCH         = 1;
+            break;
+        case 'W':
+            OPT_PROV_FILE     = optarg;
+            break;
+        case 'H':
+            OPT_HOTPLUG_MAP   = optarg;
+            break;
+        case 'U':
+            OPT_UEVENT_SOCK   = optarg;
+            break;
+        case 'M':
+            OPT_METRICS_FILE  = optarg;
+            break;
+        case 'J':
+            OPT_JOURNAL_FILE  = optarg;
+            break;
+        case 'R':
+            OPT_RESOLVE_ID    = optarg;
+            break;
+        case 'O':
+            OPT_OWNER_FILE    = optarg;
+            break;
+        case 'T':
+            OPT_TRACE_FILE    = optarg;
+            break;
+        case 'P':
+            OPT_REPLAY_FILE   = optarg;
+            break;
+        case 'S':
+            OPT_REPLAY_SPEED  = atof (optarg);
+            break;
+        case 'L':
+            OPT_LABEL_PRINTER = optarg;
+            break;
+        case 'Q':
+            OPT_LABEL_SPOOL   = optarg;
+            break;
         default:
             print_usage(argv[0]);
             break;
@@ -142,6 +296,510 @@ static void parse_opts (int argc, char *argv[])
     }
 }
 
+//------------------------------------------------------------------------------
+static int board_id_opt (void)
+{
+    int board_id;
+
+    if (OPT_BOARD_NAME != NULL) {
+        if ((board_id = efuse_board_find (OPT_BOARD_NAME)) < 0)
+            print_usage ("unknown board");
+        return board_id;
+    }
+    // -b 가 없으면 실행중인 board (확인 안되면 m1s)
+    board_id = efuse_board_detect ();
+    return (board_id < 0) ? eBOARD_ID_M1S : board_id;
+}
+
+//------------------------------------------------------------------------------
+// daemon/batch/prov/hotplug mode의 board context에도 default context와 같은 설정 적용.
+//------------------------------------------------------------------------------
+static void ctx_init (void *arg, efuse_ctx *ctx)
+{
+    (void)arg;
+    efuse_ctx_set_journal (ctx, Journal);
+    efuse_ctx_set_owner   (ctx, Owner);
+    if (Trace != NULL)
+        efuse_trace_attach (Trace, ctx);
+    efuse_ctx_set_label   (ctx, Label);
+}
+
+//------------------------------------------------------------------------------
+static void daemon_signal (int signo)
+{
+    (void)signo;
+    efuse_daemon_stop ();
+}
+
+//------------------------------------------------------------------------------
+// daemon client mode. 출력 형식은 기존 app과 동일하게 유지.
+//------------------------------------------------------------------------------
+static int client_main (const char *sock_path)
+{
+    char efuse_data[EFUSE_UUID_SIZE+1];
+    int board_id = board_id_opt (), ret = 0;
+
+    memset  (efuse_data, 0, sizeof(efuse_data));
+    switch (OPT_EFUSE_CONTROL) {
+        case EFUSE_WRITE:
+            if (OPT_EFUSE_DATA != NULL) {
+                memcpy (efuse_data, OPT_EFUSE_DATA, EFUSE_UUID_SIZE);
+                toupperstr(efuse_data);
+            }
+            ret = efuse_client_request (sock_path, EFUSE_SRV_WRITE, board_id, efuse_data);
+            printf ("%s, eFuse data write. efuse = %s\n",
+                ret > 0 ? "success" : "error", efuse_data);
+            break;
+        case EFUSE_ERASE:
+            ret = efuse_client_request (sock_path, EFUSE_SRV_ERASE, board_id, efuse_data);
+            printf ("%s, eFuse data erase.\n", ret > 0 ? "success" : "error");
+            break;
+        case EFUSE_READ:
+            if (OPT_ADD_CONTROL != NULL)
+                break;
+            ret = efuse_client_request (sock_path, EFUSE_SRV_READ, board_id, efuse_data);
+            printf ("%s, eFuse data read. efuse = %s\n",
+                ret > 0 ? "success" : "error", efuse_data);
+            break;
+        default :
+            break;
+    }
+    if (ret < 0)
+        return 1;
+
+    if (OPT_ADD_CONTROL != NULL) {
+        if (!strncmp (OPT_ADD_CONTROL, "mac_read", strlen("mac_read")-1)) {
+            char *mac = efuse_data;
+            ret = efuse_client_request (sock_path, EFUSE_SRV_MAC, board_id, efuse_data);
+            if (ret > 0)
+                printf ("mac : %c%c:%c%c:%c%c:%c%c:%c%c:%c%c\n",
+                    mac[0], mac[1], mac[2], mac[3],
+                    mac[4], mac[5], mac[6], mac[7],
+                    mac[8], mac[9], mac[10],mac[11]);
+        }
+        if (!strncmp (OPT_ADD_CONTROL, "valid_check", strlen("valid_check")-1)) {
+            ret = efuse_client_request (sock_path, EFUSE_SRV_CHECK, board_id, efuse_data);
+            if (ret > 0)
+                printf("success, eFuse data is valid \n");
+            else
+                printf("error, eFuse data is not valid \n");
+        }
+    }
+    return (ret < 0) ? 1 : 0;
+}
+
+//------------------------------------------------------------------------------
+// audit mode. 분류 실패 record 출력 후 board별 summary 출력.
+//------------------------------------------------------------------------------
+static pthread_mutex_t AuditLock = PTHREAD_MUTEX_INITIALIZER;
+
+static void audit_report (void *arg, long offset, const char *line, int len, int result)
+{
+    const char *reason = (result == eAUDIT_FOREIGN) ? "foreign" :
+                         (result == eAUDIT_UNKNOWN) ? "unknown" : "invalid";
+    (void)arg;
+
+    if (len > 64)
+        len = 64;
+    pthread_mutex_lock (&AuditLock);
+    printf ("%s, offset %ld : %.*s\n", reason, offset, len, line);
+    pthread_mutex_unlock (&AuditLock);
+}
+
+static int audit_main (const char *path)
+{
+    struct efuse_audit_stat stat;
+    int i;
+
+    if (!efuse_audit_file (path, OPT_AUDIT_THREADS, &stat, audit_report, NULL)) {
+        printf ("error, audit file read. file = %s\n", path);
+        return 1;
+    }
+    printf ("records : %ld, valid : %ld, invalid : %ld, foreign : %ld, unknown : %ld\n",
+        stat.records, stat.valid, stat.invalid, stat.foreign, stat.unknown);
+    for (i = 0; i < eBOARD_ID_END; i++)
+        printf ("  %-4s : %ld\n", efuse_board_name (i), stat.board[i]);
+    printf ("  (C4 legacy 0x001E0648xxxx : %ld)\n", stat.c4_legacy);
+
+    return (stat.records == stat.valid) ? 0 : 1;
+}
+
+//------------------------------------------------------------------------------
+// mac index mode. log file들을 ingest 하여 중복 mac 출력 후 board별 summary 출력.
+//------------------------------------------------------------------------------
+static void index_report (void *arg, const char *log_path, long offset,
+                          unsigned long long mac, int board_id)
+{
+    int *dups = (int *)arg;
+
+    (*dups)++;
+    printf ("duplicate, %s offset %ld : mac %012llX (board %d)\n",
+        log_path, offset, mac, board_id);
+}
+
+static void index_hole (void *arg, unsigned long long mac_start, int cnt)
+{
+    (void)arg;
+    printf ("hole, mac %012llX ~ %012llX (%d)\n", mac_start, mac_start + cnt - 1, cnt);
+}
+
+static int index_main (const char *idx_file, int argc, char **argv)
+{
+    struct efuse_macidx_stat stat;
+    efuse_macidx *idx;
+    int i, dups = 0;
+    long records;
+
+    if ((idx = efuse_macidx_open (idx_file)) == NULL) {
+        printf ("error, mac index open. file = %s\n", idx_file);
+        return 1;
+    }
+    for (i = 0; i < argc; i++) {
+        if ((records = efuse_macidx_ingest (idx, argv[i], index_report, &dups)) < 0)
+            printf ("error, log file read. file = %s\n", argv[i]);
+        else
+            printf ("%s : %ld records\n", argv[i], records);
+    }
+    for (i = 0; i < eBOARD_ID_END; i++) {
+        efuse_macidx_stat (idx, i, &stat);
+        printf ("  %-4s : issued %ld, duplicated %ld, holes %ld, last %012llX\n",
+            efuse_board_name (i), stat.issued, stat.dups, stat.holes, stat.mac_last);
+    }
+    if (OPT_BOARD_NAME != NULL)
+        efuse_macidx_holes (idx, board_id_opt (), index_hole, NULL);
+
+    efuse_macidx_close (idx);
+    return dups ? 1 : 0;
+}
+
+//------------------------------------------------------------------------------
+// provisioning mode. job list의 device들을 -t 개의 thread로 동시에 write/verify.
+// device path가 없는 line은 board 기본 device 사용.
+//------------------------------------------------------------------------------
+struct prov_line {
+    char    uuid [64];
+    char    rw_control [PATH_MAX];
+    char    rw_file [PATH_MAX];
+    int     has_path;
+};
+
+static int prov_main (const char *path)
+{
+    struct efuse_prov_report report;
+    struct efuse_prov_job *jobs = NULL;
+    struct prov_line *lines = NULL, *p;
+    char buf [PATH_MAX * 2 + 64];
+    int board_id = board_id_opt (), cnt = 0, max = 0, n, i, ret = 1;
+    FILE *fp = strcmp (path, "-") ? fopen (path, "r") : stdin;
+
+    if (fp == NULL) {
+        printf ("error, prov file open. file = %s\n", path);
+        return 1;
+    }
+    // job은 line의 path를 참조하므로 모두 읽은 후 생성.
+    while (fgets (buf, sizeof(buf), fp) != NULL) {
+        if (cnt == max) {
+            max = max ? max * 2 : 16;
+            if ((p = realloc (lines, sizeof(*lines) * max)) == NULL) {
+                printf ("error, prov job alloc.\n");
+                goto out;
+            }
+            lines = p;
+        }
+        n = sscanf (buf, "%63s %4095s %4095s",
+                    lines[cnt].uuid, lines[cnt].rw_control, lines[cnt].rw_file);
+        if (n < 1)
+            continue;
+        lines[cnt++].has_path = (n == 3);
+    }
+    if (!cnt) {
+        printf ("error, prov job empty. file = %s\n", path);
+        goto out;
+    }
+    if ((jobs = malloc (sizeof(*jobs) * cnt)) == NULL) {
+        printf ("error, prov job alloc.\n");
+        goto out;
+    }
+    for (i = 0; i < cnt; i++) {
+        if (!efuse_prov_job_init (&jobs[i], board_id,
+                lines[i].has_path ? lines[i].rw_control : NULL,
+                lines[i].has_path ? lines[i].rw_file    : NULL, lines[i].uuid)) {
+            printf ("error, prov job %d uuid. (%s)\n", i, lines[i].uuid);
+            goto out;
+        }
+    }
+    efuse_prov_run (jobs, cnt, OPT_AUDIT_THREADS, &report);
+    for (i = 0; i < cnt; i++) {
+        printf ("%s, prov job %d, eFuse data write. efuse = %s, device = %s (%ld us)\n",
+            jobs[i].status ? "success" : "error", i, jobs[i].read_data,
+            lines[i].has_path ? lines[i].rw_file : efuse_board_info (board_id)->rw_file,
+            jobs[i].elapsed_us);
+    }
+    printf ("prov, %d job(s), ok %d, fail %d, wall %ld us, max job %ld us\n",
+        report.job_cnt, report.ok_cnt, report.fail_cnt, report.wall_us, report.max_job_us);
+    ret = report.fail_cnt ? 1 : 0;
+out:
+    free (jobs);
+    free (lines);
+    if (fp != stdin)
+        fclose (fp);
+    return ret;
+}
+
+//------------------------------------------------------------------------------
+// batch mode. library debug message가 json 출력에 섞이지 않도록 stdout은 stderr로 변경.
+//------------------------------------------------------------------------------
+static int batch_main (void)
+{
+    struct efuse_batch_report report;
+    FILE *out;
+    int fd, ret;
+
+    if (((fd = dup (STDOUT_FILENO)) < 0) || ((out = fdopen (fd, "w")) == NULL)) {
+        printf ("error, batch output open.\n");
+        return 1;
+    }
+    dup2 (STDERR_FILENO, STDOUT_FILENO);
+
+    ret = efuse_batch_run (stdin, out, &report);
+    fclose (out);
+    return ret ? 0 : 1;
+}
+
+//------------------------------------------------------------------------------
+// hotplug mode. board가 연결되면 이미 valid한 uuid가 있는 경우 제외하고
+// allocation map의 다음 mac으로 write/verify.
+//------------------------------------------------------------------------------
+static void hotplug_signal (int signo)
+{
+    (void)signo;
+    efuse_hotplug_stop ();
+}
+
+static int hotplug_prov (void *arg, int slot, efuse_ctx *ctx)
+{
+    char efuse_data[EFUSE_UUID_SIZE+1], read_data[EFUSE_UUID_SIZE+1];
+    efuse_alloc *alloc = (efuse_alloc *)arg;
+    unsigned long long mac;
+    int wv;
+
+    memset (efuse_data, 0, sizeof(efuse_data));
+    if (efuse_ctx_control (ctx, efuse_data, EFUSE_READ) &&
+        efuse_ctx_valid_check (ctx, efuse_data)) {
+        printf ("hotplug slot %d, already provisioned. efuse = %s\n", slot, efuse_data);
+        return 1;
+    }
+    if (!efuse_alloc_generate (alloc, 1, &mac, efuse_data, sizeof(efuse_data))) {
+        printf ("error, hotplug slot %d, mac allocate.\n", slot);
+        return 0;
+    }
+    ctx_init (NULL, ctx);
+    wv = efuse_ctx_write_verify (ctx, efuse_data, read_data);
+    if (wv != eEFUSE_WV_WRITTEN) {
+        efuse_alloc_release (alloc, mac);
+        printf ("error, hotplug slot %d, eFuse data write. (%s)\n", slot,
+            efuse_strerror (efuse_ctx_last_error (ctx)));
+        return 0;
+    }
+    efuse_alloc_commit (alloc, mac);
+    printf ("success, hotplug slot %d, eFuse data write. efuse = %s\n", slot, read_data);
+    return 1;
+}
+
+static int hotplug_main (const char *map_file)
+{
+    struct efuse_hotplug_slot slot = { board_id_opt (), NULL, NULL };
+    struct efuse_hotplug_report report;
+    efuse_alloc *alloc;
+    int fd, ret;
+
+    if ((alloc = efuse_alloc_open (map_file, slot.board_id)) == NULL) {
+        printf ("error, mac allocation map open. file = %s\n", map_file);
+        return 1;
+    }
+    if ((fd = efuse_uevent_open (OPT_UEVENT_SOCK)) < 0) {
+        printf ("error, uevent open.\n");
+        efuse_alloc_close (alloc);
+        return 1;
+    }
+    signal (SIGINT,  hotplug_signal);
+    signal (SIGTERM, hotplug_signal);
+
+    ret = efuse_hotplug_run (fd, &slot, 1, hotplug_prov, alloc, &report);
+    printf ("events : %ld, provisioning : %ld, success : %ld, fail : %ld\n",
+        report.event_cnt, report.trigger_cnt, report.ok_cnt, report.fail_cnt);
+
+    efuse_uevent_close (fd, OPT_UEVENT_SOCK);
+    efuse_alloc_close (alloc);
+    return ret ? 0 : 1;
+}
+
+//------------------------------------------------------------------------------
+// journal. 이전 실행에서 완료되지 않은 operation만 출력 (해당 board만 확인).
+//------------------------------------------------------------------------------
+static void journal_report (void *arg, const struct efuse_journal_entry *e)
+{
+    char date[32];
+    time_t t = e->time;
+
+    (void)arg;
+    strftime (date, sizeof(date), "%Y-%m-%d %H:%M:%S", localtime (&t));
+    printf ("journal, in-flight id %llu : %s %s, %s, uuid = %s, device = %s (%s)\n",
+        e->id, efuse_board_name (e->board_id), efuse_journal_op_name (e->op),
+        efuse_journal_state_name (e->state), e->uuid[0] ? e->uuid : "-", e->device, date);
+}
+
+static void journal_resolve (void *arg, const struct efuse_journal_entry *e)
+{
+    unsigned long long *ids = (unsigned long long *)arg;
+
+    if ((OPT_RESOLVE_ID == NULL) || (ids[0] >= 1024))
+        return;
+    if (!strcmp (OPT_RESOLVE_ID, "all") || (strtoull (OPT_RESOLVE_ID, NULL, 10) == e->id))
+        ids[++ids[0]] = e->id;
+}
+
+static void journal_close (void)
+{
+    efuse_journal_close (Journal);
+    Journal = NULL;
+}
+
+static int journal_main (const char *path)
+{
+    unsigned long long ids[1024 + 1];
+    int i, cnt;
+
+    if ((Journal = efuse_journal_open (path)) == NULL) {
+        printf ("error, journal open. file = %s\n", path);
+        return 0;
+    }
+    atexit (journal_close);
+
+    cnt = efuse_journal_inflight (Journal, journal_report, NULL);
+    printf ("journal, %d in-flight operation(s). file = %s\n", cnt, path);
+
+    ids[0] = 0;
+    efuse_journal_inflight (Journal, journal_resolve, ids);
+    for (i = 1; i <= (int)ids[0]; i++) {
+        if (efuse_journal_state (Journal, ids[i], eJOURNAL_RESOLVED))
+            printf ("journal, resolved id %llu\n", ids[i]);
+    }
+    efuse_journal_sync (Journal);
+    efuse_set_journal (Journal);
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+// device owner table. 같은 host의 다른 process와 device write 순서 조정.
+//------------------------------------------------------------------------------
+static void owner_report (void *arg, const struct efuse_owner_info *info)
+{
+    char date[32] = "-";
+    time_t t = info->since;
+
+    (void)arg;
+    if (info->pid)
+        strftime (date, sizeof(date), "%Y-%m-%d %H:%M:%S", localtime (&t));
+    printf ("owner, %s : pid %d (%s), waiters %d, acquired %llu, contended %llu, stale %llu\n",
+        info->device, info->pid, date, info->waiters,
+        info->acquired, info->contended, info->stale);
+}
+
+static void owner_close (void)
+{
+    efuse_owner_close (Owner);
+    Owner = NULL;
+}
+
+static int owner_main (const char *path)
+{
+    if ((Owner = efuse_owner_open (path)) == NULL) {
+        printf ("error, owner table open. file = %s\n", path);
+        return 0;
+    }
+    atexit (owner_close);
+    efuse_set_owner (Owner);
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+// device operation trace. 기록 (--trace) 및 simulation device에서 실행 (--replay).
+//------------------------------------------------------------------------------
+static void trace_close (void)
+{
+    if (!efuse_trace_close (Trace))
+        printf ("error, trace file write. file = %s\n", OPT_TRACE_FILE);
+    Trace = NULL;
+}
+
+static int trace_main (const char *path)
+{
+    if ((Trace = efuse_trace_open (path)) == NULL) {
+        printf ("error, trace file open. file = %s\n", path);
+        return 0;
+    }
+    atexit (trace_close);
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+// mac label print queue. write/verify 완료된 board의 label을 background로 출력.
+//------------------------------------------------------------------------------
+static void label_close (void)
+{
+    struct efuse_label_stat st;
+
+    // 남은 label 출력 후 종료
+    efuse_label_flush    (Label);
+    efuse_label_get_stat (Label, &st);
+    printf ("label, printed %ld (%ld job(s)), failed %ld, dropped %ld\n",
+        st.printed, st.jobs, st.failed, st.dropped);
+    efuse_set_label   (NULL);
+    efuse_label_close (Label);
+    Label = NULL;
+}
+
+static int label_main (const char *printer, const char *spool_dir)
+{
+    struct efuse_label_cfg cfg;
+
+    memset (&cfg, 0, sizeof(cfg));
+    cfg.printer         = (printer != NULL) && strcmp (printer, "-") ? printer : NULL;
+    cfg.spool_dir       = spool_dir;
+    cfg.push_timeout_ms = -1;
+    if ((Label = efuse_label_open (&cfg)) == NULL) {
+        printf ("error, label print queue. (%s)\n", strerror (errno));
+        return 0;
+    }
+    atexit (label_close);
+    efuse_set_label (Label);
+    return 1;
+}
+
+static int replay_main (const char *path, double speed)
+{
+    struct efuse_trace_report r;
+    int i;
+
+    if (!efuse_trace_replay (path, speed, &r)) {
+        printf ("error, trace replay. file = %s\n", path);
+        return 1;
+    }
+    for (i = 0; i < eSIM_OP_END; i++) {
+        if (!r.op_cnt[i])
+            continue;
+        printf ("replay, %-9s : %6ld op(s), record avg %8lld ns max %8lld ns, "
+                "replay avg %8lld ns max %8lld ns\n",
+            efuse_trace_op_name (i), r.op_cnt[i],
+            r.rec_ns[i] / r.op_cnt[i], r.rec_max_ns[i],
+            r.play_ns[i] / r.op_cnt[i], r.play_max_ns[i]);
+    }
+    printf ("replay, span record %lld us, replay %lld us, mismatch %ld, skipped %ld\n",
+        r.rec_span_ns / 1000, r.play_span_ns / 1000, r.mismatch, r.skipped);
+    return r.mismatch ? 1 : 0;
+}
+
 //------------------------------------------------------------------------------
 int main (int argc, char **argv)
 {
@@ -153,28 +811,69 @@ int main (int argc, char **argv)
         print_usage("argc count < 2");
     memset  (efuse_data, 0, sizeof(efuse_data));
 
-    // default board is m1s
-    efuse_set_board (eBOARD_ID_M1S);
+    // 모든 mode 종료시 마지막 값 저장.
+    if ((OPT_METRICS_FILE != NULL) && efuse_metrics_start (OPT_METRICS_FILE, 1000))
+        atexit (efuse_metrics_stop);
+    if ((OPT_JOURNAL_FILE != NULL) && !journal_main (OPT_JOURNAL_FILE))
+        return 1;
+    if ((OPT_OWNER_FILE != NULL) && !owner_main (OPT_OWNER_FILE))
+        return 1;
+    if ((OPT_TRACE_FILE != NULL) && !trace_main (OPT_TRACE_FILE))
+        return 1;
+    if (((OPT_LABEL_PRINTER != NULL) || (OPT_LABEL_SPOOL != NULL)) &&
+        !label_main (OPT_LABEL_PRINTER, OPT_LABEL_SPOOL))
+        return 1;
+    if (OPT_REPLAY_FILE != NULL)
+        return replay_main (OPT_REPLAY_FILE, OPT_REPLAY_SPEED);
 
-    if (OPT_BOARD_NAME != NULL) {
-        if      (!strncmp (OPT_BOARD_NAME, "M1", sizeof("M1")))
-            efuse_set_board (eBOARD_ID_M2);
-        else if (!strncmp (OPT_BOARD_NAME, "M2", sizeof("M2")))
-            efuse_set_board (eBOARD_ID_C4);
-        else if (!strncmp (OPT_BOARD_NAME, "C4", sizeof("C4")))
-            efuse_set_board (eBOARD_ID_C4);
-        else if (!strncmp (OPT_BOARD_NAME, "C5", sizeof("C5")))
-            efuse_set_board (eBOARD_ID_C5);
-        else
-            efuse_set_board (eBOARD_ID_M1S);
+    efuse_daemon_set_ctx_init (ctx_init, NULL);
+    efuse_batch_set_ctx_init  (ctx_init, NULL);
+    efuse_prov_set_ctx_init   (ctx_init, NULL);
+
+    if (OPT_DAEMON_SOCK != NULL) {
+        signal (SIGINT,  daemon_signal);
+        signal (SIGTERM, daemon_signal);
+        return efuse_daemon_run (OPT_DAEMON_SOCK) ? 0 : 1;
     }
+    if (OPT_AUDIT_FILE != NULL)
+        return audit_main (OPT_AUDIT_FILE);
+    if (OPT_BATCH)
+        return batch_main ();
+    if (OPT_PROV_FILE != NULL)
+        return prov_main (OPT_PROV_FILE);
+    if (OPT_HOTPLUG_MAP != NULL)
+        return hotplug_main (OPT_HOTPLUG_MAP);
+    if (OPT_INDEX_FILE != NULL)
+        return index_main (OPT_INDEX_FILE, argc - optind, argv + optind);
+    if (OPT_CLIENT_SOCK == NULL)
+        OPT_CLIENT_SOCK = getenv ("EFUSE_SOCKET");
+    if (OPT_CLIENT_SOCK != NULL)
+        return client_main (OPT_CLIENT_SOCK);
+
+    efuse_set_board (board_id_opt ());
+    if (Trace != NULL)
+        efuse_trace_attach (Trace, efuse_get_ctx ());
 
+    if ((Owner != NULL) && !OPT_EFUSE_CONTROL && (OPT_ADD_CONTROL == NULL)) {
+        printf ("owner, %d device(s). file = %s\n",
+            efuse_owner_list (Owner, owner_report, NULL), OPT_OWNER_FILE);
+        return 0;
+    }
     switch (OPT_EFUSE_CONTROL) {
         case EFUSE_WRITE:
             if (OPT_EFUSE_DATA != NULL) {
                 memcpy (efuse_data, OPT_EFUSE_DATA, EFUSE_UUID_SIZE);
                 toupperstr(efuse_data);
             }
+            // label은 read back 확인 후 출력
+            if (Label != NULL) {
+                int wv = efuse_ctx_write_verify (efuse_get_ctx (), efuse_data, NULL);
+
+                printf ("%s, eFuse data write. efuse = %s\n",
+                    (wv == eEFUSE_WV_WRITTEN) || (wv == eEFUSE_WV_UNCHANGED) ?
+                    "success" : "error", efuse_data);
+                break;
+            }
         case EFUSE_READ: case EFUSE_ERASE:
             efuse_control (efuse_data, OPT_EFUSE_CONTROL);
             break;
@@ -182,7 +881,9 @@ int main (int argc, char **argv)
             break;
     }
     if (OPT_ADD_CONTROL != NULL) {
-        efuse_control (efuse_data, EFUSE_READ);
+        // -c 는 위에서 이미 read 함.
+        if (OPT_EFUSE_CONTROL != EFUSE_READ)
+            efuse_control (efuse_data, EFUSE_READ);
         if (!strncmp (OPT_ADD_CONTROL, "mac_read", strlen("mac_read")-1)) {
             char mac[MAC_STR_SIZE];
             memset (mac, 0, sizeof(mac));
@@ -0,0 +1,132 @@
+//------------------------------------------------------------------------------
+/**
+ * @file test.h
+ * @author charles-park (charles.park@hardkernel.com)
+ * @brief lib_efuse test helper (make test).
+ * @version 0.2
+ * @date 2023-09-22
+ *
+ * @package apt install cups cups-bsd
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#ifndef __LIB_EFUSE_TEST_H__
+#define __LIB_EFUSE_TEST_H__
+
+//------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <limits.h>
+#include <dirent.h>
+#include <time.h>
+#include <fcntl.h>
+
+#include "lib_efuse.h"
+#include "lib_efuse_sim.h"
+
+//------------------------------------------------------------------------------
+// test program 1개 = test/test_xxx.c 1개. 실패한 check는 file:line 출력,
+// main은 test_result()를 return (0 = 모두 성공).
+//------------------------------------------------------------------------------
+static int TestCnt  = 0;
+static int TestFail = 0;
+
+#define test_check(cond)    do {                                            \
+    TestCnt++;                                                              \
+    if (!(cond)) {                                                          \
+        TestFail++;                                                         \
+        printf ("fail, %s:%d : %s\n", __FILE__, __LINE__, #cond);           \
+    }                                                                       \
+} while (0)
+
+// 정수 비교 (error code 등). 실패시 실제 값 출력.
+#define test_check_int(val, expect)  do {                                   \
+    long _v = (long)(val), _e = (long)(expect);                             \
+    TestCnt++;                                                              \
+    if (_v != _e) {                                                         \
+        TestFail++;                                                         \
+        printf ("fail, %s:%d : %s = %ld, expected %ld\n",                   \
+            __FILE__, __LINE__, #val, _v, _e);                              \
+    }                                                                       \
+} while (0)
+
+//------------------------------------------------------------------------------
+static inline long long test_now_ms (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000LL;
+}
+
+//------------------------------------------------------------------------------
+static inline void test_sleep_ms (int ms)
+{
+    struct timespec ts = { ms / 1000, (ms % 1000) * 1000000L };
+
+    nanosleep (&ts, NULL);
+}
+
+//------------------------------------------------------------------------------
+// /tmp/lib_efuse_test.XXXXXX 생성. return : 0 = 실패
+//------------------------------------------------------------------------------
+static inline int test_tmpdir (char *path, int size)
+{
+    snprintf (path, size, "/tmp/lib_efuse_test.XXXXXX");
+    return mkdtemp (path) != NULL;
+}
+
+//------------------------------------------------------------------------------
+// test directory 삭제 (하위 directory 없음)
+//------------------------------------------------------------------------------
+static inline void test_rmdir (const char *path)
+{
+    char file [PATH_MAX];
+    struct dirent *d;
+    DIR *dir;
+
+    if ((dir = opendir (path)) == NULL)
+        return;
+    while ((d = readdir (dir)) != NULL) {
+        if (!strcmp (d->d_name, ".") || !strcmp (d->d_name, ".."))
+            continue;
+        snprintf (file, sizeof(file), "%s/%s", path, d->d_name);
+        unlink (file);
+    }
+    closedir (dir);
+    rmdir (path);
+}
+
+//------------------------------------------------------------------------------
+// simulation emmc device의 force_ro 값 ('0' = unlock, '1' = lock, 0 = error)
+//------------------------------------------------------------------------------
+static inline char test_force_ro (efuse_sim *sim, const char *rw_control)
+{
+    const struct efuse_io *io = efuse_sim_io (sim);
+    char ro = 0;
+    int fd;
+
+    if ((fd = io->open (io->priv, rw_control, O_RDONLY)) < 0)
+        return 0;
+    if (io->pread (io->priv, fd, &ro, 1, 0) != 1)
+        ro = 0;
+    io->close (io->priv, fd);
+    return ro;
+}
+
+//------------------------------------------------------------------------------
+static inline int test_result (const char *name)
+{
+    printf ("%s, %s : %d check(s), %d fail\n",
+        TestFail ? "error" : "success", name, TestCnt, TestFail);
+    return TestFail ? 1 : 0;
+}
+
+//------------------------------------------------------------------------------
+#endif  // #ifndef __LIB_EFUSE_TEST_H__
+//------------------------------------------------------------------------------
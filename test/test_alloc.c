@@ -0,0 +1,231 @@
+//------------------------------------------------------------------------------
+/**
+ * @file test_alloc.c
+ * @author charles-park (charles.park@hardkernel.com)
+ * @brief mac allocation map test (중복, 반환된 hole 재사용, 재시작, crash 후 open).
+ * @version 0.2
+ * @date 2023-09-22
+ *
+ * @package apt install cups cups-bsd
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "lib_efuse.h"
+#include "lib_efuse_alloc.h"
+#include "test.h"
+
+//------------------------------------------------------------------------------
+// thread 4개가 각각 RESERVE_CNT개 reserve (batch 크기 다르게)
+//------------------------------------------------------------------------------
+#define THREAD_CNT  4
+#define RESERVE_CNT 2000
+
+static char Dir [64];
+static char Map [128];
+static unsigned long long MacStart;
+static int MacCnt;
+
+static efuse_alloc *Alloc;
+static unsigned long long Macs [THREAD_CNT][RESERVE_CNT];
+
+//------------------------------------------------------------------------------
+static void *reserve_thread (void *arg)
+{
+    int t = (int)(long)arg, got = 0, n;
+
+    while (got < RESERVE_CNT) {
+        n = t + 1;
+        if (n > RESERVE_CNT - got)
+            n = RESERVE_CNT - got;
+        if ((n = efuse_alloc_reserve_batch (Alloc, &Macs[t][got], n)) <= 0)
+            break;
+        got += n;
+    }
+    return (void *)(long)got;
+}
+
+//------------------------------------------------------------------------------
+// 모든 thread의 reserve 결과가 범위 안이고 중복 없는지 확인
+//------------------------------------------------------------------------------
+static int reserve_unique (void)
+{
+    unsigned char *seen = calloc (MacCnt, 1);
+    int t, i, idx, ret = 1;
+
+    for (t = 0; (t < THREAD_CNT) && ret; t++) {
+        for (i = 0; i < RESERVE_CNT; i++) {
+            idx = (int)(Macs[t][i] - MacStart);
+            if ((Macs[t][i] < MacStart) || (idx >= MacCnt) || seen[idx]) {
+                ret = 0;
+                break;
+            }
+            seen[idx] = 1;
+        }
+    }
+    free (seen);
+    return ret;
+}
+
+//------------------------------------------------------------------------------
+// 여러 thread 동시 reserve : 중복 없음
+//------------------------------------------------------------------------------
+static void test_reserve (void)
+{
+    struct efuse_alloc_stat stat;
+    pthread_t thread [THREAD_CNT];
+    void *got;
+    long t;
+
+    test_check ((Alloc = efuse_alloc_open (Map, eBOARD_ID_M1S)) != NULL);
+    for (t = 0; t < THREAD_CNT; t++)
+        test_check_int (pthread_create (&thread[t], NULL, reserve_thread, (void *)t), 0);
+    for (t = 0; t < THREAD_CNT; t++) {
+        pthread_join (thread[t], &got);
+        test_check_int ((int)(long)got, RESERVE_CNT);
+    }
+    test_check (reserve_unique ());
+
+    test_check (efuse_alloc_stat (Alloc, &stat));
+    test_check_int (stat.mac_cnt,       MacCnt);
+    test_check_int (stat.reserved_cnt,  THREAD_CNT * RESERVE_CNT);
+    test_check_int (stat.committed_cnt, 0);
+    test_check_int (stat.free_cnt,      MacCnt - THREAD_CNT * RESERVE_CNT);
+}
+
+//------------------------------------------------------------------------------
+// commit/release, 반환된 mac(hole)을 먼저 재사용, commit된 mac은 반환 불가
+//------------------------------------------------------------------------------
+static void test_hole (void)
+{
+    struct efuse_alloc_stat stat;
+    unsigned long long mac, hole;
+    int i;
+
+    // thread 0의 mac 모두 commit, thread 1의 mac은 release
+    for (i = 0; i < RESERVE_CNT; i++) {
+        test_check_int (efuse_alloc_commit  (Alloc, Macs[0][i]), 1);
+        test_check_int (efuse_alloc_release (Alloc, Macs[1][i]), 1);
+    }
+    test_check_int (efuse_alloc_release (Alloc, Macs[0][0]), 0);
+    test_check_int (efuse_alloc_release (Alloc, Macs[1][0]), 0);
+    test_check_int (efuse_alloc_commit  (Alloc, Macs[1][0]), 0);
+    test_check_int (efuse_alloc_commit  (Alloc, MacStart + MacCnt), 0);
+
+    // 다음 reserve는 가장 작은 hole부터
+    for (i = 0, hole = ~0ULL; i < RESERVE_CNT; i++)
+        if (Macs[1][i] < hole)
+            hole = Macs[1][i];
+    test_check (efuse_alloc_reserve_next (Alloc, &mac));
+    test_check (mac == hole);
+    test_check_int (efuse_alloc_release (Alloc, mac), 1);
+
+    // 이미 사용된 mac 등록 : 사용중이면 fail
+    test_check_int (efuse_alloc_claim (Alloc, Macs[0][1]), 0);
+    test_check_int (efuse_alloc_claim (Alloc, Macs[1][1]), 1);
+    test_check_int (efuse_alloc_claim (Alloc, Macs[1][1]), 0);
+
+    test_check (efuse_alloc_stat (Alloc, &stat));
+    test_check_int (stat.committed_cnt, RESERVE_CNT + 1);
+    test_check_int (stat.reserved_cnt,  (THREAD_CNT - 2) * RESERVE_CNT);
+    efuse_alloc_close (Alloc);
+}
+
+//------------------------------------------------------------------------------
+// 재시작 : map 상태 유지, commit된 mac은 다시 할당되지 않음. recover는 reserve만 반환.
+//------------------------------------------------------------------------------
+static void test_reopen (void)
+{
+    struct efuse_alloc_stat stat;
+    unsigned long long macs [64];
+    unsigned char *committed = calloc (MacCnt, 1);
+    int i, n, dup = 0;
+
+    for (i = 0; i < RESERVE_CNT; i++)
+        committed[Macs[0][i] - MacStart] = 1;
+    committed[Macs[1][1] - MacStart] = 1;
+
+    // board 다른 map : open 실패
+    test_check (efuse_alloc_open (Map, eBOARD_ID_M2) == NULL);
+
+    test_check ((Alloc = efuse_alloc_open (Map, eBOARD_ID_M1S)) != NULL);
+    test_check (efuse_alloc_stat (Alloc, &stat));
+    test_check_int (stat.committed_cnt, RESERVE_CNT + 1);
+    test_check_int (stat.reserved_cnt,  (THREAD_CNT - 2) * RESERVE_CNT);
+
+    // crash로 남은 reserve 반환
+    test_check_int (efuse_alloc_recover (Alloc), (THREAD_CNT - 2) * RESERVE_CNT);
+    test_check (efuse_alloc_stat (Alloc, &stat));
+    test_check_int (stat.reserved_cnt, 0);
+    test_check_int (stat.free_cnt,     MacCnt - RESERVE_CNT - 1);
+
+    // 남은 mac 모두 reserve : commit된 mac과 중복 없음
+    while ((n = efuse_alloc_reserve_batch (Alloc, macs, 64)) > 0)
+        for (i = 0; i < n; i++)
+            dup += committed[macs[i] - MacStart];
+    test_check_int (dup, 0);
+    test_check (efuse_alloc_stat (Alloc, &stat));
+    test_check_int (stat.free_cnt, 0);
+    test_check_int (efuse_alloc_reserve_next (Alloc, &macs[0]), 0);
+    efuse_alloc_close (Alloc);
+    free (committed);
+}
+
+//------------------------------------------------------------------------------
+// ftruncate 후 header 기록 전 crash (모두 0인 map file) : 새 map으로 open
+//------------------------------------------------------------------------------
+static void test_crash (void)
+{
+    struct efuse_alloc_stat as;
+    struct stat st;
+    unsigned long long mac;
+    char path [128];
+    int fd;
+
+    test_check (stat (Map, &st) == 0);
+    snprintf (path, sizeof(path), "%s/crash.map", Dir);
+    test_check ((fd = open (path, O_RDWR | O_CREAT | O_TRUNC, 0644)) >= 0);
+    test_check (ftruncate (fd, st.st_size) == 0);
+    close (fd);
+
+    test_check ((Alloc = efuse_alloc_open (path, eBOARD_ID_M1S)) != NULL);
+    test_check (efuse_alloc_stat (Alloc, &as));
+    test_check_int (as.free_cnt, MacCnt);
+    test_check (efuse_alloc_reserve_next (Alloc, &mac));
+    test_check (mac == MacStart);
+    efuse_alloc_close (Alloc);
+
+    // 초기화 후 다시 open
+    test_check ((Alloc = efuse_alloc_open (path, eBOARD_ID_M1S)) != NULL);
+    test_check (efuse_alloc_stat (Alloc, &as));
+    test_check_int (as.reserved_cnt, 1);
+    efuse_alloc_close (Alloc);
+}
+
+//------------------------------------------------------------------------------
+int main (void)
+{
+    if (!test_tmpdir (Dir, sizeof(Dir))) {
+        printf ("error, test directory create.\n");
+        return 1;
+    }
+    snprintf (Map, sizeof(Map), "%s/m1s.map", Dir);
+    efuse_get_mac_range (eBOARD_ID_M1S, &MacStart, &MacCnt);
+
+    test_reserve ();
+    test_hole ();
+    test_reopen ();
+    test_crash ();
+
+    test_rmdir (Dir);
+    return test_result ("alloc");
+}
+
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
@@ -0,0 +1,191 @@
+//------------------------------------------------------------------------------
+/**
+ * @file test_audit.c
+ * @author charles-park (charles.park@hardkernel.com)
+ * @brief uuid audit test (board 분류, c4 이전 생산품, line 형식, multi thread file 검사).
+ * @version 0.2
+ * @date 2023-09-22
+ *
+ * @package apt install cups cups-bsd
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#include <fcntl.h>
+#include <pthread.h>
+
+#include "lib_efuse.h"
+#include "lib_efuse_audit.h"
+#include "test.h"
+
+//------------------------------------------------------------------------------
+// 분류 실패 line : 4개 (unknown, foreign, invalid 2)
+//------------------------------------------------------------------------------
+static const char *Buffer =
+    "dcbaa404-91bd-4a63-b5f1-001e06510001\n"                // m1
+    "dcbaa404-91bd-4a63-b5f1-001e06540001,2024-01-01\r\n"   // m1s (2번째 block)
+    "\r\n"
+    "\n"
+    "DCBAA404-91BD-4A63-B5F1-001E06480001\r\n"              // c4 이전 생산품
+    "dcbaa404-91bd-4a63-b5f1-001e064cffff \n"               // c4 (3번째 block)
+    "dcbaa404-91bd-4a63-b5f1-001e06590001\n"                // unknown
+    "dcbaa404-91bd-4a63-b5f1-001122330001\n"                // foreign
+    "dcbaa404-91bd-4a63-b5f1-001e06510001x\n"               // invalid
+    "short\n"                                               // invalid
+    "dcbaa404-91bd-4a63-b5f1-001e06570001";                 // c5 ('\n' 없음)
+
+#define FAIL_CNT    4
+
+static char Dir [64];
+static pthread_mutex_t FailMutex = PTHREAD_MUTEX_INITIALIZER;
+static int  FailCnt;
+static long FailOffset [FAIL_CNT];
+static int  FailResult [FAIL_CNT];
+
+//------------------------------------------------------------------------------
+// multi thread에서 동시 호출. offset 순서로 저장 (chunk 처리 순서와 무관하게 비교).
+//------------------------------------------------------------------------------
+static void fail_cb (void *arg, long offset, const char *line, int len, int result)
+{
+    int i;
+
+    (void)arg;
+    pthread_mutex_lock (&FailMutex);
+    // callback의 line은 buffer/file 내용 그대로
+    if ((FailCnt < FAIL_CNT) && !strncmp (line, &Buffer[offset], len)) {
+        for (i = FailCnt++; (i > 0) && (FailOffset[i - 1] > offset); i--) {
+            FailOffset[i] = FailOffset[i - 1];
+            FailResult[i] = FailResult[i - 1];
+        }
+        FailOffset[i] = offset;
+        FailResult[i] = result;
+    }
+    pthread_mutex_unlock (&FailMutex);
+}
+
+//------------------------------------------------------------------------------
+static void uuid_make (char *uuid, int size, unsigned long long mac)
+{
+    snprintf (uuid, size, "dcbaa404-91bd-4a63-b5f1-%012llx", mac);
+}
+
+//------------------------------------------------------------------------------
+// board mac 범위 처음/끝, 범위 밖, 형식 error
+//------------------------------------------------------------------------------
+static void test_classify (void)
+{
+    unsigned long long mac_start;
+    char uuid [EFUSE_UUID_SIZE +1];
+    int board_id, mac_cnt;
+
+    for (board_id = 0; board_id < eBOARD_ID_END; board_id++) {
+        test_check (efuse_get_mac_range (board_id, &mac_start, &mac_cnt));
+        uuid_make (uuid, sizeof(uuid), mac_start);
+        test_check_int (efuse_audit_classify (uuid), board_id);
+        uuid_make (uuid, sizeof(uuid), mac_start + mac_cnt - 1);
+        test_check_int (efuse_audit_classify (uuid), board_id);
+        test_check_int (efuse_audit_mac (mac_start + 65536), board_id);
+    }
+    test_check_int (efuse_audit_mac (0x001E06480000ULL), eBOARD_ID_C4);
+    test_check_int (efuse_audit_mac (0x001E06490000ULL), eAUDIT_UNKNOWN);
+    test_check_int (efuse_audit_mac (0x001E06000001ULL), eAUDIT_UNKNOWN);
+    test_check_int (efuse_audit_mac (0x001E06FF0001ULL), eAUDIT_UNKNOWN);
+    test_check_int (efuse_audit_mac (0x001E07530001ULL), eAUDIT_FOREIGN);
+    test_check_int (efuse_audit_mac (0x0000000000000ULL), eAUDIT_FOREIGN);
+
+    test_check_int (efuse_audit_classify ("DCBAA404-91BD-4A63-B5F1-001E06530001"), eBOARD_ID_M1S);
+    test_check_int (efuse_audit_classify ("dcbaa404-91bd-4a63-b5f1-001e0653000"),  eAUDIT_INVALID);
+    test_check_int (efuse_audit_classify ("dcbaa404-91bd-4a63-b5f1_001e06530001"), eAUDIT_INVALID);
+    test_check_int (efuse_audit_classify ("dcbaa404-91bd-4a63-b5f1-001e0653000g"), eAUDIT_INVALID);
+    test_check_int (efuse_audit_classify (""), eAUDIT_INVALID);
+}
+
+//------------------------------------------------------------------------------
+// Buffer 검사 결과 (thread 수와 무관하게 같아야 함)
+//------------------------------------------------------------------------------
+static void check_stat (const struct efuse_audit_stat *stat)
+{
+    test_check_int (stat->records, 9);
+    test_check_int (stat->valid,   5);
+    test_check_int (stat->board[eBOARD_ID_M1],  1);
+    test_check_int (stat->board[eBOARD_ID_M1S], 1);
+    test_check_int (stat->board[eBOARD_ID_M2],  0);
+    test_check_int (stat->board[eBOARD_ID_C4],  2);
+    test_check_int (stat->board[eBOARD_ID_C5],  1);
+    test_check_int (stat->c4_legacy, 1);
+    test_check_int (stat->invalid,   2);
+    test_check_int (stat->foreign,   1);
+    test_check_int (stat->unknown,   1);
+
+    test_check_int (FailCnt, FAIL_CNT);
+    test_check_int (FailOffset[0], strstr (Buffer, "001e06590001") - Buffer - 24);
+    test_check_int (FailResult[0], eAUDIT_UNKNOWN);
+    test_check_int (FailOffset[1], strstr (Buffer, "001122330001") - Buffer - 24);
+    test_check_int (FailResult[1], eAUDIT_FOREIGN);
+    test_check_int (FailOffset[2], strstr (Buffer, "001e06510001x") - Buffer - 24);
+    test_check_int (FailResult[2], eAUDIT_INVALID);
+    test_check_int (FailOffset[3], strstr (Buffer, "short") - Buffer);
+    test_check_int (FailResult[3], eAUDIT_INVALID);
+}
+
+//------------------------------------------------------------------------------
+static void test_buffer (void)
+{
+    struct efuse_audit_stat stat;
+
+    FailCnt = 0;
+    test_check_int (efuse_audit_buffer (Buffer, strlen (Buffer), &stat, fail_cb, NULL), 5);
+    check_stat (&stat);
+
+    test_check_int (efuse_audit_buffer (Buffer, 0, &stat, NULL, NULL), 0);
+    test_check_int (stat.records, 0);
+}
+
+//------------------------------------------------------------------------------
+// file을 thread 수로 나누어도 line 경계가 유지되어야 함 (1 ~ line 수보다 많은 thread)
+//------------------------------------------------------------------------------
+static void test_file (void)
+{
+    struct efuse_audit_stat stat;
+    char path [128];
+    int fd, threads;
+
+    snprintf (path, sizeof(path), "%s/audit.txt", Dir);
+    test_check ((fd = open (path, O_WRONLY | O_CREAT | O_TRUNC, 0644)) >= 0);
+    test_check (write (fd, Buffer, strlen (Buffer)) == (ssize_t)strlen (Buffer));
+    close (fd);
+
+    for (threads = 1; threads <= 16; threads++) {
+        FailCnt = 0;
+        test_check_int (efuse_audit_file (path, threads, &stat, fail_cb, NULL), 1);
+        check_stat (&stat);
+    }
+
+    // 빈 file : success, record 없음. file 없음 : fail
+    test_check ((fd = open (path, O_WRONLY | O_TRUNC)) >= 0);
+    close (fd);
+    test_check_int (efuse_audit_file (path, 4, &stat, NULL, NULL), 1);
+    test_check_int (stat.records, 0);
+    test_check_int (efuse_audit_file ("/nonexistent/audit.txt", 4, &stat, NULL, NULL), 0);
+}
+
+//------------------------------------------------------------------------------
+int main (void)
+{
+    if (!test_tmpdir (Dir, sizeof(Dir))) {
+        printf ("error, test directory create.\n");
+        return 1;
+    }
+
+    test_classify ();
+    test_buffer ();
+    test_file ();
+
+    test_rmdir (Dir);
+    return test_result ("audit");
+}
+
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
@@ -0,0 +1,178 @@
+//------------------------------------------------------------------------------
+/**
+ * @file test_batch.c
+ * @author charles-park (charles.park@hardkernel.com)
+ * @brief batch mode test (입력 순서 출력, json escape) on the simulation device.
+ * @version 0.2
+ * @date 2023-09-22
+ *
+ * @package apt install cups cups-bsd
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#include <fcntl.h>
+
+#include "lib_efuse.h"
+#include "lib_efuse_batch.h"
+#include "lib_efuse_board.h"
+#include "lib_efuse_journal.h"
+#include "lib_efuse_sim.h"
+#include "test.h"
+
+//------------------------------------------------------------------------------
+#define LINE_MAX_CNT    16
+
+static efuse_sim *Sim;
+static char *Line [LINE_MAX_CNT];
+static int LineCnt;
+static int InitCnt;
+
+//------------------------------------------------------------------------------
+// simulation device의 data file에 임의의 byte 기록 (c5 sysfs, 1회 write)
+//------------------------------------------------------------------------------
+static int sim_put (const char *rw_file, const char *data, int size)
+{
+    const struct efuse_io *io = efuse_sim_io (Sim);
+    int fd, ret;
+
+    if ((fd = io->open (io->priv, rw_file, O_WRONLY)) < 0)
+        return 0;
+    ret = (io->pwrite (io->priv, fd, data, size, 0) == size);
+    io->close (io->priv, fd);
+    return ret;
+}
+
+//------------------------------------------------------------------------------
+// lane context 생성시 호출 : journal 설정
+//------------------------------------------------------------------------------
+static void ctx_init (void *arg, efuse_ctx *ctx)
+{
+    __atomic_fetch_add (&InitCnt, 1, __ATOMIC_RELAXED);
+    efuse_ctx_set_journal (ctx, (efuse_journal *)arg);
+}
+
+//------------------------------------------------------------------------------
+// 명령 실행 후 출력을 줄 단위로 Line에 저장. return : efuse_batch_run
+//------------------------------------------------------------------------------
+static int batch_run (const char *cmd, struct efuse_batch_report *report)
+{
+    char *buf = NULL, *p, *save;
+    size_t size = 0;
+    FILE *in, *out;
+    int ret;
+
+    for (LineCnt = 0; LineCnt < LINE_MAX_CNT; LineCnt++) {
+        free (Line[LineCnt]);
+        Line[LineCnt] = NULL;
+    }
+    in  = fmemopen ((void *)cmd, strlen (cmd), "r");
+    out = open_memstream (&buf, &size);
+    ret = efuse_batch_run (in, out, report);
+    fclose (in);
+    fclose (out);
+
+    LineCnt = 0;
+    for (p = strtok_r (buf, "\n", &save); p && (LineCnt < LINE_MAX_CNT);
+         p = strtok_r (NULL, "\n", &save))
+        Line[LineCnt++] = strdup (p);
+    free (buf);
+    return ret;
+}
+
+//------------------------------------------------------------------------------
+// 출력 1줄에 '"' escape 되지 않은 제어 문자/8bit 문자가 없는지 확인
+//------------------------------------------------------------------------------
+static int json_clean (const char *line)
+{
+    const unsigned char *p;
+
+    for (p = (const unsigned char *)line; *p; p++)
+        if ((*p < 0x20) || (*p > 0x7E))
+            return 0;
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+int main (void)
+{
+    const struct efuse_board *m1s = efuse_board_info (eBOARD_ID_M1S);
+    const struct efuse_board *c5  = efuse_board_info (eBOARD_ID_C5);
+    const char *uuid = "dcbaa404-91bd-4a63-b5f1-001e06530001";
+    struct efuse_batch_report report;
+    char cmd [512], raw [EFUSE_UUID_SIZE], dir [64], path [128];
+    efuse_journal *journal;
+    int i;
+
+    Sim = efuse_sim_create (NULL);
+    test_check (efuse_sim_add_device (Sim, eSIM_DEV_EMMC,  m1s->rw_control, m1s->rw_file));
+    test_check (efuse_sim_add_device (Sim, eSIM_DEV_SYSFS, c5->rw_control,  c5->rw_file));
+    efuse_batch_set_io (efuse_sim_io (Sim));
+
+    // 입력 순서대로 출력, 잘못된 명령은 error 출력 후 계속
+    snprintf (cmd, sizeof(cmd),
+              "# comment\n"
+              "m1s write %s\n"
+              "m1s read\n"
+              "\n"
+              "m1s mac   # comment\n"
+              "foo read\n"
+              "m1s bar\n"
+              "m1s write short\n"
+              "m1s check\n", uuid);
+    test_check_int (batch_run (cmd, &report), 0);
+    test_check_int (LineCnt, 7);
+    test_check_int (report.cmd_cnt,  7);
+    test_check_int (report.ok_cnt,   4);
+    test_check_int (report.fail_cnt, 3);
+    test_check (!strcmp (Line[0], "{\"seq\":0,\"op\":\"write\",\"board\":\"m1s\",\"status\":\"success\","
+                                  "\"data\":\"DCBAA404-91BD-4A63-B5F1-001E06530001\"}"));
+    test_check (!strcmp (Line[1], "{\"seq\":1,\"op\":\"read\",\"board\":\"m1s\",\"status\":\"success\","
+                                  "\"data\":\"DCBAA404-91BD-4A63-B5F1-001E06530001\"}"));
+    test_check (strstr (Line[2], "\"op\":\"mac\"") != NULL);
+    test_check (strstr (Line[2], "\"mac\":\"001E06530001\"") != NULL);
+    test_check (!strcmp (Line[3], "{\"seq\":3,\"op\":\"read\",\"status\":\"error\",\"error\":\"unknown board\"}"));
+    test_check (!strcmp (Line[4], "{\"seq\":4,\"status\":\"error\",\"error\":\"unknown op\"}"));
+    test_check (!strcmp (Line[5], "{\"seq\":5,\"op\":\"write\",\"status\":\"error\",\"error\":\"invalid data\"}"));
+    test_check (strstr (Line[6], "\"valid\":true") != NULL);
+
+    // device data가 json 문자열을 깨뜨리지 않도록 escape
+    memcpy (raw, "dc\"aa404-91b\\-4a63-b5f1-001e06570001", sizeof(raw));
+    raw[20] = '\n';
+    raw[21] = 0x01;
+    raw[22] = (char)0xA5;
+    test_check (sim_put (c5->rw_file, raw, sizeof(raw)));
+    test_check_int (batch_run ("c5 read\nc5 check\n", &report), 1);
+    test_check_int (LineCnt, 2);
+    test_check (!strcmp (Line[0], "{\"seq\":0,\"op\":\"read\",\"board\":\"c5\",\"status\":\"success\","
+                                  "\"data\":\"DC\\\"AA404-91B\\\\-4A63-B\\u000a\\u0001\\u00a5-001E06570001\"}"));
+    test_check (strstr (Line[1], "\"data\":\"DC\\\"AA404-91B\\\\-4A63-B\\u000a") != NULL);
+    for (i = 0; i < LineCnt; i++)
+        test_check (json_clean (Line[i]));
+
+    // lane context에 ctx_init 적용 (board 1개 = lane 1개, context는 1회 생성)
+    test_check (test_tmpdir (dir, sizeof(dir)));
+    snprintf (path, sizeof(path), "%s/efuse.journal", dir);
+    test_check ((journal = efuse_journal_open (path)) != NULL);
+    efuse_batch_set_ctx_init (ctx_init, journal);
+    snprintf (cmd, sizeof(cmd), "m1s write %s\nm1s read\nm1s erase\n", uuid);
+    test_check_int (batch_run (cmd, &report), 1);
+    test_check_int (InitCnt, 1);
+    efuse_batch_set_ctx_init (NULL, NULL);
+    // write, erase 2개가 journal에 기록되었으므로 다음 id는 3
+    test_check (efuse_journal_intent (journal, eJOURNAL_OP_ERASE, eBOARD_ID_M1S,
+                                      NULL, m1s->rw_file, 0) == 3);
+    test_check_int (efuse_journal_inflight (journal, NULL, NULL), 1);
+    efuse_journal_close (journal);
+    test_rmdir (dir);
+
+    for (i = 0; i < LINE_MAX_CNT; i++)
+        free (Line[i]);
+    efuse_sim_destroy (Sim);
+    return test_result ("batch");
+}
+
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
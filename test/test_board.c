@@ -0,0 +1,160 @@
+//------------------------------------------------------------------------------
+/**
+ * @file test_board.c
+ * @author charles-park (charles.park@hardkernel.com)
+ * @brief board descriptor table / device-tree board 확인 test.
+ * @version 0.2
+ * @date 2023-09-22
+ *
+ * @package apt install cups cups-bsd
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#include <fcntl.h>
+
+#include "lib_efuse.h"
+#include "lib_efuse_board.h"
+#include "test.h"
+
+//------------------------------------------------------------------------------
+static char Dir [64];
+
+//------------------------------------------------------------------------------
+// device-tree 항목 file 작성 (size 만큼, compatible은 '\0' 구분 list). NULL = 삭제
+//------------------------------------------------------------------------------
+static void dt_set (const char *name, const char *data, int size)
+{
+    char path [128];
+    int fd;
+
+    snprintf (path, sizeof(path), "%s/%s", Dir, name);
+    unlink (path);
+    if (data == NULL)
+        return;
+    test_check ((fd = open (path, O_WRONLY | O_CREAT | O_TRUNC, 0644)) >= 0);
+    test_check (write (fd, data, size) == size);
+    close (fd);
+}
+
+//------------------------------------------------------------------------------
+#define dt_compatible(s)    dt_set ("compatible", s, sizeof(s))
+#define dt_model(s)         dt_set ("model", s, sizeof(s))
+
+//------------------------------------------------------------------------------
+// device-tree 정보가 없는 경우 : device file이 있는 board가 1개일 때만 선택
+//------------------------------------------------------------------------------
+static int dev_present (void)
+{
+    const struct efuse_board *b;
+    int id, found = -1;
+
+    for (id = 0; id < eBOARD_ID_END; id++) {
+        b = efuse_board_info (id);
+        if (access (b->rw_control, F_OK) || access (b->rw_file, F_OK))
+            continue;
+        if (found >= 0)
+            return -1;
+        found = id;
+    }
+    return found;
+}
+
+//------------------------------------------------------------------------------
+// table : 이름, mac 범위, simulation device type
+//------------------------------------------------------------------------------
+static void test_table (void)
+{
+    const struct efuse_board *b;
+    unsigned long long mac_start;
+    int id, mac_cnt;
+
+    for (id = 0; id < eBOARD_ID_END; id++) {
+        test_check ((b = efuse_board_info (id)) != NULL);
+        test_check (!strcmp (efuse_board_name (id), b->name));
+        test_check_int (efuse_board_find (b->name), id);
+        test_check_int (b->size_byte, EFUSE_UUID_SIZE);
+
+        test_check (efuse_get_mac_range (id, &mac_start, &mac_cnt));
+        test_check (mac_start == strtoull (b->mac_start_str, NULL, 16) << 16);
+        test_check_int (mac_cnt, b->mac_block_cnt * 65536);
+        test_check_int (efuse_sim_dev_type (id), b->dev_type);
+    }
+    test_check_int (efuse_board_find ("M1S"), eBOARD_ID_M1S);
+    test_check_int (efuse_board_find ("m1s "), -1);
+    test_check_int (efuse_board_find (NULL), -1);
+    test_check (efuse_board_info (-1) == NULL);
+    test_check (efuse_board_info (eBOARD_ID_END) == NULL);
+    test_check (!strcmp (efuse_board_name (eBOARD_ID_END), "unknown"));
+}
+
+//------------------------------------------------------------------------------
+// compatible list, model, 이름이 다른 board 이름의 앞부분인 경우 (m1 / m1s)
+//------------------------------------------------------------------------------
+static void test_match (void)
+{
+    dt_set ("model", NULL, 0);
+    dt_compatible ("hardkernel,odroid-m1s\0rockchip,rk3566");
+    test_check_int (efuse_board_match (Dir), eBOARD_ID_M1S);
+    dt_compatible ("hardkernel,odroid-m1\0rockchip,rk3568");
+    test_check_int (efuse_board_match (Dir), eBOARD_ID_M1);
+    // list 2번째 항목, '-' 구분
+    dt_compatible ("rockchip,rk3588\0rockchip,rk3588s-odroid-m2");
+    test_check_int (efuse_board_match (Dir), eBOARD_ID_M2);
+    dt_compatible ("amlogic,sm1-odroid-c4\0amlogic,sm1");
+    test_check_int (efuse_board_match (Dir), eBOARD_ID_C4);
+    dt_compatible ("hardkernel,odroid-c5");
+    test_check_int (efuse_board_match (Dir), eBOARD_ID_C5);
+    // 이름 앞/뒤에 문자가 이어지면 다른 board
+    dt_compatible ("hardkernel,odroid-c55\0hardkernel,xodroid-c4");
+    test_check_int (efuse_board_match (Dir), dev_present ());
+
+    // compatible에 없으면 model (대소문자 구분 없음)
+    dt_model ("Hardkernel ODROID-M1S");
+    test_check_int (efuse_board_match (Dir), eBOARD_ID_M1S);
+    dt_model ("Hardkernel ODROID-M1");
+    test_check_int (efuse_board_match (Dir), eBOARD_ID_M1);
+    dt_model ("Hardkernel ODROID-C4 (rev 2)");
+    test_check_int (efuse_board_match (Dir), eBOARD_ID_C4);
+
+    // 알 수 없는 board : device file 확인
+    dt_model ("Hardkernel ODROID-M1X");
+    test_check_int (efuse_board_match (Dir), dev_present ());
+    dt_set ("compatible", NULL, 0);
+    dt_set ("model", NULL, 0);
+    test_check_int (efuse_board_match (Dir), dev_present ());
+    test_check_int (efuse_board_match ("/nonexistent/device-tree"), dev_present ());
+}
+
+//------------------------------------------------------------------------------
+// 실행중인 board는 1회만 확인 (cache)
+//------------------------------------------------------------------------------
+static void test_detect (void)
+{
+    int id = efuse_board_detect ();
+
+    test_check ((id >= -1) && (id < eBOARD_ID_END));
+    test_check_int (efuse_board_detect (), id);
+    test_check_int (efuse_board_match (NULL), id);
+}
+
+//------------------------------------------------------------------------------
+int main (void)
+{
+    if (!test_tmpdir (Dir, sizeof(Dir))) {
+        printf ("error, test directory create.\n");
+        return 1;
+    }
+
+    test_table ();
+    test_match ();
+    test_detect ();
+
+    test_rmdir (Dir);
+    return test_result ("board");
+}
+
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
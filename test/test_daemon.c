@@ -0,0 +1,150 @@
+//------------------------------------------------------------------------------
+/**
+ * @file test_daemon.c
+ * @author charles-park (charles.park@hardkernel.com)
+ * @brief daemon test (warm session, socket permission) on the simulation device.
+ * @version 0.2
+ * @date 2023-09-22
+ *
+ * @package apt install cups cups-bsd
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <strings.h>
+#include <sys/stat.h>
+
+#include "lib_efuse.h"
+#include "lib_efuse_board.h"
+#include "lib_efuse_daemon.h"
+#include "lib_efuse_sim.h"
+#include "test.h"
+
+//------------------------------------------------------------------------------
+static char Dir  [64];
+static char Sock [128];
+static efuse_sim *Sim;
+static int InitCnt;
+
+//------------------------------------------------------------------------------
+static void *daemon_thread (void *arg)
+{
+    (void)arg;
+    efuse_daemon_run (Sock);
+    return NULL;
+}
+
+//------------------------------------------------------------------------------
+// board context 생성시 호출 (daemon thread)
+//------------------------------------------------------------------------------
+static void ctx_init (void *arg, efuse_ctx *ctx)
+{
+    (void)arg;
+    (void)ctx;
+    InitCnt++;
+}
+
+//------------------------------------------------------------------------------
+int main (void)
+{
+    const struct efuse_board *m1s = efuse_board_info (eBOARD_ID_M1S);
+    const char *uuid = "dcbaa404-91bd-4a63-b5f1-001e06530001";
+    char data [EFUSE_UUID_SIZE +1];
+    struct stat st;
+    pthread_t thread;
+    long long t0;
+    int i, fd;
+
+    if (!test_tmpdir (Dir, sizeof(Dir))) {
+        printf ("error, test directory create.\n");
+        return 1;
+    }
+    snprintf (Sock, sizeof(Sock), "%s/efuse.sock", Dir);
+
+    Sim = efuse_sim_create (NULL);
+    test_check (efuse_sim_add_device (Sim, eSIM_DEV_EMMC, m1s->rw_control, m1s->rw_file));
+    efuse_daemon_set_io (efuse_sim_io (Sim));
+    efuse_daemon_set_ctx_init (ctx_init, NULL);
+
+    // socket path에 socket이 아닌 file이 있으면 삭제하지 않고 실패
+    test_check ((fd = open (Sock, O_WRONLY | O_CREAT | O_EXCL, 0644)) >= 0);
+    close (fd);
+    test_check_int (efuse_daemon_run (Sock), 0);
+    test_check_int (lstat (Sock, &st), 0);
+    test_check (S_ISREG (st.st_mode));
+    unlink (Sock);
+
+    // umask와 무관하게 socket은 EFUSE_SOCKET_MODE
+    umask (0);
+    test_check_int (pthread_create (&thread, NULL, daemon_thread, NULL), 0);
+    for (t0 = test_now_ms (); (access (Sock, F_OK) != 0) && (test_now_ms () - t0 < 2000); )
+        test_sleep_ms (5);
+    test_check_int (stat (Sock, &st), 0);
+    test_check (S_ISSOCK (st.st_mode));
+    test_check_int (st.st_mode & 0777, EFUSE_SOCKET_MODE);
+
+    // write : write session 1회 (file + control open), 완료 후 force_ro lock 복구
+    memcpy (data, uuid, sizeof(data));
+    test_check_int (efuse_client_request (Sock, EFUSE_SRV_WRITE, eBOARD_ID_M1S, data), 1);
+    test_check_int (efuse_sim_get_count (Sim, eSIM_OP_OPEN), 2);
+    test_check_int (test_force_ro (Sim, m1s->rw_control), '1');
+
+    // read/check/mac : 첫 요청에서 read session open, 이후 descriptor 재사용
+    efuse_sim_reset_count (Sim);
+    for (i = 0; i < 10; i++) {
+        test_check_int (efuse_client_request (Sock, EFUSE_SRV_READ, eBOARD_ID_M1S, data), 1);
+        test_check (!strcasecmp (data, uuid));
+    }
+    test_check_int (efuse_client_request (Sock, EFUSE_SRV_CHECK, eBOARD_ID_M1S, data), 1);
+    test_check_int (efuse_client_request (Sock, EFUSE_SRV_MAC, eBOARD_ID_M1S, data), 1);
+    test_check (!strcmp (data, "001E06530001"));
+    test_check_int (efuse_sim_get_count (Sim, eSIM_OP_OPEN),   1);
+    test_check_int (efuse_sim_get_count (Sim, eSIM_OP_CLOSE),  0);
+    test_check_int (efuse_sim_get_count (Sim, eSIM_OP_ACCESS), 0);
+    test_check_int (efuse_sim_get_count (Sim, eSIM_OP_PREAD),  12);
+
+    // read error : session을 다시 open 하여 재시도
+    efuse_sim_reset_count (Sim);
+    efuse_sim_set_fault (Sim, eSIM_OP_PREAD, 1, EIO);
+    test_check_int (efuse_client_request (Sock, EFUSE_SRV_READ, eBOARD_ID_M1S, data), 1);
+    test_check (!strcasecmp (data, uuid));
+    test_check_int (efuse_sim_get_count (Sim, eSIM_OP_CLOSE), 1);
+    test_check_int (efuse_sim_get_count (Sim, eSIM_OP_OPEN),  1);
+
+    // 계속 실패하면 error
+    efuse_sim_set_fault (Sim, eSIM_OP_PREAD, -1, EIO);
+    test_check_int (efuse_client_request (Sock, EFUSE_SRV_READ, eBOARD_ID_M1S, data), 0);
+    efuse_sim_set_fault (Sim, eSIM_OP_PREAD, 0, 0);
+
+    // erase 후 read session 다시 사용, force_ro는 lock 상태
+    test_check_int (efuse_client_request (Sock, EFUSE_SRV_ERASE, eBOARD_ID_M1S, data), 1);
+    test_check_int (test_force_ro (Sim, m1s->rw_control), '1');
+    efuse_sim_reset_count (Sim);
+    test_check_int (efuse_client_request (Sock, EFUSE_SRV_READ, eBOARD_ID_M1S, data), 1);
+    test_check_int (efuse_client_request (Sock, EFUSE_SRV_CHECK, eBOARD_ID_M1S, data), 0);
+    test_check_int (efuse_sim_get_count (Sim, eSIM_OP_OPEN), 1);
+
+    // device 없는 board : error, daemon은 계속 동작
+    test_check_int (efuse_client_request (Sock, EFUSE_SRV_READ, eBOARD_ID_C5, data), 0);
+    test_check_int (efuse_client_request (Sock, EFUSE_SRV_READ, eBOARD_ID_M1S, data), 1);
+
+    efuse_daemon_stop ();
+    pthread_join (thread, NULL);
+    test_check (access (Sock, F_OK) != 0);
+    // daemon 종료시 session close
+    test_check_int (efuse_sim_get_count (Sim, eSIM_OP_CLOSE), 1);
+    // board context (m1s, c5) 생성시 1회씩
+    test_check_int (InitCnt, 2);
+
+    efuse_sim_destroy (Sim);
+    test_rmdir (Dir);
+    return test_result ("daemon");
+}
+
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
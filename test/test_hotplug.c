@@ -0,0 +1,270 @@
+//------------------------------------------------------------------------------
+/**
+ * @file test_hotplug.c
+ * @author charles-park (charles.park@hardkernel.com)
+ * @brief hotplug test (synthetic uevent from the local socket, simulation device).
+ * @version 0.2
+ * @date 2023-09-22
+ *
+ * @package apt install cups cups-bsd
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#include <fcntl.h>
+#include <pthread.h>
+#include <strings.h>
+#include <sys/stat.h>
+
+#include "lib_efuse.h"
+#include "lib_efuse_hotplug.h"
+#include "lib_efuse_sim.h"
+#include "test.h"
+
+//------------------------------------------------------------------------------
+// jig slot 3개 (board 기본 device) : m1s = mmcblk0boot0, m2 = mmcblk0boot1, c4 = efuse
+//------------------------------------------------------------------------------
+#define SLOT_CNT    3
+#define WAIT_MS     2000
+
+static const struct efuse_hotplug_slot Slots [SLOT_CNT] = {
+    { eBOARD_ID_M1S, NULL, NULL },
+    { eBOARD_ID_M2,  NULL, NULL },
+    { eBOARD_ID_C4,  NULL, NULL },
+};
+
+static const char *Uuid [SLOT_CNT] = {
+    "dcbaa404-91bd-4a63-b5f1-001e06530001",
+    "dcbaa404-91bd-4a63-b5f1-001e06550001",
+    "dcbaa404-91bd-4a63-b5f1-001e064a0001",
+};
+
+static char Dir  [64];
+static char Sock [128];
+static efuse_sim *Sim;
+static int UeventFd;
+
+// efuse_hotplug_run 대상 slot
+static const struct efuse_hotplug_slot *RunSlots = Slots;
+static int RunCnt = SLOT_CNT;
+
+// provisioning callback 결과 (slot별)
+static int  Called  [SLOT_CNT];
+static int  Board   [SLOT_CNT];
+static int  Written [SLOT_CNT];
+static char Device  [SLOT_CNT][64];
+
+static struct efuse_hotplug_report Report;
+
+//------------------------------------------------------------------------------
+// slot thread에서 호출. slot ctx를 simulation device에 연결 후 write/verify.
+//------------------------------------------------------------------------------
+static int hotplug_prov (void *arg, int slot, efuse_ctx *ctx)
+{
+    const char *rw_control, *rw_file;
+    char read_data [EFUSE_UUID_SIZE +1];
+    int ret;
+
+    (void)arg;
+    efuse_ctx_get_path (ctx, &rw_control, &rw_file);
+    snprintf (Device[slot], sizeof(Device[slot]), "%s", rw_file);
+    Board[slot] = efuse_ctx_get_board (ctx);
+
+    ret = efuse_sim_attach (Sim, ctx) &&
+          (efuse_ctx_write_verify (ctx, Uuid[slot], read_data) != eEFUSE_WV_ERROR) &&
+          efuse_ctx_valid_check (ctx, read_data);
+    if (ret)
+        __atomic_add_fetch (&Written[slot], 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch (&Called[slot], 1, __ATOMIC_RELEASE);
+    return ret;
+}
+
+//------------------------------------------------------------------------------
+static void *hotplug_thread (void *arg)
+{
+    (void)arg;
+    efuse_hotplug_run (UeventFd, RunSlots, RunCnt, hotplug_prov, NULL, &Report);
+    return NULL;
+}
+
+//------------------------------------------------------------------------------
+// slot의 callback 호출 횟수가 cnt가 될 때까지 대기. return : 1 = success
+//------------------------------------------------------------------------------
+static int wait_called (int slot, int cnt)
+{
+    long long t0 = test_now_ms ();
+
+    while (__atomic_load_n (&Called[slot], __ATOMIC_ACQUIRE) < cnt) {
+        if (test_now_ms () - t0 > WAIT_MS)
+            return 0;
+        test_sleep_ms (2);
+    }
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+// simulation device에 기록된 uuid 확인 (slot과 같은 board/device의 새 ctx)
+//------------------------------------------------------------------------------
+static int sim_check (int slot)
+{
+    char data [EFUSE_UUID_SIZE +1];
+    efuse_ctx *ctx = efuse_ctx_open (Slots[slot].board_id);
+    int ret;
+
+    memset (data, 0, sizeof(data));
+    ret = efuse_sim_attach (Sim, ctx) &&
+          efuse_ctx_control (ctx, data, EFUSE_READ) &&
+          !strcasecmp (data, Uuid[slot]);
+    efuse_ctx_close (ctx);
+    return ret;
+}
+
+//------------------------------------------------------------------------------
+// hotplug 시작 전에 연결된 device : event 없이 바로 provisioning.
+// slot 0 = device file 존재, slot 1 = 없음 (event 대기)
+//------------------------------------------------------------------------------
+static void test_present (void)
+{
+    struct efuse_hotplug_slot slots [2];
+    char control [2][128], file [2][128];
+    pthread_t thread;
+    int i, fd;
+
+    for (i = 0; i < 2; i++) {
+        snprintf (control[i], sizeof(control[i]), "%s/force_ro%d", Dir, i);
+        snprintf (file[i],    sizeof(file[i]),    "%s/boot%d",     Dir, i);
+        slots[i].board_id   = eBOARD_ID_M1S;
+        slots[i].rw_control = control[i];
+        slots[i].rw_file    = file[i];
+        test_check (efuse_sim_add_device (Sim, eSIM_DEV_EMMC, control[i], file[i]));
+    }
+    // slot 1은 control file만 존재
+    for (i = 0; i < 3; i++) {
+        const char *path = (i == 0) ? control[0] : (i == 1) ? file[0] : control[1];
+
+        test_check ((fd = open (path, O_WRONLY | O_CREAT | O_EXCL, 0644)) >= 0);
+        close (fd);
+    }
+
+    memset (Called,  0, sizeof(Called));
+    memset (Written, 0, sizeof(Written));
+    memset (&Report, 0, sizeof(Report));
+    RunSlots = slots;
+    RunCnt   = 2;
+    UeventFd = efuse_uevent_open (Sock);
+    test_check (UeventFd >= 0);
+    test_check_int (pthread_create (&thread, NULL, hotplug_thread, NULL), 0);
+
+    test_check (wait_called (0, 1));
+    test_check (!strcmp (Device[0], file[0]));
+    test_check_int (Written[0], 1);
+
+    efuse_hotplug_stop ();
+    pthread_join (thread, NULL);
+    efuse_uevent_close (UeventFd, Sock);
+
+    test_check_int (Called[1], 0);
+    test_check_int (Report.event_cnt,   0);
+    test_check_int (Report.trigger_cnt, 1);
+    test_check_int (Report.ok_cnt,      1);
+
+    for (i = 0; i < 2; i++) {
+        unlink (control[i]);
+        unlink (file[i]);
+    }
+}
+
+//------------------------------------------------------------------------------
+// socket path에 socket이 아닌 file이 있으면 삭제하지 않고 실패
+//------------------------------------------------------------------------------
+static void test_sock_file (void)
+{
+    struct stat st;
+    int fd;
+
+    test_check ((fd = open (Sock, O_WRONLY | O_CREAT | O_EXCL, 0644)) >= 0);
+    close (fd);
+    test_check_int (efuse_uevent_open (Sock), -1);
+    efuse_uevent_close (-1, Sock);
+    test_check_int (lstat (Sock, &st), 0);
+    test_check (S_ISREG (st.st_mode));
+    unlink (Sock);
+}
+
+//------------------------------------------------------------------------------
+int main (void)
+{
+    pthread_t thread;
+    int i;
+
+    if (!test_tmpdir (Dir, sizeof(Dir))) {
+        printf ("error, test directory create.\n");
+        return 1;
+    }
+    snprintf (Sock, sizeof(Sock), "%s/uevent.sock", Dir);
+
+    Sim = efuse_sim_create (NULL);
+    UeventFd = efuse_uevent_open (Sock);
+    test_check (UeventFd >= 0);
+    test_check_int (pthread_create (&thread, NULL, hotplug_thread, NULL), 0);
+
+    // 다른 device, add 외 action : provisioning 하지 않음
+    test_check (efuse_uevent_send (Sock, "add",    "block", "mmcblk1boot0"));
+    test_check (efuse_uevent_send (Sock, "add",    "block", "sda1"));
+    test_check (efuse_uevent_send (Sock, "change", "block", "mmcblk0boot1"));
+
+    // m2 slot (mmcblk0boot1) : m2 board로 provisioning, 다른 slot은 동작 안함
+    test_check (efuse_uevent_send (Sock, "add", "block", "mmcblk0boot1"));
+    test_check (wait_called (1, 1));
+    test_check_int (Board[1], eBOARD_ID_M2);
+    test_check (!strcmp (Device[1], "/dev/mmcblk0boot1"));
+    test_check_int (Written[1], 1);
+    test_check (sim_check (1));
+    test_check_int (Called[0], 0);
+    test_check_int (Called[2], 0);
+
+    // m1s slot, c4 slot (misc/efuse)
+    test_check (efuse_uevent_send (Sock, "add", "block", "mmcblk0boot0"));
+    test_check (efuse_uevent_send (Sock, "add", "misc",  "efuse"));
+    test_check (wait_called (0, 1));
+    test_check (wait_called (2, 1));
+    test_check_int (Board[0], eBOARD_ID_M1S);
+    test_check (!strcmp (Device[0], "/dev/mmcblk0boot0"));
+    test_check_int (Board[2], eBOARD_ID_C4);
+    test_check (!strcmp (Device[2], "/sys/class/efuse/uuid"));
+    test_check_int (Written[0], 1);
+    test_check_int (Written[2], 1);
+    test_check (sim_check (0));
+    test_check (sim_check (2));
+
+    // remove 없이 다시 add : 무시. remove 후 add : 새 board로 다시 provisioning
+    test_check (efuse_uevent_send (Sock, "add",    "block", "mmcblk0boot0"));
+    test_check (efuse_uevent_send (Sock, "remove", "block", "mmcblk0boot0"));
+    test_check (efuse_uevent_send (Sock, "add",    "block", "mmcblk0boot0"));
+    test_check (wait_called (0, 2));
+    test_check_int (Written[0], 2);
+
+    efuse_hotplug_stop ();
+    pthread_join (thread, NULL);
+    efuse_uevent_close (UeventFd, Sock);
+
+    for (i = 0; i < SLOT_CNT; i++)
+        test_check_int (Called[i], (i == 0) ? 2 : 1);
+    test_check_int (Report.event_cnt,   9);
+    test_check_int (Report.trigger_cnt, 4);
+    test_check_int (Report.ok_cnt,      4);
+    test_check_int (Report.fail_cnt,    0);
+    test_check (access (Sock, F_OK) != 0);
+
+    test_present ();
+    test_sock_file ();
+
+    efuse_sim_destroy (Sim);
+    test_rmdir (Dir);
+    return test_result ("hotplug");
+}
+
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
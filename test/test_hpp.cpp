@@ -0,0 +1,173 @@
+//------------------------------------------------------------------------------
+/**
+ * @file test_hpp.cpp
+ * @author charles-park (charles.park@hardkernel.com)
+ * @brief C++17 wrapper test (board traits, Efuse<N>, AnyEfuse를 simulation device에서 확인).
+ * @version 0.2
+ * @date 2023-09-22
+ *
+ * @package apt install cups cups-bsd
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#include <strings.h>
+
+#include "lib_efuse.hpp"
+
+extern "C" {
+#include "lib_efuse_sim.h"
+}
+#include "test.h"
+
+//------------------------------------------------------------------------------
+// compile time 확인 (uuid 형식, board mac 범위, c4 이전 생산품)
+//------------------------------------------------------------------------------
+using M1S = efuse::Board<eBOARD_ID_M1S>;
+using C4  = efuse::Board<eBOARD_ID_C4>;
+
+static_assert (efuse::uuid_format_ok ("dcbaa404-91bd-4a63-b5f1-001e06530001"));
+static_assert (!efuse::uuid_format_ok ("dcbaa404-91bd-4a63-b5f1_001e06530001"));
+static_assert (efuse::uuid_mac ("DCBAA404-91BD-4A63-B5F1-001E06530001") == 0x001E06530001ULL);
+static_assert (M1S::valid ("dcbaa404-91bd-4a63-b5f1-001e06530001"));
+static_assert (!M1S::valid ("dcbaa404-91bd-4a63-b5f1-001e06550001"));
+static_assert (C4::valid ("dcbaa404-91bd-4a63-b5f1-001e06480001"));
+static_assert (!C4::valid ("dcbaa404-91bd-4a63-b5f1-001e06490001"));
+static_assert (efuse::Efuse<eBOARD_ID_M2>::access () == efuse::Access::Emmc);
+
+//------------------------------------------------------------------------------
+static std::string uuid_make (int board_id, int i)
+{
+    unsigned long long mac_start;
+    char uuid [EFUSE_UUID_SIZE +1];
+    int mac_cnt;
+
+    efuse_get_mac_range (board_id, &mac_start, &mac_cnt);
+    snprintf (uuid, sizeof(uuid), "dcbaa404-91bd-4a63-b5f1-%012llx", mac_start + i);
+    return uuid;
+}
+
+//------------------------------------------------------------------------------
+static bool uuid_same (const std::optional<std::string> &data, const std::string &uuid)
+{
+    return data && !strcasecmp (data->c_str (), uuid.c_str ());
+}
+
+//------------------------------------------------------------------------------
+// BoardTraits와 C library board table (lib_efuse_board.c) 비교
+//------------------------------------------------------------------------------
+static void test_traits (void)
+{
+    int id, cnt = 0;
+
+    test_check (efuse::traits_check ());
+    for (id = 0; id < eBOARD_ID_END; id++)
+        cnt += efuse::visit_board (id, [] (auto) {});
+    test_check_int (cnt, eBOARD_ID_END);
+    test_check (!efuse::visit_board (eBOARD_ID_END, [] (auto) {}));
+}
+
+//------------------------------------------------------------------------------
+// emmc board : session write (force_ro 복구), board mac 범위 밖은 device 접근 없음
+//------------------------------------------------------------------------------
+static void test_efuse (void)
+{
+    using Dev = efuse::Efuse<eBOARD_ID_M1S>;
+    efuse_sim *sim = efuse_sim_create (NULL);
+    std::string uuid = uuid_make (eBOARD_ID_M1S, 1), rdata;
+    Dev dev;
+
+    test_check (static_cast<bool> (dev));
+    test_check (efuse_sim_add_device (sim, eSIM_DEV_EMMC, M1S::rw_control, M1S::rw_file));
+    test_check (dev.set_io (efuse_sim_io (sim)));
+
+    test_check (dev.write (uuid));
+    test_check_int (test_force_ro (sim, M1S::rw_control), '1');
+    test_check (uuid_same (dev.read (), uuid));
+    test_check_int (dev.write_verify (uuid, &rdata), eEFUSE_WV_UNCHANGED);
+    test_check (!strcasecmp (rdata.c_str (), uuid.c_str ()));
+
+    efuse_sim_reset_count (sim);
+    test_check (!dev.write (uuid_make (eBOARD_ID_M2, 1)));
+    test_check (!dev.write ("not-a-uuid"));
+    test_check_int (dev.write_verify (uuid_make (eBOARD_ID_M2, 1)), eEFUSE_WV_ERROR);
+    test_check_int (efuse_sim_get_count (sim, eSIM_OP_OPEN), 0);
+    test_check (Dev::mac (uuid) == "001e06530001");
+    test_check (Dev::mac ("short").empty ());
+
+    // move : 이전 객체는 ctx 없음
+    Dev moved (std::move (dev));
+    test_check (!dev);
+    test_check (!dev.read ());
+    test_check (uuid_same (moved.read (), uuid));
+    test_check (moved.erase ());
+    test_check_int (test_force_ro (sim, M1S::rw_control), '1');
+    // erase : 0 으로 write, read 결과는 빈 문자열
+    test_check (moved.read () && moved.read ()->empty ());
+
+    // device path 변경
+    {
+        efuse::Efuse<eBOARD_ID_M2> jig ("/tmp/jig/force_ro", "/tmp/jig/boot1");
+
+        test_check (efuse_sim_add_device (sim, eSIM_DEV_EMMC, "/tmp/jig/force_ro", "/tmp/jig/boot1"));
+        test_check (jig.set_io (efuse_sim_io (sim)));
+        test_check_int (jig.write_verify (uuid_make (eBOARD_ID_M2, 2)), eEFUSE_WV_WRITTEN);
+        test_check (uuid_same (jig.read (), uuid_make (eBOARD_ID_M2, 2)));
+        test_check_int (test_force_ro (sim, "/tmp/jig/force_ro"), '1');
+    }
+    efuse_sim_destroy (sim);
+}
+
+//------------------------------------------------------------------------------
+// runtime board 선택 : board마다 simulation device 1개 (c4/c5는 같은 device path)
+//------------------------------------------------------------------------------
+static void test_any (void)
+{
+    efuse_sim *sim;
+    std::string uuid;
+    int id;
+
+    for (id = 0; id < eBOARD_ID_END; id++) {
+        efuse::AnyEfuse dev (id);
+
+        sim  = efuse_sim_create (NULL);
+        uuid = uuid_make (id, 3);
+        test_check (static_cast<bool> (dev));
+        test_check_int (dev.board (), id);
+        test_check (dev.native () != NULL);
+        test_check (efuse_sim_attach (sim, dev.native ()));
+
+        test_check (dev.valid (uuid));
+        test_check (!dev.valid (uuid_make ((id + 1) % eBOARD_ID_END, 3)));
+        test_check_int (dev.write_verify (uuid), eEFUSE_WV_WRITTEN);
+        test_check (uuid_same (dev.read (), uuid));
+        test_check_int (dev.write_verify (uuid), eEFUSE_WV_UNCHANGED);
+        test_check (dev.write (uuid_make (id, 4)));
+        test_check (uuid_same (dev.read (), uuid_make (id, 4)));
+        efuse_sim_destroy (sim);
+    }
+
+    // 없는 board : 모든 operation fail
+    efuse::AnyEfuse none (eBOARD_ID_END);
+    test_check (!none);
+    test_check_int (none.board (), -1);
+    test_check (none.native () == NULL);
+    test_check (!none.read ());
+    test_check (!none.write (uuid_make (eBOARD_ID_M1S, 1)));
+    test_check_int (none.write_verify (uuid_make (eBOARD_ID_M1S, 1)), eEFUSE_WV_ERROR);
+}
+
+//------------------------------------------------------------------------------
+int main (void)
+{
+    test_traits ();
+    test_efuse ();
+    test_any ();
+
+    return test_result ("hpp");
+}
+
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
@@ -0,0 +1,276 @@
+//------------------------------------------------------------------------------
+/**
+ * @file test_journal.c
+ * @author charles-park (charles.park@hardkernel.com)
+ * @brief write journal test (in-flight replay, 기록 도중 중단된 마지막 record, group commit).
+ * @version 0.2
+ * @date 2023-09-22
+ *
+ * @package apt install cups cups-bsd
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "lib_efuse.h"
+#include "lib_efuse_journal.h"
+#include "test.h"
+
+//------------------------------------------------------------------------------
+#define ENTRY_MAX   8
+#define THREAD_CNT  4
+#define INTENT_CNT  50
+
+static char Dir     [64];
+static char Path    [128];
+static const char *Device = "/dev/mmcblk0boot0";
+static const char *Uuid   = "dcbaa404-91bd-4a63-b5f1-001e06530001";
+static const char *UuidUp = "DCBAA404-91BD-4A63-B5F1-001E06530001";
+
+static efuse_journal *Journal;
+
+// efuse_journal_inflight/replay 결과
+static struct efuse_journal_entry Entry [ENTRY_MAX];
+static int EntryCnt;
+
+// op id (IdWrite ~ IdFail)
+static unsigned long long IdWrite, IdErase, IdVerify, IdFail;
+
+//------------------------------------------------------------------------------
+static void entry_cb (void *arg, const struct efuse_journal_entry *entry)
+{
+    (void)arg;
+    if (EntryCnt < ENTRY_MAX)
+        Entry[EntryCnt] = *entry;
+    EntryCnt++;
+}
+
+//------------------------------------------------------------------------------
+static int replay (void)
+{
+    EntryCnt = 0;
+    return efuse_journal_replay (Path, entry_cb, NULL);
+}
+
+//------------------------------------------------------------------------------
+static int file_lines (void)
+{
+    char buf [4096];
+    int fd, n, i, lines = 0;
+
+    if ((fd = open (Path, O_RDONLY)) < 0)
+        return -1;
+    while ((n = read (fd, buf, sizeof(buf))) > 0)
+        for (i = 0; i < n; i++)
+            lines += (buf[i] == '\n');
+    close (fd);
+    return lines;
+}
+
+//------------------------------------------------------------------------------
+static void file_append (const char *text)
+{
+    int fd = open (Path, O_WRONLY | O_APPEND);
+
+    test_check (fd >= 0);
+    test_check (write (fd, text, strlen (text)) == (ssize_t)strlen (text));
+    close (fd);
+}
+
+//------------------------------------------------------------------------------
+// erase(intent), write_verify(written) 2개가 in-flight인지 확인
+//------------------------------------------------------------------------------
+static void check_inflight (int cnt)
+{
+    test_check_int (cnt, 2);
+    test_check_int (EntryCnt, 2);
+    test_check (Entry[0].id == IdErase);
+    test_check_int (Entry[0].op,    eJOURNAL_OP_ERASE);
+    test_check_int (Entry[0].state, eJOURNAL_INTENT);
+    test_check_int (Entry[0].board_id, eBOARD_ID_M1S);
+    test_check (!strcmp (Entry[0].uuid, ""));
+    test_check (!strcmp (Entry[0].device, Device));
+
+    test_check (Entry[1].id == IdVerify);
+    test_check_int (Entry[1].op,    eJOURNAL_OP_WRITE_VERIFY);
+    test_check_int (Entry[1].state, eJOURNAL_WRITTEN);
+    test_check (!strcmp (Entry[1].uuid, UuidUp));
+    test_check (Entry[1].time > 0);
+}
+
+//------------------------------------------------------------------------------
+// write/erase는 written, write_verify는 verified/mismatch/failed에서 완료
+//------------------------------------------------------------------------------
+static void test_state (void)
+{
+    test_check ((Journal = efuse_journal_open (Path)) != NULL);
+
+    test_check ((IdWrite  = efuse_journal_intent (Journal, eJOURNAL_OP_WRITE, eBOARD_ID_M1S,
+                                                  Uuid, Device, 1)) != 0);
+    test_check ((IdErase  = efuse_journal_intent (Journal, eJOURNAL_OP_ERASE, eBOARD_ID_M1S,
+                                                  NULL, Device, 0)) != 0);
+    test_check ((IdVerify = efuse_journal_intent (Journal, eJOURNAL_OP_WRITE_VERIFY, eBOARD_ID_M1S,
+                                                  Uuid, Device, 0)) != 0);
+    test_check ((IdFail   = efuse_journal_intent (Journal, eJOURNAL_OP_WRITE_VERIFY, eBOARD_ID_M1S,
+                                                  Uuid, Device, 0)) != 0);
+    test_check (IdWrite < IdErase);
+    test_check (IdErase < IdVerify);
+
+    test_check_int (efuse_journal_state (Journal, IdWrite,  eJOURNAL_WRITTEN), 1);
+    test_check_int (efuse_journal_state (Journal, IdVerify, eJOURNAL_WRITTEN), 1);
+    test_check_int (efuse_journal_state (Journal, IdFail,   eJOURNAL_FAILED),  1);
+    // 완료된 operation, intent state : error
+    test_check_int (efuse_journal_state (Journal, IdWrite,  eJOURNAL_VERIFIED), 0);
+    test_check_int (efuse_journal_state (Journal, IdErase,  eJOURNAL_INTENT),   0);
+    test_check_int (efuse_journal_sync (Journal), 1);
+
+    EntryCnt = 0;
+    check_inflight (efuse_journal_inflight (Journal, entry_cb, NULL));
+    // 실행 중에도 file replay 결과가 같음
+    check_inflight (replay ());
+
+    // 잘못된 uuid, device path : intent 기록 안함
+    test_check (efuse_journal_intent (Journal, eJOURNAL_OP_WRITE, eBOARD_ID_M1S,
+                                      "dcbaa404", Device, 1) == 0);
+    test_check (efuse_journal_intent (Journal, eJOURNAL_OP_WRITE, eBOARD_ID_M1S,
+                                      Uuid, "/dev/a\nb", 1) == 0);
+    test_check (efuse_journal_intent (Journal, eJOURNAL_OP_END, eBOARD_ID_M1S,
+                                      Uuid, Device, 1) == 0);
+    test_check_int (efuse_journal_inflight (Journal, NULL, NULL), 2);
+    efuse_journal_close (Journal);
+}
+
+//------------------------------------------------------------------------------
+// 전원 차단 : 마지막 record가 일부만 기록 ('\n' 없음) 또는 crc가 다른 record
+//------------------------------------------------------------------------------
+static void test_truncated (void)
+{
+    struct stat st;
+
+    // verified record 기록 후 file 끝을 잘라냄 -> write_verify는 in-flight로 남음
+    test_check ((Journal = efuse_journal_open (Path)) != NULL);
+    test_check_int (efuse_journal_state (Journal, IdVerify, eJOURNAL_VERIFIED), 1);
+    efuse_journal_close (Journal);
+    test_check_int (replay (), 1);
+
+    test_check (stat (Path, &st) == 0);
+    test_check (truncate (Path, st.st_size - 1) == 0);
+    check_inflight (replay ());
+    test_check (truncate (Path, st.st_size - 6) == 0);
+    check_inflight (replay ());
+
+    // crc가 다른 record, 형식이 다른 record : 무시
+    file_append ("\n00000000 3 verified\n");
+    file_append ("garbage\n");
+    check_inflight (replay ());
+
+    // open시 in-flight만 남기고 다시 작성. 이후 record는 새 line에 기록, id 계속 증가.
+    test_check ((Journal = efuse_journal_open (Path)) != NULL);
+    EntryCnt = 0;
+    check_inflight (efuse_journal_inflight (Journal, entry_cb, NULL));
+    test_check (efuse_journal_intent (Journal, eJOURNAL_OP_WRITE, eBOARD_ID_M1S,
+                                      Uuid, Device, 1) > IdFail);
+    test_check_int (efuse_journal_inflight (Journal, NULL, NULL), 3);
+    efuse_journal_close (Journal);
+    test_check_int (replay (), 3);
+}
+
+//------------------------------------------------------------------------------
+// replay는 in-flight만 : open 후 file은 base + in-flight record만 포함
+//------------------------------------------------------------------------------
+static void test_compact (void)
+{
+    int i;
+
+    test_check ((Journal = efuse_journal_open (Path)) != NULL);
+    // base 1 + erase intent 1 + write_verify intent/written 2 + write intent 1
+    test_check_int (file_lines (), 5);
+
+    // 모두 완료 후 다시 open : base record만 남음
+    EntryCnt = 0;
+    efuse_journal_inflight (Journal, entry_cb, NULL);
+    for (i = 0; (i < EntryCnt) && (i < ENTRY_MAX); i++)
+        test_check_int (efuse_journal_state (Journal, Entry[i].id, eJOURNAL_RESOLVED), 1);
+    test_check_int (efuse_journal_inflight (Journal, NULL, NULL), 0);
+    efuse_journal_close (Journal);
+    test_check_int (replay (), 0);
+
+    test_check ((Journal = efuse_journal_open (Path)) != NULL);
+    test_check_int (file_lines (), 1);
+    test_check (efuse_journal_intent (Journal, eJOURNAL_OP_ERASE, eBOARD_ID_M1S,
+                                      NULL, Device, 1) > IdFail + 1);
+    efuse_journal_close (Journal);
+
+    // file 없음 : in-flight 없음
+    test_check_int (efuse_journal_replay ("/nonexistent/efuse.journal", NULL, NULL), 0);
+}
+
+//------------------------------------------------------------------------------
+static void *intent_thread (void *arg)
+{
+    unsigned long long *ids = (unsigned long long *)arg;
+    int i;
+
+    for (i = 0; i < INTENT_CNT; i++)
+        ids[i] = efuse_journal_intent (Journal, eJOURNAL_OP_WRITE, eBOARD_ID_M1S,
+                                       Uuid, Device, 1);
+    return NULL;
+}
+
+//------------------------------------------------------------------------------
+// 여러 thread의 intent (group commit) : id 중복 없음, 모두 in-flight
+//------------------------------------------------------------------------------
+static void test_group (void)
+{
+    static unsigned long long ids [THREAD_CNT * INTENT_CNT];
+    pthread_t thread [THREAD_CNT];
+    int i, k, ok, dup;
+
+    unlink (Path);
+    test_check ((Journal = efuse_journal_open (Path)) != NULL);
+    for (i = 0; i < THREAD_CNT; i++)
+        test_check_int (pthread_create (&thread[i], NULL, intent_thread, &ids[i * INTENT_CNT]), 0);
+    for (i = 0; i < THREAD_CNT; i++)
+        pthread_join (thread[i], NULL);
+
+    for (i = 0, ok = 0, dup = 0; i < THREAD_CNT * INTENT_CNT; i++) {
+        ok += (ids[i] != 0);
+        for (k = i + 1; k < THREAD_CNT * INTENT_CNT; k++)
+            dup += (ids[i] == ids[k]);
+    }
+    test_check_int (ok, THREAD_CNT * INTENT_CNT);
+    test_check_int (dup, 0);
+    test_check_int (efuse_journal_inflight (Journal, NULL, NULL), THREAD_CNT * INTENT_CNT);
+
+    // written 기록 후 sync 없이 close : close에서 sync
+    for (i = 0; i < THREAD_CNT * INTENT_CNT; i++)
+        efuse_journal_state (Journal, ids[i], eJOURNAL_WRITTEN);
+    efuse_journal_close (Journal);
+    test_check_int (replay (), 0);
+}
+
+//------------------------------------------------------------------------------
+int main (void)
+{
+    if (!test_tmpdir (Dir, sizeof(Dir))) {
+        printf ("error, test directory create.\n");
+        return 1;
+    }
+    snprintf (Path, sizeof(Path), "%s/efuse.journal", Dir);
+
+    test_state ();
+    test_truncated ();
+    test_compact ();
+    test_group ();
+
+    test_rmdir (Dir);
+    return test_result ("journal");
+}
+
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
@@ -0,0 +1,324 @@
+//------------------------------------------------------------------------------
+/**
+ * @file test_label.c
+ * @author charles-park (charles.park@hardkernel.com)
+ * @brief label print queue test (backpressure, batch, spool_dir spooler).
+ * @version 0.2
+ * @date 2023-09-22
+ *
+ * @package apt install cups cups-bsd
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#include <errno.h>
+#include <fcntl.h>
+
+#include "lib_efuse.h"
+#include "lib_efuse_board.h"
+#include "lib_efuse_label.h"
+#include "lib_efuse_sim.h"
+#include "lib_efuse_uring.h"
+#include "test.h"
+
+//------------------------------------------------------------------------------
+// queue 4개, job 1개 최대 3 label, job당 30ms (느린 printer) 에 label 20개 push
+//------------------------------------------------------------------------------
+#define LABEL_CNT   20
+#define QUEUE_MAX   4
+#define BATCH_MAX   3
+#define SPOOL_MS    30
+// io_uring path 사용 최소 device 수
+#define DEV_CNT     URING_DEV_MIN
+
+static char Dir [64];
+static char Uuid [LABEL_CNT][EFUSE_UUID_SIZE +1];
+static char Spool [LABEL_CNT * LABEL_SIZE];
+
+//------------------------------------------------------------------------------
+static int spool_filter (const struct dirent *d)
+{
+    size_t len = strlen (d->d_name);
+
+    return !strncmp (d->d_name, "label-", 6) && (len > 4) &&
+           !strcmp (&d->d_name[len - 4], ".zpl");
+}
+
+//------------------------------------------------------------------------------
+// spool file 이름(seq) 순서로 내용을 Spool에 연결.
+// return : file 수, labels : file별 label 수 최대/최소
+//------------------------------------------------------------------------------
+static int spool_read (int *label_max, int *label_min)
+{
+    struct dirent **list;
+    char path [PATH_MAX], *p;
+    int i, n, fd, len = 0, cnt;
+
+    *label_max = 0;
+    *label_min = LABEL_CNT;
+    memset (Spool, 0, sizeof(Spool));
+    if ((n = scandir (Dir, &list, spool_filter, alphasort)) < 0)
+        return 0;
+
+    for (i = 0; i < n; i++) {
+        snprintf (path, sizeof(path), "%s/%s", Dir, list[i]->d_name);
+        if ((fd = open (path, O_RDONLY)) >= 0) {
+            int ret = read (fd, &Spool[len], sizeof(Spool) - 1 - len);
+
+            // file 1개 = spooler job 1개, label 1개 = ^XA ... ^XZ
+            for (p = &Spool[len], cnt = 0; (p = strstr (p, "^XA")) != NULL; p++)
+                cnt++;
+            if (cnt > *label_max)   *label_max = cnt;
+            if (cnt < *label_min)   *label_min = cnt;
+            if (ret > 0)
+                len += ret;
+            close (fd);
+        }
+        free (list[i]);
+    }
+    free (list);
+    return n;
+}
+
+//------------------------------------------------------------------------------
+// 이전 test의 spool file 삭제 (efuse_label_open 마다 seq 0부터 시작)
+//------------------------------------------------------------------------------
+static void spool_clear (void)
+{
+    struct dirent **list;
+    char path [PATH_MAX];
+    int i, n;
+
+    if ((n = scandir (Dir, &list, spool_filter, alphasort)) < 0)
+        return;
+    for (i = 0; i < n; i++) {
+        snprintf (path, sizeof(path), "%s/%s", Dir, list[i]->d_name);
+        unlink (path);
+        free (list[i]);
+    }
+    free (list);
+}
+
+//------------------------------------------------------------------------------
+// 느린 spooler : queue가 가득 차면 push 대기, 대기중 쌓인 label은 job 1개로 묶음
+//------------------------------------------------------------------------------
+static void test_backpressure (void)
+{
+    struct efuse_label_cfg cfg = {
+        .spool_dir = Dir, .spool_ms = SPOOL_MS,
+        .queue_max = QUEUE_MAX, .batch_max = BATCH_MAX, .push_timeout_ms = -1,
+    };
+    struct efuse_label_stat stat;
+    char expect [LABEL_CNT * LABEL_SIZE], buf [LABEL_SIZE];
+    int i, files, label_max, label_min, len = 0;
+    efuse_label *label;
+    long long t0;
+
+    test_check ((label = efuse_label_open (&cfg)) != NULL);
+    t0 = test_now_ms ();
+    for (i = 0; i < LABEL_CNT; i++) {
+        test_check_int (efuse_label_push (label, eBOARD_ID_M1S, Uuid[i]), 1);
+        len += efuse_label_render (eBOARD_ID_M1S, Uuid[i], &expect[len], sizeof(expect) - len);
+    }
+    // queue에 들어가지 못한 label은 spooler job이 끝날 때까지 대기
+    test_check (test_now_ms () - t0 >= SPOOL_MS);
+    efuse_label_flush (label);
+
+    efuse_label_get_stat (label, &stat);
+    test_check_int (stat.queued,    LABEL_CNT);
+    test_check_int (stat.printed,   LABEL_CNT);
+    test_check_int (stat.failed,    0);
+    test_check_int (stat.dropped,   0);
+    test_check_int (stat.depth_max, QUEUE_MAX);
+    test_check (stat.wait_ns >= SPOOL_MS * 1000000LL);
+    test_check (stat.jobs >= (LABEL_CNT + BATCH_MAX - 1) / BATCH_MAX);
+    test_check (stat.jobs <  LABEL_CNT);
+    test_check_int (efuse_label_close (label), 1);
+
+    // spool file : job 수 만큼, job 1개 최대 batch_max label, push 순서 그대로
+    files = spool_read (&label_max, &label_min);
+    test_check_int (files, stat.jobs);
+    test_check (label_max <= BATCH_MAX);
+    test_check (label_max >  1);
+    test_check (label_min >= 1);
+    test_check (!strcmp (Spool, expect));
+
+    // label 내용 (첫 label : m1s, mac 00:1E:06:53:00:01)
+    test_check (!strncmp (Spool, "^XA", 3));
+    test_check (strstr (Spool, "^FDODROID-M1S^FS") != NULL);
+    test_check (strstr (Spool, "^FDMAC 00:1E:06:53:00:01^FS") != NULL);
+    test_check (strstr (Spool, "^FD001E06530001^FS") != NULL);
+    snprintf (buf, sizeof(buf), "^FDMAC 00:1E:06:53:00:%02X^FS^", LABEL_CNT);
+    test_check (strstr (Spool, buf) != NULL);
+    test_check (!strcmp (&Spool[strlen (Spool) - 4], "^XZ\n"));
+}
+
+//------------------------------------------------------------------------------
+// queue full : 대기 없음 (EAGAIN), timeout (ETIMEDOUT), uuid 형식 error (EINVAL)
+//------------------------------------------------------------------------------
+static void test_drop (void)
+{
+    struct efuse_label_cfg cfg = {
+        .spool_dir = Dir, .spool_ms = 200,
+        .queue_max = 2, .batch_max = 1, .push_timeout_ms = 0,
+    };
+    struct efuse_label_stat stat;
+    efuse_label *label;
+    long long t0;
+    int i, ok;
+
+    // worker가 spooler에 전달중인 1개 + queue 2개 이후 실패
+    test_check ((label = efuse_label_open (&cfg)) != NULL);
+    for (i = 0, ok = 1; (i < 10) && ok; i++)
+        ok = efuse_label_push (label, eBOARD_ID_M1S, Uuid[i]);
+    test_check_int (ok, 0);
+    test_check_int (errno, EAGAIN);
+    test_check (i >= 3);
+    test_check (i <= 4);
+
+    test_check_int (efuse_label_push (label, eBOARD_ID_M1S, "not-a-uuid"), 0);
+    test_check_int (errno, EINVAL);
+
+    efuse_label_flush (label);
+    efuse_label_get_stat (label, &stat);
+    test_check_int (stat.dropped, 1);
+    test_check_int (stat.printed, i - 1);
+    test_check_int (efuse_label_close (label), 0);
+
+    // timeout 대기 후 실패
+    cfg.push_timeout_ms = 50;
+    test_check ((label = efuse_label_open (&cfg)) != NULL);
+    for (i = 0, ok = 1; (i < 10) && ok; i++) {
+        t0 = test_now_ms ();
+        ok = efuse_label_push (label, eBOARD_ID_M1S, Uuid[i]);
+    }
+    t0 = test_now_ms () - t0;
+    test_check_int (ok, 0);
+    test_check_int (errno, ETIMEDOUT);
+    test_check (t0 >= 50);
+    efuse_label_get_stat (label, &stat);
+    test_check (stat.wait_ns >= 50 * 1000000LL);
+    test_check_int (efuse_label_close (label), 0);
+}
+
+//------------------------------------------------------------------------------
+// efuse_ctx_write_verify : eEFUSE_WV_WRITTEN 인 경우에만 label 추가
+//------------------------------------------------------------------------------
+static void test_write_verify (void)
+{
+    struct efuse_label_cfg cfg = { .spool_dir = Dir, .push_timeout_ms = -1 };
+    const struct efuse_board *b = efuse_board_info (eBOARD_ID_M1S);
+    char expect [LABEL_SIZE], data [EFUSE_UUID_SIZE +1];
+    int label_max, label_min;
+    efuse_label *label;
+    efuse_sim *sim;
+    efuse_ctx *ctx;
+
+    spool_clear ();
+    test_check ((label = efuse_label_open (&cfg)) != NULL);
+    sim = efuse_sim_create (NULL);
+    test_check (efuse_sim_add_device (sim, eSIM_DEV_EMMC, b->rw_control, b->rw_file));
+    test_check ((ctx = efuse_ctx_open (eBOARD_ID_M1S)) != NULL);
+    test_check (efuse_sim_attach (sim, ctx));
+    test_check_int (efuse_ctx_set_label (ctx, label), 1);
+    test_check (efuse_ctx_get_label (ctx) == label);
+
+    test_check_int (efuse_ctx_write_verify (ctx, Uuid[0], data), eEFUSE_WV_WRITTEN);
+    test_check_int (efuse_ctx_write_verify (ctx, Uuid[0], data), eEFUSE_WV_UNCHANGED);
+    // device error : write 실패
+    efuse_sim_set_fault (sim, eSIM_OP_PWRITE, 100, EIO);
+    test_check_int (efuse_ctx_write_verify (ctx, Uuid[1], data), eEFUSE_WV_ERROR);
+    efuse_sim_set_fault (sim, eSIM_OP_PWRITE, 0, 0);
+    // label 설정 해제 : write 되어도 label 없음
+    test_check_int (efuse_ctx_set_label (ctx, NULL), 1);
+    test_check_int (efuse_ctx_write_verify (ctx, Uuid[2], data), eEFUSE_WV_WRITTEN);
+    efuse_ctx_close (ctx);
+    efuse_sim_destroy (sim);
+
+    efuse_label_flush (label);
+    test_check_int (efuse_label_close (label), 1);
+    efuse_label_render (eBOARD_ID_M1S, Uuid[0], expect, sizeof(expect));
+    test_check_int (spool_read (&label_max, &label_min), 1);
+    test_check_int (label_max, 1);
+    test_check (!strcmp (Spool, expect));
+}
+
+//------------------------------------------------------------------------------
+// efuse_uring_write_verify : file-backed m2 device (io_uring 사용 불가시 sync path).
+// 어느 path든 written device 마다 label 1개, request 순서.
+//------------------------------------------------------------------------------
+static void test_uring (void)
+{
+    struct efuse_label_cfg cfg = { .spool_dir = Dir, .push_timeout_ms = -1 };
+    struct efuse_uring_req req [DEV_CNT];
+    char expect [DEV_CNT * LABEL_SIZE], uuid [DEV_CNT][EFUSE_UUID_SIZE +1];
+    char path [2][PATH_MAX];
+    unsigned long long mac_start;
+    int i, fd, label_max, label_min, len = 0, uring = 0;
+    efuse_label *label;
+
+    spool_clear ();
+    test_check ((label = efuse_label_open (&cfg)) != NULL);
+    efuse_get_mac_range (eBOARD_ID_M2, &mac_start, NULL);
+    memset (req, 0, sizeof(req));
+    for (i = 0; i < DEV_CNT; i++) {
+        snprintf (path[0], sizeof(path[0]), "%s/force_ro%d", Dir, i);
+        snprintf (path[1], sizeof(path[1]), "%s/boot%d", Dir, i);
+        test_check ((fd = open (path[0], O_RDWR | O_CREAT | O_TRUNC, 0644)) >= 0);
+        test_check (write (fd, "1", 1) == 1);
+        close (fd);
+        test_check ((fd = open (path[1], O_RDWR | O_CREAT | O_TRUNC, 0644)) >= 0);
+        close (fd);
+
+        test_check ((req[i].ctx = efuse_ctx_open (eBOARD_ID_M2)) != NULL);
+        efuse_ctx_set_path  (req[i].ctx, path[0], path[1]);
+        efuse_ctx_set_label (req[i].ctx, label);
+        snprintf (uuid[i], sizeof(uuid[i]), "dcbaa404-91bd-4a63-b5f1-%012llx", mac_start + i);
+        req[i].efuse_data = uuid[i];
+        len += efuse_label_render (eBOARD_ID_M2, uuid[i], &expect[len], sizeof(expect) - len);
+    }
+
+    test_check_int (efuse_uring_write_verify (req, DEV_CNT), DEV_CNT);
+    for (i = 0; i < DEV_CNT; i++) {
+        test_check_int (req[i].result, eEFUSE_WV_WRITTEN);
+        uring += req[i].uring;
+    }
+    test_check_int (uring, efuse_uring_available () ? DEV_CNT : 0);
+    // 같은 uuid : unchanged, label 없음
+    test_check_int (efuse_uring_write_verify (req, DEV_CNT), DEV_CNT);
+    for (i = 0; i < DEV_CNT; i++) {
+        test_check_int (req[i].result, eEFUSE_WV_UNCHANGED);
+        efuse_ctx_close (req[i].ctx);
+    }
+
+    efuse_label_flush (label);
+    test_check_int (efuse_label_close (label), 1);
+    test_check (spool_read (&label_max, &label_min) >= 1);
+    test_check (!strcmp (Spool, expect));
+}
+
+//------------------------------------------------------------------------------
+int main (void)
+{
+    int i;
+
+    if (!test_tmpdir (Dir, sizeof(Dir))) {
+        printf ("error, test directory create.\n");
+        return 1;
+    }
+    for (i = 0; i < LABEL_CNT; i++)
+        snprintf (Uuid[i], sizeof(Uuid[i]), "dcbaa404-91bd-4a63-b5f1-001e0653%04x", i + 1);
+
+    test_backpressure ();
+    test_drop ();
+    test_write_verify ();
+    test_uring ();
+
+    test_rmdir (Dir);
+    return test_result ("label");
+}
+
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
@@ -0,0 +1,223 @@
+//------------------------------------------------------------------------------
+/**
+ * @file test_macidx.c
+ * @author charles-park (charles.park@hardkernel.com)
+ * @brief issued mac index test (중복, hole, log ingest, 재시작, crash 후 open).
+ * @version 0.2
+ * @date 2023-09-22
+ *
+ * @package apt install cups cups-bsd
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include "lib_efuse.h"
+#include "lib_efuse_macidx.h"
+#include "test.h"
+
+//------------------------------------------------------------------------------
+#define M1S_MAC(n)  (0x001E06530000ULL + (n))
+
+static char Dir [64];
+static char Idx [128];
+static char Log [128];
+
+// callback 결과
+static int  DupCnt;
+static long DupOffset;
+static unsigned long long DupMac;
+static int  HoleCnt;
+static unsigned long long HoleMac [4];
+static int  HoleLen [4];
+
+//------------------------------------------------------------------------------
+static void dup_cb (void *arg, const char *log_path, long offset,
+                    unsigned long long mac, int board_id)
+{
+    (void)arg;
+    (void)log_path;
+    if (board_id == eBOARD_ID_M1S) {
+        DupCnt++;
+        DupOffset = offset;
+        DupMac    = mac;
+    }
+}
+
+//------------------------------------------------------------------------------
+static void hole_cb (void *arg, unsigned long long mac_start, int cnt)
+{
+    (void)arg;
+    if (HoleCnt < 4) {
+        HoleMac[HoleCnt] = mac_start;
+        HoleLen[HoleCnt] = cnt;
+    }
+    HoleCnt++;
+}
+
+//------------------------------------------------------------------------------
+static void log_append (const char *text)
+{
+    int fd = open (Log, O_WRONLY | O_CREAT | O_APPEND, 0644);
+
+    test_check (fd >= 0);
+    test_check (write (fd, text, strlen (text)) == (ssize_t)strlen (text));
+    close (fd);
+}
+
+//------------------------------------------------------------------------------
+// 등록, 중복, 범위 밖, hole
+//------------------------------------------------------------------------------
+static void test_add (efuse_macidx *idx)
+{
+    struct efuse_macidx_stat stat;
+    int i;
+
+    // 0 ~ 9 중 5, 6 제외
+    for (i = 0; i < 10; i++)
+        if ((i != 5) && (i != 6))
+            test_check_int (efuse_macidx_add (idx, M1S_MAC (i)), eMACIDX_NEW);
+    test_check_int (efuse_macidx_add (idx, M1S_MAC (3)), eMACIDX_DUP);
+    test_check_int (efuse_macidx_add (idx, 0x001E06000001ULL), eMACIDX_RANGE);
+    test_check_int (efuse_macidx_add (idx, 0x001122330001ULL), eMACIDX_RANGE);
+
+    test_check_int (efuse_macidx_test (idx, M1S_MAC (4)), 1);
+    test_check_int (efuse_macidx_test (idx, M1S_MAC (5)), 0);
+
+    test_check (efuse_macidx_stat (idx, eBOARD_ID_M1S, &stat));
+    test_check_int (stat.issued, 8);
+    test_check_int (stat.dups,   1);
+    test_check_int (stat.holes,  2);
+    test_check (stat.mac_last == M1S_MAC (9));
+
+    test_check_int (efuse_macidx_holes (idx, eBOARD_ID_M1S, hole_cb, NULL), 1);
+    test_check_int (HoleCnt, 1);
+    test_check (HoleMac[0] == M1S_MAC (5));
+    test_check_int (HoleLen[0], 2);
+
+    // 다른 board는 영향 없음
+    test_check (efuse_macidx_stat (idx, eBOARD_ID_M2, &stat));
+    test_check_int (stat.issued, 0);
+    test_check (stat.mac_last == 0);
+}
+
+//------------------------------------------------------------------------------
+// log ingest : 추가된 line만, 미완성 마지막 line은 다음에 처리, 중복 line 위치 통보
+//------------------------------------------------------------------------------
+static void test_ingest (efuse_macidx *idx)
+{
+    const char *line0 = "success, eFuse data write. efuse = dcbaa404-91bd-4a63-b5f1-001e0653000a\n";
+    const char *line1 = "no uuid line\n";
+    const char *line2 = "success, efuse = DCBAA404-91BD-4A63-B5F1-001E06530002\n";
+
+    log_append (line0);
+    log_append (line1);
+    log_append (line2);
+    log_append ("success, efuse = dcbaa404-91bd-4a63-b5f1-001e0653");
+
+    test_check_int (efuse_macidx_ingest (idx, Log, dup_cb, NULL), 2);
+    test_check_int (DupCnt, 1);
+    test_check (DupMac == M1S_MAC (2));
+    test_check_int (DupOffset, strlen (line0) + strlen (line1));
+    test_check_int (efuse_macidx_test (idx, M1S_MAC (10)), 1);
+
+    // 변경 없음 : 0, 미완성 line 완료 후 : 1
+    test_check_int (efuse_macidx_ingest (idx, Log, dup_cb, NULL), 0);
+    log_append ("0005\n");
+    test_check_int (efuse_macidx_ingest (idx, Log, dup_cb, NULL), 1);
+    test_check_int (efuse_macidx_test (idx, M1S_MAC (5)), 1);
+    test_check_int (DupCnt, 1);
+
+    test_check_int (efuse_macidx_ingest (idx, "/nonexistent/efuse.log", dup_cb, NULL), -1);
+}
+
+//------------------------------------------------------------------------------
+// 재시작 : bitmap, 통계, log 위치 유지
+//------------------------------------------------------------------------------
+static void test_reopen (void)
+{
+    struct efuse_macidx_stat stat;
+    efuse_macidx *idx;
+
+    test_check ((idx = efuse_macidx_open (Idx)) != NULL);
+    test_check (efuse_macidx_stat (idx, eBOARD_ID_M1S, &stat));
+    test_check_int (stat.issued, 10);
+    test_check_int (stat.dups,   2);
+    test_check_int (stat.holes,  1);
+    test_check (stat.mac_last == M1S_MAC (10));
+    test_check_int (efuse_macidx_add (idx, M1S_MAC (10)), eMACIDX_DUP);
+    test_check_int (efuse_macidx_add (idx, M1S_MAC (6)),  eMACIDX_NEW);
+
+    HoleCnt = 0;
+    test_check_int (efuse_macidx_holes (idx, eBOARD_ID_M1S, hole_cb, NULL), 0);
+    test_check_int (efuse_macidx_ingest (idx, Log, dup_cb, NULL), 0);
+    efuse_macidx_close (idx);
+}
+
+//------------------------------------------------------------------------------
+// ftruncate 후 header 기록 전 crash (모두 0인 index file) : 새 index로 open
+//------------------------------------------------------------------------------
+static void test_crash (void)
+{
+    struct efuse_macidx_stat stat;
+    efuse_macidx *idx;
+    char path [128];
+    struct stat st;
+    int fd;
+
+    test_check (lstat (Idx, &st) == 0);
+    snprintf (path, sizeof(path), "%s/crash.idx", Dir);
+    test_check ((fd = open (path, O_RDWR | O_CREAT | O_TRUNC, 0644)) >= 0);
+    test_check (ftruncate (fd, st.st_size) == 0);
+    close (fd);
+
+    test_check ((idx = efuse_macidx_open (path)) != NULL);
+    test_check (efuse_macidx_stat (idx, eBOARD_ID_M1S, &stat));
+    test_check_int (stat.issued, 0);
+    test_check_int (efuse_macidx_add (idx, M1S_MAC (1)), eMACIDX_NEW);
+    efuse_macidx_close (idx);
+
+    test_check ((idx = efuse_macidx_open (path)) != NULL);
+    test_check_int (efuse_macidx_test (idx, M1S_MAC (1)), 1);
+    efuse_macidx_close (idx);
+
+    // 크기가 다른 file : open 실패
+    test_check ((fd = open (path, O_RDWR | O_TRUNC)) >= 0);
+    test_check (ftruncate (fd, 4096) == 0);
+    close (fd);
+    test_check (efuse_macidx_open (path) == NULL);
+}
+
+//------------------------------------------------------------------------------
+int main (void)
+{
+    efuse_macidx *idx;
+
+    if (!test_tmpdir (Dir, sizeof(Dir))) {
+        printf ("error, test directory create.\n");
+        return 1;
+    }
+    snprintf (Idx, sizeof(Idx), "%s/mac.idx", Dir);
+    snprintf (Log, sizeof(Log), "%s/station.log", Dir);
+
+    test_check ((idx = efuse_macidx_open (Idx)) != NULL);
+    // 한 process만 open 가능
+    test_check (efuse_macidx_open (Idx) == NULL);
+
+    test_add (idx);
+    test_ingest (idx);
+    efuse_macidx_close (idx);
+
+    test_reopen ();
+    test_crash ();
+
+    test_rmdir (Dir);
+    return test_result ("macidx");
+}
+
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
@@ -0,0 +1,241 @@
+//------------------------------------------------------------------------------
+/**
+ * @file test_owner.c
+ * @author charles-park (charles.park@hardkernel.com)
+ * @brief device owner table test (종료된 owner 회수, ticket 순서 대기, crash 후 open).
+ * @version 0.2
+ * @date 2023-09-22
+ *
+ * @package apt install cups cups-bsd
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "lib_efuse.h"
+#include "lib_efuse_owner.h"
+#include "test.h"
+
+//------------------------------------------------------------------------------
+#define WAITER_CNT  4
+#define WAIT_MS     2000
+
+static char Dir    [64];
+static char Table  [128];
+static char Device [128];
+static efuse_owner *Owner;
+
+// ticket 순서 test
+static int Order [WAITER_CNT];
+static int OrderCnt;
+
+// efuse_owner_list 결과 (Device slot)
+static struct efuse_owner_info Info;
+
+//------------------------------------------------------------------------------
+static void list_cb (void *arg, const struct efuse_owner_info *info)
+{
+    (void)arg;
+    if (strstr (Device, info->device) != NULL)
+        Info = *info;
+}
+
+//------------------------------------------------------------------------------
+static void owner_info (void)
+{
+    memset (&Info, 0, sizeof(Info));
+    efuse_owner_list (Owner, list_cb, NULL);
+}
+
+//------------------------------------------------------------------------------
+// Device slot의 대기자가 cnt가 될 때까지 대기. return : 1 = success
+//------------------------------------------------------------------------------
+static int wait_waiters (int cnt)
+{
+    long long t0 = test_now_ms ();
+
+    for (owner_info (); Info.waiters != cnt; owner_info ()) {
+        if (test_now_ms () - t0 > WAIT_MS)
+            return 0;
+        test_sleep_ms (1);
+    }
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+static void *waiter_thread (void *arg)
+{
+    struct efuse_owner_lock lock;
+    int id = (int)(long)arg;
+
+    efuse_owner_lock_init (&lock);
+    if (!efuse_owner_acquire (Owner, &lock, Device, -1, NULL))
+        return NULL;
+    Order[__atomic_fetch_add (&OrderCnt, 1, __ATOMIC_RELAXED)] = id;
+    test_sleep_ms (2);
+    efuse_owner_release (Owner, &lock);
+    return NULL;
+}
+
+//------------------------------------------------------------------------------
+// 경쟁 없음, 대기 안함(EBUSY), timeout, cancel
+//------------------------------------------------------------------------------
+static void test_basic (void)
+{
+    struct efuse_owner_lock lock, other;
+    int cancel = 1;
+    long long t0;
+
+    efuse_owner_lock_init (&lock);
+    efuse_owner_lock_init (&other);
+    test_check_int (efuse_owner_acquire (Owner, &lock, Device, 0, NULL), 1);
+    test_check_int (efuse_owner_acquire (Owner, &lock, Device, 0, NULL), 1);
+
+    test_check_int (efuse_owner_acquire (Owner, &other, Device, 0, NULL), 0);
+    test_check_int (errno, EBUSY);
+    t0 = test_now_ms ();
+    test_check_int (efuse_owner_acquire (Owner, &other, Device, 30, NULL), 0);
+    test_check_int (errno, ETIMEDOUT);
+    test_check (test_now_ms () - t0 >= 30);
+    test_check_int (efuse_owner_acquire (Owner, &other, Device, -1, &cancel), 0);
+    test_check_int (errno, ECANCELED);
+
+    owner_info ();
+    test_check_int (Info.pid, getpid ());
+    test_check_int (Info.waiters, 0);
+
+    test_check_int (efuse_owner_release (Owner, &lock), 1);
+    test_check_int (efuse_owner_release (Owner, &lock), 0);
+    test_check_int (efuse_owner_acquire (Owner, &other, Device, 0, NULL), 1);
+    test_check_int (efuse_owner_release (Owner, &other), 1);
+}
+
+//------------------------------------------------------------------------------
+// 대기 순서(ticket)대로 owner 전달
+//------------------------------------------------------------------------------
+static void test_order (void)
+{
+    struct efuse_owner_lock lock;
+    pthread_t thread [WAITER_CNT];
+    long i;
+
+    efuse_owner_lock_init (&lock);
+    test_check_int (efuse_owner_acquire (Owner, &lock, Device, 0, NULL), 1);
+    for (i = 0; i < WAITER_CNT; i++) {
+        test_check_int (pthread_create (&thread[i], NULL, waiter_thread, (void *)i), 0);
+        test_check (wait_waiters (i + 1));
+    }
+    test_check_int (efuse_owner_release (Owner, &lock), 1);
+    for (i = 0; i < WAITER_CNT; i++)
+        pthread_join (thread[i], NULL);
+
+    test_check_int (OrderCnt, WAITER_CNT);
+    for (i = 0; i < WAITER_CNT; i++)
+        test_check_int (Order[i], i);
+    owner_info ();
+    test_check_int (Info.pid, 0);
+    test_check (Info.contended >= WAITER_CNT);
+}
+
+//------------------------------------------------------------------------------
+// owner process가 release 없이 종료 : 대기중인 process가 회수 (zombie도 종료로 처리)
+//------------------------------------------------------------------------------
+static void test_dead_owner (void)
+{
+    struct efuse_owner_lock lock;
+    int status, ready [2];
+    pid_t pid;
+    char c;
+
+    test_check (pipe (ready) == 0);
+    if ((pid = fork ()) == 0) {
+        efuse_owner_lock_init (&lock);
+        c = efuse_owner_acquire (Owner, &lock, Device, 0, NULL) ? '1' : '0';
+        if (write (ready[1], &c, 1) != 1)
+            _exit (1);
+        test_sleep_ms (50);
+        _exit (0);
+    }
+    test_check (pid > 0);
+    test_check (read (ready[0], &c, 1) == 1);
+    test_check_int (c, '1');
+    close (ready[0]);
+    close (ready[1]);
+
+    owner_info ();
+    test_check_int (Info.pid, pid);
+
+    efuse_owner_lock_init (&lock);
+    test_check_int (efuse_owner_acquire (Owner, &lock, Device, WAIT_MS, NULL), 1);
+    test_check (waitpid (pid, &status, 0) == pid);
+    owner_info ();
+    test_check_int (Info.pid, getpid ());
+    test_check_int (Info.stale, 1);
+    test_check_int (efuse_owner_release (Owner, &lock), 1);
+}
+
+//------------------------------------------------------------------------------
+// ftruncate 후 header 기록 전 crash (모두 0인 table file) : 새 table로 open
+//------------------------------------------------------------------------------
+static void test_crash (void)
+{
+    struct efuse_owner_lock lock;
+    efuse_owner *owner;
+    char path [128];
+    struct stat st;
+    int fd;
+
+    test_check (lstat (Table, &st) == 0);
+    snprintf (path, sizeof(path), "%s/crash.owner", Dir);
+    test_check ((fd = open (path, O_RDWR | O_CREAT | O_TRUNC, 0644)) >= 0);
+    test_check (ftruncate (fd, st.st_size) == 0);
+    close (fd);
+
+    test_check ((owner = efuse_owner_open (path)) != NULL);
+    efuse_owner_lock_init (&lock);
+    test_check_int (efuse_owner_acquire (owner, &lock, Device, 0, NULL), 1);
+    test_check_int (efuse_owner_release (owner, &lock), 1);
+    efuse_owner_close (owner);
+
+    // 크기가 다른 file : open 실패
+    test_check ((fd = open (path, O_RDWR | O_TRUNC)) >= 0);
+    test_check (ftruncate (fd, 4096) == 0);
+    close (fd);
+    test_check (efuse_owner_open (path) == NULL);
+}
+
+//------------------------------------------------------------------------------
+int main (void)
+{
+    int fd;
+
+    if (!test_tmpdir (Dir, sizeof(Dir))) {
+        printf ("error, test directory create.\n");
+        return 1;
+    }
+    snprintf (Table,  sizeof(Table),  "%s/efuse.owner", Dir);
+    snprintf (Device, sizeof(Device), "%s/force_ro", Dir);
+    if ((fd = open (Device, O_WRONLY | O_CREAT, 0644)) >= 0)
+        close (fd);
+
+    test_check ((Owner = efuse_owner_open (Table)) != NULL);
+    test_basic ();
+    test_order ();
+    test_dead_owner ();
+    efuse_owner_close (Owner);
+
+    test_crash ();
+
+    test_rmdir (Dir);
+    return test_result ("owner");
+}
+
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
@@ -0,0 +1,173 @@
+//------------------------------------------------------------------------------
+/**
+ * @file test_prov.c
+ * @author charles-park (charles.park@hardkernel.com)
+ * @brief provisioning engine test (file-backed boot0/force_ro, kernel backend).
+ * @version 0.2
+ * @date 2023-09-22
+ *
+ * @package apt install cups cups-bsd
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#include <fcntl.h>
+#include <strings.h>
+
+#include "lib_efuse.h"
+#include "lib_efuse_prov.h"
+#include "test.h"
+
+//------------------------------------------------------------------------------
+// device 8개를 worker 3개로 처리. 추가 job : 이미 같은 uuid (unchanged),
+// device 없음, mac range 밖 (write 후 valid check 실패).
+//------------------------------------------------------------------------------
+#define DEV_CNT     8
+#define WORKER_CNT  3
+#define JOB_CNT     (DEV_CNT + 3)
+
+#define JOB_SAME    (DEV_CNT + 0)
+#define JOB_NODEV   (DEV_CNT + 1)
+#define JOB_RANGE   (DEV_CNT + 2)
+
+static char Dir [64];
+static char Control [JOB_CNT][PATH_MAX];
+static char File    [JOB_CNT][PATH_MAX];
+static int  InitCnt;
+
+//------------------------------------------------------------------------------
+// job context 생성시 호출 (worker thread)
+//------------------------------------------------------------------------------
+static void ctx_init (void *arg, efuse_ctx *ctx)
+{
+    const char *rw_control, *rw_file;
+
+    (void)arg;
+    efuse_ctx_get_path (ctx, &rw_control, &rw_file);
+    if (!strncmp (rw_file, Dir, strlen (Dir)))
+        __atomic_fetch_add (&InitCnt, 1, __ATOMIC_RELAXED);
+}
+
+//------------------------------------------------------------------------------
+static int file_write (const char *path, const char *data, int size)
+{
+    int fd, ret;
+
+    if ((fd = open (path, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0)
+        return 0;
+    ret = (write (fd, data, size) == size);
+    close (fd);
+    return ret;
+}
+
+//------------------------------------------------------------------------------
+static int file_read (const char *path, char *data, int size)
+{
+    int fd, ret;
+
+    memset (data, 0, size);
+    if ((fd = open (path, O_RDONLY)) < 0)
+        return -1;
+    ret = read (fd, data, size - 1);
+    close (fd);
+    return ret;
+}
+
+//------------------------------------------------------------------------------
+// boot partition (512 byte, 0) + force_ro ("1" = lock) 생성
+//------------------------------------------------------------------------------
+static int dev_create (int i, const char *uuid)
+{
+    char boot [512];
+
+    snprintf (Control[i], PATH_MAX, "%s/force_ro%d", Dir, i);
+    snprintf (File[i],    PATH_MAX, "%s/mmcblk%dboot0", Dir, i);
+
+    memset (boot, 0, sizeof(boot));
+    if (uuid != NULL)
+        memcpy (boot, uuid, EFUSE_UUID_SIZE);
+    return file_write (Control[i], "1", 1) && file_write (File[i], boot, sizeof(boot));
+}
+
+//------------------------------------------------------------------------------
+int main (void)
+{
+    struct efuse_prov_job jobs [JOB_CNT];
+    struct efuse_prov_report report;
+    char uuid [JOB_CNT][EFUSE_UUID_SIZE +1], buf [512];
+    int i, ok;
+
+    if (!test_tmpdir (Dir, sizeof(Dir))) {
+        printf ("error, test directory create.\n");
+        return 1;
+    }
+    for (i = 0; i < JOB_CNT; i++)
+        snprintf (uuid[i], sizeof(uuid[i]), "dcbaa404-91bd-4a63-b5f1-001e0653%04x", i + 1);
+    snprintf (uuid[JOB_RANGE], sizeof(uuid[JOB_RANGE]), "dcbaa404-91bd-4a63-b5f1-001e064a0001");
+
+    for (i = 0; i < JOB_CNT; i++) {
+        if (i == JOB_NODEV) {
+            snprintf (Control[i], PATH_MAX, "%s/force_ro_none", Dir);
+            snprintf (File[i],    PATH_MAX, "%s/mmcblk_none", Dir);
+            continue;
+        }
+        test_check (dev_create (i, (i == JOB_SAME) ? "DCBAA404-91BD-4A63-B5F1-001E06530009" : NULL));
+    }
+    for (i = 0; i < JOB_CNT; i++)
+        test_check (efuse_prov_job_init (&jobs[i], eBOARD_ID_M1S, Control[i], File[i], uuid[i]));
+    test_check (!efuse_prov_job_init (&jobs[0], eBOARD_ID_M1S, NULL, NULL, "dcbaa404"));
+    test_check (efuse_prov_job_init (&jobs[0], eBOARD_ID_M1S, Control[0], File[0], uuid[0]));
+
+    ok = efuse_prov_run (jobs, JOB_CNT, WORKER_CNT, &report);
+    test_check_int (ok, DEV_CNT + 1);
+    test_check_int (report.job_cnt,  JOB_CNT);
+    test_check_int (report.ok_cnt,   DEV_CNT + 1);
+    test_check_int (report.fail_cnt, 2);
+    test_check (report.max_job_us <= report.wall_us);
+
+    // write 된 device : read back, device file 내용, force_ro lock 복구
+    for (i = 0; i < DEV_CNT; i++) {
+        test_check_int (jobs[i].status, 1);
+        test_check_int (jobs[i].wv_status, eEFUSE_WV_WRITTEN);
+        test_check (!strcasecmp (jobs[i].read_data, uuid[i]));
+        test_check_int (file_read (File[i], buf, sizeof(buf)), sizeof(buf) - 1);
+        test_check (!strncasecmp (buf, uuid[i], EFUSE_UUID_SIZE));
+        test_check_int (file_read (Control[i], buf, sizeof(buf)), 1);
+        test_check (!strcmp (buf, "1"));
+    }
+    // 이미 같은 uuid : write 하지 않음
+    test_check_int (jobs[JOB_SAME].status, 1);
+    test_check_int (jobs[JOB_SAME].wv_status, eEFUSE_WV_UNCHANGED);
+    test_check (!strcasecmp (jobs[JOB_SAME].read_data, uuid[JOB_SAME]));
+
+    // device 없음
+    test_check_int (jobs[JOB_NODEV].status, 0);
+    test_check_int (jobs[JOB_NODEV].wv_status, eEFUSE_WV_ERROR);
+    test_check (access (File[JOB_NODEV], F_OK) != 0);
+
+    // m1s mac range 밖 (c4 mac) : write/verify는 성공, valid check 실패
+    test_check_int (jobs[JOB_RANGE].status, 0);
+    test_check_int (jobs[JOB_RANGE].wv_status, eEFUSE_WV_WRITTEN);
+    test_check_int (file_read (Control[JOB_RANGE], buf, sizeof(buf)), 1);
+    test_check (!strcmp (buf, "1"));
+
+    // 다시 실행하면 모두 unchanged. job context마다 device path 설정 후 ctx_init 호출.
+    efuse_prov_set_ctx_init (ctx_init, NULL);
+    ok = efuse_prov_run (jobs, DEV_CNT, WORKER_CNT, NULL);
+    efuse_prov_set_ctx_init (NULL, NULL);
+    test_check_int (ok, DEV_CNT);
+    test_check_int (InitCnt, DEV_CNT);
+    for (i = 0; i < DEV_CNT; i++)
+        test_check_int (jobs[i].wv_status, eEFUSE_WV_UNCHANGED);
+
+    test_check_int (efuse_prov_run (NULL, 1, 1, NULL), 0);
+    test_check_int (efuse_prov_run (jobs, 0, 1, NULL), 0);
+
+    test_rmdir (Dir);
+    return test_result ("prov");
+}
+
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
@@ -0,0 +1,310 @@
+//------------------------------------------------------------------------------
+/**
+ * @file test_retry.c
+ * @author charles-park (charles.park@hardkernel.com)
+ * @brief deadline/retry/cancel test with the fault-injecting simulation device.
+ * @version 0.2
+ * @date 2023-09-22
+ *
+ * @package apt install cups cups-bsd
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#include <errno.h>
+#include <pthread.h>
+#include <strings.h>
+
+#include "lib_efuse.h"
+#include "lib_efuse_board.h"
+#include "lib_efuse_sim.h"
+#include "test.h"
+
+//------------------------------------------------------------------------------
+// sim latency로 멈춘 device 재현. timeout은 latency보다 충분히 짧게 설정.
+//------------------------------------------------------------------------------
+#define HANG_MS     400
+#define TIMEOUT_MS  100
+
+static const char *Uuid = "dcbaa404-91bd-4a63-b5f1-001e06530001";
+
+static efuse_sim *Sim;
+
+struct cancel_arg {
+    efuse_ctx   *ctx;
+    int         delay_ms;
+};
+
+//------------------------------------------------------------------------------
+static void *cancel_thread (void *arg)
+{
+    struct cancel_arg *c = (struct cancel_arg *)arg;
+
+    test_sleep_ms (c->delay_ms);
+    efuse_ctx_cancel (c->ctx, 1);
+    return NULL;
+}
+
+//------------------------------------------------------------------------------
+static efuse_ctx *ctx_create (int timeout_ms, int retry_cnt, int backoff_ms, int backoff_max_ms)
+{
+    struct efuse_retry retry;
+    efuse_ctx *ctx = efuse_ctx_open (eBOARD_ID_M1S);
+
+    memset (&retry, 0, sizeof(retry));
+    retry.timeout_ms     = timeout_ms;
+    retry.retry_cnt      = retry_cnt;
+    retry.backoff_ms     = backoff_ms;
+    retry.backoff_max_ms = backoff_max_ms;
+
+    test_check (efuse_sim_attach (Sim, ctx));
+    test_check (efuse_ctx_set_retry (ctx, &retry));
+    return ctx;
+}
+
+//------------------------------------------------------------------------------
+static void sim_clear (void)
+{
+    int op;
+
+    for (op = 0; op < eSIM_OP_END; op++) {
+        efuse_sim_set_fault   (Sim, op, 0, 0);
+        efuse_sim_set_latency (Sim, op, 0);
+    }
+    efuse_sim_reset_count (Sim);
+}
+
+//------------------------------------------------------------------------------
+// 일시적 error 1회 후 재시도 성공
+//------------------------------------------------------------------------------
+static void test_transient (void)
+{
+    efuse_ctx *ctx = ctx_create (0, 3, 1, 0);
+    char data [EFUSE_UUID_SIZE +1];
+
+    sim_clear ();
+    efuse_sim_set_fault (Sim, eSIM_OP_PREAD, 1, EIO);
+    memset (data, 0, sizeof(data));
+    test_check_int (efuse_ctx_control (ctx, data, EFUSE_READ), 1);
+    test_check_int (efuse_ctx_last_error (ctx), eEFUSE_OK);
+    test_check (!strcasecmp (data, Uuid));
+    test_check_int (efuse_sim_get_count (Sim, eSIM_OP_PREAD), 2);
+
+    // open 실패 (device 연결 지연)도 재시도
+    sim_clear ();
+    efuse_sim_set_fault (Sim, eSIM_OP_OPEN, 2, ENOENT);
+    test_check_int (efuse_ctx_control (ctx, data, EFUSE_READ), 1);
+    test_check_int (efuse_ctx_last_error (ctx), eEFUSE_OK);
+    test_check_int (efuse_sim_get_count (Sim, eSIM_OP_OPEN), 3);
+
+    // 재시도 없음 (retry_cnt 0) : 첫 error로 실패
+    efuse_ctx_close (ctx);
+    ctx = ctx_create (0, 0, 1, 0);
+    sim_clear ();
+    efuse_sim_set_fault (Sim, eSIM_OP_PREAD, 1, EIO);
+    test_check_int (efuse_ctx_control (ctx, data, EFUSE_READ), 0);
+    test_check_int (efuse_ctx_last_error (ctx), eEFUSE_ERR_IO);
+    test_check_int (efuse_sim_get_count (Sim, eSIM_OP_PREAD), 1);
+    efuse_ctx_close (ctx);
+}
+
+//------------------------------------------------------------------------------
+// 계속 실패 : 1 + retry_cnt 회 시도, backoff 2배씩 증가 (backoff_max_ms 까지)
+//------------------------------------------------------------------------------
+static void test_exhaust (void)
+{
+    efuse_ctx *ctx = ctx_create (0, 3, 20, 30);
+    char data [EFUSE_UUID_SIZE +1];
+    long long t0;
+
+    sim_clear ();
+    efuse_sim_set_fault (Sim, eSIM_OP_PREAD, -1, EIO);
+    t0 = test_now_ms ();
+    test_check_int (efuse_ctx_control (ctx, data, EFUSE_READ), 0);
+    t0 = test_now_ms () - t0;
+    test_check_int (efuse_ctx_last_error (ctx), eEFUSE_ERR_IO);
+    test_check_int (efuse_sim_get_count (Sim, eSIM_OP_PREAD), 4);
+    // backoff 20 + 30 + 30 ms
+    test_check (t0 >= 80);
+    test_check (t0 < 80 + 200);
+
+    // retry error가 아닌 경우 (uuid 형식) 재시도 하지 않음
+    sim_clear ();
+    memcpy (data, "not-a-uuid", 11);
+    test_check_int (efuse_ctx_control (ctx, data, EFUSE_WRITE), 0);
+    test_check_int (efuse_ctx_last_error (ctx), eEFUSE_ERR_PARAM);
+    test_check_int (efuse_sim_get_count (Sim, eSIM_OP_PWRITE), 0);
+
+    // 다음 operation은 error 초기화
+    sim_clear ();
+    test_check_int (efuse_ctx_control (ctx, data, EFUSE_READ), 1);
+    test_check_int (efuse_ctx_last_error (ctx), eEFUSE_OK);
+    efuse_ctx_close (ctx);
+
+    // deadline 안에 backoff 할 수 없으면 재시도 중단 (마지막 error 유지)
+    ctx = ctx_create (TIMEOUT_MS, 10, 60, 0);
+    sim_clear ();
+    efuse_sim_set_fault (Sim, eSIM_OP_PREAD, -1, EIO);
+    t0 = test_now_ms ();
+    test_check_int (efuse_ctx_control (ctx, data, EFUSE_READ), 0);
+    test_check (test_now_ms () - t0 < TIMEOUT_MS + 100);
+    test_check_int (efuse_ctx_last_error (ctx), eEFUSE_ERR_IO);
+    test_check_int (efuse_sim_get_count (Sim, eSIM_OP_PREAD), 2);
+    efuse_ctx_close (ctx);
+}
+
+//------------------------------------------------------------------------------
+// device hang : timeout -> (이전 요청 진행중) busy -> 요청이 끝나면 정상
+//------------------------------------------------------------------------------
+static void test_hang (void)
+{
+    efuse_ctx *ctx = ctx_create (TIMEOUT_MS, 3, 1, 0);
+    char data [EFUSE_UUID_SIZE +1];
+    long long t0;
+
+    sim_clear ();
+    efuse_sim_set_latency (Sim, eSIM_OP_PREAD, HANG_MS * 1000L);
+    t0 = test_now_ms ();
+    test_check_int (efuse_ctx_control (ctx, data, EFUSE_READ), 0);
+    t0 = test_now_ms () - t0;
+    test_check_int (efuse_ctx_last_error (ctx), eEFUSE_ERR_TIMEOUT);
+    test_check (t0 >= TIMEOUT_MS);
+    test_check (t0 <  HANG_MS);
+    // timeout은 재시도 하지 않음
+    test_check_int (efuse_sim_get_count (Sim, eSIM_OP_PREAD), 1);
+
+    // abandoned 요청이 끝나기 전 : busy (device 요청 없이 바로 return)
+    efuse_sim_set_latency (Sim, eSIM_OP_PREAD, 0);
+    t0 = test_now_ms ();
+    test_check_int (efuse_ctx_control (ctx, data, EFUSE_READ), 0);
+    test_check_int (efuse_ctx_last_error (ctx), eEFUSE_ERR_BUSY);
+    test_check (test_now_ms () - t0 < TIMEOUT_MS);
+    test_check_int (efuse_sim_get_count (Sim, eSIM_OP_PREAD), 1);
+
+    // abandoned 요청 종료 후 복구
+    test_sleep_ms (HANG_MS);
+    memset (data, 0, sizeof(data));
+    test_check_int (efuse_ctx_control (ctx, data, EFUSE_READ), 1);
+    test_check_int (efuse_ctx_last_error (ctx), eEFUSE_OK);
+    test_check (!strcasecmp (data, Uuid));
+    // abandoned 요청의 descriptor는 요청 종료 후 close
+    test_check_int (efuse_sim_get_count (Sim, eSIM_OP_OPEN), efuse_sim_get_count (Sim, eSIM_OP_CLOSE));
+    efuse_ctx_close (ctx);
+}
+
+//------------------------------------------------------------------------------
+// 다른 thread에서 cancel : device 요청 대기중, backoff 대기중
+//------------------------------------------------------------------------------
+static void test_cancel (void)
+{
+    struct cancel_arg arg;
+    char data [EFUSE_UUID_SIZE +1];
+    pthread_t thread;
+    long long t0;
+
+    // device 요청 대기중 (deadline보다 먼저 cancel)
+    arg.ctx      = ctx_create (5000, 0, 0, 0);
+    arg.delay_ms = 50;
+    sim_clear ();
+    efuse_sim_set_latency (Sim, eSIM_OP_PREAD, HANG_MS * 1000L);
+    t0 = test_now_ms ();
+    test_check_int (pthread_create (&thread, NULL, cancel_thread, &arg), 0);
+    test_check_int (efuse_ctx_control (arg.ctx, data, EFUSE_READ), 0);
+    t0 = test_now_ms () - t0;
+    pthread_join (thread, NULL);
+    test_check_int (efuse_ctx_last_error (arg.ctx), eEFUSE_ERR_CANCELED);
+    test_check (t0 < HANG_MS);
+
+    // cancel 유지중에는 바로 canceled
+    efuse_sim_set_latency (Sim, eSIM_OP_PREAD, 0);
+    test_check_int (efuse_ctx_control (arg.ctx, data, EFUSE_READ), 0);
+    test_check_int (efuse_ctx_last_error (arg.ctx), eEFUSE_ERR_CANCELED);
+
+    // cancel 해제, abandoned 요청 종료 후 정상
+    efuse_ctx_cancel (arg.ctx, 0);
+    test_sleep_ms (HANG_MS);
+    test_check_int (efuse_ctx_control (arg.ctx, data, EFUSE_READ), 1);
+    test_check_int (efuse_ctx_last_error (arg.ctx), eEFUSE_OK);
+    efuse_ctx_close (arg.ctx);
+
+    // backoff 대기중 (timeout 없음, guard 사용 안함)
+    arg.ctx      = ctx_create (0, 5, 1000, 0);
+    arg.delay_ms = 50;
+    sim_clear ();
+    efuse_sim_set_fault (Sim, eSIM_OP_PREAD, -1, EIO);
+    t0 = test_now_ms ();
+    test_check_int (pthread_create (&thread, NULL, cancel_thread, &arg), 0);
+    test_check_int (efuse_ctx_control (arg.ctx, data, EFUSE_READ), 0);
+    t0 = test_now_ms () - t0;
+    pthread_join (thread, NULL);
+    test_check_int (efuse_ctx_last_error (arg.ctx), eEFUSE_ERR_CANCELED);
+    test_check (t0 < 500);
+    test_check_int (efuse_sim_get_count (Sim, eSIM_OP_PREAD), 1);
+    efuse_ctx_cancel (arg.ctx, 0);
+    efuse_ctx_close (arg.ctx);
+}
+
+//------------------------------------------------------------------------------
+// write/verify 중 fdatasync hang : timeout, force_ro는 바로 lock 복구
+//------------------------------------------------------------------------------
+static void test_sync_hang (void)
+{
+    const char *rw_control = efuse_board_info (eBOARD_ID_M1S)->rw_control;
+    const char *uuid = "dcbaa404-91bd-4a63-b5f1-001e06530002";
+    efuse_ctx *ctx = ctx_create (TIMEOUT_MS, 3, 1, 0);
+    char data [EFUSE_UUID_SIZE +1];
+    long long t0;
+
+    sim_clear ();
+    efuse_sim_set_latency (Sim, eSIM_OP_SYNC, HANG_MS * 1000L);
+    t0 = test_now_ms ();
+    test_check_int (efuse_ctx_write_verify (ctx, uuid, data), eEFUSE_WV_ERROR);
+    t0 = test_now_ms () - t0;
+    test_check_int (efuse_ctx_last_error (ctx), eEFUSE_ERR_TIMEOUT);
+    test_check (t0 < HANG_MS);
+    // fdatasync가 끝나기 전에 lock 복구
+    test_check_int (test_force_ro (Sim, rw_control), '1');
+
+    // fdatasync 진행중 : busy, force_ro는 lock 유지
+    efuse_sim_set_latency (Sim, eSIM_OP_SYNC, 0);
+    test_check_int (efuse_ctx_write_verify (ctx, uuid, data), eEFUSE_WV_ERROR);
+    test_check_int (efuse_ctx_last_error (ctx), eEFUSE_ERR_BUSY);
+    test_check_int (test_force_ro (Sim, rw_control), '1');
+
+    // 복구 후 write/verify (이전 write는 이미 적용되어 unchanged)
+    test_sleep_ms (HANG_MS);
+    test_check_int (efuse_ctx_write_verify (ctx, uuid, data), eEFUSE_WV_UNCHANGED);
+    test_check_int (efuse_ctx_last_error (ctx), eEFUSE_OK);
+    test_check (!strcasecmp (data, uuid));
+    test_check_int (efuse_ctx_write_verify (ctx, Uuid, data), eEFUSE_WV_WRITTEN);
+    test_check_int (efuse_ctx_last_error (ctx), eEFUSE_OK);
+    test_check_int (test_force_ro (Sim, rw_control), '1');
+    efuse_ctx_close (ctx);
+}
+
+//------------------------------------------------------------------------------
+int main (void)
+{
+    efuse_ctx *ctx;
+
+    Sim = efuse_sim_create (NULL);
+
+    // 기본 data write
+    ctx = ctx_create (0, 0, 0, 0);
+    test_check_int (efuse_ctx_write_verify (ctx, Uuid, NULL), eEFUSE_WV_WRITTEN);
+    efuse_ctx_close (ctx);
+
+    test_transient ();
+    test_exhaust   ();
+    test_hang      ();
+    test_cancel    ();
+    test_sync_hang ();
+
+    efuse_sim_destroy (Sim);
+    return test_result ("retry");
+}
+
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
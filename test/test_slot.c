@@ -0,0 +1,135 @@
+//------------------------------------------------------------------------------
+/**
+ * @file test_slot.c
+ * @author charles-park (charles.park@hardkernel.com)
+ * @brief uuid flash slot write/erase test (IOC_DUMP 결과가 실제 flash와 다른 경우).
+ * @version 0.2
+ * @date 2023-09-22
+ *
+ * @package apt install cups cups-bsd
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#include <strings.h>
+
+#include "lib_efuse.h"
+#include "lib_efuse_sim.h"
+#include "test.h"
+
+//------------------------------------------------------------------------------
+#define WRITE_CNT   3
+
+static efuse_sim *Sim;
+
+//------------------------------------------------------------------------------
+static void uuid_make (char *uuid, int size, int i)
+{
+    snprintf (uuid, size, "dcbaa404-91bd-4a63-b5f1-001e064a%04x", i + 1);
+}
+
+//------------------------------------------------------------------------------
+// 실제 flash 기준 slot 상태 (dump 응답을 flash 그대로로 바꾼 후 scan)
+//------------------------------------------------------------------------------
+static int flash_scan (efuse_ctx *ctx, struct efuse_slot_info *info, int dump_mode)
+{
+    int ret;
+
+    efuse_sim_set_dump (Sim, eSIM_DUMP_FLASH);
+    ret = efuse_ctx_slot_scan (ctx, info);
+    efuse_sim_set_dump (Sim, dump_mode);
+    return ret;
+}
+
+//------------------------------------------------------------------------------
+// dump_mode의 IOC_DUMP 응답으로 새 부품에 WRITE_CNT번 write.
+// 항상 마지막 uuid 1개만 valid, 이전 slot은 erase 되어야 함.
+//------------------------------------------------------------------------------
+static void test_write (int dump_mode)
+{
+    struct efuse_slot_info info;
+    char uuid [EFUSE_UUID_SIZE +1], data [EFUSE_UUID_SIZE +1];
+    efuse_ctx *ctx = efuse_ctx_open (eBOARD_ID_C4);
+    int i, s;
+
+    efuse_sim_format (Sim);
+    efuse_sim_set_dump (Sim, dump_mode);
+    test_check (efuse_sim_attach (Sim, ctx));
+
+    for (i = 0; i < WRITE_CNT; i++) {
+        uuid_make (uuid, sizeof(uuid), i);
+        test_check_int (efuse_ctx_control (ctx, uuid, EFUSE_WRITE), 1);
+        test_check_int (efuse_ctx_last_error (ctx), eEFUSE_OK);
+
+        test_check (flash_scan (ctx, &info, dump_mode));
+        test_check_int (info.active,    i);
+        test_check_int (info.next_free, i + 1);
+        test_check_int (info.remain,    UUID_SLOT_CNT - i - 1);
+        for (s = 0; s < i; s++)
+            test_check_int (info.state[s], eSLOT_ERASED);
+
+        memset (data, 0, sizeof(data));
+        test_check_int (efuse_ctx_control (ctx, data, EFUSE_READ), 1);
+        test_check (!strcasecmp (data, uuid));
+    }
+    efuse_ctx_close (ctx);
+}
+
+//------------------------------------------------------------------------------
+// flash 전체 사용 후 write : dump가 있으면 NOSPACE, dump를 믿을 수 없으면 IO
+//------------------------------------------------------------------------------
+static void test_full (int dump_mode, int error)
+{
+    struct efuse_slot_info info;
+    char uuid [EFUSE_UUID_SIZE +1];
+    efuse_ctx *ctx = efuse_ctx_open (eBOARD_ID_C4);
+    int i, ok;
+
+    efuse_sim_format (Sim);
+    efuse_sim_set_dump (Sim, dump_mode);
+    test_check (efuse_sim_attach (Sim, ctx));
+
+    for (i = 0, ok = 1; (i < UUID_SLOT_CNT) && ok; i++) {
+        uuid_make (uuid, sizeof(uuid), i);
+        ok = efuse_ctx_control (ctx, uuid, EFUSE_WRITE);
+    }
+    test_check_int (ok, 1);
+    test_check (flash_scan (ctx, &info, dump_mode));
+    test_check_int (info.active,    UUID_SLOT_CNT - 1);
+    test_check_int (info.next_free, -1);
+
+    uuid_make (uuid, sizeof(uuid), i);
+    test_check_int (efuse_ctx_control (ctx, uuid, EFUSE_WRITE), 0);
+    test_check_int (efuse_ctx_last_error (ctx), error);
+
+    // 마지막 uuid는 유지
+    test_check (flash_scan (ctx, &info, dump_mode));
+    test_check_int (info.active, UUID_SLOT_CNT - 1);
+    efuse_ctx_close (ctx);
+}
+
+//------------------------------------------------------------------------------
+int main (void)
+{
+    Sim = efuse_sim_create (NULL);
+
+    // dump 정상, dump 미지원(ENOTTY)
+    test_write (eSIM_DUMP_FLASH);
+    test_write (eSIM_DUMP_NONE);
+    // dump 성공 응답 + buffer 미기록 (모두 empty로 보임)
+    test_write (eSIM_DUMP_ZERO);
+    // dump가 모든 slot을 erase 상태로 응답 (next_free 없음)
+    test_write (eSIM_DUMP_ERASED);
+
+    test_full (eSIM_DUMP_FLASH, eEFUSE_ERR_NOSPACE);
+    test_full (eSIM_DUMP_ZERO,  eEFUSE_ERR_IO);
+    test_full (eSIM_DUMP_NONE,  eEFUSE_ERR_IO);
+
+    efuse_sim_destroy (Sim);
+    return test_result ("slot");
+}
+
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
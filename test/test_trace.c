@@ -0,0 +1,207 @@
+//------------------------------------------------------------------------------
+/**
+ * @file test_trace.c
+ * @author charles-park (charles.park@hardkernel.com)
+ * @brief device operation trace test (simulation device에서 기록 후 replay).
+ * @version 0.2
+ * @date 2023-09-22
+ *
+ * @package apt install cups cups-bsd
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#include <errno.h>
+#include <pthread.h>
+
+#include "lib_efuse.h"
+#include "lib_efuse_board.h"
+#include "lib_efuse_sim.h"
+#include "lib_efuse_trace.h"
+#include "test.h"
+
+//------------------------------------------------------------------------------
+#define THREAD_CNT  3
+// c4 uuid flash는 write 마다 slot 1개 사용 (loop 1회 = 2개, UUID_SLOT_CNT 이내)
+#define LOOP_CNT    2
+
+static const int BoardId [THREAD_CNT] = { eBOARD_ID_M1S, eBOARD_ID_M2, eBOARD_ID_C4 };
+
+static char Dir  [64];
+static char Path [128];
+static efuse_sim   *Sim;
+static efuse_trace *Trace;
+
+// 기록시 simulation device operation 수 (replay 결과와 비교)
+static long RecCnt [eSIM_OP_END];
+
+//------------------------------------------------------------------------------
+static void uuid_make (char *uuid, int size, int board_id, int i)
+{
+    unsigned long long mac_start;
+    int mac_cnt;
+
+    efuse_get_mac_range (board_id, &mac_start, &mac_cnt);
+    snprintf (uuid, size, "dcbaa404-91bd-4a63-b5f1-%012llx", mac_start + i);
+}
+
+//------------------------------------------------------------------------------
+static efuse_ctx *ctx_open (int board_id)
+{
+    efuse_ctx *ctx = efuse_ctx_open (board_id);
+
+    test_check (ctx != NULL);
+    test_check (efuse_sim_attach (Sim, ctx));
+    test_check (efuse_trace_attach (Trace, ctx));
+    return ctx;
+}
+
+//------------------------------------------------------------------------------
+// board 1개 : write, read, write_verify (unchanged/written), erase 반복
+//------------------------------------------------------------------------------
+static void *board_thread (void *arg)
+{
+    int board_id = *(const int *)arg, i, ok = 1;
+    char uuid [EFUSE_UUID_SIZE +1], data [EFUSE_UUID_SIZE +1];
+    efuse_ctx *ctx = ctx_open (board_id);
+
+    for (i = 0; i < LOOP_CNT; i++) {
+        uuid_make (uuid, sizeof(uuid), board_id, i);
+        ok &= efuse_ctx_control (ctx, uuid, EFUSE_WRITE);
+        ok &= efuse_ctx_control (ctx, data, EFUSE_READ);
+        ok &= (efuse_ctx_write_verify (ctx, uuid, data) == eEFUSE_WV_UNCHANGED);
+        uuid_make (uuid, sizeof(uuid), board_id, i + 100);
+        ok &= (efuse_ctx_write_verify (ctx, uuid, data) == eEFUSE_WV_WRITTEN);
+        ok &= efuse_ctx_control (ctx, data, EFUSE_ERASE);
+    }
+    efuse_ctx_close (ctx);
+    return (void *)(long)ok;
+}
+
+//------------------------------------------------------------------------------
+// 여러 board를 동시에 기록 후 replay : 결과 (성공/실패) 모두 같음
+//------------------------------------------------------------------------------
+static void test_replay (void)
+{
+    struct efuse_trace_report r;
+    pthread_t thread [THREAD_CNT];
+    const struct efuse_board *b;
+    void *ok;
+    long total;
+    int i;
+
+    Sim = efuse_sim_create (NULL);
+    for (i = 0; i < THREAD_CNT; i++) {
+        b = efuse_board_info (BoardId[i]);
+        test_check (efuse_sim_add_device (Sim, efuse_sim_dev_type (BoardId[i]),
+                                          b->rw_control, b->rw_file));
+    }
+    test_check ((Trace = efuse_trace_open (Path)) != NULL);
+
+    for (i = 0; i < THREAD_CNT; i++)
+        test_check_int (pthread_create (&thread[i], NULL, board_thread, (void *)&BoardId[i]), 0);
+    for (i = 0; i < THREAD_CNT; i++) {
+        pthread_join (thread[i], &ok);
+        test_check_int ((int)(long)ok, 1);
+    }
+    test_check_int (efuse_trace_close (Trace), 1);
+    for (i = 0; i < eSIM_OP_END; i++)
+        RecCnt[i] = efuse_sim_get_count (Sim, i);
+    efuse_sim_destroy (Sim);
+
+    test_check_int (efuse_trace_replay (Path, 0, &r), 1);
+    test_check_int (r.mismatch, 0);
+    test_check_int (r.skipped,  0);
+    for (i = 0, total = 0; i < eSIM_OP_END; i++) {
+        test_check_int (r.op_cnt[i], RecCnt[i]);
+        total += r.op_cnt[i];
+    }
+    test_check (r.op_cnt[eSIM_OP_PWRITE] > 0);
+    test_check (r.op_cnt[eSIM_OP_IOCTL]  > 0);
+    test_check (r.rec_span_ns > 0);
+    test_check (total > THREAD_CNT * LOOP_CNT * 4);
+}
+
+//------------------------------------------------------------------------------
+// 기록시 device error : replay (정상 device)에서는 성공하므로 mismatch
+//------------------------------------------------------------------------------
+static void test_mismatch (void)
+{
+    struct efuse_trace_report r;
+    const struct efuse_board *b = efuse_board_info (eBOARD_ID_M1S);
+    char uuid [EFUSE_UUID_SIZE +1], data [EFUSE_UUID_SIZE +1];
+    efuse_ctx *ctx;
+
+    Sim = efuse_sim_create (NULL);
+    test_check (efuse_sim_add_device (Sim, eSIM_DEV_EMMC, b->rw_control, b->rw_file));
+    test_check ((Trace = efuse_trace_open (Path)) != NULL);
+    ctx = ctx_open (eBOARD_ID_M1S);
+
+    uuid_make (uuid, sizeof(uuid), eBOARD_ID_M1S, 1);
+    efuse_sim_set_fault (Sim, eSIM_OP_PREAD, 1, EIO);
+    test_check_int (efuse_ctx_control (ctx, data, EFUSE_READ), 0);
+    test_check_int (efuse_ctx_control (ctx, uuid, EFUSE_WRITE), 1);
+    efuse_ctx_close (ctx);
+    test_check_int (efuse_trace_close (Trace), 1);
+    efuse_sim_destroy (Sim);
+
+    test_check_int (efuse_trace_replay (Path, 0, &r), 1);
+    test_check_int (r.mismatch, 1);
+    test_check_int (r.skipped,  0);
+}
+
+//------------------------------------------------------------------------------
+// speed 1.0 : 기록된 시작 간격 재현 (simulation latency가 replay에는 없음)
+//------------------------------------------------------------------------------
+static void test_speed (void)
+{
+    struct efuse_trace_report r;
+    const struct efuse_board *b = efuse_board_info (eBOARD_ID_C5);
+    char uuid [EFUSE_UUID_SIZE +1];
+    efuse_ctx *ctx;
+    int i;
+
+    Sim = efuse_sim_create (NULL);
+    test_check (efuse_sim_add_device (Sim, eSIM_DEV_SYSFS, b->rw_control, b->rw_file));
+    efuse_sim_set_latency (Sim, eSIM_OP_PWRITE, 10000);
+    test_check ((Trace = efuse_trace_open (Path)) != NULL);
+    ctx = ctx_open (eBOARD_ID_C5);
+    for (i = 0; i < 3; i++) {
+        uuid_make (uuid, sizeof(uuid), eBOARD_ID_C5, i);
+        test_check_int (efuse_ctx_control (ctx, uuid, EFUSE_WRITE), 1);
+    }
+    efuse_ctx_close (ctx);
+    test_check_int (efuse_trace_close (Trace), 1);
+    efuse_sim_destroy (Sim);
+
+    test_check_int (efuse_trace_replay (Path, 1.0, &r), 1);
+    test_check_int (r.mismatch, 0);
+    test_check (r.rec_max_ns[eSIM_OP_PWRITE]  >= 10000000LL);
+    test_check (r.play_max_ns[eSIM_OP_PWRITE] <  r.rec_max_ns[eSIM_OP_PWRITE]);
+    // 마지막 operation 시작 시간까지는 기록과 같은 간격
+    test_check (r.play_span_ns >= 20000000LL);
+
+    test_check_int (efuse_trace_replay ("/nonexistent/efuse.trace", 0, &r), 0);
+}
+
+//------------------------------------------------------------------------------
+int main (void)
+{
+    if (!test_tmpdir (Dir, sizeof(Dir))) {
+        printf ("error, test directory create.\n");
+        return 1;
+    }
+    snprintf (Path, sizeof(Path), "%s/efuse.trace", Dir);
+
+    test_replay ();
+    test_mismatch ();
+    test_speed ();
+
+    test_rmdir (Dir);
+    return test_result ("trace");
+}
+
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
@@ -0,0 +1,153 @@
+//------------------------------------------------------------------------------
+/**
+ * @file test_uuid.c
+ * @author charles-park (charles.park@hardkernel.com)
+ * @brief write용 uuid record 일괄 생성 test (efuse_uuid_generate, efuse_alloc_generate).
+ * @version 0.2
+ * @date 2023-09-22
+ *
+ * @package apt install cups cups-bsd
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#include "lib_efuse.h"
+#include "lib_efuse_alloc.h"
+#include "lib_efuse_audit.h"
+#include "test.h"
+
+//------------------------------------------------------------------------------
+#define REC_SIZE    (EFUSE_UUID_SIZE + 1)
+#define GEN_MAX     1000
+
+static char Dir [64];
+static unsigned long long MacStart;
+static int MacCnt;
+
+static unsigned long long Macs [GEN_MAX];
+static char Out [GEN_MAX * REC_SIZE + 1];
+
+//------------------------------------------------------------------------------
+// record 1개 확인 : 형식, v4/variant, mac, board 분류. return : 1 = 정상
+//------------------------------------------------------------------------------
+static int record_check (const char *rec, unsigned long long mac, int board_id)
+{
+    struct efuse_uuid bin;
+
+    if ((rec[EFUSE_UUID_SIZE] != 0) || !efuse_uuid_parse (rec, &bin))
+        return 0;
+    if ((rec[14] != '4') || !strchr ("89AB", rec[19]))
+        return 0;
+    return (efuse_uuid_mac (&bin) == mac) && (efuse_audit_classify (rec) == board_id);
+}
+
+//------------------------------------------------------------------------------
+// batch 크기별 (getrandom 256 byte 이상 포함) 생성, random 영역 중복 없음
+//------------------------------------------------------------------------------
+static void test_generate (void)
+{
+    int cnt [] = { 1, 7, 26, GEN_MAX }, i, n, ok, dup;
+
+    for (i = 0; i < GEN_MAX; i++)
+        Macs[i] = MacStart + MacCnt - GEN_MAX + i;
+
+    for (n = 0; n < (int)(sizeof(cnt) / sizeof(cnt[0])); n++) {
+        memset (Out, 0x5A, sizeof(Out));
+        test_check_int (efuse_uuid_generate (eBOARD_ID_M1S, Macs, cnt[n], Out,
+                                             cnt[n] * REC_SIZE), cnt[n]);
+        for (i = 0, ok = 0; i < cnt[n]; i++)
+            ok += record_check (&Out[i * REC_SIZE], Macs[i], eBOARD_ID_M1S);
+        test_check_int (ok, cnt[n]);
+        // out_size 밖은 사용하지 않음
+        test_check_int (Out[cnt[n] * REC_SIZE], 0x5A);
+    }
+
+    // random 부분 (앞 23 문자) 중복 없음
+    for (i = 0, dup = 0; i < GEN_MAX; i++)
+        for (n = i + 1; n < GEN_MAX; n++)
+            dup += !strncmp (&Out[i * REC_SIZE], &Out[n * REC_SIZE], 23);
+    test_check_int (dup, 0);
+}
+
+//------------------------------------------------------------------------------
+// error : buffer 부족, board mac 범위 밖 (random 사용 전 거부, out 변경 없음)
+//------------------------------------------------------------------------------
+static void test_generate_error (void)
+{
+    int i, changed;
+
+    Macs[0] = MacStart;
+    Macs[1] = MacStart + MacCnt;
+    memset (Out, 0x5A, sizeof(Out));
+    test_check_int (efuse_uuid_generate (eBOARD_ID_M1S, Macs, 2, Out, sizeof(Out)), 0);
+    test_check_int (efuse_uuid_generate (eBOARD_ID_M2,  Macs, 1, Out, sizeof(Out)), 0);
+    test_check_int (efuse_uuid_generate (eBOARD_ID_M1S, Macs, 1, Out, REC_SIZE - 1), 0);
+    test_check_int (efuse_uuid_generate (eBOARD_ID_M1S, Macs, 0, Out, sizeof(Out)), 0);
+    test_check_int (efuse_uuid_generate (eBOARD_ID_END, Macs, 1, Out, sizeof(Out)), 0);
+    test_check_int (efuse_uuid_generate (eBOARD_ID_M1S, NULL, 1, Out, sizeof(Out)), 0);
+    for (i = 0, changed = 0; i < (int)sizeof(Out); i++)
+        changed += (Out[i] != 0x5A);
+    test_check_int (changed, 0);
+}
+
+//------------------------------------------------------------------------------
+// reserve + 생성. buffer 부족시 reserve 안함, mac 범위 끝에서는 남은 개수만 생성.
+//------------------------------------------------------------------------------
+static void test_alloc (void)
+{
+    struct efuse_alloc_stat stat;
+    efuse_alloc *alloc;
+    char path [128];
+    int i, ok;
+
+    snprintf (path, sizeof(path), "%s/m1s.map", Dir);
+    test_check ((alloc = efuse_alloc_open (path, eBOARD_ID_M1S)) != NULL);
+
+    test_check_int (efuse_alloc_generate (alloc, 100, Macs, Out, 100 * REC_SIZE), 100);
+    for (i = 0, ok = 0; i < 100; i++)
+        ok += record_check (&Out[i * REC_SIZE], Macs[i], eBOARD_ID_M1S) &&
+              (Macs[i] == MacStart + i);
+    test_check_int (ok, 100);
+    test_check (efuse_alloc_stat (alloc, &stat));
+    test_check_int (stat.reserved_cnt, 100);
+
+    // buffer 부족 : reserve 하지 않음
+    test_check_int (efuse_alloc_generate (alloc, 10, Macs, Out, 10 * REC_SIZE - 1), 0);
+    test_check (efuse_alloc_stat (alloc, &stat));
+    test_check_int (stat.reserved_cnt, 100);
+
+    // 남은 mac이 cnt 보다 적은 경우
+    while (efuse_alloc_reserve_batch (alloc, Macs, GEN_MAX) == GEN_MAX)
+        ;
+    for (i = 0; i < 5; i++)
+        test_check_int (efuse_alloc_release (alloc, MacStart + 200 + i), 1);
+    test_check_int (efuse_alloc_generate (alloc, 10, Macs, Out, 10 * REC_SIZE), 5);
+    for (i = 0, ok = 0; i < 5; i++)
+        ok += record_check (&Out[i * REC_SIZE], Macs[i], eBOARD_ID_M1S) &&
+              (Macs[i] == MacStart + 200 + i);
+    test_check_int (ok, 5);
+    test_check_int (efuse_alloc_generate (alloc, 10, Macs, Out, 10 * REC_SIZE), 0);
+    efuse_alloc_close (alloc);
+}
+
+//------------------------------------------------------------------------------
+int main (void)
+{
+    if (!test_tmpdir (Dir, sizeof(Dir))) {
+        printf ("error, test directory create.\n");
+        return 1;
+    }
+    efuse_get_mac_range (eBOARD_ID_M1S, &MacStart, &MacCnt);
+
+    test_generate ();
+    test_generate_error ();
+    test_alloc ();
+
+    test_rmdir (Dir);
+    return test_result ("uuid");
+}
+
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------